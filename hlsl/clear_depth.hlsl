@@ -0,0 +1,12 @@
+#ifndef __CLEAR_DEPTH__
+#define __CLEAR_DEPTH__
+
+// Covers the bound viewport with a triangle on the far plane,
+// it is used to clear a region of a depth map which can't be cleared by ClearDepthStencilView.
+float4 vs_main(uint vertex_id : SV_VertexID) : SV_POSITION
+{
+	float2 uv = float2((vertex_id << 1) & 2, vertex_id & 2);
+	return float4(uv * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f), 1.0f, 1.0f);
+}
+
+#endif
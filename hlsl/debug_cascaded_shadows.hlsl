@@ -20,7 +20,7 @@ cbuffer Pass_Data : register(b0) {
 	uint mesh_id;
 	uint world_matrix_id;
 	uint pad11;
-	uint pad22;
+	uint first_instance;
 }
 
 struct Vertex_Out {
@@ -34,17 +34,18 @@ struct Vertex_Out {
 StructuredBuffer<Mesh_Instance> mesh_instances : register(t2);
 StructuredBuffer<uint> unified_index_buffer : register(t4);
 StructuredBuffer<Vertex_XNUV> unified_vertex_buffer : register(t5);
+StructuredBuffer<uint> instance_world_matrix_indices : register(t6);
 StructuredBuffer<float4x4> world_matrices : register(t3);
 StructuredBuffer<Light> lights : register(t7);
 
-Vertex_Out vs_main(uint vertex_id : SV_VertexID)
+Vertex_Out vs_main(uint vertex_id : SV_VertexID, uint instance_id : SV_InstanceID)
 {
 	Mesh_Instance mesh_instance = mesh_instances[mesh_id];
 	
 	uint index = unified_index_buffer[mesh_instance.index_offset + vertex_id];
 	Vertex_XNUV vertex = unified_vertex_buffer[mesh_instance.vertex_offset + index];
 
-	float4x4 world_matrix = transpose(world_matrices[world_matrix_id]);
+	float4x4 world_matrix = transpose(world_matrices[instance_world_matrix_indices[first_instance + instance_id]]);
 	
 	Vertex_Out vertex_out;
 	vertex_out.position = mul(float4(vertex.position, 1.0f), mul(world_matrix, mul(view_matrix, perspective_matrix))); 
@@ -6,7 +6,7 @@
 
 cbuffer Pass_Data : register(b0) {
 	uint mesh_idx;
-	uint world_matrix_idx;
+	uint first_instance;
 	uint2 pad30;
 	float4x4 view_projection_matrix;
 }
@@ -14,16 +14,17 @@ cbuffer Pass_Data : register(b0) {
 StructuredBuffer<Mesh_Instance> mesh_instances : register(t2);
 StructuredBuffer<uint> unified_index_buffer : register(t4);
 StructuredBuffer<Vertex_XNUV> unified_vertex_buffer : register(t5);
+StructuredBuffer<uint> instance_world_matrix_indices : register(t6);
 StructuredBuffer<float4x4> world_matrices : register(t3);
 
-float4 vs_main(uint vertex_id : SV_VertexID) : SV_POSITION
+float4 vs_main(uint vertex_id : SV_VertexID, uint instance_id : SV_InstanceID) : SV_POSITION
 {
 	Mesh_Instance mesh_instance = mesh_instances[mesh_idx];
 	
 	uint index = unified_index_buffer[mesh_instance.index_offset + vertex_id];
 	Vertex_XNUV vertex = unified_vertex_buffer[mesh_instance.vertex_offset + index];
 
-	float4x4 world_matrix = transpose(world_matrices[world_matrix_idx]);
+	float4x4 world_matrix = transpose(world_matrices[instance_world_matrix_indices[first_instance + instance_id]]);
 	float4x4 wvp_matrix = mul(world_matrix, view_projection_matrix);
 	return mul(float4(vertex.position, 1.0f), wvp_matrix);
 }
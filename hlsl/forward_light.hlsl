@@ -10,7 +10,7 @@ cbuffer Pass_Data : register(b0) {
 	uint mesh_id;
 	uint world_matrix_id;
 	uint pad11;
-	uint pad22;
+	uint first_instance;
 }
 
 struct Vertex_Out {
@@ -25,15 +25,16 @@ StructuredBuffer<Mesh_Instance> mesh_instances : register(t2);
 StructuredBuffer<float4x4> world_matrices : register(t3);
 StructuredBuffer<uint> unified_index_buffer : register(t4);
 StructuredBuffer<Vertex_XNUV> unified_vertex_buffer : register(t5);
+StructuredBuffer<uint> instance_world_matrix_indices : register(t6);
 
-Vertex_Out vs_main(uint vertex_id : SV_VertexID)
+Vertex_Out vs_main(uint vertex_id : SV_VertexID, uint instance_id : SV_InstanceID)
 {
 	Mesh_Instance mesh_instance = mesh_instances[mesh_id];
 	
 	uint index = unified_index_buffer[mesh_instance.index_offset + vertex_id];
 	Vertex_XNUV vertex = unified_vertex_buffer[mesh_instance.vertex_offset + index];
 
-	float4x4 world_matrix = transpose(world_matrices[world_matrix_id]);
+	float4x4 world_matrix = transpose(world_matrices[instance_world_matrix_indices[first_instance + instance_id]]);
 	
 	Vertex_Out vertex_out;
 	vertex_out.position = mul(float4(vertex.position, 1.0f), mul(world_matrix, mul(view_matrix, perspective_matrix))); 
@@ -45,6 +46,8 @@ Vertex_Out vs_main(uint vertex_id : SV_VertexID)
 }
 
 StructuredBuffer<Light> lights : register(t7);
+StructuredBuffer<Light_Cluster> light_clusters : register(t15);
+StructuredBuffer<uint> light_indices : register(t16);
 
 float2 parallax_mapping(float2 uv, float3 camera_direction, float3x3 TBN_matrix)
 { 
@@ -117,7 +120,8 @@ float4 ps_main(Vertex_Out vertex_out) : SV_Target
 	}
     uint shadow_cascade_index;
     float4 shadow_factor = calculate_shadow_factor(vertex_out.world_position, vertex_out.position.xy, material.normal, shadow_cascade_index);    
-    float3 light_factor = calculate_light(vertex_out.world_position, material, light_count, lights);
+    // The w of SV_POSITION is the view space depth.
+    float3 light_factor = calculate_clustered_light(vertex_out.world_position, vertex_out.position.xy, vertex_out.position.w, material, lights, light_clusters, light_indices);
 
     return float4(light_factor, 1.0f) * shadow_factor;
 }
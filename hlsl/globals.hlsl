@@ -8,7 +8,6 @@
 
 cbuffer Render_2D_Info : register(b4) {
 	float4x4 orthographics_matrix;
-	float4 primitive_color;
 };
 
 cbuffer Frame_Info : register(b5) {
@@ -20,7 +19,11 @@ cbuffer Frame_Info : register(b5) {
 	float3 camera_direction;
 	float far_plane;
 	uint light_count;
-    uint3 pad50;
+	float cluster_depth_scale;
+	float cluster_depth_bias;
+	float pad50;
+	float2 cluster_tile_scale;
+	float2 pad51;
 };
 
 cbuffer Shadow_Info : register(b6) {
@@ -8,6 +8,11 @@
 #define POINT_LIGHT_TYPE 1
 #define DIRECTIONAL_LIGHT_TYPE 2
 
+// Update light_clusters.h if you change the counts.
+#define LIGHT_CLUSTER_X_COUNT 16
+#define LIGHT_CLUSTER_Y_COUNT 9
+#define LIGHT_CLUSTER_Z_COUNT 24
+
 struct Material {
     float3 normal;
     float3 diffuse;
@@ -23,6 +28,11 @@ struct Light {
 	uint light_type;
 };
 
+struct Light_Cluster {
+	uint light_offset;
+	uint light_count;
+};
+
 //float4 calculate_spot_light(Light light, Material material, float3 normal, float3 position)
 //{
 //	float shininess = material.specular.w;
@@ -118,22 +128,46 @@ float3 calculate_directional_light(float3 position, Material material, Light lig
 	return diffuse + specular;
 }
 
+float3 calculate_light(float3 world_position, Material material, Light light)
+{
+	switch (light.light_type) {
+		case SPOT_LIGHT_TYPE:
+			//return calculate_spot_light(light, material, world_position);
+			break;
+		case POINT_LIGHT_TYPE:
+			//return calculate_point_light(light, material, world_position);
+			break;
+		case DIRECTIONAL_LIGHT_TYPE:
+			return calculate_directional_light(world_position, material, light);
+	}
+	return float3(0.0f, 0.0f, 0.0f);
+}
+
 float3 calculate_light(float3 world_position, Material material, uint light_count, StructuredBuffer<Light> lights)
 {
     float3 light_factor = { 0.0f, 0.0f, 0.0f};
     for (uint i = 0; i < light_count; i++) {
-		Light light = lights[i];
-		switch (light.light_type) {
-			case SPOT_LIGHT_TYPE:
-				//light_factor += calculate_spot_light(light, material, world_position);
-				break;
-			case POINT_LIGHT_TYPE:
-				//light_factor += calculate_point_light(light, material, world_position);
-				break;
-			case DIRECTIONAL_LIGHT_TYPE:
-				light_factor += calculate_directional_light(world_position, material, light);
-				break;
-		}
+		light_factor += calculate_light(world_position, material, lights[i]);
+	}
+	return light_factor;
+}
+
+// Tiles are found from the pixel position and slices from the log of the view depth, the same way as Light_Clusters does on the cpu.
+uint get_light_cluster_index(float2 screen_position, float view_depth)
+{
+	uint3 cluster = uint3(0, 0, 0);
+	cluster.xy = min(uint2(screen_position * cluster_tile_scale), uint2(LIGHT_CLUSTER_X_COUNT - 1, LIGHT_CLUSTER_Y_COUNT - 1));
+	cluster.z = uint(clamp(floor(log(max(view_depth, near_plane)) * cluster_depth_scale + cluster_depth_bias), 0.0f, LIGHT_CLUSTER_Z_COUNT - 1));
+	return cluster.x + cluster.y * LIGHT_CLUSTER_X_COUNT + cluster.z * LIGHT_CLUSTER_X_COUNT * LIGHT_CLUSTER_Y_COUNT;
+}
+
+float3 calculate_clustered_light(float3 world_position, float2 screen_position, float view_depth, Material material, StructuredBuffer<Light> lights, StructuredBuffer<Light_Cluster> light_clusters, StructuredBuffer<uint> light_indices)
+{
+	Light_Cluster light_cluster = light_clusters[get_light_cluster_index(screen_position, view_depth)];
+
+	float3 light_factor = { 0.0f, 0.0f, 0.0f };
+	for (uint i = 0; i < light_cluster.light_count; i++) {
+		light_factor += calculate_light(world_position, material, lights[light_indices[light_cluster.light_offset + i]]);
 	}
 	return light_factor;
 }
@@ -5,19 +5,20 @@
 #include "vertex.hlsl"
 
 
-Vertex_XUV_Out vs_main(Vertex_XUV_In vertex)
+Vertex_XUVC_Out vs_main(Vertex_XUVC_In vertex)
 {
-	Vertex_XUV_Out result;
+	Vertex_XUVC_Out result;
 	result.position = mul(float4(vertex.position, 0.0f, 1.0f), orthographics_matrix);
 	result.position.z = 0.0f;
 	result.position.w = 1.0f;
 	result.uv = vertex.uv;
+	result.color = vertex.color;
 	return result;
 }
 
-float4 ps_main(Vertex_XUV_Out pixel) : SV_TARGET
+float4 ps_main(Vertex_XUVC_Out pixel) : SV_TARGET
 {
-	float4 color = primitive_color * texture_map.Sample(point_sampling, pixel.uv);
+	float4 color = pixel.color * texture_map.Sample(point_sampling, pixel.uv);
 	float alpha = texture_map.Sample(point_sampling, pixel.uv).a;
 	if (color.w < 1.0f) {
 		alpha = color.w;
@@ -0,0 +1,15 @@
+#ifndef __RENDER_2D_TEXT__
+#define __RENDER_2D_TEXT__
+
+#include "globals.hlsl"
+#include "vertex.hlsl"
+
+// Vertices are transformed by vs_main of render_2d.hlsl.
+float4 ps_main(Vertex_XUVC_Out pixel) : SV_TARGET
+{
+	// The glyph atlas has one channel, it is coverage of a glyph.
+	float coverage = texture_map.Sample(point_sampling, pixel.uv).r;
+	return float4(pixel.color.rgb, pixel.color.a * coverage);
+}
+
+#endif
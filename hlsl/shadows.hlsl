@@ -16,11 +16,10 @@ struct Cascaded_Shadows_Info {
 
 StructuredBuffer<float4x4> shadow_cascade_view_projection_matrices : register(t8);
 StructuredBuffer<Cascaded_Shadows_Info> cascaded_shadows_info_buffer : register(t9);
+StructuredBuffer<float4> shadow_cascade_atlas_rects : register(t10); // xy is an offset and zw is a scale in the atlas uv space.
 
 float4 calculate_shadow_factor(float3 world_position, float2 screen_position, float3 normal, out uint cascade_index)
 {
-    static const uint shadow_cascade_rows = shadow_atlas_size / shadow_cascade_size;
-    static const uint shadow_cascade_cols = shadow_atlas_size / shadow_cascade_size;
     static const float shadow_atlas_texel_size = 1.0f / (float)shadow_atlas_size;
     
     cascade_index = 0;
@@ -45,11 +44,12 @@ float4 calculate_shadow_factor(float3 world_position, float2 screen_position, fl
             float min = 0.1f;
             float max = 0.9f;
             if (in_range(min, max, cascaded_ndc_coordinates.x) && in_range(min, max, cascaded_ndc_coordinates.y) && in_range(min, max, cascaded_ndc_coordinates.z)) {     
-                uint shadow_cascade_row_index = shadow_cascade_index % shadow_cascade_rows;
-                uint shadow_cascade_col_index = shadow_cascade_index / shadow_cascade_cols;
-                float2 shadow_atlas_ndc_coordinates;
-                shadow_atlas_ndc_coordinates.x = ((cascaded_ndc_coordinates.x * shadow_cascade_size) + (shadow_cascade_size * shadow_cascade_row_index)) / shadow_atlas_size;
-                shadow_atlas_ndc_coordinates.y = ((cascaded_ndc_coordinates.y * shadow_cascade_size) + (shadow_cascade_size * shadow_cascade_col_index)) / shadow_atlas_size;
+                float4 shadow_cascade_atlas_rect = shadow_cascade_atlas_rects[shadow_cascade_index];
+                if (shadow_cascade_atlas_rect.z == 0.0f) {
+                    // The cascade has no casters or no atlas tile.
+                    break;
+                }
+                float2 shadow_atlas_ndc_coordinates = shadow_cascade_atlas_rect.xy + cascaded_ndc_coordinates.xy * shadow_cascade_atlas_rect.zw;
                 
                 float current_depth = position_from_cascade_perspective.z / position_from_cascade_perspective.w;
                 
@@ -21,6 +21,18 @@ struct Vertex_XUV_Out {
     float2 uv       : TEXCOORD;
 };
 
+struct Vertex_XUVC_In {
+    float2 position : POSITION;
+    float2 uv       : TEXCOORD;
+    float4 color    : COLOR;
+};
+
+struct Vertex_XUVC_Out {
+    float4 position : SV_POSITION;
+    float2 uv       : TEXCOORD;
+    float4 color    : COLOR;
+};
+
 struct Vertex_XNUV {
     float3 position;
     float3 normal;
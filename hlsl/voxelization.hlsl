@@ -9,7 +9,7 @@ cbuffer Pass_Data : register(b0) {
 	uint mesh_id;
 	uint world_matrix_id;
 	uint pad11;
-	uint pad22;
+	uint first_instance;
 }
 
 cbuffer Voxelization_Info : register(b1) {
@@ -53,6 +53,7 @@ StructuredBuffer<Mesh_Instance> mesh_instances : register(t2);
 StructuredBuffer<float4x4> world_matrices : register(t3);
 StructuredBuffer<uint> unified_index_buffer : register(t4);
 StructuredBuffer<Vertex_XNUV> unified_vertex_buffer : register(t5);
+StructuredBuffer<uint> instance_world_matrix_indices : register(t6);
 RWStructuredBuffer<Voxel> voxels : register(u1);
 
 static uint pack_RGBA8(float4 value)
@@ -89,13 +90,13 @@ static uint get_view_matrix_index(float3 normal)
     return index;
 }
 
-VS_Output vs_main(uint vertex_id : SV_VertexID)
+VS_Output vs_main(uint vertex_id : SV_VertexID, uint instance_id : SV_InstanceID)
 {
     Mesh_Instance mesh_instance = mesh_instances[mesh_id];
 	uint index = unified_index_buffer[mesh_instance.index_offset + vertex_id];
 	Vertex_XNUV vertex = unified_vertex_buffer[mesh_instance.vertex_offset + index];
 	
-	float4x4 world_matrix = transpose(world_matrices[world_matrix_id]);
+	float4x4 world_matrix = transpose(world_matrices[instance_world_matrix_indices[first_instance + instance_id]]);
 
 	VS_Output output;
 	output.world_position = (float3)mul(float4(vertex.position, 1.0f), world_matrix);
@@ -39,8 +39,10 @@ class Compilation_Params:
 
 shader_files = [
     Shader_File("render_2d.hlsl", Shader_Type.VERTEX_SHADER, Shader_Type.PIXEL_SHADER),
+    Shader_File("render_2d_text.hlsl", Shader_Type.PIXEL_SHADER),
     Shader_File("forward_light.hlsl", Shader_Type.VERTEX_SHADER, Shader_Type.PIXEL_SHADER),
     Shader_File("depth_map.hlsl", Shader_Type.VERTEX_SHADER),
+    Shader_File("clear_depth.hlsl", Shader_Type.VERTEX_SHADER),
     Shader_File("debug_cascaded_shadows.hlsl", Shader_Type.VERTEX_SHADER, Shader_Type.PIXEL_SHADER),
     Shader_File("draw_vertices.hlsl", Shader_Type.VERTEX_SHADER, Shader_Type.PIXEL_SHADER),
     Shader_File("silhouette.hlsl", Shader_Type.VERTEX_SHADER, Shader_Type.PIXEL_SHADER),
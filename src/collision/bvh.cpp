@@ -0,0 +1,394 @@
+#include <assert.h>
+#include <float.h>
+
+#include "bvh.h"
+#include "../libs/math/functions.h"
+
+const u32 BVH_BIN_COUNT = 12;
+const float BVH_TRAVERSAL_COST = 1.0f;
+const float BVH_INTERSECTION_COST = 1.0f;
+
+inline AABB make_empty_AABB()
+{
+	return { Vector3(FLT_MAX, FLT_MAX, FLT_MAX), Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX) };
+}
+
+inline void grow(AABB *aabb, const Vector3 &point)
+{
+	aabb->min.x = math::min(aabb->min.x, point.x);
+	aabb->min.y = math::min(aabb->min.y, point.y);
+	aabb->min.z = math::min(aabb->min.z, point.z);
+	aabb->max.x = math::max(aabb->max.x, point.x);
+	aabb->max.y = math::max(aabb->max.y, point.y);
+	aabb->max.z = math::max(aabb->max.z, point.z);
+}
+
+inline void grow(AABB *aabb, const AABB &other)
+{
+	grow(aabb, other.min);
+	grow(aabb, other.max);
+}
+
+inline float get_surface_area(const AABB &aabb)
+{
+	float x = aabb.max.x - aabb.min.x;
+	float y = aabb.max.y - aabb.min.y;
+	float z = aabb.max.z - aabb.min.z;
+	if ((x < 0.0f) || (y < 0.0f) || (z < 0.0f)) {
+		return 0.0f;
+	}
+	return 2.0f * (x * y + y * z + z * x);
+}
+
+inline float get_axis(const Vector3 &vector, u32 axis)
+{
+	return (axis == 0) ? vector.x : ((axis == 1) ? vector.y : vector.z);
+}
+
+struct Bin {
+	AABB bounds = make_empty_AABB();
+	u32 triangle_count = 0;
+};
+
+struct Build_Context {
+	Array<AABB> triangle_bounds;
+	Array<Vector3> triangle_centroids;
+};
+
+static void update_node_bounds(Mesh_BVH *bvh, Build_Context *context, u32 node_index)
+{
+	BVH_Node *node = &bvh->nodes[node_index];
+	node->bounds = make_empty_AABB();
+	for (u32 i = 0; i < node->triangle_count; i++) {
+		grow(&node->bounds, context->triangle_bounds[bvh->triangles[node->first + i]]);
+	}
+}
+
+static bool find_best_split(Mesh_BVH *bvh, Build_Context *context, BVH_Node *node, u32 *split_axis, float *split_position, float *split_cost)
+{
+	AABB centroid_bounds = make_empty_AABB();
+	for (u32 i = 0; i < node->triangle_count; i++) {
+		grow(&centroid_bounds, context->triangle_centroids[bvh->triangles[node->first + i]]);
+	}
+
+	bool found = false;
+	*split_cost = FLT_MAX;
+
+	for (u32 axis = 0; axis < 3; axis++) {
+		float bounds_min = get_axis(centroid_bounds.min, axis);
+		float bounds_max = get_axis(centroid_bounds.max, axis);
+		if (bounds_min == bounds_max) {
+			continue;
+		}
+
+		Bin bins[BVH_BIN_COUNT];
+		float scale = (float)BVH_BIN_COUNT / (bounds_max - bounds_min);
+		for (u32 i = 0; i < node->triangle_count; i++) {
+			u32 triangle = bvh->triangles[node->first + i];
+			u32 bin_index = math::min(BVH_BIN_COUNT - 1, (u32)((get_axis(context->triangle_centroids[triangle], axis) - bounds_min) * scale));
+			bins[bin_index].triangle_count++;
+			grow(&bins[bin_index].bounds, context->triangle_bounds[triangle]);
+		}
+
+		float left_areas[BVH_BIN_COUNT - 1];
+		float right_areas[BVH_BIN_COUNT - 1];
+		u32 left_counts[BVH_BIN_COUNT - 1];
+		u32 right_counts[BVH_BIN_COUNT - 1];
+
+		AABB left_bounds = make_empty_AABB();
+		AABB right_bounds = make_empty_AABB();
+		u32 left_sum = 0;
+		u32 right_sum = 0;
+		for (u32 i = 0; i < (BVH_BIN_COUNT - 1); i++) {
+			left_sum += bins[i].triangle_count;
+			left_counts[i] = left_sum;
+			grow(&left_bounds, bins[i].bounds);
+			left_areas[i] = get_surface_area(left_bounds);
+
+			right_sum += bins[BVH_BIN_COUNT - 1 - i].triangle_count;
+			right_counts[BVH_BIN_COUNT - 2 - i] = right_sum;
+			grow(&right_bounds, bins[BVH_BIN_COUNT - 1 - i].bounds);
+			right_areas[BVH_BIN_COUNT - 2 - i] = get_surface_area(right_bounds);
+		}
+
+		float bin_width = (bounds_max - bounds_min) / (float)BVH_BIN_COUNT;
+		for (u32 i = 0; i < (BVH_BIN_COUNT - 1); i++) {
+			if ((left_counts[i] == 0) || (right_counts[i] == 0)) {
+				continue;
+			}
+			float cost = left_counts[i] * left_areas[i] + right_counts[i] * right_areas[i];
+			if (cost < *split_cost) {
+				*split_cost = cost;
+				*split_axis = axis;
+				*split_position = bounds_min + bin_width * (float)(i + 1);
+				found = true;
+			}
+		}
+	}
+	return found;
+}
+
+static void subdivide(Mesh_BVH *bvh, Build_Context *context, u32 node_index, u32 depth)
+{
+	BVH_Node *node = &bvh->nodes[node_index];
+	if ((node->triangle_count <= 1) || (depth >= (BVH_MAX_DEPTH - 1))) {
+		return;
+	}
+
+	u32 axis = 0;
+	float split_position = 0.0f;
+	float split_cost = FLT_MAX;
+	bool split_found = find_best_split(bvh, context, node, &axis, &split_position, &split_cost);
+
+	float node_area = get_surface_area(node->bounds);
+	float leaf_cost = BVH_INTERSECTION_COST * (float)node->triangle_count;
+	float cost = BVH_TRAVERSAL_COST + ((node_area > 0.0f) ? (BVH_INTERSECTION_COST * split_cost / node_area) : FLT_MAX);
+
+	if (!split_found || ((cost >= leaf_cost) && (node->triangle_count <= BVH_MAX_LEAF_TRIANGLES))) {
+		return;
+	}
+
+	u32 first = node->first;
+	u32 last = node->first + node->triangle_count - 1;
+	u32 i = first;
+	while (i <= last) {
+		if (get_axis(context->triangle_centroids[bvh->triangles[i]], axis) < split_position) {
+			i++;
+		} else {
+			u32 temp = bvh->triangles[i];
+			bvh->triangles[i] = bvh->triangles[last];
+			bvh->triangles[last] = temp;
+			if (last == 0) {
+				break;
+			}
+			last--;
+		}
+	}
+
+	u32 left_count = i - node->first;
+	if ((left_count == 0) || (left_count == node->triangle_count)) {
+		return;
+	}
+
+	BVH_Node left_child;
+	left_child.first = node->first;
+	left_child.triangle_count = left_count;
+
+	BVH_Node right_child;
+	right_child.first = i;
+	right_child.triangle_count = node->triangle_count - left_count;
+
+	u32 left_child_index = bvh->nodes.push(left_child);
+	u32 right_child_index = bvh->nodes.push(right_child);
+
+	// The push can move nodes in memory.
+	node = &bvh->nodes[node_index];
+	node->first = left_child_index;
+	node->triangle_count = 0;
+
+	update_node_bounds(bvh, context, left_child_index);
+	update_node_bounds(bvh, context, right_child_index);
+
+	subdivide(bvh, context, left_child_index, depth + 1);
+	subdivide(bvh, context, right_child_index, depth + 1);
+}
+
+void Mesh_BVH::free()
+{
+	nodes.clear();
+	triangles.clear();
+}
+
+void Mesh_BVH::build(Vertex_PNTUV *vertices, u32 *indices, u32 index_count)
+{
+	assert(vertices);
+	assert(indices);
+	assert(index_count % 3 == 0);
+
+	free();
+
+	u32 triangle_count = index_count / 3;
+	if (triangle_count == 0) {
+		return;
+	}
+
+	Build_Context context;
+	context.triangle_bounds.reserve(triangle_count);
+	context.triangle_centroids.reserve(triangle_count);
+	triangles.reserve(triangle_count);
+
+	for (u32 i = 0; i < triangle_count; i++) {
+		Vector3 a = vertices[indices[i * 3 + 0]].position;
+		Vector3 b = vertices[indices[i * 3 + 1]].position;
+		Vector3 c = vertices[indices[i * 3 + 2]].position;
+
+		AABB bounds = make_empty_AABB();
+		grow(&bounds, a);
+		grow(&bounds, b);
+		grow(&bounds, c);
+
+		context.triangle_bounds[i] = bounds;
+		context.triangle_centroids[i] = Vector3((bounds.min.x + bounds.max.x) * 0.5f, (bounds.min.y + bounds.max.y) * 0.5f, (bounds.min.z + bounds.max.z) * 0.5f);
+		triangles[i] = i;
+	}
+
+	nodes.resize(triangle_count * 2);
+
+	BVH_Node root;
+	root.first = 0;
+	root.triangle_count = triangle_count;
+	nodes.push(root);
+
+	update_node_bounds(this, &context, 0);
+	subdivide(this, &context, 0, 0);
+}
+
+inline bool detect_intersection(Ray *ray, const Vector3 &inverse_direction, AABB *aabb, float max_distance, float *distance)
+{
+	float tx1 = (aabb->min.x - ray->origin.x) * inverse_direction.x;
+	float tx2 = (aabb->max.x - ray->origin.x) * inverse_direction.x;
+	float tmin = math::min(tx1, tx2);
+	float tmax = math::max(tx1, tx2);
+
+	float ty1 = (aabb->min.y - ray->origin.y) * inverse_direction.y;
+	float ty2 = (aabb->max.y - ray->origin.y) * inverse_direction.y;
+	tmin = math::max(tmin, math::min(ty1, ty2));
+	tmax = math::min(tmax, math::max(ty1, ty2));
+
+	float tz1 = (aabb->min.z - ray->origin.z) * inverse_direction.z;
+	float tz2 = (aabb->max.z - ray->origin.z) * inverse_direction.z;
+	tmin = math::max(tmin, math::min(tz1, tz2));
+	tmax = math::min(tmax, math::max(tz1, tz2));
+
+	if ((tmax >= tmin) && (tmax > 0.0f) && (tmin < max_distance)) {
+		*distance = tmin;
+		return true;
+	}
+	return false;
+}
+
+bool detect_intersection(Ray *ray, const Vector3 &a, const Vector3 &b, const Vector3 &c, float *distance)
+{
+	const float epsilon = 1e-8f;
+
+	Vector3 edge1 = b - a;
+	Vector3 edge2 = c - a;
+	Vector3 p = cross(ray->direction, edge2);
+	float determinant = dot(edge1, p);
+	if (math::abs(determinant) < epsilon) {
+		return false;
+	}
+	float inverse_determinant = 1.0f / determinant;
+
+	Vector3 s = ray->origin - a;
+	float u = dot(s, p) * inverse_determinant;
+	if ((u < 0.0f) || (u > 1.0f)) {
+		return false;
+	}
+
+	Vector3 q = cross(s, edge1);
+	float v = dot(ray->direction, q) * inverse_determinant;
+	if ((v < 0.0f) || ((u + v) > 1.0f)) {
+		return false;
+	}
+
+	float t = dot(edge2, q) * inverse_determinant;
+	if (t > epsilon) {
+		*distance = t;
+		return true;
+	}
+	return false;
+}
+
+bool Mesh_BVH::detect_intersection(Ray *ray, Vertex_PNTUV *vertices, u32 *indices, Ray_Mesh_Intersection *intersection)
+{
+	assert(ray);
+	assert(vertices);
+	assert(indices);
+
+	if (nodes.is_empty()) {
+		return false;
+	}
+
+	Vector3 inverse_direction = Vector3(1.0f / ray->direction.x, 1.0f / ray->direction.y, 1.0f / ray->direction.z);
+
+	float closest_distance = FLT_MAX;
+	u32 closest_triangle = UINT32_MAX;
+
+	float root_distance = 0.0f;
+	if (!::detect_intersection(ray, inverse_direction, &nodes[0].bounds, closest_distance, &root_distance)) {
+		return false;
+	}
+
+	struct Stack_Entry {
+		u32 node_index;
+		float distance;
+	};
+	Stack_Entry stack[BVH_MAX_DEPTH * 2];
+	u32 stack_size = 0;
+	stack[stack_size++] = { 0, root_distance };
+
+	while (stack_size > 0) {
+		Stack_Entry entry = stack[--stack_size];
+		if (entry.distance >= closest_distance) {
+			continue;
+		}
+
+		BVH_Node *node = &nodes[entry.node_index];
+		if (node->is_leaf()) {
+			for (u32 i = 0; i < node->triangle_count; i++) {
+				u32 triangle = triangles[node->first + i];
+				Vector3 &a = vertices[indices[triangle * 3 + 0]].position;
+				Vector3 &b = vertices[indices[triangle * 3 + 1]].position;
+				Vector3 &c = vertices[indices[triangle * 3 + 2]].position;
+
+				float distance = 0.0f;
+				if (::detect_intersection(ray, a, b, c, &distance) && (distance < closest_distance)) {
+					closest_distance = distance;
+					closest_triangle = triangle;
+				}
+			}
+			continue;
+		}
+
+		u32 near_child = node->first;
+		u32 far_child = node->first + 1;
+		float near_distance = 0.0f;
+		float far_distance = 0.0f;
+		bool near_hit = ::detect_intersection(ray, inverse_direction, &nodes[near_child].bounds, closest_distance, &near_distance);
+		bool far_hit = ::detect_intersection(ray, inverse_direction, &nodes[far_child].bounds, closest_distance, &far_distance);
+
+		if (near_hit && far_hit && (far_distance < near_distance)) {
+			u32 temp_child = near_child;
+			near_child = far_child;
+			far_child = temp_child;
+			float temp_distance = near_distance;
+			near_distance = far_distance;
+			far_distance = temp_distance;
+		} else if (!near_hit && far_hit) {
+			near_child = far_child;
+			near_distance = far_distance;
+			near_hit = true;
+			far_hit = false;
+		}
+
+		// The far child is pushed first so the near one is visited first.
+		if (far_hit) {
+			assert(stack_size < ARRAY_SIZE(stack));
+			stack[stack_size++] = { far_child, far_distance };
+		}
+		if (near_hit) {
+			assert(stack_size < ARRAY_SIZE(stack));
+			stack[stack_size++] = { near_child, near_distance };
+		}
+	}
+
+	if (closest_triangle != UINT32_MAX) {
+		if (intersection) {
+			intersection->triangle_index = closest_triangle;
+			intersection->distance = closest_distance;
+		}
+		return true;
+	}
+	return false;
+}
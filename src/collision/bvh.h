@@ -0,0 +1,53 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "collision.h"
+#include "../render/vertices.h"
+#include "../libs/number_types.h"
+#include "../libs/math/structures.h"
+#include "../libs/structures/array.h"
+
+const u32 BVH_MAX_LEAF_TRIANGLES = 4;
+const u32 BVH_MAX_DEPTH = 64;
+
+struct BVH_Node {
+	AABB bounds;
+	// If the node is a leaf, first is an index of the first triangle in Mesh_BVH::triangles.
+	// Otherwise first is an index of the left child and the right child is always placed right after it.
+	u32 first = 0;
+	u32 triangle_count = 0;
+
+	bool is_leaf();
+};
+
+inline bool BVH_Node::is_leaf()
+{
+	return triangle_count > 0;
+}
+
+struct Ray_Mesh_Intersection {
+	u32 triangle_index = UINT32_MAX;
+	float distance = 0.0f; // A ray parameter, an intersection point is ray.origin + ray.direction * distance.
+};
+
+// Bounding volume hierarchy over triangles of one mesh, it's built in the mesh object space with the binned SAH.
+struct Mesh_BVH {
+	Array<BVH_Node> nodes;
+	Array<u32> triangles;
+
+	void free();
+	void build(Vertex_PNTUV *vertices, u32 *indices, u32 index_count);
+
+	bool is_empty();
+	// A ray direction is not normalized, so a ray transformed from world space gives the same distance.
+	bool detect_intersection(Ray *ray, Vertex_PNTUV *vertices, u32 *indices, Ray_Mesh_Intersection *intersection = NULL);
+};
+
+inline bool Mesh_BVH::is_empty()
+{
+	return nodes.is_empty();
+}
+
+bool detect_intersection(Ray *ray, const Vector3 &a, const Vector3 &b, const Vector3 &c, float *distance);
+
+#endif
@@ -20,15 +20,107 @@ inline void init_entity(Entity *entity, Entity_Type type, const Vector3 &scaling
 	entity->position = position;
 }
 
+void Entity_Slot_Map::clear()
+{
+	slots.clear();
+	free_slots.clear();
+}
+
+u32 Entity_Slot_Map::allocate_slot(u32 entity_index)
+{
+	u32 slot_index = 0;
+	if (!free_slots.is_empty()) {
+		slot_index = free_slots.pop();
+	} else {
+		assert(slots.count < ENTITY_INVALID_INDEX);
+		slot_index = slots.push(Slot());
+	}
+	slots[slot_index].entity_index = entity_index;
+	return slot_index;
+}
+
+void Entity_Slot_Map::free_slot(u32 slot_index)
+{
+	Slot *slot = &slots[slot_index];
+	slot->entity_index = ENTITY_INVALID_INDEX;
+	slot->transform_changed = false;
+	slot->generation = (slot->generation + 1) & ENTITY_GENERATION_MASK;
+	free_slots.push(slot_index);
+}
+
+bool Entity_Slot_Map::get_entity_index(Entity_Id entity_id, u32 *entity_index)
+{
+	assert(entity_index);
+
+	if (entity_id.index >= slots.count) {
+		return false;
+	}
+	Slot *slot = &slots[entity_id.index];
+	if ((slot->generation != entity_id.generation) || (slot->entity_index == ENTITY_INVALID_INDEX)) {
+		return false;
+	}
+	*entity_index = slot->entity_index;
+	return true;
+}
+
+template <typename T>
+inline Entity_Id add_entity(T *entity, Array<T> &entity_list, Entity_Slot_Map *slot_map)
+{
+	entity->idx = slot_map->allocate_slot(entity_list.count);
+	entity->generation = slot_map->slots[entity->idx].generation;
+	entity_list.push(*entity);
+	return get_entity_id(entity);
+}
+
+template <typename T>
+inline T *find_entity(Entity_Id entity_id, Array<T> &entity_list, Entity_Slot_Map *slot_map)
+{
+	u32 entity_index;
+	if (slot_map->get_entity_index(entity_id, &entity_index)) {
+		return &entity_list[entity_index];
+	}
+	return NULL;
+}
+
+template <typename T>
+inline bool delete_entity(Entity_Id entity_id, Array<T> &entity_list, Entity_Slot_Map *slot_map)
+{
+	u32 entity_index;
+	if (!slot_map->get_entity_index(entity_id, &entity_index)) {
+		return false;
+	}
+	entity_list.swap_remove(entity_index);
+	if (entity_index < entity_list.count) {
+		slot_map->slots[entity_list[entity_index].idx].entity_index = entity_index;
+	}
+	slot_map->free_slot(entity_id.index);
+	return true;
+}
+
+Entity_Slot_Map *Game_World::get_slot_map(Entity_Type entity_type)
+{
+	switch (entity_type) {
+		case ENTITY_TYPE_ENTITY:
+			return &entity_slots;
+		case ENTITY_TYPE_LIGHT:
+			return &light_slots;
+		case ENTITY_TYPE_GEOMETRY:
+			return &geometry_entity_slots;
+		case ENTITY_TYPE_CAMERA:
+			return &camera_slots;
+	}
+	return NULL;
+}
+
 Entity *Game_World::get_entity(Entity_Id entity_id)
 {
 	switch (entity_id.type) {
 		case ENTITY_TYPE_ENTITY:
-			return &entities[entity_id.index];
+			return find_entity(entity_id, entities, &entity_slots);
 		case ENTITY_TYPE_LIGHT:
-			return &lights[entity_id.index];
+			return find_entity(entity_id, lights, &light_slots);
 		case ENTITY_TYPE_GEOMETRY:
-			return &geometry_entities[entity_id.index];
+			return find_entity(entity_id, geometry_entities, &geometry_entity_slots);
 		case ENTITY_TYPE_CAMERA:
 			return get_camera(entity_id);
 	}
@@ -37,8 +129,11 @@ Entity *Game_World::get_entity(Entity_Id entity_id)
 
 Camera *Game_World::get_camera(Entity_Id entity_id)
 {
-	if ((entity_id.type == ENTITY_TYPE_CAMERA) && (entity_id.index < cameras.count)) {
-		return &cameras[entity_id.index];
+	if (entity_id.type == ENTITY_TYPE_CAMERA) {
+		Camera *camera = find_entity(entity_id, cameras, &camera_slots);
+		if (camera) {
+			return camera;
+		}
 	}
 	print("Game_World::get_camera: Failed to get a camera. The entity id not valied.");
 	return NULL;
@@ -48,18 +143,14 @@ Entity_Id Game_World::make_entity(const Vector3 &position)
 {
 	Entity entity;
 	init_entity(&entity, ENTITY_TYPE_ENTITY, position);
-	entity.idx = entities.count;
-	entities.push(entity);
-	return get_entity_id(&entity);
+	return add_entity(&entity, entities, &entity_slots);
 }
 
 Entity_Id Game_World::make_entity(const Vector3 &scaling, const Vector3 &rotation, const Vector3 &position)
 {
 	Entity entity;
 	init_entity(&entity, ENTITY_TYPE_ENTITY, scaling, rotation, position);
-	entity.idx = entities.count;
-	entities.push(entity);
-	return get_entity_id(&entity);
+	return add_entity(&entity, entities, &entity_slots);
 }
 
 Entity_Id Game_World::make_camera(const Vector3 &position, const Vector3 &target)
@@ -68,9 +159,7 @@ Entity_Id Game_World::make_camera(const Vector3 &position, const Vector3 &target
 	init_entity(&camera, ENTITY_TYPE_CAMERA, position);
 	camera.up = Vector3::base_y;
 	camera.target = target;
-	camera.idx = cameras.count;
-	cameras.push(camera);
-	return get_entity_id(&camera);
+	return add_entity(&camera, cameras, &camera_slots);
 }
 
 Entity_Id Game_World::make_geometry_entity(const Vector3 &position, Geometry_Type geometry_type, void *data)
@@ -79,7 +168,6 @@ Entity_Id Game_World::make_geometry_entity(const Vector3 &position, Geometry_Typ
 	init_entity(&geometry_entity, ENTITY_TYPE_GEOMETRY, position);
 
 	geometry_entity.geometry_type = geometry_type;
-	geometry_entity.idx = geometry_entities.count;
 
 	if (geometry_type == GEOMETRY_TYPE_BOX) {
 		geometry_entity.box = *((Box *)data);
@@ -91,8 +179,7 @@ Entity_Id Game_World::make_geometry_entity(const Vector3 &position, Geometry_Typ
 		print("Game_World::make_geometry_entity: Was passed not existing Geometry Type argument.");
 		return Entity_Id();
 	}
-	geometry_entities.push(geometry_entity);
-	return get_entity_id(&geometry_entity);
+	return add_entity(&geometry_entity, geometry_entities, &geometry_entity_slots);
 }
 
 
@@ -103,10 +190,8 @@ Entity_Id Game_World::make_direction_light(const Vector3 &direction, const Vecto
 	light.direction = direction;
 	light.color = color;
 	light.light_type = DIRECTIONAL_LIGHT_TYPE;;
-	light.idx = lights.count;
 
-	lights.push(light);
-	return get_entity_id(&light);
+	return add_entity(&light, lights, &light_slots);
 }
 
 Entity_Id Game_World::make_point_light(const Vector3 &position, const Vector3 &color, float range)
@@ -116,10 +201,8 @@ Entity_Id Game_World::make_point_light(const Vector3 &position, const Vector3 &c
 	light.color = color;
 	light.light_type = POINT_LIGHT_TYPE;
 	light.range = range;
-	light.idx = lights.count;
 
-	lights.push(light);
-	return get_entity_id(&light);
+	return add_entity(&light, lights, &light_slots);
 }
 
 Entity_Id Game_World::make_spot_light(const Vector3 &position, const Vector3 &direction, const Vector3 &color, float radius)
@@ -130,10 +213,8 @@ Entity_Id Game_World::make_spot_light(const Vector3 &position, const Vector3 &di
 	light.color = color;
 	light.light_type = SPOT_LIGHT_TYPE;
 	light.radius = radius;
-	light.idx = lights.count;
 
-	lights.push(light);
-	return get_entity_id(&light);
+	return add_entity(&light, lights, &light_slots);
 }
 
 void Game_World::init()
@@ -146,45 +227,71 @@ void Game_World::release_all_resources()
 	cameras.clear();
 	lights.clear();
 	geometry_entities.clear();
+
+	entity_slots.clear();
+	camera_slots.clear();
+	light_slots.clear();
+	geometry_entity_slots.clear();
+	transformed_entities.clear();
 }
 
-template <typename T>
-inline void update_entity_indices(u32 start_index, Array<T> &entity_list)
+void Game_World::rebuild_entity_slots()
+{
+	entity_slots.rebuild(entities);
+	camera_slots.rebuild(cameras);
+	light_slots.rebuild(lights);
+	geometry_entity_slots.rebuild(geometry_entities);
+	transformed_entities.clear();
+}
+
+// An entity is added to the list only once until the changes are cleared.
+void Game_World::mark_transform_changed(Entity *entity)
+{
+	assert(entity);
+
+	Entity_Slot_Map::Slot *slot = &get_slot_map(entity->type)->slots[entity->idx];
+	if (!slot->transform_changed) {
+		slot->transform_changed = true;
+		transformed_entities.push(get_entity_id(entity));
+	}
+}
+
+void Game_World::clear_transform_changes()
 {
-	for (u32 i = start_index; i < entity_list.count; i++) {
-		Entity *entity = &entity_list[i];
-		assert(entity->idx > 0);
-		entity->idx--;
+	for (u32 i = 0; i < transformed_entities.count; i++) {
+		Entity_Slot_Map *slot_map = get_slot_map(transformed_entities[i].type);
+		slot_map->slots[transformed_entities[i].index].transform_changed = false;
 	}
+	transformed_entities.clear();
 }
 
 void Game_World::delete_entity(Entity_Id entity_id)
 {
+	bool deleted = false;
 	switch (entity_id.type) {
 		case ENTITY_TYPE_ENTITY: {
-			entities.remove(entity_id.index);
-			update_entity_indices(entity_id.index, entities);
+			deleted = ::delete_entity(entity_id, entities, &entity_slots);
 			break;
 		}
 		case ENTITY_TYPE_LIGHT: {
-			lights.remove(entity_id.index);
-			update_entity_indices(entity_id.index, lights);
+			deleted = ::delete_entity(entity_id, lights, &light_slots);
 			break;
 		}
 		case ENTITY_TYPE_GEOMETRY: {
-			geometry_entities.remove(entity_id.index);
-			update_entity_indices(entity_id.index, geometry_entities);
+			deleted = ::delete_entity(entity_id, geometry_entities, &geometry_entity_slots);
 			break;
 		}
 		case ENTITY_TYPE_CAMERA: {
-			cameras.remove(entity_id.index);
-			update_entity_indices(entity_id.index, cameras);
+			deleted = ::delete_entity(entity_id, cameras, &camera_slots);
 			break;
 		}
 		default: {
 			assert(false);
 		}
 	}
+	if (!deleted) {
+		print("Game_World::delete_entity: Failed to delete a entity. The entity id is not valid or the entity was already deleted.");
+	}
 }
 
 void Game_World::attach_AABB(Entity_Id entity_id, AABB *bounding_box)
@@ -206,6 +313,7 @@ void Game_World::move_entity(Entity *entity, const Vector3 &displacement)
 		entity->AABB_box.min += displacement;
 		entity->AABB_box.max += displacement;
 	}
+	mark_transform_changed(entity);
 }
 
 void Game_World::place_entity(Entity *entity, const Vector3 &position)
@@ -217,6 +325,7 @@ void Game_World::place_entity(Entity *entity, const Vector3 &position)
 		entity->AABB_box.min += position;
 		entity->AABB_box.max += position;
 	}
+	mark_transform_changed(entity);
 }
 
 void Game_World::update_light_direction(Light *light, const Vector3 &direction)
@@ -227,18 +336,18 @@ void Game_World::update_light_direction(Light *light, const Vector3 &direction)
 
 Entity_Id::Entity_Id()
 {
-	type = ENTITY_TYPE_UNKNOWN;
-	index = UINT32_MAX;
+	reset();
 }
 
-Entity_Id::Entity_Id(Entity_Type type, u32 index) : type(type), index(index)
+Entity_Id::Entity_Id(Entity_Type type, u32 index, u32 generation) : type(type), index(index), generation(generation)
 {
 }
 
 void Entity_Id::reset()
 {
 	type = ENTITY_TYPE_UNKNOWN;
-	index = UINT32_MAX;
+	index = ENTITY_INVALID_INDEX;
+	generation = 0;
 }
 
 void Camera::handle_commands(Array<Entity_Command *> *entity_commands)
@@ -300,7 +409,7 @@ void Camera::handle_commands(Array<Entity_Command *> *entity_commands)
 
 bool operator==(const Entity_Id &first, const Entity_Id &second)
 {
-	if ((first.type == second.type) && (first.index == second.index)) {
+	if ((first.type == second.type) && (first.index == second.index) && (first.generation == second.generation)) {
 		return true;
 	}
 	return false;
@@ -308,8 +417,5 @@ bool operator==(const Entity_Id &first, const Entity_Id &second)
 
 bool operator!=(const Entity_Id &first, const Entity_Id &second)
 {
-	if ((first.type != second.type) && (first.index != second.index)) {
-		return true;
-	}
-	return false;
+	return !(first == second);
 }
@@ -19,12 +19,21 @@ enum Entity_Type : u32 {
 	ENTITY_TYPE_CAMERA,
 };
 
+// An index and a generation share 32 bits, so entity ids and entities have the same size in level files as before.
+const u32 ENTITY_INDEX_BITS = 20;
+const u32 ENTITY_GENERATION_BITS = 12;
+const u32 ENTITY_INVALID_INDEX = (1 << ENTITY_INDEX_BITS) - 1;
+const u32 ENTITY_GENERATION_MASK = (1 << ENTITY_GENERATION_BITS) - 1;
+
+// The index is a slot in the slot map of the entity type. The generation of a slot is changed
+// when its entity is deleted, so ids of deleted entities don't refer to new entities in the slot.
 struct Entity_Id {
 	Entity_Id();
-	Entity_Id(Entity_Type type, u32 index);
+	Entity_Id(Entity_Type type, u32 index, u32 generation = 0);
 
 	Entity_Type type;
-	u32 index;
+	u32 index : ENTITY_INDEX_BITS;
+	u32 generation : ENTITY_GENERATION_BITS;
 
 	void reset();
 };
@@ -34,7 +43,8 @@ bool operator!=(const Entity_Id &first, const Entity_Id &second);
 
 struct Entity {
 	Entity() { type = ENTITY_TYPE_ENTITY; bounding_box_type = BOUNDING_BOX_TYPE_UNKNOWN; }
-	u32 idx;
+	u32 idx : ENTITY_INDEX_BITS; // The slot of the entity, not its index in an entity list.
+	u32 generation : ENTITY_GENERATION_BITS;
 	Entity_Type type;
 
 	Vector3 scaling;
@@ -49,12 +59,52 @@ struct Entity {
 inline Entity_Id get_entity_id(Entity *entity)
 {
 	//@Note: Should entity_id field be in the Entity struct ?
-	return Entity_Id(entity->type, entity->idx);
+	return Entity_Id(entity->type, entity->idx, entity->generation);
 }
 
 inline bool valid_entity_id(Entity_Id entity_id)
 {
-	return ((entity_id.type == ENTITY_TYPE_UNKNOWN) && (entity_id.index == UINT32_MAX)) ? false : true;
+	return ((entity_id.type == ENTITY_TYPE_UNKNOWN) && (entity_id.index == ENTITY_INVALID_INDEX)) ? false : true;
+}
+
+// Entities of one type are stored densely in an entity list, a slot keeps an index of its entity in the list.
+// Deleted entities are replaced by the last entity of the list, so only the slot of the moved entity is updated.
+struct Entity_Slot_Map {
+	struct Slot {
+		u32 entity_index = ENTITY_INVALID_INDEX;
+		u32 generation = 0;
+		bool transform_changed = false;
+	};
+	Array<Slot> slots;
+	Array<u32> free_slots;
+
+	void clear();
+	u32 allocate_slot(u32 entity_index);
+	void free_slot(u32 slot_index);
+	bool get_entity_index(Entity_Id entity_id, u32 *entity_index);
+
+	template <typename T>
+	void rebuild(Array<T> &entity_list);
+};
+
+// Slots are restored from the entities, it is used after entity lists were read from a level file.
+template <typename T>
+void Entity_Slot_Map::rebuild(Array<T> &entity_list)
+{
+	clear();
+	for (u32 i = 0; i < entity_list.count; i++) {
+		u32 slot_index = entity_list[i].idx;
+		while (slots.count <= slot_index) {
+			slots.push(Slot());
+		}
+		slots[slot_index].entity_index = i;
+		slots[slot_index].generation = entity_list[i].generation;
+	}
+	for (u32 i = 0; i < slots.count; i++) {
+		if (slots[i].entity_index == ENTITY_INVALID_INDEX) {
+			free_slots.push(i);
+		}
+	}
 }
 
 enum Geometry_Type {
@@ -145,8 +195,20 @@ struct Game_World {
 	Array<Light> lights;
 	Array<Geometry_Entity> geometry_entities;
 
+	Entity_Slot_Map entity_slots;
+	Entity_Slot_Map camera_slots;
+	Entity_Slot_Map light_slots;
+	Entity_Slot_Map geometry_entity_slots;
+
+	// Entities which were moved, rotated or scaled since the render world took the changes last time.
+	Array<Entity_Id> transformed_entities;
+
 	void init();
 	void release_all_resources();
+	void rebuild_entity_slots();
+
+	void mark_transform_changed(Entity *entity);
+	void clear_transform_changes();
 
 	void delete_entity(Entity_Id entity_id);
 
@@ -158,6 +220,8 @@ struct Game_World {
 	Entity *get_entity(Entity_Id entity_id);
 	Camera *get_camera(Entity_Id entity_id);
 
+	Entity_Slot_Map *get_slot_map(Entity_Type entity_type);
+
 	Entity_Id make_entity(const Vector3 &position);
 	Entity_Id make_entity(const Vector3 &scaling, const Vector3 &rotation, const Vector3 &position);
 
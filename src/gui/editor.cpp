@@ -89,55 +89,27 @@ inline void calculate_picking_ray(Vector3 &camera_position, Matrix4 &view_matrix
 	*ray = Ray(camera_position, to_vector3(mouse_point_in_world) - camera_position);
 }
 
-inline float find_triangle_area(const Vector3 &a, const Vector3 &b, const Vector3 &c)
-{
-	Vector3 area = cross(b - a, c - a); //  The magnitude of the cross-product can be interpreted as the area of the parallelogram
-	return length(area) * 0.5f;
-}
-
-struct Ray_Trinagle_Intersection_Result {
-	Vector3 a;
-	Vector3 b;
-	Vector3 c;
-	Vector3 intersection_point;
-};
-
-static bool detect_intersection(Matrix4 &entity_world_matrix, Ray *picking_ray, Vertex_PNTUV *vertices, u32 vertex_count, u32 *indices, u32 index_count, Ray_Trinagle_Intersection_Result *intersection_result = NULL)
+static bool detect_intersection(Matrix4 &entity_world_matrix, Ray *picking_ray, Mesh_BVH *mesh_bvh, Vertex_PNTUV *vertices, u32 *indices, Vector3 *intersection_point)
 {
 	assert(picking_ray);
+	assert(mesh_bvh);
 	assert(vertices);
 	assert(indices);
-	assert(index_count % 3 == 0);
-
-	for (u32 index = 0, i = 0; i < (index_count / 3); index += 3, i++) {
-		Vector3 a = vertices[indices[index + 0]].position * entity_world_matrix;
-		Vector3 b = vertices[indices[index + 1]].position * entity_world_matrix;
-		Vector3 c = vertices[indices[index + 2]].position * entity_world_matrix;
-		Vector3 plane_normal = normalize(vertices[indices[index]].normal * entity_world_matrix.to_matrix3());
-
-		float result = dot(picking_ray->direction, plane_normal);
-		if (result < 0.0f) {
-			Vector3 plane_origin = (a + b + c) / 3.0f;
-			float ray_length = dot(plane_origin - picking_ray->origin, plane_normal) / result;
-			if (ray_length > 0.0f) {
-				Vector3 ray_plane_intersection_point = picking_ray->origin + Vector3(picking_ray->direction * ray_length);
-
-				float triangle_area = find_triangle_area(a, b, c);
-				float u = find_triangle_area(c, a, ray_plane_intersection_point) / triangle_area;
-				float v = find_triangle_area(a, b, ray_plane_intersection_point) / triangle_area;
-				float w = find_triangle_area(b, c, ray_plane_intersection_point) / triangle_area;
-
-				if (in_range(0.0f, 1.1f, u + v + w)) {
-					if (result) {
-						intersection_result->a = a;
-						intersection_result->b = b;
-						intersection_result->c = c;
-						intersection_result->intersection_point = ray_plane_intersection_point;
-					}
-					return true;
-				}
-			}
+
+	// The BVH is built in the mesh object space, so the picking ray is moved there instead of transforming every vertex.
+	// The direction is not normalized after the transformation, that keeps a ray parameter the same in both spaces.
+	Matrix4 inverse_world_matrix = inverse(entity_world_matrix);
+	Ray object_space_ray;
+	object_space_ray.len = picking_ray->len;
+	object_space_ray.origin = picking_ray->origin * inverse_world_matrix;
+	object_space_ray.direction = picking_ray->direction * inverse_world_matrix.to_matrix3();
+
+	Ray_Mesh_Intersection intersection;
+	if (mesh_bvh->detect_intersection(&object_space_ray, vertices, indices, &intersection)) {
+		if (intersection_point) {
+			*intersection_point = picking_ray->origin + Vector3(picking_ray->direction * intersection.distance);
 		}
+		return true;
 	}
 	return false;
 }
@@ -179,13 +151,15 @@ bool Ray_Entity_Intersection::detect_intersection(Ray *picking_ray, Game_World *
 					Vertex_PNTUV *vertices = &render_world->model_storage.unified_vertices[mesh_instance.vertex_offset];
 					u32 *indices = &render_world->model_storage.unified_indices[mesh_instance.index_offset];
 
+					Mesh_BVH *mesh_bvh = render_world->model_storage.get_mesh_bvh(mesh_id.instance_idx);
+					if (!mesh_bvh || mesh_bvh->is_empty()) {
+						continue;
+					}
 					Matrix4 entity_world_matrix = get_world_matrix(entity);
 
-					Ray_Trinagle_Intersection_Result ray_mesh_intersection_result;
-					if (::detect_intersection(entity_world_matrix, picking_ray, vertices, mesh_instance.vertex_count, indices, mesh_instance.index_count, &ray_mesh_intersection_result)) {
+					if (::detect_intersection(entity_world_matrix, picking_ray, mesh_bvh, vertices, indices, &intersection_result.intersection_point)) {
 						intersection_result.entity_id = entity_id;
 						intersection_result.render_entity_idx = i;
-						intersection_result.intersection_point = ray_mesh_intersection_result.intersection_point;
 						intersected_entities.push(intersection_result);
 					}
 				}
@@ -362,6 +336,7 @@ void Entity_Window::draw()
 			} else {
 				if (gui::edit_field("Scaling", &scaling)) {
 					entity->scaling = scaling;
+					game_world->mark_transform_changed(entity);
 				}
 				gui::edit_field("Rotation", &rotation);
 				if (gui::edit_field("Position", &position)) {
@@ -408,7 +383,7 @@ void Entity_Tree_Window::draw_entity_list(Array<T> &entity_list, const char *nam
 						Outlining_Pass *outlining_pass = &render_world->render_passes.outlining;
 						outlining_pass->reset_render_entity_indices();
 						u32 index = 0;
-						Render_Entity *render_entity = find_render_entity(&render_world->game_render_entities, entity_id, &index);
+						Render_Entity *render_entity = render_world->find_render_entity(entity_id, &index);
 						if (render_entity) {
 							editor->picked_entity = entity_id;
 							outlining_pass->add_render_entity_index(index);
@@ -975,9 +950,12 @@ void Editor::render_menus()
 
 		}
 		if (gui::menu_item("Delete")) {
+			if (picked_entity.type == ENTITY_TYPE_LIGHT) {
+				render_world->delete_light(picked_entity);
+			}
+			render_world->delete_render_entity(picked_entity);
 			game_world->delete_entity(picked_entity);
-			u32 render_entity_index = render_world->delete_render_entity(picked_entity);
-			render_world->render_passes.outlining.delete_render_entity_index(render_entity_index);
+			picked_entity.reset();
 		}
 		gui::end_menu();
 	}
@@ -21,8 +21,9 @@ struct Enum_Helper {
 template<typename Enum_Type>
 inline void Enum_Helper<Enum_Type>::get_string_enums(Array<String> *array)
 {
+	// Enum indices are keys of the table, so strings come in the enum order.
 	for (u32 i = 0; i < index_str_table.count; i++) {
-		array->push(index_str_table.get_value(i));
+		array->push(index_str_table[i]);
 	}
 }
 
@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <stddef.h>
 #include <stdlib.h>
 
 #include "gui.h"
@@ -17,6 +18,7 @@
 #include "../libs/structures/tree.h"
 #include "../libs/structures/stack.h"
 #include "../libs/structures/array.h"
+#include "../libs/structures/hash_table.h"
 
 #define ASSERT_MSG(expr, str_msg) (assert((expr) && (str_msg)))
 
@@ -49,18 +51,53 @@ const u32 EDIT_FIELD_HASH = fast_hash("edit_Field");
 const u32 SCROLL_BAR_HASH = fast_hash("scroll_bar");
 const u32 TAB_HASH = fast_hash("window_tab_hash");
 const u32 MENU_ITEM_HASH = fast_hash("menu_item_hash");
+const u32 TEXT_HASH = fast_hash("text");
+const u32 IMAGE_HASH = fast_hash("image");
+const u32 SEGMENT_HASH = fast_hash("segment");
+const u32 LAYOUT_HASH = fast_hash("layout");
+const u32 CHILD_WINDOW_HASH = fast_hash("child_window");
+const u32 TREE_NODE_HASH = fast_hash("tree_node");
+const u32 LIST_LINE_HASH = fast_hash("list_line");
+const u32 LIST_COLUMN_HASH = fast_hash("list_column");
 
 const u32 VECTOR3_EDIT_FIELD_NUMBER = 3;
 
-#define GET_LIST_GUI_ID() (window->gui_id + LIST_HASH + list_count)
-#define GET_BUTTON_GUI_ID() (window->gui_id + BUTTON_HASH + button_count)
-#define GET_LIST_BOX_GUI_ID() (window->gui_id + LIST_BOX_HASH + list_box_count)
-#define GET_EDIT_FIELD_GUI_ID() (window->gui_id + EDIT_FIELD_HASH + edit_field_count)
-#define GET_RADIO_BUTTON_GUI_ID() (window->gui_id + RADIO_BUTTON_HASH + radio_button_count)
-#define GET_IMAGE_BUTTON_GUI_ID() (window->gui_id + IMAGE_BUTTON_HASH + image_button_count)
-#define GET_SCROLL_BAR_GUI_ID() (window->gui_id + SCROLL_BAR_HASH)
-#define GET_TAB_GUI_ID() (window->gui_id + TAB_HASH + tab_count)
-#define GET_MENU_ITEM_GUI_ID() (window->gui_id + MENU_ITEM_HASH + menu_item_count)
+// Parent windows are hashed into the root id, child windows into ids of their parents.
+const Gui_ID GUI_ROOT_ID = 0xcbf29ce484222325;
+const u32 GUI_WIDGET_STATE_LIFETIME = 256; // frames
+const u32 GUI_WINDOW_REPLAY_COOLDOWN = 30; // frames
+
+// FNV-1a continued from the seed, so the same label gets different ids in different windows.
+inline Gui_ID hash_gui_id(Gui_ID seed, const char *label)
+{
+	assert(label);
+
+	Gui_ID gui_id = seed;
+	for (const u8 *c = (const u8 *)label; *c; c++) {
+		gui_id ^= *c;
+		gui_id *= 0x100000001b3;
+	}
+	return gui_id ? gui_id : 1;
+}
+
+inline Gui_ID hash_gui_id(Gui_ID seed, u64 value)
+{
+	Gui_ID gui_id = (seed ^ value) * 0x9e3779b97f4a7c15;
+	gui_id ^= gui_id >> 32;
+	return gui_id ? gui_id : 1;
+}
+
+// Bytes before header_text are hashed, the pointer is preceded by padding.
+inline u64 hash_window_theme(u64 seed, Gui_Window_Theme *theme)
+{
+	u64 theme_hash = hash_gui_id(seed, (u64)fast_hash((const void *)theme, (u32)offsetof(Gui_Window_Theme, header_text)));
+	return theme->header_text ? hash_gui_id(theme_hash, theme->header_text) : theme_hash;
+}
+
+// Edit fields of a window have sequential ids, so keyboard navigation can compute ids of neighbour fields.
+#define GET_EDIT_FIELD_GUI_ID(index) (hash_gui_id(window->gui_id, (u64)EDIT_FIELD_HASH) + (index))
+#define GET_SCROLL_BAR_GUI_ID() hash_gui_id(window->gui_id, (u64)SCROLL_BAR_HASH)
+#define GET_LIST_GUI_ID() hash_gui_id(window->gui_id, (u64)LIST_HASH)
 
 #define GET_RENDER_LIST() (&window->render_list)
 
@@ -210,6 +247,14 @@ inline void update_list_line_state(Gui_List_Line_State *list_line_state, Rect_s3
 	}
 }
 
+// A click on a list without ctrl selects the line under the mouse, lines out of the view can't be under it.
+inline void update_hidden_list_line_state(Gui_List_Line_State *list_line_state, bool click_without_ctrl)
+{
+	if (click_without_ctrl) {
+		*list_line_state = GUI_LIST_LINE_RESET_STATE;
+	}
+}
+
 enum Window_Type {
 	WINDOW_TYPE_PARENT,
 	WINDOW_TYPE_CHILD,
@@ -239,13 +284,25 @@ static const Gui_Tree_Node_State GUI_TREE_NODE_NO_STATE = 0x0;
 static const Gui_Tree_Node_State GUI_TREE_NODE_OPEN = 0x1;
 static const Gui_Tree_Node_State GUI_TREE_NODE_SELECTED = 0x2;
 
+// Widget ids which were taken in the current frame, a label used again in the same scope gets the number of its use hashed in.
+struct Gui_Widget_State {
+	u32 last_used_frame = 0;
+	u32 use_count = 0;
+};
+
 struct Gui_Window {
 	bool open = true;
 	bool tab_was_added = false;
 	bool tab_was_drawn = false;
 	bool display_vertical_scrollbar = false;
 	bool display_horizontal_scrollbar = false;
+	bool replaying = false; // The render list of the last built frame is drawn again, widgets only hash their input.
+	bool drawn = false; // Child windows outside of the parent view are not drawn.
 	Gui_ID gui_id = 0;
+	u32 replay_cooldown = 0;
+	u32 last_begun_frame = 0;
+	u64 content_hash = 0;
+	u64 built_content_hash = 0;
 	u32 edit_field_count = 0;
 	u32 max_edit_field_number = 0;
 	s32 index_in_windows_array = -1;
@@ -432,6 +489,14 @@ struct Gui_List_Line {
 	Array<Gui_Line_Column> columns;
 };
 
+// Lines of a list are sorted again only when the sorting column or the data of lines changes.
+struct Gui_List_Sort {
+	u32 column_name_hash = 0;
+	u32 lines_hash = 0;
+	Gui_List_Column_State column_state = GUI_LIST_COLUMN_STATE_DEFAULT;
+	Array<u32> line_order; // Indices of lines in the order they are drawn.
+};
+
 struct Padding {
 	s32 rects = 0;
 	s32 horizontal = 0;
@@ -591,6 +656,12 @@ struct Gui_Manager {
 	Gui_ID became_just_actived = 0; //window
 	Gui_ID probably_resizing_window = 0;
 	Gui_ID hover_window = 0;
+	Gui_ID last_tab_gui_id = 0;
+
+	u32 frame_index = 0;
+	Array<Gui_ID> gui_id_stack;
+	Hash_Table<Gui_ID, u32> window_indices;
+	Hash_Table<Gui_ID, Gui_Widget_State> widget_states;
 
 	Gui_Layout current_layout = LAYOUT_LEFT | LAYOUT_VERTICALLY;
 
@@ -599,6 +670,8 @@ struct Gui_Manager {
 	Font *font = NULL;
 	Render_Font *render_font = NULL;
 	Render_2D *render_2d = NULL;
+	// Custom drawing of a window which is replayed in the current frame goes to the list, it is never rendered.
+	Render_Primitive_List discarded_render_list;
 
 	struct Pre_Setup {
 		Rect_s32 window_rect;
@@ -622,6 +695,7 @@ struct Gui_Manager {
 	Gui_List_Line current_list_line;
 	Array<Gui_List_Line> line_list;
 	Array<Rect_s32> list_column_rect_list;
+	Hash_Table<Gui_ID, Gui_List_Sort> list_sorts;
 
 	Stack<u32> window_stack;
 	Array<u32> windows_order;
@@ -668,7 +742,7 @@ struct Gui_Manager {
 
 	void setup_active_window(Gui_Window *window);
 	void update_active_and_hot_state(Gui_ID gui_id, Rect_s32 *rect);
-	void update_active_and_hot_state(Gui_Window *window, u32 rect_gui_id, Rect_s32 *rect);
+	void update_active_and_hot_state(Gui_Window *window, Gui_ID rect_gui_id, Rect_s32 *rect);
 	
 	void remove_window_from_rendering_order(Gui_Window *window);
 	void move_window_on_rendering_order_top(Gui_Window *window);
@@ -730,6 +804,7 @@ struct Gui_Manager {
 	void end_list();
 
 	bool begin_line(Gui_List_Line_State *list_line);
+	Array<u32> *sort_list_lines(Gui_ID list_gui_id);
 	void end_line();
 
 	bool begin_column(const char *column_name);
@@ -755,10 +830,24 @@ struct Gui_Manager {
 
 	Gui_Window *get_window();
 	Gui_Window *get_parent_window(Gui_Window *window);
-	Gui_Window *find_window(const char *name, u32 *window_index = NULL);
-	Gui_Window *find_window_in_order(const char *name, int *window_index);
+	Gui_Window *find_window(const char *name);
+	Gui_Window *find_window(Gui_ID window_gui_id);
+
+	Gui_Window *create_window(const char *name, Gui_ID window_gui_id, Window_Type window_type, Window_Style window_style, bool window_open);
 
-	Gui_Window *create_window(const char *name, Window_Type window_type, Window_Style window_style, bool window_open);
+	void push_gui_id(Gui_ID gui_id);
+	void pop_gui_id();
+	Gui_ID get_gui_id(const char *label, u32 kind_hash);
+	Gui_ID get_gui_id(u32 kind_hash, u32 counter);
+	void remove_unused_widget_states();
+
+	Gui_Window *get_root_window(Gui_Window *window);
+	bool window_replaying();
+	bool hash_widget(u32 kind_hash, const char *label, u64 value = 0);
+	bool can_replay_window(Gui_Window *window, Window_Style window_style, u32 last_begun_frame);
+	bool keep_render_lists(Gui_Window *window);
+	void clear_render_lists(Gui_Window *window);
+	Render_Primitive_List *get_custom_render_list();
 
 	Gui_Window *get_window_by_index(Array<u32> *window_indices, u32 index);
 
@@ -841,33 +930,167 @@ Gui_Window *Gui_Manager::get_parent_window(Gui_Window *window)
 	return &windows[window->parent_window_idx];
 }
 
-Gui_Window *Gui_Manager::find_window(const char *name, u32 *window_index)
+// Finds a parent window, child windows are found by ids made from ids of their parents.
+Gui_Window *Gui_Manager::find_window(const char *name)
 {
-	Gui_ID window_id = fast_hash(name);
+	return find_window(hash_gui_id(GUI_ROOT_ID, name));
+}
 
-	for (u32 i = 0; i < windows.count; i++) {
-		if (name == windows[i].name) {
-			if (window_index) {
-				*window_index = i;
-			}
-			return &windows[i];
-		}
+Gui_Window *Gui_Manager::find_window(Gui_ID window_gui_id)
+{
+	u32 window_index = 0;
+	if (window_indices.get(window_gui_id, &window_index)) {
+		return &windows[window_index];
 	}
 	return NULL;
 }
 
-Gui_Window *Gui_Manager::find_window_in_order(const char *name, int *window_index)
+void Gui_Manager::push_gui_id(Gui_ID gui_id)
 {
-	Gui_ID window_id = fast_hash(name);
+	gui_id_stack.push(gui_id);
+}
 
-	for (u32 i = 0; i < windows_order.count; i++) {
-		Gui_Window *window = get_window_by_index(&windows_order, i);
-		if (name == window->name) {
-			*window_index = i;
-			return window;
+void Gui_Manager::pop_gui_id()
+{
+	assert(!gui_id_stack.is_empty());
+	gui_id_stack.pop();
+}
+
+Gui_ID Gui_Manager::get_gui_id(const char *label, u32 kind_hash)
+{
+	assert(!gui_id_stack.is_empty());
+
+	Gui_ID gui_id = hash_gui_id(hash_gui_id(gui_id_stack.last(), (u64)kind_hash), label);
+
+	Hash_Node<Gui_ID, Gui_Widget_State> *node = widget_states.get_table_entry(gui_id);
+	if (!node) {
+		widget_states.set(gui_id, Gui_Widget_State());
+		node = widget_states.get_table_entry(gui_id);
+	} else if (node->value.last_used_frame == frame_index) {
+		node->value.use_count++;
+		return hash_gui_id(gui_id, (u64)node->value.use_count);
+	}
+	node->value.last_used_frame = frame_index;
+	node->value.use_count = 0;
+	return gui_id;
+}
+
+Gui_ID Gui_Manager::get_gui_id(u32 kind_hash, u32 counter)
+{
+	assert(!gui_id_stack.is_empty());
+	return hash_gui_id(hash_gui_id(gui_id_stack.last(), (u64)kind_hash), (u64)counter);
+}
+
+void Gui_Manager::remove_unused_widget_states()
+{
+	Array<Gui_ID> unused_gui_ids;
+	for (Hash_Node<Gui_ID, Gui_Widget_State> *node = widget_states.first_entry(); node; node = widget_states.next_entry(node)) {
+		if ((node->value.last_used_frame + GUI_WIDGET_STATE_LIFETIME) < frame_index) {
+			unused_gui_ids.push(node->key);
 		}
 	}
-	return NULL;
+	for (u32 i = 0; i < unused_gui_ids.count; i++) {
+		widget_states.remove(unused_gui_ids[i]);
+	}
+}
+
+Gui_Window *Gui_Manager::get_root_window(Gui_Window *window)
+{
+	while (window->type == WINDOW_TYPE_CHILD) {
+		window = get_parent_window(window);
+	}
+	return window;
+}
+
+bool Gui_Manager::window_replaying()
+{
+	return get_root_window(get_window())->replaying;
+}
+
+// Widget input is hashed into the content hash of the parent window. Returns true if the window is replayed,
+// then the widget is neither laid out nor drawn, only counters used in ids are updated.
+bool Gui_Manager::hash_widget(u32 kind_hash, const char *label, u64 value)
+{
+	Gui_Window *window = get_root_window(get_window());
+	window->content_hash = hash_gui_id(window->content_hash, (u64)kind_hash);
+	if (label) {
+		window->content_hash = hash_gui_id(window->content_hash, label);
+	}
+	window->content_hash = hash_gui_id(window->content_hash, value);
+	return window->replaying;
+}
+
+// A window is replayed if nothing can interact with it in this frame. The content hash is checked in end_window,
+// if it is different the window is drawn with the old content in this frame and is built for the next frames.
+bool Gui_Manager::can_replay_window(Gui_Window *window, Window_Style window_style, u32 last_begun_frame)
+{
+	if ((window->replay_cooldown > 0) || (window->built_content_hash == 0)) {
+		return false;
+	}
+	// The caches keep only primitives used in the current or the previous frame, so the render lists of a window
+	// which was not begun in the previous frame can point to deleted primitives.
+	if ((last_begun_frame + 1) != frame_index) {
+		return false;
+	}
+	if ((window_style != window->style) || (window_style & WINDOW_TAB_BAR)) {
+		return false;
+	}
+	if (were_key_events() || next_ui_element_active || (active_list_box != 0)) {
+		return false;
+	}
+	if ((hover_window == window->gui_id) || (resizing_window == window->gui_id) || (probably_resizing_window == window->gui_id) || window_active(window)) {
+		return false;
+	}
+	if ((reset_window_params & SET_WINDOW_POSITION) && ((pre_setup.window_rect.x != window->rect.x) || (pre_setup.window_rect.y != window->rect.y))) {
+		return false;
+	}
+	if ((reset_window_params & SET_WINDOW_SIZE) && (((pre_setup.window_rect.width > 0) && (pre_setup.window_rect.width != window->rect.width)) || ((pre_setup.window_rect.height > 0) && (pre_setup.window_rect.height != window->rect.height)))) {
+		return false;
+	}
+	return keep_render_lists(window);
+}
+
+// Tabs change window content when they are switched, windows with tab bars are always built.
+bool Gui_Manager::keep_render_lists(Gui_Window *window)
+{
+	if ((window->style & WINDOW_TAB_BAR) || !render_2d->keep_render_primitive_list(&window->render_list)) {
+		return false;
+	}
+	for (u32 i = 0; i < window->child_windows.count; i++) {
+		if (!keep_render_lists(&windows[window->child_windows[i]])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void Gui_Manager::clear_render_lists(Gui_Window *window)
+{
+	window->render_list.render_primitives.count = 0;
+	for (u32 i = 0; i < window->child_windows.count; i++) {
+		clear_render_lists(&windows[window->child_windows[i]]);
+	}
+}
+
+// Primitives which are added to a render list directly are not hashed, so a window with custom drawing is not replayed.
+// If the window is already replayed in this frame, it keeps the content of the last built frame and the primitives are discarded.
+Render_Primitive_List *Gui_Manager::get_custom_render_list()
+{
+	Gui_Window *window = get_window();
+	Gui_Window *root_window = get_root_window(window);
+	root_window->replay_cooldown = GUI_WINDOW_REPLAY_COOLDOWN;
+
+	if (!root_window->replaying) {
+		return &window->render_list;
+	}
+	discarded_render_list.render_2d = window->render_list.render_2d;
+	discarded_render_list.font = window->render_list.font;
+	discarded_render_list.render_font = window->render_list.render_font;
+	discarded_render_list.retained = true;
+	discarded_render_list.clip_rects.count = 0;
+	discarded_render_list.clip_rects.push(window->clip_rect);
+	discarded_render_list.render_primitives.count = 0;
+	return &discarded_render_list;
 }
 
 static bool find_saved_window_rect(const Pair<String, Rect_s32> &name_rect_pair, const String &name)
@@ -880,7 +1103,7 @@ static bool find_window_pre_setup(const Pair<String, bool> &window_pre_setup, co
 	return window_pre_setup.first == name;
 }
 
-Gui_Window *Gui_Manager::create_window(const char *name, Window_Type window_type, Window_Style window_style, bool window_open)
+Gui_Window *Gui_Manager::create_window(const char *name, Gui_ID window_gui_id, Window_Type window_type, Window_Style window_style, bool window_open)
 {
 	Find_Result<Pair<String, bool>> result1 = find_in_array(pre_setup.windows_params, name, find_window_pre_setup);
 	if (result1.found) {
@@ -890,7 +1113,7 @@ Gui_Window *Gui_Manager::create_window(const char *name, Window_Type window_type
 	Gui_Window window;
 	window.open = window_open;
 	window.name = name;
-	window.gui_id = fast_hash(name);
+	window.gui_id = window_gui_id;
 	window.type = window_type;
 
 	s32 offset = 0;
@@ -912,6 +1135,7 @@ Gui_Window *Gui_Manager::create_window(const char *name, Window_Type window_type
 	window.context = new Window_Context();
 
 	window.render_list = Render_Primitive_List(render_2d, font, render_font);
+	window.render_list.retained = true;
 #ifdef _DEBUG
 	window.name = name;
 #endif
@@ -919,6 +1143,7 @@ Gui_Window *Gui_Manager::create_window(const char *name, Window_Type window_type
 	window.index_in_windows_order = windows_order.count;
 	
 	windows.push(window);
+	window_indices.set(window_gui_id, window.index_in_windows_array);
 	if (window_open && (window_type == WINDOW_TYPE_PARENT)) {
 		windows_order.push(window.index_in_windows_array);
 	}
@@ -955,7 +1180,7 @@ void Gui_Manager::update_active_and_hot_state(Gui_ID gui_id, Rect_s32 *rect)
 	}
 }
 
-void Gui_Manager::update_active_and_hot_state(Gui_Window *window, u32 rect_gui_id, Rect_s32 *rect)
+void Gui_Manager::update_active_and_hot_state(Gui_Window *window, Gui_ID rect_gui_id, Rect_s32 *rect)
 {
 	Gui_ID window_gui_id = window->gui_id;
 	//if (window->type == WINDOW_TYPE_CHILD) {
@@ -1009,6 +1234,10 @@ inline bool must_rect_be_drawn(Rect_s32 *win_rect, Rect_s32 *item_rect)
 
 bool Gui_Manager::radio_button(const char *name, bool *state)
 {
+	if (hash_widget(RADIO_BUTTON_HASH, name, (u64)*state)) {
+		radio_button_count++;
+		return false;
+	}
 	bool was_click_by_mouse_key = false;
 	Rect_s32 rect = radio_button_theme.rect;
 	Rect_s32 radio_rect = radio_button_theme.radio_rect;
@@ -1020,12 +1249,13 @@ bool Gui_Manager::radio_button(const char *name, bool *state)
 	Gui_Window *window = get_window();
 	context->place_rect(&rect);
 
+	// The id is taken before the visibility check, so hidden radio buttons don't change ids of next ones with the same name.
+	Gui_ID radio_button_gui_id = get_gui_id(name, RADIO_BUTTON_HASH);
 	if (must_rect_be_drawn(&window->clip_rect, &rect)) {
 		place_in_middle_and_by_left(&rect, &name_rect, radio_rect.width + radio_button_theme.text_shift);
 		place_in_middle_and_by_left(&rect, &radio_rect, 0);
 		place_in_middle(&radio_rect, &check_texture_rect, BOTH_AXIS);
 
-		Gui_ID radio_button_gui_id = GET_RADIO_BUTTON_GUI_ID();
 		update_active_and_hot_state(window, radio_button_gui_id, &radio_rect);
 
 		if ((hot_item == radio_button_gui_id) && was_click(KEY_LMOUSE)) {
@@ -1057,6 +1287,11 @@ bool Gui_Manager::image_button(Image *image)
 	assert(image);
 	assert((image->width > 0) && (image->height > 0));
 
+	if (hash_widget(IMAGE_BUTTON_HASH, NULL, (u64)image->texture.srv.Get())) {
+		image_button_count++;
+		return false;
+	}
+
 	Size_s32 button_size = image_button_theme.button_size;
 	if ((button_size.width < 0) || (button_size.height < 0)) {
 		button_size = image_button_theme.image_size;
@@ -1078,7 +1313,7 @@ bool Gui_Manager::base_image_button(Rect_s32 *button_rect, Image *image)
 	Rect_s32 image_rect = image_size;
 	
 	Gui_Window *window = get_window();
-	Gui_ID image_button_gui_id = GET_IMAGE_BUTTON_GUI_ID();
+	Gui_ID image_button_gui_id = get_gui_id(IMAGE_BUTTON_HASH, image_button_count);
 	if (must_rect_be_drawn(&window->clip_rect, button_rect)) {
 		update_active_and_hot_state(image_button_gui_id, button_rect);
 
@@ -1139,6 +1374,10 @@ void Gui_Manager::edit_field(const char *name, String *string)
 	assert(name);
 	assert(string);
 
+	if (hash_widget(EDIT_FIELD_HASH, name, string->is_empty() ? 0 : (u64)fast_hash(string->c_str()))) {
+		edit_field_count++;
+		return;
+	}
 	Gui_Edit_Field_Theme *theme = &edit_field_theme;
 
 	Edit_Field_Instance edit_field_instance;
@@ -1176,7 +1415,7 @@ void Gui_Manager::edit_field(const char *name, String *string)
 		place_in_middle_and_by_left(&edit_field_instance.value_rect, &edit_field_instance.caret_rect, edit_field_instance.value_rect.width);
 
 		update_value = update_edit_field(&edit_field_instance);
-		Gui_ID edit_field_gui_id = GET_EDIT_FIELD_GUI_ID();
+		Gui_ID edit_field_gui_id = GET_EDIT_FIELD_GUI_ID(edit_field_count);
 		if (active_edit_field == edit_field_gui_id) {
 			bool result = handle_edit_field_shortcut_event(window, &edit_field_instance.edit_field_rect, edit_field_gui_id, EDIT_FIELD_TYPE_COMMON);
 			update_value = update_value ? update_value : result;
@@ -1247,6 +1486,10 @@ bool Gui_Manager::edit_field(const char *name, Vector3 *vector, const char *x, c
 
 bool Gui_Manager::edit_field(const char *name, const char *editing_value, u32 max_chars_number, bool(*symbol_validation)(char symbol))
 {
+	if (hash_widget(EDIT_FIELD_HASH, name, (u64)fast_hash(editing_value))) {
+		edit_field_count++;
+		return false;
+	}
 	Gui_Edit_Field_Theme *theme = &edit_field_theme;
 
 	Edit_Field_Instance edit_field_instance;
@@ -1273,7 +1516,7 @@ bool Gui_Manager::edit_field(const char *name, const char *editing_value, u32 ma
 		place_in_middle_and_by_left(&edit_field_instance.value_rect, &edit_field_instance.caret_rect, edit_field_instance.value_rect.width);
 
 		update_value = update_edit_field(&edit_field_instance);
-		Gui_ID edit_field_gui_id = GET_EDIT_FIELD_GUI_ID();
+		Gui_ID edit_field_gui_id = GET_EDIT_FIELD_GUI_ID(edit_field_count);
 		if (active_edit_field == edit_field_gui_id) {
 			bool result = handle_edit_field_shortcut_event(window, &edit_field_instance.edit_field_rect, edit_field_gui_id, EDIT_FIELD_TYPE_COMMON);
 			update_value = update_value ? update_value : result;
@@ -1300,6 +1543,10 @@ bool Gui_Manager::edit_field(const char *name, const char *editing_value, u32 ma
 
 bool Gui_Manager::edit_field(const char *name, const char *editing_value, u32 max_chars_number, bool(*symbol_validation)(char symbol), const Color &color, u32 field_index)
 {
+	if (hash_widget(EDIT_FIELD_HASH, name, hash_gui_id((u64)fast_hash(editing_value), (u64)field_index))) {
+		edit_field_count++;
+		return false;
+	}
 	Gui_Edit_Field_Theme *theme = &edit_field_theme;
 
 	Edit_Field_Instance edit_field_instance;
@@ -1329,7 +1576,7 @@ bool Gui_Manager::edit_field(const char *name, const char *editing_value, u32 ma
 		place_in_middle_and_by_left(&edit_field_instance.value_rect, &edit_field_instance.caret_rect, edit_field_instance.value_rect.width);
 
 		update_value = update_edit_field(&edit_field_instance);
-		Gui_ID edit_field_gui_id = GET_EDIT_FIELD_GUI_ID();
+		Gui_ID edit_field_gui_id = GET_EDIT_FIELD_GUI_ID(edit_field_count);
 		if (active_edit_field == edit_field_gui_id) {
 			bool result = handle_edit_field_shortcut_event(window, &edit_field_instance.edit_field_rect, edit_field_gui_id, EDIT_FIELD_TYPE_VECTOR3, field_index);
 			update_value = update_value ? update_value : result;
@@ -1394,15 +1641,18 @@ bool Gui_Manager::begin_menu(const char *name)
 
 bool Gui_Manager::menu_item(Image *image, const char *text, const char *shortcut, bool submenu)
 {
+	if (hash_widget(MENU_ITEM_HASH, text, image ? (u64)image->texture.srv.Get() : 0)) {
+		menu_item_count++;
+		return false;
+	}
 	Context *context = get_context();
 	Gui_Window *window = get_window();
 
 	Rect_s32 menu_item_rect = { 0, 0, get_window_size_with_padding().width, menu_theme.menu_item_height };
 	context->place_rect(&menu_item_rect);
 
-	Gui_ID menu_item_gui_id = 0;
+	Gui_ID menu_item_gui_id = get_gui_id(text, MENU_ITEM_HASH);
 	if (must_rect_be_drawn(&window->clip_rect, &menu_item_rect)) {
-		menu_item_gui_id = GET_MENU_ITEM_GUI_ID();
 		update_active_and_hot_state(window, menu_item_gui_id, &menu_item_rect);
 		
 		if ((became_just_actived != window->gui_id) && was_click(KEY_LMOUSE)) {
@@ -1441,6 +1691,9 @@ bool Gui_Manager::menu_item(Image *image, const char *text, const char *shortcut
 
 void Gui_Manager::segment()
 {
+	if (hash_widget(SEGMENT_HASH, NULL)) {
+		return;
+	}
 	Context *context = get_context();
 	Gui_Window *window = get_window();
 
@@ -1552,6 +1805,18 @@ bool Gui_Manager::begin_tree_node(const char *name, Gui_Tree_Style node_flags)
 	if (!current_node) {
 		current_node = tree_state.current_tree->create_child_node(tree_state.parent_node, { name , GUI_TREE_NODE_NO_STATE }, level_node_counter);
 	}
+	if (hash_widget(TREE_NODE_HASH, name, ((u64)node_flags << 32) | (u64)current_node->data.state)) {
+		// In a replayed window only the node tree and the id stack are walked.
+		tree_state.level_node_count_stack.last() = level_node_counter + 1;
+		tree_state.level_node_count_stack.push(0);
+		tree_state.parent_node = current_node;
+		context_stack.push(&tree_state.context);
+		push_gui_id(hash_gui_id(hash_gui_id(gui_id_stack.last(), name), (u64)level_node_counter));
+#ifdef _DEBUG
+		tree_node_debug_counter++;
+#endif
+		return true;
+	}
 	Context *context = tree_state.window_context;
 	Gui_Window *window = get_window();
 	Gui_Tree_Theme *theme = &tree_theme;
@@ -1618,6 +1883,7 @@ bool Gui_Manager::begin_tree_node(const char *name, Gui_Tree_Style node_flags)
 	tree_state.context.setup(LAYOUT_HORIZONTALLY_CENTER, &tree_node_context_rect, &tree_node_context_rect, &padding);
 
 	context_stack.push(&tree_state.context);
+	push_gui_id(hash_gui_id(hash_gui_id(gui_id_stack.last(), name), (u64)level_node_counter));
 
 #ifdef _DEBUG
 	tree_node_debug_counter++;
@@ -1635,6 +1901,7 @@ void Gui_Manager::end_tree_node()
 	tree_state.tree_level_depth -= 1;
 
 	context_stack.pop();
+	pop_gui_id();
 }
 
 template <typename T>
@@ -1718,52 +1985,98 @@ inline bool is_integer(const char *string)
 	return true;
 }
 
-inline int compare_list_lines(void *context, const void *first_line, const void *second_line)
+inline const char *get_list_line_text(const Gui_List_Line *list_line, const char *column_name)
+{
+	for (u32 i = 0; i < list_line->columns.count; i++) {
+		Gui_Line_Column *column = &list_line->columns[i];
+		if (!strcmp(column->name, column_name)) {
+			for (u32 j = 0; j < column->rendering_data_list.count; j++) {
+				if (column->rendering_data_list[j].type == LIST_LINE_INFO_TYPE_TEXT) {
+					return column->rendering_data_list[j].text;
+				}
+			}
+			return NULL;
+		}
+	}
+	return NULL;
+}
+
+// Compares indices of lines in Gui_Manager::line_list by texts in the picked column.
+inline int compare_list_lines(void *context, const void *first_index, const void *second_index)
 {
 	assert(context);
-	assert(first_line);
-	assert(second_line);
+	assert(first_index);
+	assert(second_index);
 
 	Gui_Manager *gui_manager = static_cast<Gui_Manager *>(context);
-	const Gui_List_Line *first_list_line = static_cast<const Gui_List_Line *>(first_line);
-	const Gui_List_Line *second_list_line = static_cast<const Gui_List_Line *>(second_line);
+	u32 first_line_index = *static_cast<const u32 *>(first_index);
+	u32 second_line_index = *static_cast<const u32 *>(second_index);
 
-	assert(first_list_line->columns.count == second_list_line->columns.count);
+	const char *first_text = get_list_line_text(&gui_manager->line_list[first_line_index], gui_manager->picked_column->name);
+	const char *second_text = get_list_line_text(&gui_manager->line_list[second_line_index], gui_manager->picked_column->name);
 
 	s32 result = 0;
-	for (u32 i = 0; i < first_list_line->columns.count; i++) {
-		if (!strcmp(first_list_line->columns[i].name, gui_manager->picked_column->name) && !strcmp(second_list_line->columns[i].name, gui_manager->picked_column->name)) {
-			Gui_Line_Column *first_line_column = (Gui_Line_Column *)&first_list_line->columns[i];
-			Gui_Line_Column *second_line_column = (Gui_Line_Column *)&second_list_line->columns[i];
-
-			assert(first_line_column->rendering_data_list.count == second_line_column->rendering_data_list.count);
-
-			for (u32 j = 0; j < first_line_column->rendering_data_list.count; j++) {
-				Column_Rendering_Data *first_line_column_data = &first_line_column->rendering_data_list[j];
-				Column_Rendering_Data *second_line_column_data = &second_line_column->rendering_data_list[j];
-
-				assert(first_line_column_data->type == second_line_column_data->type);
-
-				if (first_line_column_data->type == LIST_LINE_INFO_TYPE_TEXT) {
-					if (is_integer(first_line_column_data->text) && is_integer(second_line_column_data->text)) {
-						s32 first_integer = atoi(first_line_column_data->text);
-						s32 second_integer = atoi(second_line_column_data->text);
-						result = gui_manager->picked_column->state == GUI_LIST_COLUMN_STATE_SORTING_UP ? first_integer < second_integer : first_integer > second_integer;
-					} else {
-						result = compare_strings_priority(first_line_column_data->text, second_line_column_data->text);
-						if (gui_manager->picked_column->state == GUI_LIST_COLUMN_STATE_SORTING_DOWN) {
-							result *= -1;
-						}
-					}
-					break;
-				}
-			}
-			break;
+	if (first_text && second_text) {
+		if (is_integer(first_text) && is_integer(second_text)) {
+			s32 first_integer = atoi(first_text);
+			s32 second_integer = atoi(second_text);
+			result = (first_integer > second_integer) - (first_integer < second_integer);
+		} else {
+			result = compare_strings_priority(first_text, second_text);
 		}
+		if (gui_manager->picked_column->state == GUI_LIST_COLUMN_STATE_SORTING_DOWN) {
+			result *= -1;
+		}
+	}
+	// Equal lines keep the order they were added in, so they don't jump when the order is sorted again.
+	if (result == 0) {
+		result = (first_line_index > second_line_index) - (first_line_index < second_line_index);
 	}
 	return result;
 }
 
+Array<u32> *Gui_Manager::sort_list_lines(Gui_ID list_gui_id)
+{
+	Hash_Node<Gui_ID, Gui_List_Sort> *node = list_sorts.get_table_entry(list_gui_id);
+	if (!node) {
+		list_sorts.set(list_gui_id, Gui_List_Sort());
+		node = list_sorts.get_table_entry(list_gui_id);
+	}
+	Gui_List_Sort *list_sort = &node->value;
+
+	bool sorting = list_theme.column_filter && picked_column;
+	u32 column_name_hash = sorting ? fast_hash(picked_column->name) : 0;
+	Gui_List_Column_State column_state = sorting ? picked_column->state : GUI_LIST_COLUMN_STATE_DEFAULT;
+
+	// Lines are identified by their states, hashing them with sorted texts is much cheaper than sorting.
+	u32 lines_hash = hash(line_list.count);
+	if (sorting) {
+		for (u32 i = 0; i < line_list.count; i++) {
+			lines_hash = hash(lines_hash + hash((u64)line_list[i].state));
+			const char *text = get_list_line_text(&line_list[i], picked_column->name);
+			if (text) {
+				lines_hash = hash(lines_hash + fast_hash(text));
+			}
+		}
+	}
+
+	if ((list_sort->line_order.count == line_list.count) && (list_sort->lines_hash == lines_hash) && (list_sort->column_name_hash == column_name_hash) && (list_sort->column_state == column_state)) {
+		return &list_sort->line_order;
+	}
+	list_sort->lines_hash = lines_hash;
+	list_sort->column_name_hash = column_name_hash;
+	list_sort->column_state = column_state;
+
+	list_sort->line_order.reserve(line_list.count);
+	for (u32 i = 0; i < line_list.count; i++) {
+		list_sort->line_order[i] = i;
+	}
+	if (sorting) {
+		qsort_s((void *)list_sort->line_order.items, list_sort->line_order.count, sizeof(u32), compare_list_lines, (void *)this);
+	}
+	return &list_sort->line_order;
+}
+
 bool Gui_Manager::begin_list(const char *name, Gui_List_Column columns[], u32 columns_count)
 {
 	assert(name);
@@ -1782,6 +2095,18 @@ bool Gui_Manager::begin_list(const char *name, Gui_List_Column columns[], u32 co
 
 	gui::set_theme(&window_theme);
 
+	u64 columns_hash = (u64)columns_count;
+	for (u32 i = 0; i < columns_count; i++) {
+		columns_hash = hash_gui_id(hash_gui_id(columns_hash, columns[i].name), ((u64)columns[i].state << 32) | (u64)columns[i].size_in_percents);
+	}
+	if (hash_widget(LIST_HASH, name, columns_hash)) {
+		if (begin_child(name, WINDOW_SCROLL_BAR)) {
+			return true;
+		}
+		gui::reset_window_theme();
+		return false;
+	}
+
 	Size_s32 window_list_size = list_theme.window_size;
 	set_next_window_size(window_list_size.width, window_list_size.height);
 
@@ -1904,6 +2229,12 @@ static const u32 QUICK_GO_MODE_TIME = 300; // time in milliseconds
 
 void Gui_Manager::end_list()
 {
+	if (window_replaying()) {
+		end_child();
+		gui::reset_window_theme();
+		list_count++;
+		return;
+	}
 	Context *context = get_context();
 	Gui_Window *window = get_window();
 	Gui_ID list_gui_id = GET_LIST_GUI_ID();
@@ -1924,16 +2255,22 @@ void Gui_Manager::end_list()
 		next_list_active = false;
 	}
 
+	Array<u32> *line_order = sort_list_lines(list_gui_id);
+
+	// All lines are placed as one rect, rects of lines are calculated from it, so only visible lines are laid out.
+	s32 line_step = list_theme.line_height + context->padding.rects;
+	Rect_s32 lines_rect = { 0, 0, get_window_size().width, 0 };
+	if (line_list.count > 0) {
+		lines_rect.height = (s32)line_list.count * line_step - context->padding.rects;
+	}
+
 	if (active_list == list_gui_id) {
 		Window_Context *window_context = static_cast<Window_Context *>(context);
 		Window_Placing_State window_placing_state = window_context->get_placing_state();
 
-		Array<Rect_s32> line_rects;
-		for (u32 i = 0; i < line_list.count; i++) {
-			Rect_s32 temp = { 0, 0, get_window_size().width, list_theme.line_height };
-			context->place_rect(&temp);
-			line_rects.push(temp);
-		}
+		Rect_s32 lines_placing_rect = lines_rect;
+		context->place_rect(&lines_placing_rect);
+
 		static bool run_quick_mode = false;
 		static s64 timer = 0;
 		static bool check_timer = false;
@@ -1957,6 +2294,7 @@ void Gui_Manager::end_list()
 		s64 delta = milliseconds_counter() - last_modifing_time;
 		bool result = delta > TIME_BETWEEN_LIST_LINE_STEPS;
 
+		// Lines are walked in the drawing order, so arrows move the selection to neighbour lines on the screen.
 		u32 selected_lines_count = 0;
 		if ((was_click(KEY_ARROW_DOWN) || (run_quick_mode && Keys_State::is_key_down(KEY_ARROW_DOWN) && result)) || (was_click(KEY_ARROW_UP) || (run_quick_mode && Keys_State::is_key_down(KEY_ARROW_UP) && result))) {
 			for (u32 i = 0; i < line_list.count; i++) {
@@ -1966,16 +2304,16 @@ void Gui_Manager::end_list()
 				}
 			}
 			if (selected_lines_count > 1) {
-				u32 index = 0;
-				for (index; index < line_list.count; index++) {
-					Gui_List_Line *line = &line_list[index];
+				u32 position = 0;
+				for (position; position < line_order->count; position++) {
+					Gui_List_Line *line = &line_list[line_order->get(position)];
 					if (*line->state & GUI_LIST_LINE_SELECTED) {
 						break;
 					}
 				}
-				index += 1;
-				for (index; index < line_list.count; index++) {
-					Gui_List_Line *line = &line_list[index];
+				position += 1;
+				for (position; position < line_order->count; position++) {
+					Gui_List_Line *line = &line_list[line_order->get(position)];
 					*line->state = 0;
 				}
 			}
@@ -1983,27 +2321,30 @@ void Gui_Manager::end_list()
 
 		// To prevent a line blicking the code should select a line in the next frame bacause 
 		// after the call move_window_content a window content moves only at the next frame.
-		static u32 reset_index = 0;
-		static u32 select_index = 0;
+		static u32 reset_position = 0;
+		static u32 select_position = 0;
 		static bool select_line_in_next_frame = false;
 		if (select_line_in_next_frame) {
 			select_line_in_next_frame = false;
-			*line_list[reset_index].state = 0;
-			*line_list[select_index].state = GUI_LIST_LINE_SELECTED;
+			if ((reset_position < line_order->count) && (select_position < line_order->count)) {
+				*line_list[line_order->get(reset_position)].state = 0;
+				*line_list[line_order->get(select_position)].state = GUI_LIST_LINE_SELECTED;
+			}
 		}
 
 		if (selected_lines_count == 1) {
-			u32 line_index = 0;
+			u32 position = 0;
 			if (was_click(KEY_ARROW_DOWN) || (run_quick_mode && Keys_State::is_key_down(KEY_ARROW_DOWN) && result)) {
-				for (; line_index < line_list.count; line_index++) {
-					Gui_List_Line *line = &line_list[line_index];
-					if ((*line->state & GUI_LIST_LINE_SELECTED) && (line_index != (line_list.count - 1))) {
+				for (; position < line_order->count; position++) {
+					Gui_List_Line *line = &line_list[line_order->get(position)];
+					if ((*line->state & GUI_LIST_LINE_SELECTED) && (position != (line_order->count - 1))) {
 						select_line_in_next_frame = true;
-						reset_index = line_index;
-						select_index = line_index + 1;
+						reset_position = position;
+						select_position = position + 1;
 
-						if (line_rects[line_index + 1].bottom() > window->view_rect.bottom()) {
-							move_window_content(window, line_rects[line_index + 1].bottom() - window->view_rect.bottom(), MOVE_UP);
+						s32 next_line_bottom = lines_placing_rect.y + (s32)(position + 1) * line_step + list_theme.line_height;
+						if (next_line_bottom > window->view_rect.bottom()) {
+							move_window_content(window, next_line_bottom - window->view_rect.bottom(), MOVE_UP);
 						}
 						last_modifing_time = milliseconds_counter();
 						break;
@@ -2011,15 +2352,16 @@ void Gui_Manager::end_list()
 				}
 			}
 			if (was_click(KEY_ARROW_UP) || (run_quick_mode && Keys_State::is_key_down(KEY_ARROW_UP) && result)) {
-				for (; line_index < line_list.count; line_index++) {
-					Gui_List_Line *line = &line_list[line_index];
-					if ((*line->state & GUI_LIST_LINE_SELECTED) && (line_index != 0)) {
+				for (; position < line_order->count; position++) {
+					Gui_List_Line *line = &line_list[line_order->get(position)];
+					if ((*line->state & GUI_LIST_LINE_SELECTED) && (position != 0)) {
 						select_line_in_next_frame = true;
-						reset_index = line_index;
-						select_index = line_index - 1;
+						reset_position = position;
+						select_position = position - 1;
 
-						if (line_rects[line_index - 1].y < window->view_rect.y) {
-							move_window_content(window, window->view_rect.y - line_rects[line_index - 1].y, MOVE_DOWN);
+						s32 prev_line_y = lines_placing_rect.y + (s32)(position - 1) * line_step;
+						if (prev_line_y < window->view_rect.y) {
+							move_window_content(window, window->view_rect.y - prev_line_y, MOVE_DOWN);
 						}
 						last_modifing_time = milliseconds_counter();
 						break;
@@ -2032,83 +2374,92 @@ void Gui_Manager::end_list()
 		window_context->set_placing_state(&window_placing_state);
 	}
 
-	if (list_theme.column_filter) {
-		qsort_s((void *)line_list.items, line_list.count, sizeof(Gui_List_Line), compare_list_lines, (void *)this);
+	if (line_list.count > 0) {
+		context->place_rect(&lines_rect);
 	}
 
-	Render_Primitive_List *render_list = GET_RENDER_LIST();
-	render_list->push_clip_rect(&window->clip_rect);
+	bool mouse_hover = hot_item == list_gui_id;
+	bool click_without_ctrl = mouse_hover && (was_click(KEY_LMOUSE) || was_click(KEY_RMOUSE)) && !Keys_State::is_key_down(KEY_CTRL);
 
-	Rect_s32 line_rect = { 0, 0, get_window_size().width, list_theme.line_height };
+	// Lines from first_visible_position to last_visible_position are drawn, other lines only update their states.
+	u32 first_visible_position = 0;
+	u32 last_visible_position = 0;
+	if ((line_list.count > 0) && (window->view_rect.bottom() >= lines_rect.y) && (window->view_rect.y <= lines_rect.bottom())) {
+		first_visible_position = (u32)(math::max(window->view_rect.y - lines_rect.y, 0) / line_step);
+		last_visible_position = math::min((u32)((window->view_rect.bottom() - lines_rect.y) / line_step) + 1, line_list.count);
+	}
 
 	for (u32 line_index = 0; line_index < line_list.count; line_index++) {
 		Gui_List_Line *gui_list_line = &line_list[line_index];
 		if (*gui_list_line->state > (GUI_LIST_LINE_SELECTED | GUI_LIST_LINE_CLICKED_BY_ENTER_KEY)) {
 			*gui_list_line->state = GUI_LIST_LINE_RESET_STATE;
 		}
-		if (*gui_list_line->state & GUI_LIST_LINE_CLICKED_BY_LEFT_MOUSE) {
-			*gui_list_line->state &= ~GUI_LIST_LINE_CLICKED_BY_LEFT_MOUSE;
-		}
-		if (*gui_list_line->state & GUI_LIST_LINE_CLICKED_BY_RIGHT_MOUSE) {
-			*gui_list_line->state &= ~GUI_LIST_LINE_CLICKED_BY_RIGHT_MOUSE;
-		}
-		if (*gui_list_line->state & GUI_LIST_LINE_CLICKED_BY_ENTER_KEY) {
-			*gui_list_line->state &= ~GUI_LIST_LINE_CLICKED_BY_ENTER_KEY;
-		}
-		
-		context->place_rect(&line_rect);
-		if (must_rect_be_drawn(&window->view_rect, &line_rect)) {
-			bool mouse_hover = hot_item == list_gui_id;
-			if (mouse_hover && was_click(KEY_LMOUSE) && !Keys_State::is_key_down(KEY_CTRL)) {
-				update_list_line_state(gui_list_line->state, &line_rect, GUI_LIST_LINE_CLICKED_BY_LEFT_MOUSE);
-
-			} else if (mouse_hover && was_click(KEY_RMOUSE) && !Keys_State::is_key_down(KEY_CTRL)) {
-				update_list_line_state(gui_list_line->state, &line_rect, GUI_LIST_LINE_CLICKED_BY_RIGHT_MOUSE);
-
-			} else if (mouse_hover && detect_intersection(&line_rect) && (key_bindings.was_binding_triggered(KEY_CTRL, KEY_LMOUSE))) {
-				*gui_list_line->state = GUI_LIST_LINE_RESET_STATE;
-				*gui_list_line->state |= GUI_LIST_LINE_SELECTED;
-				*gui_list_line->state |= GUI_LIST_LINE_CLICKED_BY_LEFT_MOUSE;
-			
-			} else if (was_click(KEY_ENTER) && (*gui_list_line->state && GUI_LIST_LINE_SELECTED)) {
-				*gui_list_line->state = GUI_LIST_LINE_RESET_STATE;
-				*gui_list_line->state |= GUI_LIST_LINE_SELECTED;
-				*gui_list_line->state |= GUI_LIST_LINE_CLICKED_BY_ENTER_KEY;
+		*gui_list_line->state &= ~(GUI_LIST_LINE_CLICKED_BY_LEFT_MOUSE | GUI_LIST_LINE_CLICKED_BY_RIGHT_MOUSE | GUI_LIST_LINE_CLICKED_BY_ENTER_KEY);
+	}
 
-			}
+	for (u32 position = 0; position < first_visible_position; position++) {
+		update_hidden_list_line_state(line_list[line_order->get(position)].state, click_without_ctrl);
+	}
+	for (u32 position = last_visible_position; position < line_order->count; position++) {
+		update_hidden_list_line_state(line_list[line_order->get(position)].state, click_without_ctrl);
+	}
 
-			Color line_color = list_theme.line_color;
-			if (*gui_list_line->state & GUI_LIST_LINE_SELECTED) {
-				line_color = list_theme.picked_line_color;
-			} else if (mouse_hover && detect_intersection(&line_rect)) {
-				line_color = list_theme.hover_line_color;
-			}
-			render_list->add_rect(&line_rect, line_color);
+	Render_Primitive_List *render_list = GET_RENDER_LIST();
+	render_list->push_clip_rect(&window->clip_rect);
+
+	for (u32 position = first_visible_position; position < last_visible_position; position++) {
+		Gui_List_Line *gui_list_line = &line_list[line_order->get(position)];
+		Rect_s32 line_rect = { lines_rect.x, lines_rect.y + (s32)position * line_step, lines_rect.width, list_theme.line_height };
+
+		if (mouse_hover && was_click(KEY_LMOUSE) && !Keys_State::is_key_down(KEY_CTRL)) {
+			update_list_line_state(gui_list_line->state, &line_rect, GUI_LIST_LINE_CLICKED_BY_LEFT_MOUSE);
+
+		} else if (mouse_hover && was_click(KEY_RMOUSE) && !Keys_State::is_key_down(KEY_CTRL)) {
+			update_list_line_state(gui_list_line->state, &line_rect, GUI_LIST_LINE_CLICKED_BY_RIGHT_MOUSE);
+
+		} else if (mouse_hover && detect_intersection(&line_rect) && (key_bindings.was_binding_triggered(KEY_CTRL, KEY_LMOUSE))) {
+			*gui_list_line->state = GUI_LIST_LINE_RESET_STATE;
+			*gui_list_line->state |= GUI_LIST_LINE_SELECTED;
+			*gui_list_line->state |= GUI_LIST_LINE_CLICKED_BY_LEFT_MOUSE;
 			
-			for (u32 column_index = 0; column_index < gui_list_line->columns.count; column_index++) {
-				Gui_Line_Column *column = &gui_list_line->columns[column_index];
-				Rect_s32 *filter_column_rect = &list_column_rect_list[column_index];
-				Rect_s32 line_column_rect = { filter_column_rect->x, line_rect.y, filter_column_rect->width, line_rect.height };
-
-				Rect_s32 clip_rect = calculate_clip_rect(&window->clip_rect, &line_column_rect);
-				render_list->push_clip_rect(&clip_rect);
-
-				for (u32 i = 0; i < column->rendering_data_list.count; i++) {
-					Column_Rendering_Data *rendering_data = &column->rendering_data_list[i];
-					if (rendering_data->type == LIST_LINE_INFO_TYPE_TEXT) {
-						Rect_s32 line_column_text_rect = get_text_rect(rendering_data->text);
-						place_in_middle_and_by_left(&line_column_rect, &line_column_text_rect, list_theme.line_text_offset);
-						render_list->add_text(&line_column_text_rect, rendering_data->text);
-
-					} else if (rendering_data->type == LIST_LINE_INFO_TYPE_IMAGE) {
-						Rect_s32 texture_rect = { 0, 0, 20, 20 };
-						place_in_middle_and_by_left(&line_column_rect, &texture_rect, list_theme.line_text_offset);
-						render_list->add_texture(&texture_rect, rendering_data->texture);
-						line_column_rect.x += texture_rect.width + 5;
-					}
+		} else if (was_click(KEY_ENTER) && (*gui_list_line->state && GUI_LIST_LINE_SELECTED)) {
+			*gui_list_line->state = GUI_LIST_LINE_RESET_STATE;
+			*gui_list_line->state |= GUI_LIST_LINE_SELECTED;
+			*gui_list_line->state |= GUI_LIST_LINE_CLICKED_BY_ENTER_KEY;
+
+		}
+
+		Color line_color = list_theme.line_color;
+		if (*gui_list_line->state & GUI_LIST_LINE_SELECTED) {
+			line_color = list_theme.picked_line_color;
+		} else if (mouse_hover && detect_intersection(&line_rect)) {
+			line_color = list_theme.hover_line_color;
+		}
+		render_list->add_rect(&line_rect, line_color);
+		
+		for (u32 column_index = 0; column_index < gui_list_line->columns.count; column_index++) {
+			Gui_Line_Column *column = &gui_list_line->columns[column_index];
+			Rect_s32 *filter_column_rect = &list_column_rect_list[column_index];
+			Rect_s32 line_column_rect = { filter_column_rect->x, line_rect.y, filter_column_rect->width, line_rect.height };
+
+			Rect_s32 clip_rect = calculate_clip_rect(&window->clip_rect, &line_column_rect);
+			render_list->push_clip_rect(&clip_rect);
+
+			for (u32 i = 0; i < column->rendering_data_list.count; i++) {
+				Column_Rendering_Data *rendering_data = &column->rendering_data_list[i];
+				if (rendering_data->type == LIST_LINE_INFO_TYPE_TEXT) {
+					Rect_s32 line_column_text_rect = get_text_rect(rendering_data->text);
+					place_in_middle_and_by_left(&line_column_rect, &line_column_text_rect, list_theme.line_text_offset);
+					render_list->add_text(&line_column_text_rect, rendering_data->text);
+
+				} else if (rendering_data->type == LIST_LINE_INFO_TYPE_IMAGE) {
+					Rect_s32 texture_rect = { 0, 0, 20, 20 };
+					place_in_middle_and_by_left(&line_column_rect, &texture_rect, list_theme.line_text_offset);
+					render_list->add_texture(&texture_rect, rendering_data->texture);
+					line_column_rect.x += texture_rect.width + 5;
 				}
-				render_list->pop_clip_rect();
 			}
+			render_list->pop_clip_rect();
 		}
 	}
 	render_list->pop_clip_rect();
@@ -2126,6 +2477,7 @@ bool Gui_Manager::begin_line(Gui_List_Line_State *list_line_state)
 #endif
 	current_list_line.state = list_line_state;
 	current_list_line.columns.count = 0;
+	hash_widget(LIST_LINE_HASH, NULL, (u64)*list_line_state);
 	return true;
 }
 
@@ -2135,7 +2487,9 @@ void Gui_Manager::end_line()
 	list_line_debug_counter--;
 	ASSERT_MSG(list_line_debug_counter == 0, "You forgot to use gui::begin_line");
 #endif
-	line_list.push(current_list_line);
+	if (!window_replaying()) {
+		line_list.push(current_list_line);
+	}
 }
 
 bool Gui_Manager::begin_column(const char *filter_name)
@@ -2146,6 +2500,7 @@ bool Gui_Manager::begin_column(const char *filter_name)
 #endif
 	current_list_column.name = filter_name;
 	current_list_column.rendering_data_list.count = 0;
+	hash_widget(LIST_COLUMN_HASH, filter_name);
 	return true;
 }
 
@@ -2155,11 +2510,16 @@ void Gui_Manager::end_column()
 	list_column_debug_counter--;
 	ASSERT_MSG(list_column_debug_counter == 0, "You forgot to use gui::begin_column");
 #endif
-	current_list_line.columns.push(current_list_column);
+	if (!window_replaying()) {
+		current_list_line.columns.push(current_list_column);
+	}
 }
 
 void Gui_Manager::add_text(const char *text, Alignment alignment)
 {
+	if (hash_widget(TEXT_HASH, text, (u64)alignment)) {
+		return;
+	}
 	Column_Rendering_Data data;
 	data.type = LIST_LINE_INFO_TYPE_TEXT;
 	data.text = text;
@@ -2168,6 +2528,9 @@ void Gui_Manager::add_text(const char *text, Alignment alignment)
 
 void Gui_Manager::add_image(Texture2D *texture, Alignment alignment)
 {
+	if (hash_widget(IMAGE_HASH, NULL, hash_gui_id((u64)texture->srv.Get(), (u64)alignment))) {
+		return;
+	}
 	Column_Rendering_Data data;
 	data.type = LIST_LINE_INFO_TYPE_IMAGE;
 	data.texture = texture;
@@ -2222,7 +2585,7 @@ bool Gui_Manager::handle_edit_field_shortcut_event(Gui_Window *window, Rect_s32
 		if (edit_field_type == EDIT_FIELD_TYPE_VECTOR3) {
 			if (key_bindings.was_binding_triggered(KEY_CTRL, KEY_ARROW_LEFT)) {
 				if (((s32)vector3_edit_field_index - 1) >= 0) {
-					active_edit_field = window->gui_id + EDIT_FIELD_HASH + edit_field_count - 1;
+					active_edit_field = GET_EDIT_FIELD_GUI_ID(edit_field_count - 1);
 					update_value = true;
 					change_active_field = true;
 					move_vertically = false;
@@ -2230,7 +2593,7 @@ bool Gui_Manager::handle_edit_field_shortcut_event(Gui_Window *window, Rect_s32
 			}
 			if (key_bindings.was_binding_triggered(KEY_CTRL, KEY_ARROW_RIGHT)) {
 				if ((vector3_edit_field_index + 1) < VECTOR3_EDIT_FIELD_NUMBER) {
-					active_edit_field = window->gui_id + EDIT_FIELD_HASH + edit_field_count + 1;
+					active_edit_field = GET_EDIT_FIELD_GUI_ID(edit_field_count + 1);
 					update_value = true;
 					change_active_field = true;
 					move_vertically = false;
@@ -2240,13 +2603,13 @@ bool Gui_Manager::handle_edit_field_shortcut_event(Gui_Window *window, Rect_s32
 		if (key_bindings.was_binding_triggered(KEY_CTRL, KEY_ARROW_UP)) {
 			if (edit_field_type == EDIT_FIELD_TYPE_COMMON) {
 				if (window->edit_field_count > 0) {
-					active_edit_field = window->gui_id + EDIT_FIELD_HASH + edit_field_count - 1;
+					active_edit_field = GET_EDIT_FIELD_GUI_ID(edit_field_count - 1);
 					update_value = true;
 					change_active_field = true;
 				}
 			} else if (edit_field_type == EDIT_FIELD_TYPE_VECTOR3) {
 				if (((s32)window->edit_field_count - (s32)vector3_edit_field_index) > 0) {
-					active_edit_field = window->gui_id + EDIT_FIELD_HASH + edit_field_count - (vector3_edit_field_index + 1);
+					active_edit_field = GET_EDIT_FIELD_GUI_ID(edit_field_count - (vector3_edit_field_index + 1));
 					update_value = true;
 					change_active_field = true;
 					move_vertically = true;
@@ -2258,13 +2621,13 @@ bool Gui_Manager::handle_edit_field_shortcut_event(Gui_Window *window, Rect_s32
 		if (key_bindings.was_binding_triggered(KEY_CTRL, KEY_ARROW_DOWN)) {
 			if (edit_field_type == EDIT_FIELD_TYPE_COMMON) {
 				if ((window->edit_field_count + 1) < window->max_edit_field_number) {
-					active_edit_field = window->gui_id + EDIT_FIELD_HASH + edit_field_count + 1;
+					active_edit_field = GET_EDIT_FIELD_GUI_ID(edit_field_count + 1);
 					update_value = true;
 					change_active_field = true;
 				}
 			} else if (edit_field_type == EDIT_FIELD_TYPE_VECTOR3) {
 				if ((window->edit_field_count + VECTOR3_EDIT_FIELD_NUMBER) < window->max_edit_field_number) {
-					active_edit_field = window->gui_id + EDIT_FIELD_HASH + edit_field_count + (VECTOR3_EDIT_FIELD_NUMBER - vector3_edit_field_index);
+					active_edit_field = GET_EDIT_FIELD_GUI_ID(edit_field_count + (VECTOR3_EDIT_FIELD_NUMBER - vector3_edit_field_index));
 					update_value = true;
 					change_active_field = true;
 					move_vertically = true;
@@ -2275,7 +2638,7 @@ bool Gui_Manager::handle_edit_field_shortcut_event(Gui_Window *window, Rect_s32
 		}
 	} else {
 		if ((vector3_edit_field_index == 2) && move_vertically) {
-			active_edit_field = window->gui_id + EDIT_FIELD_HASH + edit_field_count - 2;
+			active_edit_field = GET_EDIT_FIELD_GUI_ID(edit_field_count - 2);
 			update_value = true;
 			change_active_field = true;
 		} else {
@@ -2292,7 +2655,7 @@ bool Gui_Manager::update_edit_field(Edit_Field_Instance *edit_field_instance)
 
 	Gui_Window *window = get_window();
 
-	Gui_ID edit_field_gui_id = GET_EDIT_FIELD_GUI_ID();
+	Gui_ID edit_field_gui_id = GET_EDIT_FIELD_GUI_ID(edit_field_count);
 	update_active_and_hot_state(window, edit_field_gui_id, &edit_field_instance->edit_field_rect);
 
 	if (was_click(KEY_LMOUSE)) {
@@ -2412,7 +2775,8 @@ void Gui_Manager::handle_events(bool *update_editing_value, bool *update_next_ti
 
 void Gui_Manager::set_caret_position_on_mouse_click(Rect_s32 *rect, Rect_s32 *editing_value_rect)
 {
-	u32 text_width = font->get_text_width(edit_field_state.data);
+	Text_Run *text_run = font->get_text_run(edit_field_state.data);
+	u32 text_width = text_run->size.width;
 	u32 mouse_x_relative_text = (u32)math::abs(mouse_x - rect->x - edit_field_theme.text_shift);
 
 	if (mouse_x_relative_text > text_width) {
@@ -2424,20 +2788,12 @@ void Gui_Manager::set_caret_position_on_mouse_click(Rect_s32 *rect, Rect_s32 *ed
 		edit_field_state.caret_index_for_inserting = 0;
 		edit_field_state.caret_index_in_text = -1;
 	} else {
-		u32 chars_width = 0;
-		u32 prev_chars_advance_width = 0;
-
-		String *text = &edit_field_state.data;
-		for (u32 i = 0; i < text->len; i++) {
-			char c = text->data[i];
-			chars_width += font->get_char_advance(c);
-
-			if ((mouse_x_relative_text >= prev_chars_advance_width) && (mouse_x_relative_text <= chars_width)) {
-				edit_field_state.caret.x = rect->x + edit_field_theme.text_shift + chars_width;
-				edit_field_state.caret_index_for_inserting = i + 1;
-				edit_field_state.caret_index_in_text = i;
-				break;
-			}
+		// Edit fields hold ASCII text, so char indices are byte indices.
+		u32 char_index = text_run->find_char(mouse_x_relative_text);
+		if (char_index < text_run->get_char_count()) {
+			edit_field_state.caret.x = rect->x + edit_field_theme.text_shift + text_run->caret_offsets[char_index + 1];
+			edit_field_state.caret_index_for_inserting = char_index + 1;
+			edit_field_state.caret_index_in_text = char_index;
 		}
 	}
 }
@@ -2456,6 +2812,9 @@ void Gui_Manager::make_next_list_active()
 
 void Gui_Manager::text(const char *some_text)
 {
+	if (hash_widget(TEXT_HASH, some_text)) {
+		return;
+	}
 	Gui_Window *window = get_window();
 
 	Rect_s32 text_rect = get_text_rect(some_text);
@@ -2491,7 +2850,8 @@ bool Gui_Manager::add_tab(const char *tab_name)
 	bool draw_tab = true;
 	bool current_tab_active = false;
 
-	Gui_ID tab_gui_id = GET_TAB_GUI_ID();
+	Gui_ID tab_gui_id = get_gui_id(tab_name, TAB_HASH);
+	last_tab_gui_id = tab_gui_id;
 	if (tab_gui_id == active_tab) {
 		pre_active_tab_count = tab_count;
 		current_tab_active = true;
@@ -2565,6 +2925,10 @@ void Gui_Manager::image(Texture2D *texture, s32 width, s32 height)
 {
 	assert(texture);
 
+	if (hash_widget(IMAGE_HASH, NULL, hash_gui_id((u64)texture->srv.Get(), ((u64)(u32)width << 32) | (u64)(u32)height))) {
+		return;
+	}
+
 	Rect_s32 image_rect = { 0, 0, width, height };
 
 	Context *context = get_context();
@@ -2592,6 +2956,10 @@ void Gui_Manager::list_box(Array<String> *array, u32 *item_index)
 	if (*item_index >= array->count) {
 		*item_index = 0;
 	}
+	if (hash_widget(LIST_BOX_HASH, array->get(*item_index), ((u64)array->count << 32) | (u64)*item_index)) {
+		list_box_count++;
+		return;
+	}
 	Rect_s32 list_box_rect = list_box_theme.default_rect;
 	Rect_s32 expand_down_texture_rect = list_box_theme.expand_down_texture_rect;
 
@@ -2599,12 +2967,12 @@ void Gui_Manager::list_box(Array<String> *array, u32 *item_index)
 	context->place_rect(&list_box_rect);
 
 	Gui_Window *window = get_window();
+	Gui_ID list_box_gui_id = get_gui_id(LIST_BOX_HASH, list_box_count);
 	if (must_rect_be_drawn(&window->clip_rect, &list_box_rect)) {
 		Rect_s32 drop_window_rect;
 		drop_window_rect.set(list_box_rect.x, list_box_rect.bottom() + 5);
 		drop_window_rect.set_size(list_box_rect.width, array->count * button_theme.rect.height);
 		
-		Gui_ID list_box_gui_id = GET_LIST_BOX_GUI_ID();
 		update_active_and_hot_state(window, list_box_gui_id, &list_box_rect);
 		
 		if (was_click(KEY_LMOUSE)) {
@@ -2693,6 +3061,12 @@ bool Gui_Manager::button(const char *name, bool *state)
 
 void Gui_Manager::core_button(const char *name, bool *left_mouse_click, bool *right_mouse_click)
 {
+	if (hash_widget(BUTTON_HASH, name)) {
+		*left_mouse_click = false;
+		*right_mouse_click = false;
+		button_count++;
+		return;
+	}
 	Context *context = get_context();
 	Gui_Window *window = get_window();
 
@@ -2700,9 +3074,8 @@ void Gui_Manager::core_button(const char *name, bool *left_mouse_click, bool *ri
 	context->place_rect(&button_rect);
 
 	bool mouse_hover = false;
+	Gui_ID button_gui_id = get_gui_id(name, BUTTON_HASH);
 	if (must_rect_be_drawn(&window->clip_rect, &button_rect)) {
-
-		u32 button_gui_id = GET_BUTTON_GUI_ID();
 		update_active_and_hot_state(window, button_gui_id, &button_rect);
 
 		mouse_hover = (hot_item == button_gui_id);
@@ -2896,6 +3269,12 @@ void Gui_Manager::new_frame()
 	became_just_actived = 0;
 	hover_window = 0;
 
+	frame_index++;
+	gui_id_stack.clear();
+	if ((frame_index % GUI_WIDGET_STATE_LIFETIME) == 0) {
+		remove_unused_widget_states();
+	}
+
 	s32 max_windows_order_index = -1;
 	Gui_Window *_hover_window = NULL;
 	for (u32 i = 0; i < windows_order.count; i++) {
@@ -2935,6 +3314,10 @@ void Gui_Manager::end_frame()
 
 	for (u32 i = 0; i < windows_order.count; i++) {
 		Gui_Window *window = get_window_by_index(&windows_order, i);
+		// Render lists are retained, lists of windows which were not begun in this frame are stale.
+		if (window->last_begun_frame != frame_index) {
+			continue;
+		}
 		render_2d->add_render_primitive_list(&window->render_list);
 		for (u32 i = 0; i < window->child_windows.count; i++) {
 			Gui_Window *child_window = get_window_by_index(&window->child_windows, i);
@@ -2945,9 +3328,10 @@ void Gui_Manager::end_frame()
 
 bool Gui_Manager::begin_window(const char *name, Window_Style window_style, bool window_open)
 {
-	Gui_Window *window = find_window(name);
+	Gui_ID window_gui_id = hash_gui_id(GUI_ROOT_ID, name);
+	Gui_Window *window = find_window(window_gui_id);
 	if (!window) {
-		window = create_window(name, WINDOW_TYPE_PARENT, window_style, window_open);
+		window = create_window(name, window_gui_id, WINDOW_TYPE_PARENT, window_style, window_open);
 		setup_active_window(window);
 	}
 
@@ -2955,11 +3339,26 @@ bool Gui_Manager::begin_window(const char *name, Window_Style window_style, bool
 		reset_window_params = 0;
 		return false;
 	}
+	u32 last_begun_frame = window->last_begun_frame;
+	window->last_begun_frame = frame_index;
+	window->content_hash = hash_window_theme(hash_gui_id(GUI_ROOT_ID, (u64)font), &window_theme);
+
+	if (can_replay_window(window, window_style, last_begun_frame)) {
+		reset_window_params &= ~(SET_WINDOW_POSITION | SET_WINDOW_SIZE);
+		window->replaying = true;
+		window_stack.push(window->index_in_windows_array);
+		push_gui_id(window->gui_id);
+		context_stack.push(window->context);
+		return true;
+	}
+	window->replaying = false;
+	clear_render_lists(window);
 
 	Rect_s32 prev_view_rect = window->view_rect;
 	Rect_s32 prev_content_rect = window->content_rect;
 
 	window_stack.push(window->index_in_windows_array);
+	push_gui_id(window->gui_id);
 	window->new_frame(window_style);
 
 	if (next_ui_element_active) {
@@ -3094,6 +3493,26 @@ void Gui_Manager::end_window()
 {
 	Gui_Window *window = get_window();
 
+	if (window->replaying) {
+		// The window is drawn with the old content in this frame.
+		if (window->content_hash != window->built_content_hash) {
+			window->replay_cooldown = GUI_WINDOW_REPLAY_COOLDOWN;
+		}
+		window->replaying = false;
+		if (reset_window_params & SET_WINDOW_THEME) {
+			reset_window_params &= ~SET_WINDOW_THEME;
+			window_theme = Gui_Window_Theme();
+		}
+		window_stack.pop();
+		context_stack.pop();
+		pop_gui_id();
+		return;
+	}
+	window->built_content_hash = window->content_hash;
+	if (window->replay_cooldown > 0) {
+		window->replay_cooldown--;
+	}
+
 	window->content_rect.width += window_theme.horizontal_padding;
 	window->content_rect.height += window_theme.vertical_padding;
 
@@ -3128,6 +3547,7 @@ void Gui_Manager::end_window()
 	}
 	window_stack.pop();
 	context_stack.pop();
+	pop_gui_id();
 }
 
 void Gui_Manager::render_window(Gui_Window *window)
@@ -3223,9 +3643,20 @@ bool Gui_Manager::begin_child(const char *name, Window_Style window_style)
 	assert(!window_stack.is_empty());
 
 	Gui_Window *parent_window = get_window();
-	Gui_Window *child_window = find_window(name);
+	Gui_ID child_window_gui_id = hash_gui_id(parent_window->gui_id, name);
+	Gui_Window *child_window = find_window(child_window_gui_id);
+	if (hash_widget(CHILD_WINDOW_HASH, name, hash_window_theme((u64)window_style, &window_theme))) {
+		reset_window_params &= ~(SET_WINDOW_POSITION | SET_WINDOW_SIZE | PLACE_RECT_ON_TOP);
+		if (!child_window || !child_window->drawn) {
+			return false;
+		}
+		window_stack.push(child_window->index_in_windows_array);
+		push_gui_id(child_window->gui_id);
+		context_stack.push(child_window->context);
+		return true;
+	}
 	if (!child_window) {
-		child_window = create_window(name, WINDOW_TYPE_CHILD, window_style, true);
+		child_window = create_window(name, child_window_gui_id, WINDOW_TYPE_CHILD, window_style, true);
 		//Windows array could be resized.
 		parent_window = get_window();
 		parent_window->child_windows.push(child_window->index_in_windows_array);
@@ -3239,7 +3670,8 @@ bool Gui_Manager::begin_child(const char *name, Window_Style window_style)
 		theme = backup_window_themes.last();
 	}
 	parent_window->context->place_rect(&child_rect);
-	if (must_rect_be_drawn(&parent_window->view_rect, &child_rect)) {
+	child_window->drawn = must_rect_be_drawn(&parent_window->view_rect, &child_rect);
+	if (child_window->drawn) {
 
 		child_window->set_position(child_rect.x, child_rect.y);
 		child_window->new_frame(window_style);
@@ -3283,6 +3715,7 @@ bool Gui_Manager::begin_child(const char *name, Window_Style window_style)
 			reset_window_params &= ~PLACE_RECT_ON_TOP;
 		}
 		window_stack.push(child_window->index_in_windows_array);
+		push_gui_id(child_window->gui_id);
 
 		Render_Primitive_List *render_list = &child_window->render_list;
 		render_list->push_clip_rect(&parent_window->clip_rect);
@@ -3303,6 +3736,13 @@ void Gui_Manager::end_child()
 {
 	Gui_Window *window = get_window();
 
+	if (get_root_window(window)->replaying) {
+		window_stack.pop();
+		context_stack.pop();
+		pop_gui_id();
+		return;
+	}
+
 	window->content_rect.width += window_theme.horizontal_padding;
 	window->content_rect.height += window_theme.vertical_padding;
 
@@ -3339,6 +3779,7 @@ void Gui_Manager::end_child()
 	window->content_rect.set_size(0, 0);
 	window_stack.pop();
 	context_stack.pop();
+	pop_gui_id();
 }
 
 void Gui_Manager::same_line()
@@ -3348,6 +3789,7 @@ void Gui_Manager::same_line()
 	context->layout = 0;
 	context->layout |= LAYOUT_HORIZONTALLY;
 	context->layout |= HORIZONTAL_LAYOUT_JUST_SET;
+	hash_widget(LAYOUT_HASH, NULL, LAYOUT_HORIZONTALLY);
 }
 
 void Gui_Manager::next_line()
@@ -3356,6 +3798,7 @@ void Gui_Manager::next_line()
 	Gui_Layout prev_layout = context->layout;
 	context->layout = 0;
 	context->layout |= LAYOUT_VERTICALLY;
+	hash_widget(LAYOUT_HASH, NULL, LAYOUT_VERTICALLY);
 }
 
 void Gui_Manager::scrolling(Gui_Window *window, Axis axis)
@@ -3378,7 +3821,7 @@ void Gui_Manager::scrolling(Gui_Window *window, Axis axis)
 		} else {
 			scroll_rect = Rect_s32(window->scroll.x, window->rect.bottom() - theme->scroll_size, scroll_size, theme->scroll_size);
 		}
-		Gui_ID scroll_bar_gui_id = GET_SCROLL_BAR_GUI_ID() + (u32)axis;
+		Gui_ID scroll_bar_gui_id = GET_SCROLL_BAR_GUI_ID() + (Gui_ID)axis;
 		update_active_and_hot_state(window, scroll_bar_gui_id, &scroll_rect);
 
 		if ((active_item == scroll_bar_gui_id) && was_key_just_pressed(KEY_LMOUSE)) {
@@ -3481,10 +3924,7 @@ bool Gui_Manager::detect_window_borders_intersection(Rect_s32 *rect, Rect_Side *
 
 Gui_ID Gui_Manager::get_last_tab_gui_id()
 {
-	Gui_Window *window = get_window();
-	Gui_ID next_tab_gui_id = GET_TAB_GUI_ID();
-	// Calculate current a tab Gui_ID.
-	return next_tab_gui_id - 1;
+	return last_tab_gui_id;
 }
 
 static Gui_Manager gui_manager;
@@ -3736,7 +4176,7 @@ void gui::reset_layout()
 
 Render_Primitive_List *gui::get_render_primitive_list()
 {
-	return &gui_manager.get_window()->render_list;
+	return gui_manager.get_custom_render_list();
 }
 
 void gui::make_tab_active(Gui_ID tab_gui_id)
@@ -12,7 +12,7 @@ struct Engine;
 struct Texture2D;
 struct Render_Primitive_List;
 
-typedef u32 Gui_ID;
+typedef u64 Gui_ID;
 typedef u32 Window_Style;
 typedef u32 Gui_List_Line_State;
 typedef u32 Gui_Tree_Style;
@@ -321,6 +321,7 @@ namespace gui
 	void set_layout();
 	void reset_layout();
 
+	// The window isn't replayed while custom drawing goes to its render list, the list has to be taken every frame.
 	Render_Primitive_List *get_render_primitive_list();
 }
 #endif
\ No newline at end of file
@@ -9,7 +9,7 @@ using namespace DirectX;
 struct Vector2 : XMFLOAT2 {
 	Vector2() {}
 	Vector2(XMVECTOR vector);
-	Vector2(const Vector2 &other);
+	Vector2(const Vector2 &other) = default;
 	Vector2(float x, float y) : XMFLOAT2(x, y) {}
 
 	static Vector2 one;
@@ -18,7 +18,7 @@ struct Vector2 : XMFLOAT2 {
 	static Vector2 base_y;
 
 	Vector2 &operator=(XMVECTOR vector);
-	Vector2 &operator=(const Vector2 &other);
+	Vector2 &operator=(const Vector2 &other) = default;
 
 	Vector2 &operator+=(float value);
 	Vector2 &operator-=(float value);
@@ -53,7 +53,7 @@ struct Vector3 : XMFLOAT3 {
 	Vector3() {}
 	Vector3(XMVECTOR vector);
 	Vector3(const Vector2 &vec2, float z) : XMFLOAT3(vec2.x, vec2.y, z) {}
-	Vector3(const Vector3 &other);
+	Vector3(const Vector3 &other) = default;
 	Vector3(float x, float y, float z) : XMFLOAT3(x, y, z) {}
 
 	static Vector3 one;
@@ -63,7 +63,7 @@ struct Vector3 : XMFLOAT3 {
 	static Vector3 base_z;
 
 	Vector3 &operator=(XMVECTOR vector);
-	Vector3 &operator=(const Vector3 &other);
+	Vector3 &operator=(const Vector3 &other) = default;
 
 	Vector3 &operator+=(float value);
 	Vector3 &operator-=(float value);
@@ -97,13 +97,13 @@ inline Vector3 operator/(const Vector3 &first_vector, const Vector3 &second_vect
 struct Vector4 : XMFLOAT4 {
 	Vector4() {}
 	Vector4(XMVECTOR vector);
-	Vector4(const Vector4 &other);
+	Vector4(const Vector4 &other) = default;
 	Vector4(float x, float y, float z, float w) : XMFLOAT4(x, y, z, w) {}
 	Vector4(const Vector3 &vector, float w) : XMFLOAT4(vector.x, vector.y, vector.z, w) {}
 
 	Vector4 &operator=(XMVECTOR vector);
 	Vector4 &operator=(const Vector3 &vector);
-	Vector4 &operator=(const Vector4 &other);
+	Vector4 &operator=(const Vector4 &other) = default;
 
 	Vector4 &operator+=(float value);
 	Vector4 &operator-=(float value);
@@ -144,27 +144,12 @@ inline Vector2::Vector2(XMVECTOR vector)
 	XMStoreFloat2(this, vector);
 }
 
-inline Vector2::Vector2(const Vector2 &other)
-{
-	x = other.x;
-	y = other.y;
-}
-
 inline Vector2 &Vector2::operator=(XMVECTOR vector)
 {
 	XMStoreFloat2(this, vector);
 	return *this;
 }
 
-inline Vector2 &Vector2::operator=(const Vector2 &other)
-{
-	if (this != &other) {
-		x = other.x;
-		y = other.y;
-	}
-	return *this;
-}
-
 inline Vector2 &Vector2::operator+=(float value)
 {
 	Vector2 temp = Vector2(value, value);
@@ -337,29 +322,12 @@ inline Vector3::Vector3(XMVECTOR vector)
 	XMStoreFloat3(this, vector);
 }
 
-inline Vector3::Vector3(const Vector3 &other)
-{
-	x = other.x;
-	y = other.y;
-	z = other.z;
-}
-
 inline Vector3 &Vector3::operator=(XMVECTOR vector)
 {
 	XMStoreFloat3(this, vector);
 	return *this;
 }
 
-inline Vector3 &Vector3::operator=(const Vector3 &other)
-{
-	if (this != &other) {
-		x = other.x;
-		y = other.y;
-		z = other.z;
-	}
-	return *this;
-}
-
 inline Vector3 &Vector3::operator+=(float value)
 {
 	Vector3 temp = Vector3(value, value, value);
@@ -533,14 +501,6 @@ inline Vector4::Vector4(XMVECTOR vector)
 	XMStoreFloat4(this, vector);
 }
 
-inline Vector4::Vector4(const Vector4 &other)
-{
-	x = other.x;
-	y = other.y;
-	z = other.z;
-	w = other.w;
-}
-
 inline Vector4 &Vector4::operator=(XMVECTOR vector)
 {
 	XMStoreFloat4(this, vector);
@@ -556,17 +516,6 @@ inline Vector4 &Vector4::operator=(const Vector3 &vector)
 	return *this;
 }
 
-inline Vector4 &Vector4::operator=(const Vector4 &other)
-{
-	if (this != &other) {
-		x = other.x;
-		y = other.y;
-		z = other.z;
-		w = other.w;
-	}
-	return *this;
-}
-
 inline Vector4 &Vector4::operator+=(float value)
 {
 	Vector4 temp = Vector4(value, value, value, value);
@@ -0,0 +1,249 @@
+#include <assert.h>
+#include <string.h>
+
+#include "mesh_cache.h"
+#include "os/path.h"
+#include "../sys/sys.h"
+#include "structures/hash_table.h"
+
+inline u32 align_offset(u32 offset, u32 alignment)
+{
+	return (offset + (alignment - 1)) & ~(alignment - 1);
+}
+
+static u32 add_string(Array<char> *string_data, String &string)
+{
+	if (string.is_empty()) {
+		return 0; // The first byte of the string data is always the empty string.
+	}
+	u32 offset = string_data->count;
+	for (u32 i = 0; i < string.len; i++) {
+		string_data->push(string.data[i]);
+	}
+	string_data->push('\0');
+	return offset;
+}
+
+static bool get_content_hash(const char *full_path_to_file, u32 *content_hash)
+{
+	Mapped_File source_file;
+	if (!source_file.open(full_path_to_file)) {
+		return false;
+	}
+	assert(source_file.size <= UINT32_MAX);
+	*content_hash = fast_hash((const void *)source_file.data, (u32)source_file.size);
+	return true;
+}
+
+static bool section_in_bounds(u64 file_size, u32 offset, u32 count, u32 element_size)
+{
+	return ((u64)offset + (u64)count * (u64)element_size) <= file_size;
+}
+
+void build_full_path_to_mesh_cache(const char *full_path_to_model_file, String &full_path_to_cache_file)
+{
+	String file_name;
+	extract_file_name(full_path_to_model_file, file_name);
+
+	char *cache_file_name = format("{}.{}.cmesh", file_name, fast_hash(full_path_to_model_file));
+	build_full_path_to_mesh_cache_file(cache_file_name, full_path_to_cache_file);
+	free_string(cache_file_name);
+}
+
+bool Mesh_Cache::open(const char *full_path_to_model_file, Loading_Models_Options *options)
+{
+	assert(full_path_to_model_file);
+	close();
+
+	String full_path_to_cache_file;
+	build_full_path_to_mesh_cache(full_path_to_model_file, full_path_to_cache_file);
+	if (!file_exists(full_path_to_cache_file) || !mapped_file.open(full_path_to_cache_file)) {
+		return false;
+	}
+
+	if (mapped_file.size < sizeof(Mesh_Cache_Header)) {
+		print("Mesh_Cache::open: {} is corrupted.", full_path_to_cache_file);
+		close();
+		return false;
+	}
+
+	Mesh_Cache_Header *cache_header = (Mesh_Cache_Header *)mapped_file.data;
+	if ((cache_header->magic != MESH_CACHE_MAGIC) || (cache_header->version != MESH_CACHE_VERSION) || (cache_header->vertex_size != sizeof(Vertex_PNTUV))) {
+		print("Mesh_Cache::open: {} was cooked with an other version of the format.", full_path_to_cache_file);
+		close();
+		return false;
+	}
+
+	if (cache_header->source_path_hash != fast_hash(full_path_to_model_file)) {
+		close();
+		return false;
+	}
+
+	if (options && ((cache_header->use_scaling_value != (u32)options->use_scaling_value) || (options->use_scaling_value && (cache_header->scaling_value != options->scaling_value)))) {
+		close();
+		return false;
+	}
+
+	u64 last_write_time = 0;
+	u64 file_size = 0;
+	if (!get_file_last_write_time(full_path_to_model_file, &last_write_time, &file_size)) {
+		close();
+		return false;
+	}
+
+	if ((cache_header->source_last_write_time != last_write_time) || (cache_header->source_file_size != file_size)) {
+		// The source file was touched. The cache is still valid if the content was not changed.
+		u32 content_hash = 0;
+		if ((cache_header->source_file_size != file_size) || !get_content_hash(full_path_to_model_file, &content_hash) || (cache_header->source_content_hash != content_hash)) {
+			close();
+			return false;
+		}
+	}
+
+	u64 size = mapped_file.size;
+	if (!section_in_bounds(size, cache_header->models_offset, cache_header->model_count, sizeof(Cooked_Model)) ||
+		!section_in_bounds(size, cache_header->strings_offset, cache_header->string_data_size, sizeof(char)) ||
+		!section_in_bounds(size, cache_header->vertices_offset, cache_header->total_vertex_count, sizeof(Vertex_PNTUV)) ||
+		!section_in_bounds(size, cache_header->indices_offset, cache_header->total_index_count, sizeof(u32)) ||
+		!section_in_bounds(size, cache_header->instances_offset, cache_header->total_instance_count, sizeof(Loading_Model::Transformation))) {
+		print("Mesh_Cache::open: {} is corrupted.", full_path_to_cache_file);
+		close();
+		return false;
+	}
+
+	header = cache_header;
+	models = (Cooked_Model *)(mapped_file.data + header->models_offset);
+	strings = (const char *)(mapped_file.data + header->strings_offset);
+	vertices = (Vertex_PNTUV *)(mapped_file.data + header->vertices_offset);
+	indices = (u32 *)(mapped_file.data + header->indices_offset);
+	instances = (Loading_Model::Transformation *)(mapped_file.data + header->instances_offset);
+	return true;
+}
+
+void Mesh_Cache::close()
+{
+	mapped_file.close();
+	header = NULL;
+	models = NULL;
+	strings = NULL;
+	vertices = NULL;
+	indices = NULL;
+	instances = NULL;
+}
+
+bool cook_models(const char *full_path_to_model_file, Array<Loading_Model *> &models, Loading_Models_Options *options)
+{
+	assert(full_path_to_model_file);
+
+	Mesh_Cache_Header header;
+	memset((void *)&header, 0, sizeof(Mesh_Cache_Header));
+	header.magic = MESH_CACHE_MAGIC;
+	header.version = MESH_CACHE_VERSION;
+	header.vertex_size = sizeof(Vertex_PNTUV);
+	header.source_path_hash = fast_hash(full_path_to_model_file);
+	if (options) {
+		header.use_scaling_value = (u32)options->use_scaling_value;
+		header.scaling_value = options->scaling_value;
+	}
+
+	if (!get_file_last_write_time(full_path_to_model_file, &header.source_last_write_time, &header.source_file_size) ||
+		!get_content_hash(full_path_to_model_file, &header.source_content_hash)) {
+		print("cook_models: Failed to get information about {}.", full_path_to_model_file);
+		return false;
+	}
+
+	Array<char> string_data;
+	string_data.push('\0');
+
+	Array<Cooked_Model> cooked_models;
+	for (u32 i = 0; i < models.count; i++) {
+		Loading_Model *model = models[i];
+		if (!model || model->mesh.empty()) {
+			continue;
+		}
+		Cooked_Model cooked_model;
+		cooked_model.name = add_string(&string_data, model->name);
+		cooked_model.file_name = add_string(&string_data, model->file_name);
+		cooked_model.normal_texture_name = add_string(&string_data, model->normal_texture_name);
+		cooked_model.diffuse_texture_name = add_string(&string_data, model->diffuse_texture_name);
+		cooked_model.specular_texture_name = add_string(&string_data, model->specular_texture_name);
+		cooked_model.displacement_texture_name = add_string(&string_data, model->displacement_texture_name);
+
+		cooked_model.vertex_offset = header.total_vertex_count;
+		cooked_model.vertex_count = model->mesh.vertices.count;
+		cooked_model.index_offset = header.total_index_count;
+		cooked_model.index_count = model->mesh.indices.count;
+		cooked_model.instance_offset = header.total_instance_count;
+		cooked_model.instance_count = model->instances.count;
+
+		header.total_vertex_count += cooked_model.vertex_count;
+		header.total_index_count += cooked_model.index_count;
+		header.total_instance_count += cooked_model.instance_count;
+
+		cooked_models.push(cooked_model);
+	}
+	if (cooked_models.is_empty()) {
+		return false;
+	}
+
+	header.model_count = cooked_models.count;
+	header.string_data_size = string_data.count;
+	header.models_offset = (u32)sizeof(Mesh_Cache_Header);
+	header.strings_offset = header.models_offset + cooked_models.get_size();
+	header.vertices_offset = align_offset(header.strings_offset + string_data.get_size(), 16);
+	header.indices_offset = align_offset(header.vertices_offset + header.total_vertex_count * (u32)sizeof(Vertex_PNTUV), 16);
+	header.instances_offset = align_offset(header.indices_offset + header.total_index_count * (u32)sizeof(u32), 16);
+
+	String cache_directory;
+	if (build_full_path_to_data_directory("mesh_cache", cache_directory) && !directory_exists(cache_directory)) {
+		CreateDirectory(cache_directory, NULL);
+	}
+
+	String full_path_to_cache_file;
+	build_full_path_to_mesh_cache(full_path_to_model_file, full_path_to_cache_file);
+
+	File file;
+	if (!file.open(full_path_to_cache_file, FILE_MODE_WRITE, FILE_CREATE_ALWAYS)) {
+		print("cook_models: Failed to create {}.", full_path_to_cache_file);
+		return false;
+	}
+
+	u8 padding[16];
+	memset((void *)padding, 0, sizeof(padding));
+
+	u32 offset = 0;
+	auto write_padding = [&](u32 section_offset) {
+		assert(section_offset >= offset);
+		if (section_offset > offset) {
+			file.write((void *)padding, section_offset - offset);
+			offset = section_offset;
+		}
+	};
+
+	file.write(&header);
+	file.write((void *)cooked_models.items, cooked_models.get_size());
+	file.write((void *)string_data.items, string_data.get_size());
+	offset = header.strings_offset + string_data.get_size();
+
+	write_padding(header.vertices_offset);
+	for (u32 i = 0; i < models.count; i++) {
+		if (models[i] && !models[i]->mesh.empty()) {
+			file.write((void *)models[i]->mesh.vertices.items, models[i]->mesh.vertices.get_size());
+			offset += models[i]->mesh.vertices.get_size();
+		}
+	}
+	write_padding(header.indices_offset);
+	for (u32 i = 0; i < models.count; i++) {
+		if (models[i] && !models[i]->mesh.empty()) {
+			file.write((void *)models[i]->mesh.indices.items, models[i]->mesh.indices.get_size());
+			offset += models[i]->mesh.indices.get_size();
+		}
+	}
+	write_padding(header.instances_offset);
+	for (u32 i = 0; i < models.count; i++) {
+		if (models[i] && !models[i]->mesh.empty() && !models[i]->instances.is_empty()) {
+			file.write((void *)models[i]->instances.items, models[i]->instances.get_size());
+		}
+	}
+	return true;
+}
@@ -0,0 +1,109 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include "str.h"
+#include "os/file.h"
+#include "mesh_loader.h"
+#include "number_types.h"
+#include "../render/mesh.h"
+#include "structures/array.h"
+
+// A cooked mesh file is a flat binary image of the models that were imported by assimp from one source file.
+// Layout: Mesh_Cache_Header | Cooked_Model[model_count] | string data | vertices | indices | instances.
+// All offsets in the header are byte offsets from the beginning of the file,
+// offsets in Cooked_Model are element offsets inside the corresponding section.
+
+const u32 MESH_CACHE_MAGIC = 0x48534d43; // "CMSH"
+const u32 MESH_CACHE_VERSION = 1;
+
+struct Mesh_Cache_Header {
+	u32 magic;
+	u32 version;
+	u32 vertex_size;
+	u32 source_path_hash;
+	u64 source_last_write_time;
+	u64 source_file_size;
+	u32 source_content_hash;
+	u32 use_scaling_value;
+	float scaling_value;
+
+	u32 model_count;
+	u32 total_vertex_count;
+	u32 total_index_count;
+	u32 total_instance_count;
+	u32 string_data_size;
+
+	u32 models_offset;
+	u32 strings_offset;
+	u32 vertices_offset;
+	u32 indices_offset;
+	u32 instances_offset;
+	u32 pad;
+};
+
+struct Cooked_Model {
+	u32 name;
+	u32 file_name;
+	u32 normal_texture_name;
+	u32 diffuse_texture_name;
+	u32 specular_texture_name;
+	u32 displacement_texture_name;
+
+	u32 vertex_offset;
+	u32 vertex_count;
+	u32 index_offset;
+	u32 index_count;
+	u32 instance_offset;
+	u32 instance_count;
+};
+
+struct Mesh_Cache {
+	Mapped_File mapped_file;
+
+	Mesh_Cache_Header *header = NULL;
+	Cooked_Model *models = NULL;
+	const char *strings = NULL;
+	Vertex_PNTUV *vertices = NULL;
+	u32 *indices = NULL;
+	Loading_Model::Transformation *instances = NULL;
+
+	bool open(const char *full_path_to_model_file, Loading_Models_Options *options = NULL);
+	void close();
+
+	u32 model_count();
+	const char *get_string(u32 offset);
+	Vertex_PNTUV *get_vertices(Cooked_Model *model);
+	u32 *get_indices(Cooked_Model *model);
+	Loading_Model::Transformation *get_instances(Cooked_Model *model);
+};
+
+inline u32 Mesh_Cache::model_count()
+{
+	return header ? header->model_count : 0;
+}
+
+inline const char *Mesh_Cache::get_string(u32 offset)
+{
+	assert(offset < header->string_data_size);
+	return &strings[offset];
+}
+
+inline Vertex_PNTUV *Mesh_Cache::get_vertices(Cooked_Model *model)
+{
+	return &vertices[model->vertex_offset];
+}
+
+inline u32 *Mesh_Cache::get_indices(Cooked_Model *model)
+{
+	return &indices[model->index_offset];
+}
+
+inline Loading_Model::Transformation *Mesh_Cache::get_instances(Cooked_Model *model)
+{
+	return &instances[model->instance_offset];
+}
+
+void build_full_path_to_mesh_cache(const char *full_path_to_model_file, String &full_path_to_cache_file);
+bool cook_models(const char *full_path_to_model_file, Array<Loading_Model *> &models, Loading_Models_Options *options = NULL);
+
+#endif
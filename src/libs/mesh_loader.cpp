@@ -12,11 +12,12 @@
 #include <assimp/LogStream.hpp>
 #include <assimp/DefaultLogger.hpp>
 
-static s32 unknown_model_name_count = 0;
-static String current_file_name;
+// Loading state is per thread, so different files can be loaded by jobs at the same time.
+static thread_local s32 unknown_model_name_count = 0;
+static thread_local String current_file_name;
 static const char *FOUR_SPACES = "    ";
-static Loading_Models_Options loading_options;
-static Loading_Models_Info loading_info;
+static thread_local Loading_Models_Options loading_options;
+static thread_local Loading_Models_Info loading_info;
 
 struct Assimp_Logger : Assimp::LogStream {
 	void write(const char *message)
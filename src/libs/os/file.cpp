@@ -51,6 +51,21 @@ bool directory_exists(const char *full_path)
 	return (attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY));
 }
 
+bool get_file_last_write_time(const char *full_path, u64 *last_write_time, u64 *file_size)
+{
+	assert(last_write_time);
+
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesEx(full_path, GetFileExInfoStandard, &data)) {
+		return false;
+	}
+	*last_write_time = ((u64)data.ftLastWriteTime.dwHighDateTime << 32) | (u64)data.ftLastWriteTime.dwLowDateTime;
+	if (file_size) {
+		*file_size = ((u64)data.nFileSizeHigh << 32) | (u64)data.nFileSizeLow;
+	}
+	return true;
+}
+
 u8 read_u8(FILE *file)
 {
 	u8 byte;
@@ -334,3 +349,61 @@ void File::write(const char *string, bool new_line)
 		return;
 	}
 }
+
+Mapped_File::~Mapped_File()
+{
+	close();
+}
+
+bool Mapped_File::open(const char *path_to_file)
+{
+	assert(path_to_file);
+	close();
+
+	file_handle = CreateFile(path_to_file, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file_handle == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+
+	LARGE_INTEGER file_size;
+	if (!GetFileSizeEx(file_handle, &file_size) || (file_size.QuadPart == 0)) {
+		close();
+		return false;
+	}
+	size = (u64)file_size.QuadPart;
+
+	mapping_handle = CreateFileMapping(file_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!mapping_handle) {
+		DWORD error_id = GetLastError();
+		char *error_message = get_error_message_from_error_code(error_id);
+		print("[Error] Mapped_File::open: Failed to create a file mapping for {}. {}", path_to_file, error_message);
+		free_string(error_message);
+		close();
+		return false;
+	}
+
+	data = (u8 *)MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+	if (!data) {
+		print("[Error] Mapped_File::open: Failed to map a view of {}.", path_to_file);
+		close();
+		return false;
+	}
+	return true;
+}
+
+void Mapped_File::close()
+{
+	if (data) {
+		UnmapViewOfFile(data);
+		data = NULL;
+	}
+	if (mapping_handle) {
+		CloseHandle(mapping_handle);
+		mapping_handle = NULL;
+	}
+	if (file_handle != INVALID_HANDLE_VALUE) {
+		CloseHandle(file_handle);
+		file_handle = INVALID_HANDLE_VALUE;
+	}
+	size = 0;
+}
@@ -17,6 +17,7 @@ u32 get_file_count_in_dir(const char *full_path);
 bool get_file_names_from_dir(const char *full_path, Array<String> *file_names);
 bool file_exists(const char *full_path);
 bool directory_exists(const char *full_path);
+bool get_file_last_write_time(const char *full_path, u64 *last_write_time, u64 *file_size = NULL);
 
 u8  read_u8(FILE *file);
 u16 read_u16(FILE *file);
@@ -72,6 +73,19 @@ struct File {
 	void write(Array<T> *array);
 };
 
+struct Mapped_File {
+	Mapped_File() {}
+	~Mapped_File();
+
+	HANDLE file_handle = INVALID_HANDLE_VALUE;
+	HANDLE mapping_handle = NULL;
+	u8 *data = NULL;
+	u64 size = 0;
+
+	bool open(const char *path_to_file);
+	void close();
+};
+
 template<typename T>
 inline void File::read(T *data)
 {
@@ -65,6 +65,7 @@ void init_os_path()
 	char *texture_dir = format("{}\\{}\\{}", os_path.base_path, DATA_DIR_NAME, "textures");
 	char *shader_dir = format("{}\\{}\\{}", os_path.base_path, DATA_DIR_NAME, "shaders");
 	char *model_dir = format("{}\\{}\\{}", os_path.base_path, DATA_DIR_NAME, "models");
+	char *mesh_cache_dir = format("{}\\{}\\{}\\{}", os_path.base_path, DATA_DIR_NAME, "models", "cache");
 	char *editor_dir = format("{}\\{}\\{}", os_path.base_path, DATA_DIR_NAME, "editor");
 	char *level_dir = format("{}\\{}\\{}", os_path.base_path, DATA_DIR_NAME, "levels");
 	char *gui_dir = format("{}\\{}\\{}", os_path.base_path, DATA_DIR_NAME, "gui");
@@ -73,6 +74,7 @@ void init_os_path()
 	os_path.data_dir_paths.set("texture", texture_dir);
 	os_path.data_dir_paths.set("shaders", shader_dir);
 	os_path.data_dir_paths.set("models", model_dir);
+	os_path.data_dir_paths.set("mesh_cache", mesh_cache_dir);
 	os_path.data_dir_paths.set("editor", editor_dir);
 	os_path.data_dir_paths.set("levels", level_dir);
 	os_path.data_dir_paths.set("gui", gui_dir);
@@ -81,6 +83,7 @@ void init_os_path()
 	free_string(texture_dir);
 	free_string(shader_dir);
 	free_string(model_dir);
+	free_string(mesh_cache_dir);
 	free_string(editor_dir);
 	free_string(level_dir);
 	free_string(gui_dir);
@@ -146,6 +149,12 @@ void build_full_path_to_model_file(const char *file_name, String &full_path)
 	full_path = value + "\\" + file_name;
 }
 
+void build_full_path_to_mesh_cache_file(const char *file_name, String &full_path)
+{
+	String &value = os_path.data_dir_paths["mesh_cache"];
+	full_path = value + "\\" + file_name;
+}
+
 const char *get_base_path()
 {
 	return os_path.base_path.c_str();
@@ -16,6 +16,7 @@ void build_full_path_to_editor_file(const char *file_name, String &full_path);
 void build_full_path_to_shader_file(const char *file_name, String &full_path);
 void build_full_path_to_source_shader_file(const char *file_name, String &full_path);
 void build_full_path_to_model_file(const char *file_name, String &full_path);
+void build_full_path_to_mesh_cache_file(const char *file_name, String &full_path);
 
 const char *get_base_path();
 const char *get_full_path_to_data_directory();
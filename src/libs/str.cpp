@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <ctype.h>
+#include <charconv>
 
 #include "str.h"
 #include "math/vector.h"
@@ -13,26 +14,12 @@
 #define MAX_DIGITS_IN_INT 12
 #define MAX_DIGITS_IN_LONG_LONG 21
 
-#define bytes_of(type, count) (sizeof(type) * count)
-
-#define COPY_STRING_TO_CHAR_ARRAY(string, char_array) {\
-	u32 s_len = (u32)strlen(string); \
-	while ((char_array->size - char_array->count) < s_len) { \
-		char_array->resize(char_array->size * 2);\
-	} \
-	char *symbol = &char_array->get(char_array->count); \
-	memcpy(symbol, string, bytes_of(char, s_len));\
-	char_array->count += s_len; \
-}
-
 void free_string(const char *string)
 {
 	delete[] string;
 	string = NULL;
 }
 
-void format_(Array<char *> *array) {}
-
 void split(const char *string, const char *characters, Array<char *> *array)
 {
 	// string copy is needed so that char array don't point on the same memory location and don't free it 
@@ -106,61 +93,240 @@ bool is_alphabet(const char *string)
 	return true;
 }
 
-static void format_string(const char *format_string, Array<char> *formatting_string, Array<char *> *vars)
+struct Format_Writer {
+	char *buffer = NULL;
+	u32 buffer_size = 0;
+	u32 length = 0;
+
+	void write(char c);
+	void write(const char *string, u32 string_length);
+	void write(const char *string);
+	void write(Format_Arg *arg);
+	template <typename T>
+	void write_number(T value);
+};
+
+inline void Format_Writer::write(char c)
+{
+	if (length + 1 < buffer_size) {
+		buffer[length] = c;
+	}
+	length++;
+}
+
+inline void Format_Writer::write(const char *string, u32 string_length)
 {
-	assert(format_string);
-	assert(formatting_string);
-	assert(vars);
+	if (length + 1 < buffer_size) {
+		u32 free_space = buffer_size - length - 1;
+		memcpy((void *)&buffer[length], (void *)string, (string_length < free_space) ? string_length : free_space);
+	}
+	length += string_length;
+}
 
-	u32 var_index = 0;
-	const char *f_string = format_string;
+inline void Format_Writer::write(const char *string)
+{
+	if (string) {
+		write(string, (u32)strlen(string));
+	}
+}
 
-	while (*f_string) {
-		if (*f_string == '}') {
-			f_string++;
-			continue;
+template <typename T>
+inline void Format_Writer::write_number(T value)
+{
+	// to_chars writes the shortest representation which is read back to the same value.
+	char digits[64];
+	std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+	write(digits, (u32)(result.ptr - digits));
+}
+
+void Format_Writer::write(Format_Arg *arg)
+{
+	switch (arg->type) {
+		case FORMAT_ARG_SIGNED: {
+			write_number(arg->signed_value);
+			break;
 		}
-		if (*f_string == '{') {
-			if (!strcmp(vars->items[var_index], "")) {
-				var_index++;
-				f_string++;
-				continue;
+		case FORMAT_ARG_UNSIGNED: {
+			write_number(arg->unsigned_value);
+			break;
+		}
+		case FORMAT_ARG_FLOAT: {
+			write_number(arg->float_value);
+			break;
+		}
+		case FORMAT_ARG_DOUBLE: {
+			write_number(arg->double_value);
+			break;
+		}
+		case FORMAT_ARG_BOOL: {
+			write(arg->bool_value ? "true" : "false");
+			break;
+		}
+		case FORMAT_ARG_CHAR: {
+			write(arg->char_value);
+			break;
+		}
+		case FORMAT_ARG_STRING:
+		case FORMAT_ARG_OWNED_STRING: {
+			write(arg->string);
+			break;
+		}
+		case FORMAT_ARG_VECTOR2: {
+			Vector2 *vector = (Vector2 *)arg->pointer;
+			write("vec2(");
+			write_number(vector->x);
+			write(", ");
+			write_number(vector->y);
+			write(')');
+			break;
+		}
+		case FORMAT_ARG_VECTOR3: {
+			Vector3 *vector = (Vector3 *)arg->pointer;
+			write("vec3(");
+			write_number(vector->x);
+			write(", ");
+			write_number(vector->y);
+			write(", ");
+			write_number(vector->z);
+			write(')');
+			break;
+		}
+		case FORMAT_ARG_VECTOR4: {
+			Vector4 *vector = (Vector4 *)arg->pointer;
+			write("vec4(");
+			write_number(vector->x);
+			write(", ");
+			write_number(vector->y);
+			write(", ");
+			write_number(vector->z);
+			write(", ");
+			write_number(vector->w);
+			write(')');
+			break;
+		}
+		case FORMAT_ARG_MATRIX4: {
+			Matrix4 *matrix = (Matrix4 *)arg->pointer;
+			write("Matrix4(");
+			for (u32 row = 0; row < 4; row++) {
+				write("\n\t");
+				for (u32 column = 0; column < 4; column++) {
+					write_number(matrix->m[row][column]);
+					if (column < 3) {
+						write(", ");
+					}
+				}
+				if (row < 3) {
+					write(',');
+				}
 			}
-			COPY_STRING_TO_CHAR_ARRAY(vars->items[var_index], formatting_string);
-			var_index++;
-		} else {
-			formatting_string->push(*f_string);
+			write(')');
+			break;
+		}
+		case FORMAT_ARG_RECT_U32: {
+			Rect_u32 *rect = (Rect_u32 *)arg->pointer;
+			write("Rect_u32(");
+			write_number(rect->x);
+			write(", ");
+			write_number(rect->y);
+			write(", ");
+			write_number(rect->width);
+			write(", ");
+			write_number(rect->height);
+			write(')');
+			break;
+		}
+		case FORMAT_ARG_RECT_S32: {
+			Rect_s32 *rect = (Rect_s32 *)arg->pointer;
+			write("Rect_s32(");
+			write_number(rect->x);
+			write(", ");
+			write_number(rect->y);
+			write(", ");
+			write_number(rect->width);
+			write(", ");
+			write_number(rect->height);
+			write(')');
+			break;
+		}
+		case FORMAT_ARG_RECT_F32: {
+			Rect_f32 *rect = (Rect_f32 *)arg->pointer;
+			write("Rect_f32(");
+			write_number(rect->x);
+			write(", ");
+			write_number(rect->y);
+			write(", ");
+			write_number(rect->width);
+			write(", ");
+			write_number(rect->height);
+			write(')');
+			break;
+		}
+		case FORMAT_ARG_POINT_S32: {
+			Point_s32 *point = (Point_s32 *)arg->pointer;
+			write("Point_s32(");
+			write_number(point->x);
+			write(", ");
+			write_number(point->y);
+			write(')');
+			break;
+		}
+		default: {
+			assert(false);
 		}
-		f_string++;
 	}
 }
 
-char *__do_formatting(Array<char *> *strings)
+u32 format_args(char *buffer, u32 buffer_size, Format_Arg *args, u32 arg_count)
 {
-	Array<char>   formatting_string;
-	Array<char *> vars_buffer;
+	Format_Writer writer;
+	writer.buffer = buffer;
+	writer.buffer_size = buffer_size;
+
+	for (u32 i = 0; i < arg_count; i++) {
+		if (i > 0) {
+			writer.write(' ');
+		}
+		Format_Arg *arg = &args[i];
+		bool is_string = (arg->type == FORMAT_ARG_STRING) || (arg->type == FORMAT_ARG_OWNED_STRING);
+		u32 brace_count = (is_string && arg->string) ? is_format_string(arg->string) : 0;
+		if (brace_count == 0) {
+			writer.write(arg);
+			continue;
+		}
 
-	for (u32 i = 0; i < strings->count; i++) {
-		char *string = strings->get(i);
-		int result = is_format_string(string);
-		if (result) {
-			assert(strings->count >= (u32)result);
-			int var_index = i + 1;
-			for (int j = 0; j < result; j++, i++) {
-				vars_buffer.push(strings->get(var_index++));
+		// Every { is replaced by the next argument, } are skipped.
+		u32 first_var = i + 1;
+		u32 var_count = ((first_var + brace_count) <= arg_count) ? brace_count : arg_count - first_var;
+		u32 var_index = 0;
+		for (const char *c = arg->string; *c; c++) {
+			if (*c == '}') {
+				continue;
+			}
+			if (*c == '{') {
+				if (var_index < var_count) {
+					writer.write(&args[first_var + var_index]);
+				}
+				var_index++;
+			} else {
+				writer.write(*c);
 			}
-			format_string(string, &formatting_string, &vars_buffer);
-			vars_buffer.clear();
-			formatting_string.push(' ');
-		} else {
-			// Append string in buffer without needs for formatting
-			COPY_STRING_TO_CHAR_ARRAY(string, ((Array<char> *) & formatting_string));
-			formatting_string.push(' ');
+		}
+		i += var_count;
+	}
+
+	if (buffer_size > 0) {
+		buffer[(writer.length < buffer_size) ? writer.length : buffer_size - 1] = '\0';
+	}
+	return writer.length;
+}
+
+void free_format_args(Format_Arg *args, u32 arg_count)
+{
+	for (u32 i = 0; i < arg_count; i++) {
+		if (args[i].type == FORMAT_ARG_OWNED_STRING) {
+			free_string(args[i].string);
 		}
 	}
-	// Rewrite last not needed space
-	formatting_string[formatting_string.count - 1] = '\0';
-	return _strdup(formatting_string.items);
 }
 
 char *concatenate_c_str(const char *str1, const char *str2)
@@ -274,11 +440,9 @@ char *to_string(double num)
 	return str;
 }
 
-char *to_string(bool val)
+const char *to_string(bool val)
 {
-	static char _true[] = "true";
-	static char _false[] = "false";
-	return val ? _true : _false;
+	return val ? "true" : "false";
 }
 
 char *to_string(const char *string)
@@ -432,6 +596,14 @@ String::String(const String &other)
 	allocate_and_copy_string(other.data);
 }
 
+String::String(String &&other)
+{
+	data = other.data;
+	len = other.len;
+	other.data = NULL;
+	other.len = 0;
+}
+
 String &String::operator=(const char *string)
 {
 	assert(string != NULL);
@@ -461,6 +633,18 @@ String &String::operator=(const String &other)
 	return *this;
 }
 
+String &String::operator=(String &&other)
+{
+	if (this != &other) {
+		DELETE_ARRAY(data);
+		data = other.data;
+		len = other.len;
+		other.data = NULL;
+		other.len = 0;
+	}
+	return *this;
+}
+
 void String::free()
 {
 	DELETE_ARRAY(data);
@@ -21,6 +21,7 @@ struct String {
 	String(const char *string);
 	String(const String *other);
 	String(const String &other);
+	String(String &&other);
 	String(const char *string, u32 start, u32 end);
 	String(const String &string, u32 start, u32 end);
 
@@ -29,6 +30,7 @@ struct String {
 
 	String &operator=(const char *string);
 	String &operator=(const String &other);
+	String &operator=(String &&other);
 
 	void free();
 	void print();
@@ -70,7 +72,6 @@ inline bool operator>=(const String &first, const String &second);
 inline bool operator<=(const String &first, const String &second);
 
 void free_string(const char *string);
-void format_(Array<char *> *array);
 void split(const char *string, const char *characters, Array<char *> *array);
 void to_upper_first_letter(String *string);
 
@@ -90,7 +91,7 @@ char *to_string(u64 number, int base = 10);
 char *to_string(float number);
 char *to_string(float number, u32 precision);
 char *to_string(double num);
-char *to_string(bool val);
+const char *to_string(bool val);
 char *to_string(const char *string);
 char *to_string(char c);
 char *to_string(String &string);
@@ -107,22 +108,153 @@ char *to_string(Matrix4 *matrix);
 
 int is_format_string(const char *string);
 
-template <typename First, typename... Args>
-void format_(Array<char *> *array, First first, Args... args)
+const u32 FORMAT_BUFFER_SIZE = 512;
+
+enum Format_Arg_Type {
+	FORMAT_ARG_SIGNED,
+	FORMAT_ARG_UNSIGNED,
+	FORMAT_ARG_FLOAT,
+	FORMAT_ARG_DOUBLE,
+	FORMAT_ARG_BOOL,
+	FORMAT_ARG_CHAR,
+	FORMAT_ARG_STRING,
+	FORMAT_ARG_OWNED_STRING, // Returned by a to_string overload, it is freed after formatting.
+	FORMAT_ARG_VECTOR2,
+	FORMAT_ARG_VECTOR3,
+	FORMAT_ARG_VECTOR4,
+	FORMAT_ARG_MATRIX4,
+	FORMAT_ARG_RECT_U32,
+	FORMAT_ARG_RECT_S32,
+	FORMAT_ARG_RECT_F32,
+	FORMAT_ARG_POINT_S32
+};
+
+// Arguments are not converted to strings before formatting, a formatter writes them straight into a buffer.
+struct Format_Arg {
+	Format_Arg_Type type;
+	union {
+		s64 signed_value;
+		u64 unsigned_value;
+		float float_value;
+		double double_value;
+		bool bool_value;
+		char char_value;
+		const char *string;
+		const void *pointer;
+	};
+};
+
+inline Format_Arg make_format_arg(int value) { Format_Arg arg; arg.type = FORMAT_ARG_SIGNED; arg.signed_value = value; return arg; }
+inline Format_Arg make_format_arg(long value) { Format_Arg arg; arg.type = FORMAT_ARG_SIGNED; arg.signed_value = value; return arg; }
+inline Format_Arg make_format_arg(long long value) { Format_Arg arg; arg.type = FORMAT_ARG_SIGNED; arg.signed_value = value; return arg; }
+inline Format_Arg make_format_arg(unsigned int value) { Format_Arg arg; arg.type = FORMAT_ARG_UNSIGNED; arg.unsigned_value = value; return arg; }
+inline Format_Arg make_format_arg(unsigned long value) { Format_Arg arg; arg.type = FORMAT_ARG_UNSIGNED; arg.unsigned_value = value; return arg; }
+inline Format_Arg make_format_arg(unsigned long long value) { Format_Arg arg; arg.type = FORMAT_ARG_UNSIGNED; arg.unsigned_value = value; return arg; }
+inline Format_Arg make_format_arg(float value) { Format_Arg arg; arg.type = FORMAT_ARG_FLOAT; arg.float_value = value; return arg; }
+inline Format_Arg make_format_arg(double value) { Format_Arg arg; arg.type = FORMAT_ARG_DOUBLE; arg.double_value = value; return arg; }
+inline Format_Arg make_format_arg(bool value) { Format_Arg arg; arg.type = FORMAT_ARG_BOOL; arg.bool_value = value; return arg; }
+inline Format_Arg make_format_arg(char value) { Format_Arg arg; arg.type = FORMAT_ARG_CHAR; arg.char_value = value; return arg; }
+inline Format_Arg make_format_arg(const char *string) { Format_Arg arg; arg.type = FORMAT_ARG_STRING; arg.string = string; return arg; }
+inline Format_Arg make_format_arg(char *string) { Format_Arg arg; arg.type = FORMAT_ARG_STRING; arg.string = string; return arg; }
+inline Format_Arg make_format_arg(const String &string) { Format_Arg arg; arg.type = FORMAT_ARG_STRING; arg.string = string.data; return arg; }
+inline Format_Arg make_format_arg(String *string) { Format_Arg arg; arg.type = FORMAT_ARG_STRING; arg.string = string->data; return arg; }
+inline Format_Arg make_format_arg(Vector2 *vector) { Format_Arg arg; arg.type = FORMAT_ARG_VECTOR2; arg.pointer = vector; return arg; }
+inline Format_Arg make_format_arg(Vector3 *vector) { Format_Arg arg; arg.type = FORMAT_ARG_VECTOR3; arg.pointer = vector; return arg; }
+inline Format_Arg make_format_arg(Vector4 *vector) { Format_Arg arg; arg.type = FORMAT_ARG_VECTOR4; arg.pointer = vector; return arg; }
+inline Format_Arg make_format_arg(Matrix4 *matrix) { Format_Arg arg; arg.type = FORMAT_ARG_MATRIX4; arg.pointer = matrix; return arg; }
+inline Format_Arg make_format_arg(Rect_u32 *rect) { Format_Arg arg; arg.type = FORMAT_ARG_RECT_U32; arg.pointer = rect; return arg; }
+inline Format_Arg make_format_arg(Rect_s32 *rect) { Format_Arg arg; arg.type = FORMAT_ARG_RECT_S32; arg.pointer = rect; return arg; }
+inline Format_Arg make_format_arg(Rect_f32 *rect) { Format_Arg arg; arg.type = FORMAT_ARG_RECT_F32; arg.pointer = rect; return arg; }
+inline Format_Arg make_format_arg(Point_s32 *point) { Format_Arg arg; arg.type = FORMAT_ARG_POINT_S32; arg.pointer = point; return arg; }
+
+// Enums with a to_string overload returning a static string are written with it, others are written as numbers.
+template <typename T, typename std::enable_if<std::is_enum<T>::value, int>::type = 0>
+inline Format_Arg make_format_arg(T value)
+{
+	if constexpr (std::is_same<decltype(to_string(value)), const char *>::value) {
+		return make_format_arg(to_string(value));
+	} else {
+		return make_format_arg((s64)value);
+	}
+}
+
+// Other types are converted by their to_string overloads, a result returned as char * is owned by the caller.
+template <typename T>
+inline Format_Arg make_format_arg(T *value)
 {
-	char *temp = to_string(first);
-	array->push(temp);
-	format_(array, args...);
+	Format_Arg arg;
+	arg.type = std::is_same<decltype(to_string(value)), const char *>::value ? FORMAT_ARG_STRING : FORMAT_ARG_OWNED_STRING;
+	arg.string = to_string(value);
+	return arg;
 }
 
-char *__do_formatting(Array<char *> *strings);
+// An argument containing {} consumes the next arguments as values of its braces,
+// other arguments are written separated by a space. Returns the length of the whole result
+// even if it doesn't fit, the buffer is always null terminated.
+u32 format_args(char *buffer, u32 buffer_size, Format_Arg *args, u32 arg_count);
+void free_format_args(Format_Arg *args, u32 arg_count);
+
+template <typename... Args>
+u32 format_to(char *buffer, u32 buffer_size, const Args &...args)
+{
+	if constexpr (sizeof...(Args) == 0) {
+		return format_args(buffer, buffer_size, NULL, 0);
+	} else {
+		Format_Arg format_arg_list[] = { make_format_arg(args)... };
+		u32 length = format_args(buffer, buffer_size, format_arg_list, sizeof...(Args));
+		free_format_args(format_arg_list, sizeof...(Args));
+		return length;
+	}
+}
 
+// The result has to be freed with free_string.
 template <typename... Args>
-char *format(Args... args)
+char *format(const Args &...args)
+{
+	char buffer[FORMAT_BUFFER_SIZE];
+	u32 length = format_to(buffer, FORMAT_BUFFER_SIZE, args...);
+
+	char *result = new char[length + 1];
+	if (length < FORMAT_BUFFER_SIZE) {
+		memcpy((void *)result, (void *)buffer, length + 1);
+	} else {
+		format_to(result, length + 1, args...);
+	}
+	return result;
+}
+
+// Keeps a result on the stack, only results longer than FORMAT_BUFFER_SIZE are allocated.
+// data can point to buffer, so the string can't be copied or moved.
+struct Formatted_String {
+	template <typename... Args>
+	Formatted_String(const Args &...args);
+	~Formatted_String();
+
+	Formatted_String(const Formatted_String &other) = delete;
+	Formatted_String(Formatted_String &&other) = delete;
+	Formatted_String &operator=(const Formatted_String &other) = delete;
+	Formatted_String &operator=(Formatted_String &&other) = delete;
+
+	char buffer[FORMAT_BUFFER_SIZE];
+	char *data = buffer;
+	u32 len = 0;
+};
+
+template <typename... Args>
+inline Formatted_String::Formatted_String(const Args &...args)
+{
+	len = format_to(buffer, FORMAT_BUFFER_SIZE, args...);
+	if (len >= FORMAT_BUFFER_SIZE) {
+		data = new char[len + 1];
+		format_to(data, len + 1, args...);
+	}
+}
+
+inline Formatted_String::~Formatted_String()
 {
-	Array<char *> strings;
-	format_(&strings, args...);
-	return __do_formatting(&strings);
+	if (data != buffer) {
+		delete[] data;
+	}
 }
 
 inline String::operator const char *()
@@ -3,7 +3,11 @@
 
 #include <assert.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
+#include <new>
+#include <utility>
+#include <type_traits>
 
 #include "../number_types.h"
 
@@ -11,24 +15,53 @@
 
 #define For(array, ptr) for (u32 _i = 0; (_i < array.count ? array.set_pointer_to_item(&ptr, _i), true : false); _i++)
 
-template <typename T>
+// Allocators are stateless, an array calls them through static functions so it doesn't store an allocator.
+struct Default_Allocator {
+	static void *allocate(u64 size);
+	static void *reallocate(void *memory, u64 old_size, u64 new_size);
+	static void free(void *memory);
+};
+
+inline void *Default_Allocator::allocate(u64 size)
+{
+	return malloc((size_t)size);
+}
+
+inline void *Default_Allocator::reallocate(void *memory, u64 old_size, u64 new_size)
+{
+	return realloc(memory, (size_t)new_size);
+}
+
+inline void Default_Allocator::free(void *memory)
+{
+	::free(memory);
+}
+
+// All items in [0, size) are constructed objects. Memory is not allocated until the first item is added
+// unless the size is passed to the constructor. Trivially copyable items are grown with realloc,
+// other items are moved to a new memory block.
+template <typename T, typename Allocator = Default_Allocator>
 struct Array {
-	Array(u32 _size = 8);
+	Array(u32 _size = 0);
 	~Array();
 
 	T *items = NULL;
-	u32 count;
-	u32 size;
+	u32 count = 0;
+	u32 size = 0;
 
-	Array(const Array<T> &other);
-	Array<T> &operator=(const Array<T> &other);
+	Array(const Array<T, Allocator> &other);
+	Array(Array<T, Allocator> &&other);
+	Array<T, Allocator> &operator=(const Array<T, Allocator> &other);
+	Array<T, Allocator> &operator=(Array<T, Allocator> &&other);
 
 	T &operator[](u32 i);
 	const T &operator[](u32 i) const;
 
 	void clear();
+	void free();
 	void resize(u32 _size);
 	void remove(u32 index);
+	void swap_remove(u32 index);
 	void reserve(u32 _count);
 	void set_pointer_to_item(T *ptr, u32 index);
 	void set_pointer_to_item(T **ptr, u32 index);
@@ -37,6 +70,7 @@ struct Array {
 	bool find(const T &item);
 
 	u32 push(const T &item);
+	u32 push(T &&item);
 	u32 get_size();
 	T &pop();
 	T &get(u32 index);
@@ -49,138 +83,203 @@ inline void merge(Array<T> *dst, Array<T> *src);
 template <typename T>
 inline void free_memory(Array<T *> *array);
 
-template <typename T>
-Array<T>::Array(u32 _size)
+template <typename T, typename Allocator>
+Array<T, Allocator>::Array(u32 _size)
 {
-	items = NULL;
-	count = 0;
-	size = _size;
-	resize(_size);
+	if (_size > 0) {
+		resize(_size);
+	}
 }
 
-template <typename T>
-Array<T>::~Array()
+template <typename T, typename Allocator>
+Array<T, Allocator>::~Array()
 {
-	if (items) {
-		delete[] items;
-		items = NULL;
-	}
+	free();
 }
 
-template<typename T>
-inline Array<T>::Array(const Array<T> &other)
+template <typename T, typename Allocator>
+inline Array<T, Allocator>::Array(const Array<T, Allocator> &other)
 {
 	*this = other;
 }
 
-template<typename T>
-inline Array<T> &Array<T>::operator=(const Array<T> &other)
+template <typename T, typename Allocator>
+inline Array<T, Allocator>::Array(Array<T, Allocator> &&other)
 {
+	*this = std::move(other);
+}
+
+template <typename T, typename Allocator>
+inline Array<T, Allocator> &Array<T, Allocator>::operator=(const Array<T, Allocator> &other)
+{
+	if (this == &other) {
+		return *this;
+	}
+	count = 0;
+	if (size < other.size) {
+		free();
+		resize(other.size);
+	}
+	if constexpr (std::is_trivially_copyable<T>::value) {
+		if (other.count > 0) {
+			memcpy((void *)items, (void *)other.items, sizeof(T) * other.count);
+		}
+	} else {
+		for (u32 i = 0; i < other.count; i++) {
+			items[i] = other.items[i];
+		}
+	}
 	count = other.count;
-	size = other.size;
-	if (items) delete[] items, items = NULL;
-	items = new T[other.size];
-	for (u32 i = 0; i < count; i++) {
-		items[i] = other.items[i];
+	return *this;
+}
+
+template <typename T, typename Allocator>
+inline Array<T, Allocator> &Array<T, Allocator>::operator=(Array<T, Allocator> &&other)
+{
+	if (this == &other) {
+		return *this;
 	}
+	free();
+	items = other.items;
+	count = other.count;
+	size = other.size;
+	other.items = NULL;
+	other.count = 0;
+	other.size = 0;
 	return *this;
 }
 
-template <typename T>
-inline T &Array<T>::operator[](u32 i)
+template <typename T, typename Allocator>
+inline T &Array<T, Allocator>::operator[](u32 i)
 {
 	assert(size > i);
 	return items[i];
 }
 
-template <typename T>
-inline const T &Array<T>::operator[](u32 i) const
+template <typename T, typename Allocator>
+inline const T &Array<T, Allocator>::operator[](u32 i) const
 {
 	assert(size > i);
 	return items[i];
 }
 
-template<typename T>
-inline void Array<T>::clear()
+template <typename T, typename Allocator>
+inline void Array<T, Allocator>::clear()
+{
+	// The memory is kept for next items, use free to release it.
+	if constexpr (!std::is_trivially_copyable<T>::value) {
+		for (u32 i = 0; i < count; i++) {
+			items[i] = T();
+		}
+	}
+	count = 0;
+}
+
+template <typename T, typename Allocator>
+inline void Array<T, Allocator>::free()
 {
 	if (items) {
-		delete[] items;
+		if constexpr (!std::is_trivially_destructible<T>::value) {
+			for (u32 i = 0; i < size; i++) {
+				items[i].~T();
+			}
+		}
+		Allocator::free((void *)items);
 		items = NULL;
 	}
 	count = 0;
-	size = 8;
-	resize(size);
+	size = 0;
 }
 
-template <typename T>
-inline void Array<T>::resize(u32 new_size)
+template <typename T, typename Allocator>
+inline void Array<T, Allocator>::resize(u32 new_size)
 {
 	assert(new_size > count);
 
-	if (!items) {
-		items = new T[new_size];
+	if constexpr (std::is_trivially_copyable<T>::value) {
+		T *new_items = (T *)Allocator::reallocate((void *)items, sizeof(T) * size, sizeof(T) * new_size);
+		assert(new_items);
+		items = new_items;
+	} else {
+		T *new_items = (T *)Allocator::allocate(sizeof(T) * new_size);
+		assert(new_items);
+		for (u32 i = 0; i < count; i++) {
+			new (&new_items[i]) T(std::move(items[i]));
+		}
+		for (u32 i = 0; i < size; i++) {
+			items[i].~T();
+		}
+		if (items) {
+			Allocator::free((void *)items);
+		}
+		items = new_items;
+		for (u32 i = count; i < new_size; i++) {
+			new (&items[i]) T;
+		}
+		size = new_size;
 		return;
 	}
-
-	T *temp_array = items;
-	items = new T[new_size];
-
-	for (u32 i = 0; i < count; i++) {
-		items[i] = temp_array[i];
+	for (u32 i = size; i < new_size; i++) {
+		new (&items[i]) T;
 	}
-
 	size = new_size;
-	delete[] temp_array;
 }
 
-template<typename T>
-inline void Array<T>::remove(u32 index)
+template <typename T, typename Allocator>
+inline void Array<T, Allocator>::remove(u32 index)
 {
 	if (index < count) {
 		u32 offset = index + 1;
-		for (; offset < count; offset++) {
-			items[offset - 1] = items[offset];
+		if constexpr (std::is_trivially_copyable<T>::value) {
+			if (offset < count) {
+				memmove((void *)&items[index], (void *)&items[offset], sizeof(T) * (count - offset));
+			}
+			memset((void *)&items[count - 1], 0, sizeof(T));
+		} else {
+			for (; offset < count; offset++) {
+				items[offset - 1] = std::move(items[offset]);
+			}
+			items[count - 1] = T();
 		}
-		memset((void *)&items[count - 1], 0, sizeof(T));
 		count -= 1;
 	}
 }
 
-template <typename T>
-inline void Array<T>::reserve(u32 _count)
+template <typename T, typename Allocator>
+inline void Array<T, Allocator>::reserve(u32 _count)
 {
-	if (!is_empty()) {
-		clear();
+	clear();
+	if (_count > size) {
+		resize(_count);
 	}
-	resize(_count);
 	count = _count;
 }
 
-template <typename T>
-inline void Array<T>::set_pointer_to_item(T *ptr, u32 index)
+template <typename T, typename Allocator>
+inline void Array<T, Allocator>::set_pointer_to_item(T *ptr, u32 index)
 {
 	assert(count > index);
 
 	*ptr = items[index];
 }
 
-template <typename T>
-inline void Array<T>::set_pointer_to_item(T **ptr, u32 index)
+template <typename T, typename Allocator>
+inline void Array<T, Allocator>::set_pointer_to_item(T **ptr, u32 index)
 {
 	assert(count > index);
 	*ptr = &items[index];
 }
 
-template <typename T>
-inline bool Array<T>::is_empty()
+template <typename T, typename Allocator>
+inline bool Array<T, Allocator>::is_empty()
 {
 	assert(count >= 0);
 
 	return count == 0;
 }
 
-template<typename T>
-inline bool Array<T>::find(const T &item)
+template <typename T, typename Allocator>
+inline bool Array<T, Allocator>::find(const T &item)
 {
 	for (u32 i = 0; i < count; i++) {
 		if (item == items[i]) {
@@ -190,44 +289,82 @@ inline bool Array<T>::find(const T &item)
 	return false;
 }
 
-template <typename T>
-inline u32 Array<T>::push(const T &item)
+template <typename T, typename Allocator>
+inline u32 Array<T, Allocator>::push(const T &item)
 {
 	if (count >= size) {
-		resize(size * 2);
+		// The item can be a reference to an item of this array.
+		T temp = item;
+		resize((size > 0) ? size * 2 : 8);
+		items[count] = std::move(temp);
+		return count++;
 	}
 	items[count] = item;
 	return count++;
 }
 
-template<typename T>
-inline u32 Array<T>::get_size()
+template <typename T, typename Allocator>
+inline u32 Array<T, Allocator>::push(T &&item)
+{
+	if (count >= size) {
+		T temp = std::move(item);
+		resize((size > 0) ? size * 2 : 8);
+		items[count] = std::move(temp);
+		return count++;
+	}
+	items[count] = std::move(item);
+	return count++;
+}
+
+template <typename T, typename Allocator>
+inline u32 Array<T, Allocator>::get_size()
 {
 	return sizeof(T) * count;
 }
 
-template <typename T>
-inline T &Array<T>::get(u32 index)
+template <typename T, typename Allocator>
+inline T &Array<T, Allocator>::get(u32 index)
 {
 	return items[index];
 }
 
-template<typename T>
-inline T &Array<T>::first()
+template <typename T, typename Allocator>
+inline T &Array<T, Allocator>::first()
 {
 	assert(count > 0);
 	return items[0];
 }
 
-template<typename T>
-inline T &Array<T>::last()
+// The last item is moved into the removed place, so the order of items is not kept.
+template <typename T, typename Allocator>
+inline void Array<T, Allocator>::swap_remove(u32 index)
+{
+	if (index < count) {
+		u32 last_index = count - 1;
+		if constexpr (std::is_trivially_copyable<T>::value) {
+			if (index < last_index) {
+				memcpy((void *)&items[index], (void *)&items[last_index], sizeof(T));
+			}
+			memset((void *)&items[last_index], 0, sizeof(T));
+		} else {
+			if (index < last_index) {
+				items[index] = std::move(items[last_index]);
+			}
+			items[last_index] = T();
+		}
+		count -= 1;
+	}
+}
+
+template <typename T, typename Allocator>
+inline T &Array<T, Allocator>::last()
 {
 	assert(count > 0);
 	return items[count - 1];
 }
 
-template <typename T>
-inline T &Array<T>::pop()
+template <typename T, typename Allocator>
+inline T &Array<T, Allocator>::pop()
 {
 	assert(count > 0);
 	return items[--count];
@@ -239,7 +376,13 @@ inline void merge(Array<T> *dst, Array<T> *src)
 	if ((dst->count + src->count) > dst->size) {
 		dst->resize(dst->count + src->count);
 	}
-	memcpy((void *)&dst->items[dst->count], (void *)src->items, sizeof(T) * src->count);
+	if constexpr (std::is_trivially_copyable<T>::value) {
+		memcpy((void *)&dst->items[dst->count], (void *)src->items, sizeof(T) * src->count);
+	} else {
+		for (u32 i = 0; i < src->count; i++) {
+			dst->items[dst->count + i] = src->items[i];
+		}
+	}
 	dst->count += src->count;
 }
 
@@ -65,7 +65,14 @@
 
 u32 fast_hash(const char *data)
 {
-    u32 len = (u32)strlen(data);
+    if (data == NULL) return 0;
+
+    return fast_hash((const void *)data, (u32)strlen(data));
+}
+
+u32 fast_hash(const void *bytes, u32 len)
+{
+    const char *data = (const char *)bytes;
     u32 hash = len, tmp;
     int rem;
 
@@ -1,7 +1,9 @@
 #ifndef HASH_TABLE_H
 #define HASH_TABLE_H
 
+#include <new>
 #include <math.h>
+#include <assert.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -10,24 +12,46 @@
 #include "../../sys/utils.h"
 
 u32 fast_hash(const char *data);
+u32 fast_hash(const void *data, u32 len);
 
-inline u32 hash(const char *string, int factor, int table_count)
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define HASH_TABLE_USE_SSE
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+inline u32 hash(const char *string)
 {
-	unsigned long hash = 5381;
-	int c;
+	return fast_hash(string);
+}
 
-	while (c = *string++) {
-		hash = factor * ((hash << 5) + hash) + c;
-	}
-	return (u32)(hash % table_count);
+inline u32 hash(const String &string)
+{
+	return fast_hash((const void *)string.data, string.len);
 }
 
-inline u32 hash(int number, int table_count, int attempt)
+inline u32 hash(u32 number)
 {
-	char *str = to_string(number);
-	u32 h = hash(str, table_count, attempt);
-	free_string(str);
-	return h;
+	number ^= number >> 16;
+	number *= 0x85ebca6b;
+	number ^= number >> 13;
+	number *= 0xc2b2ae35;
+	number ^= number >> 16;
+	return number;
+}
+
+inline u32 hash(int number)
+{
+	return hash((u32)number);
+}
+
+inline u32 hash(u64 number)
+{
+	return hash((u32)number ^ hash((u32)(number >> 32)));
 }
 
 template <typename _Key_, typename _Value_>
@@ -54,6 +78,59 @@ struct Hash_Node<String, _Value_> {
 	bool compare(const String key2) { return key == key2; }
 };
 
+// A control byte describes one slot of a table. The high bit is set for empty and deleted slots,
+// full slots keep the low 7 bits of a key hash, so one SIMD compare filters 16 slots at once.
+const u8 HASH_TABLE_EMPTY = 0x80;
+const u8 HASH_TABLE_DELETED = 0xfe;
+const u32 HASH_TABLE_GROUP_WIDTH = 16;
+
+inline u32 find_first_set_bit(u32 mask)
+{
+	assert(mask != 0);
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return (u32)index;
+#else
+	return (u32)__builtin_ctz(mask);
+#endif
+}
+
+// Returns a bit mask of group slots whose control bytes are equal to the value.
+inline u32 match_control_bytes(const u8 *group, u8 value)
+{
+#ifdef HASH_TABLE_USE_SSE
+	__m128i controls = _mm_loadu_si128((const __m128i *)group);
+	return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(controls, _mm_set1_epi8((char)value)));
+#else
+	u32 mask = 0;
+	for (u32 i = 0; i < HASH_TABLE_GROUP_WIDTH; i++) {
+		mask |= (group[i] == value) ? (1 << i) : 0;
+	}
+	return mask;
+#endif
+}
+
+// Returns a bit mask of group slots which are empty or deleted.
+inline u32 match_free_control_bytes(const u8 *group)
+{
+#ifdef HASH_TABLE_USE_SSE
+	return (u32)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+#else
+	u32 mask = 0;
+	for (u32 i = 0; i < HASH_TABLE_GROUP_WIDTH; i++) {
+		mask |= (group[i] & 0x80) ? (1 << i) : 0;
+	}
+	return mask;
+#endif
+}
+
+// Open addressing hash table, keys and values are placed inline in one allocation together with control bytes.
+// Slots are probed by groups of HASH_TABLE_GROUP_WIDTH, a group index moves by triangular numbers
+// and the group count is a power of two so every group is visited. Removed slots become tombstones
+// unless their group still has an empty slot, in that case no probe sequence went past it.
+// Entries are moved to new slots when the table grows, so addresses of values are valid only until the next insert.
+// Values whose addresses are kept have to be allocated separately and stored as pointers.
 template <typename _Key_, typename _Value_>
 struct Hash_Table {
 	Hash_Table(int _size = 8);
@@ -61,237 +138,328 @@ struct Hash_Table {
 
 	typedef Hash_Node<_Key_, _Value_> Table_Entry;
 
-	Array<Table_Entry *> nodes;
+	Hash_Table(const Hash_Table<_Key_, _Value_> &other);
+	Hash_Table<_Key_, _Value_> &operator=(const Hash_Table<_Key_, _Value_> &other);
+
+	u8 *controls = NULL;
+	Table_Entry *entries = NULL;
 
-	u32 size = 0;
 	u32 count = 0;
-	u32 max_loop = 0;
-	u32 table_size = 0;
-	u32 hash_factor1 = 7;
-	u32 hash_facotr2 = 11;
+	u32 capacity = 0;
+	u32 growth_left = 0;
 
 	void clear();
-	void rehash();
-	void insert_entry(Table_Entry *entry);
-	void free_table(Table_Entry **table, u32 _table_size);
+	void reserve(u32 entry_count);
+	void rehash(u32 new_capacity);
+	void free();
 
 	void set(const _Key_ &key, const _Value_ &value);
+	bool remove(const _Key_ &key);
 
 	bool key_in_table(const _Key_ &key);
 	bool get(const _Key_ &key, _Value_ &value);
 	bool get(const _Key_ &key, _Value_ *value);
 
-	u32 hash1(const _Key_ &key);
-	u32 hash2(const _Key_ &key);
-
-	_Value_ &get_value(u32 index);
 	_Value_ &operator[](const _Key_ &key);
 
-	Hash_Node<_Key_, _Value_> *get_node(u32 index);
-	Hash_Node<_Key_, _Value_> *get_table_entry(const _Key_ &key);
-};
+	u32 find_entry_index(const _Key_ &key, u32 key_hash);
+	u32 find_free_entry_index(u32 key_hash);
+	u32 insert_entry(const _Key_ &key, const _Value_ &value, u32 key_hash);
 
-template<typename _Key_, typename _Value_>
-Hash_Table<_Key_, _Value_>::Hash_Table(int _size)
-{
-	rand();
-	hash_factor1 = rand();
-	hash_facotr2 = rand() % 256;
-	size = _size;
-	table_size = _size * 2;
-	max_loop = table_size;
+	Table_Entry *get_table_entry(const _Key_ &key);
 
-	nodes.resize(table_size);
+	// Iteration goes through the slots linearly:
+	// for (Table_Entry *entry = table.first_entry(); entry; entry = table.next_entry(entry)) {}
+	Table_Entry *first_entry();
+	Table_Entry *next_entry(Table_Entry *entry);
+	Table_Entry *find_full_entry(u32 start_index);
+};
 
-	memset(nodes.items, 0, sizeof(Table_Entry *) * table_size);
+inline u32 get_hash_table_capacity(u32 entry_count)
+{
+	// The table keeps at least 1/8 of slots free.
+	u32 min_capacity = entry_count + entry_count / 7 + 1;
+	u32 capacity = HASH_TABLE_GROUP_WIDTH;
+	while (capacity < min_capacity) {
+		capacity *= 2;
+	}
+	return capacity;
 }
 
-template<typename _Key_, typename _Value_>
-Hash_Table<_Key_, _Value_>::~Hash_Table()
+inline u32 get_hash_table_max_load(u32 capacity)
 {
-	for (u32 i = 0; i < table_size; i++) {
-		delete nodes[i];
-	}
+	return capacity - capacity / 8;
 }
 
 template<typename _Key_, typename _Value_>
-u32 Hash_Table<_Key_, _Value_>::hash1(const _Key_ &key)
+Hash_Table<_Key_, _Value_>::Hash_Table(int _size)
 {
-	return (u32)hash((_Key_)key, hash_factor1, size);
+	// Memory is allocated by the first insert, so empty tables don't touch the heap.
 }
 
 template<typename _Key_, typename _Value_>
-u32 Hash_Table<_Key_, _Value_>::hash2(const _Key_ &key)
+Hash_Table<_Key_, _Value_>::~Hash_Table()
 {
-	return (u32)hash((_Key_)key, hash_facotr2, size) + size;
+	free();
 }
 
 template<typename _Key_, typename _Value_>
-_Value_ &Hash_Table<_Key_, _Value_>::get_value(u32 index)
+inline Hash_Table<_Key_, _Value_>::Hash_Table(const Hash_Table<_Key_, _Value_> &other)
 {
-	Table_Entry *entry = get_node(index);
-	return entry->value;
+	*this = other;
 }
 
 template<typename _Key_, typename _Value_>
-_Value_ &Hash_Table<_Key_, _Value_>::operator[](const _Key_ &key)
+inline Hash_Table<_Key_, _Value_> &Hash_Table<_Key_, _Value_>::operator=(const Hash_Table<_Key_, _Value_> &other)
 {
-	Table_Entry *entry = get_table_entry(key);
-	if (!entry) {
-		_Value_ value;
-		entry = new Table_Entry(key, value);
-		insert_entry(entry);
+	if (this == &other) {
+		return *this;
+	}
+	free();
+	if (other.count > 0) {
+		reserve(other.count);
+		Hash_Table<_Key_, _Value_> *source = (Hash_Table<_Key_, _Value_> *)&other;
+		for (Table_Entry *entry = source->first_entry(); entry; entry = source->next_entry(entry)) {
+			insert_entry(entry->key, entry->value, hash(entry->key));
+		}
 	}
-	return entry->value;
+	return *this;
 }
 
 template<typename _Key_, typename _Value_>
-Hash_Node<_Key_, _Value_> *Hash_Table<_Key_, _Value_>::get_node(u32 index)
+void Hash_Table<_Key_, _Value_>::free()
 {
-	assert(count > index);
-
-	u32 node_count = 0;
-	for (u32 i = 0; i < table_size; i++) {
-		Hash_Node<_Key_, _Value_> *node = nodes[i];
-		if ((node != NULL) && (node_count == index)) {
-			return node;
-		} else {
-			if (node != NULL) {
-				node_count += 1;
+	if (controls) {
+		for (u32 i = 0; i < capacity; i++) {
+			if (!(controls[i] & 0x80)) {
+				entries[i].~Table_Entry();
 			}
 		}
+		delete[] controls;
 	}
-	assert(false);
-	return NULL;
+	controls = NULL;
+	entries = NULL;
+	count = 0;
+	capacity = 0;
+	growth_left = 0;
 }
 
 template<typename _Key_, typename _Value_>
-Hash_Node<_Key_, _Value_> *Hash_Table<_Key_, _Value_>::get_table_entry(const _Key_ &key)
+inline void Hash_Table<_Key_, _Value_>::clear()
 {
-	u32 _hash1 = hash1(key);
-	u32 _hash2 = hash2(key);
-
-	if ((nodes[_hash1] != NULL) && (nodes[_hash1]->key == key)) {
-		return nodes[_hash1];
+	// Keeps the allocated memory.
+	if (!controls) {
+		return;
 	}
-
-	if ((nodes[_hash2] != NULL) && (nodes[_hash2]->key == key)) {
-		return nodes[_hash2];
+	for (u32 i = 0; i < capacity; i++) {
+		if (!(controls[i] & 0x80)) {
+			entries[i].~Table_Entry();
+		}
 	}
-	return NULL;
+	memset((void *)controls, HASH_TABLE_EMPTY, capacity);
+	count = 0;
+	growth_left = get_hash_table_max_load(capacity);
 }
 
-
 template<typename _Key_, typename _Value_>
-inline void Hash_Table<_Key_, _Value_>::clear()
+void Hash_Table<_Key_, _Value_>::reserve(u32 entry_count)
 {
-	Table_Entry *table_entry = NULL;
-	For(nodes, table_entry) {
-		if (table_entry) {
-			DELETE_PTR(table_entry);
-		}
+	u32 new_capacity = get_hash_table_capacity(entry_count);
+	if (new_capacity > capacity) {
+		rehash(new_capacity);
 	}
-	nodes.clear();
+}
 
-	rand();
+template<typename _Key_, typename _Value_>
+void Hash_Table<_Key_, _Value_>::rehash(u32 new_capacity)
+{
+	static_assert(alignof(Table_Entry) <= HASH_TABLE_GROUP_WIDTH, "Hash_Table: Entries are placed right after control bytes, they can't have bigger alignment.");
+	assert(new_capacity >= HASH_TABLE_GROUP_WIDTH);
+	assert((new_capacity & (new_capacity - 1)) == 0);
+	assert(get_hash_table_max_load(new_capacity) >= count);
+
+	u8 *old_controls = controls;
+	Table_Entry *old_entries = entries;
+	u32 old_capacity = capacity;
+
+	// new[] returns memory aligned for any fundamental type and the capacity is a multiple of 16,
+	// so entries placed after control bytes are aligned too.
+	controls = new u8[new_capacity + new_capacity * sizeof(Table_Entry)];
+	entries = (Table_Entry *)(controls + new_capacity);
+	memset((void *)controls, HASH_TABLE_EMPTY, new_capacity);
+
+	capacity = new_capacity;
 	count = 0;
-	size = 8;
-	hash_factor1 = rand();
-	hash_facotr2 = rand() % 256;
-	table_size = size * 2;
-	max_loop = table_size;
+	growth_left = get_hash_table_max_load(new_capacity);
 
-	nodes.resize(table_size);
-
-	memset(nodes.items, 0, sizeof(Table_Entry *) * table_size);
+	if (old_controls) {
+		for (u32 i = 0; i < old_capacity; i++) {
+			if (!(old_controls[i] & 0x80)) {
+				insert_entry(old_entries[i].key, old_entries[i].value, hash(old_entries[i].key));
+				old_entries[i].~Table_Entry();
+			}
+		}
+		delete[] old_controls;
+	}
 }
 
 template<typename _Key_, typename _Value_>
-void Hash_Table<_Key_, _Value_>::rehash()
+u32 Hash_Table<_Key_, _Value_>::find_entry_index(const _Key_ &key, u32 key_hash)
 {
-	u32 old_table_size = table_size;
-	u32 _size = size * 2;
-
-	hash_factor1 = rand();
-	hash_facotr2 = rand() % 256;
-	size = _size;
-	count = 0;
-	table_size = table_size * 2;
-	max_loop = table_size;
+	if (count == 0) {
+		return UINT32_MAX;
+	}
+	u8 control = (u8)(key_hash & 0x7f);
+	u32 group_mask = capacity / HASH_TABLE_GROUP_WIDTH - 1;
+	u32 group = (key_hash >> 7) & group_mask;
+
+	for (u32 step = 1; step <= (group_mask + 1); step++) {
+		u8 *group_controls = controls + group * HASH_TABLE_GROUP_WIDTH;
+		u32 mask = match_control_bytes(group_controls, control);
+		while (mask) {
+			u32 index = group * HASH_TABLE_GROUP_WIDTH + find_first_set_bit(mask);
+			if (entries[index].key == key) {
+				return index;
+			}
+			mask &= mask - 1;
+		}
+		if (match_control_bytes(group_controls, HASH_TABLE_EMPTY)) {
+			return UINT32_MAX;
+		}
+		group = (group + step) & group_mask;
+	}
+	return UINT32_MAX;
+}
 
-	Table_Entry **old_nodes = nodes.items;
+template<typename _Key_, typename _Value_>
+u32 Hash_Table<_Key_, _Value_>::find_free_entry_index(u32 key_hash)
+{
+	u32 group_mask = capacity / HASH_TABLE_GROUP_WIDTH - 1;
+	u32 group = (key_hash >> 7) & group_mask;
 
-	nodes.items = new Table_Entry * [table_size];
-	nodes.size = table_size;
-	memset(nodes.items, 0, sizeof(Table_Entry *) * table_size);
+	for (u32 step = 1; step <= (group_mask + 1); step++) {
+		u32 mask = match_free_control_bytes(controls + group * HASH_TABLE_GROUP_WIDTH);
+		if (mask) {
+			return group * HASH_TABLE_GROUP_WIDTH + find_first_set_bit(mask);
+		}
+		group = (group + step) & group_mask;
+	}
+	assert(false);
+	return UINT32_MAX;
+}
 
-	for (u32 i = 0; i < old_table_size; i++) {
-		Table_Entry *entry = old_nodes[i];
-		if (entry != NULL) {
-			insert_entry(entry);
+template<typename _Key_, typename _Value_>
+u32 Hash_Table<_Key_, _Value_>::insert_entry(const _Key_ &key, const _Value_ &value, u32 key_hash)
+{
+	if (growth_left == 0) {
+		// If most of used slots are tombstones the table is cleaned up without growing.
+		u32 new_capacity = capacity;
+		if ((capacity == 0) || ((count + 1) > (get_hash_table_max_load(capacity) / 2))) {
+			new_capacity = get_hash_table_capacity(count + 1);
+			if (new_capacity <= capacity) {
+				new_capacity = capacity * 2;
+			}
 		}
+		rehash(new_capacity);
+	}
+	u32 index = find_free_entry_index(key_hash);
+	if (controls[index] == HASH_TABLE_EMPTY) {
+		growth_left -= 1;
 	}
-	delete[] old_nodes;
+	controls[index] = (u8)(key_hash & 0x7f);
+	new (&entries[index]) Table_Entry(key, value);
+	count += 1;
+	return index;
 }
 
 template<typename _Key_, typename _Value_>
-void Hash_Table<_Key_, _Value_>::free_table(Table_Entry **table, u32 _table_size)
+Hash_Node<_Key_, _Value_> *Hash_Table<_Key_, _Value_>::get_table_entry(const _Key_ &key)
 {
-	delete[] table;
-	table = NULL;
+	u32 index = find_entry_index(key, hash(key));
+	if (index != UINT32_MAX) {
+		return &entries[index];
+	}
+	return NULL;
 }
 
 template<typename _Key_, typename _Value_>
-void Hash_Table<_Key_, _Value_>::insert_entry(Table_Entry *entry)
+Hash_Node<_Key_, _Value_> *Hash_Table<_Key_, _Value_>::find_full_entry(u32 start_index)
 {
-	_Key_ _key = entry->key;
+	for (u32 i = start_index; i < capacity; i += HASH_TABLE_GROUP_WIDTH) {
+		u32 group_start = i & ~(HASH_TABLE_GROUP_WIDTH - 1);
+		u32 mask = ~match_free_control_bytes(controls + group_start) & 0xffff;
+		mask &= ~((1 << (i - group_start)) - 1);
+		if (mask) {
+			return &entries[group_start + find_first_set_bit(mask)];
+		}
+		i = group_start;
+	}
+	return NULL;
+}
 
-	Table_Entry *inserting_entry = entry;
-	Table_Entry **existing_entry = NULL;
+template<typename _Key_, typename _Value_>
+inline Hash_Node<_Key_, _Value_> *Hash_Table<_Key_, _Value_>::first_entry()
+{
+	return find_full_entry(0);
+}
 
-	for (u32 i = 0; i < max_loop; i++) {
-		u32 hashies[] = { hash1(_key), hash2(_key) };
+template<typename _Key_, typename _Value_>
+inline Hash_Node<_Key_, _Value_> *Hash_Table<_Key_, _Value_>::next_entry(Table_Entry *entry)
+{
+	assert(entry);
+	assert((entry >= entries) && (entry < (entries + capacity)));
 
-		u32 index = hashies[i % 2];
+	return find_full_entry((u32)(entry - entries) + 1);
+}
 
-		if (nodes[index] == NULL) {
-			nodes[index] = inserting_entry;
-			break;
-		}
-		Table_Entry *temp = nodes[index];
-		nodes[index] = inserting_entry;
-		inserting_entry = temp;
-		_key = temp->key;
-
-		if ((i + 1) >= max_loop) {
-			rehash();
-			i = 0;
-		}
+template<typename _Key_, typename _Value_>
+_Value_ &Hash_Table<_Key_, _Value_>::operator[](const _Key_ &key)
+{
+	u32 key_hash = hash(key);
+	u32 index = find_entry_index(key, key_hash);
+	if (index == UINT32_MAX) {
+		_Value_ value = _Value_();
+		index = insert_entry(key, value, key_hash);
 	}
-	count++;
+	return entries[index].value;
 }
 
 template<typename _Key_, typename _Value_>
 void Hash_Table<_Key_, _Value_>::set(const _Key_ &key, const _Value_ &value)
 {
-	Table_Entry *entry = get_table_entry(key);
-	if (entry) {
-		entry->value = value;
+	u32 key_hash = hash(key);
+	u32 index = find_entry_index(key, key_hash);
+	if (index != UINT32_MAX) {
+		entries[index].value = value;
 		return;
 	}
+	insert_entry(key, value, key_hash);
+}
 
-	Table_Entry *new_entry = new Table_Entry(key, value);
-	insert_entry(new_entry);
+template<typename _Key_, typename _Value_>
+bool Hash_Table<_Key_, _Value_>::remove(const _Key_ &key)
+{
+	u32 index = find_entry_index(key, hash(key));
+	if (index == UINT32_MAX) {
+		return false;
+	}
+	entries[index].~Table_Entry();
+	count -= 1;
+
+	u8 *group_controls = controls + (index & ~(HASH_TABLE_GROUP_WIDTH - 1));
+	if (match_control_bytes(group_controls, HASH_TABLE_EMPTY)) {
+		controls[index] = HASH_TABLE_EMPTY;
+		growth_left += 1;
+	} else {
+		controls[index] = HASH_TABLE_DELETED;
+	}
+	return true;
 }
 
 template<typename _Key_, typename _Value_>
 bool Hash_Table<_Key_, _Value_>::key_in_table(const _Key_ &key)
 {
-	Table_Entry *entry = get_table_entry(key);
-	if (entry) {
-		return true;
-	}
-	return false;
+	return get_table_entry(key) != NULL;
 }
 
 template<typename _Key_, typename _Value_>
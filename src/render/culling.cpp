@@ -0,0 +1,176 @@
+#include <assert.h>
+#include <float.h>
+
+#ifdef CULLING_USE_SSE
+#include <emmintrin.h>
+#endif
+
+#include "culling.h"
+#include "../sys/profiling.h"
+#include "../libs/math/functions.h"
+
+inline Vector4 get_column(const Matrix4 &matrix, u32 column)
+{
+	return Vector4(matrix.m[0][column], matrix.m[1][column], matrix.m[2][column], matrix.m[3][column]);
+}
+
+Frustum make_frustum(const Matrix4 &view_projection_matrix)
+{
+	// Planes are extracted for row vectors (v * M) and the d3d clip space where 0 <= z <= w.
+	Vector4 column_x = get_column(view_projection_matrix, 0);
+	Vector4 column_y = get_column(view_projection_matrix, 1);
+	Vector4 column_z = get_column(view_projection_matrix, 2);
+	Vector4 column_w = get_column(view_projection_matrix, 3);
+
+	Frustum frustum;
+	frustum.planes[0] = column_w + column_x;
+	frustum.planes[1] = column_w - column_x;
+	frustum.planes[2] = column_w + column_y;
+	frustum.planes[3] = column_w - column_y;
+	frustum.planes[4] = column_z;
+	frustum.planes[5] = column_w - column_z;
+	return frustum;
+}
+
+Frustum make_shadow_caster_frustum(const Matrix4 &view_projection_matrix)
+{
+	Frustum frustum = make_frustum(view_projection_matrix);
+	// Every point is inside the plane, the casters are clamped to the near plane by the rasterizer.
+	frustum.planes[4] = Vector4(0.0f, 0.0f, 0.0f, 1.0f);
+	return frustum;
+}
+
+AABB transform_AABB(const AABB &aabb, const Matrix4 &matrix)
+{
+	Vector3 center = Vector3((aabb.min.x + aabb.max.x) * 0.5f, (aabb.min.y + aabb.max.y) * 0.5f, (aabb.min.z + aabb.max.z) * 0.5f);
+	Vector3 extents = Vector3((aabb.max.x - aabb.min.x) * 0.5f, (aabb.max.y - aabb.min.y) * 0.5f, (aabb.max.z - aabb.min.z) * 0.5f);
+
+	Vector3 world_center = center * matrix;
+	Vector3 world_extents;
+	world_extents.x = math::abs(matrix.m[0][0]) * extents.x + math::abs(matrix.m[1][0]) * extents.y + math::abs(matrix.m[2][0]) * extents.z;
+	world_extents.y = math::abs(matrix.m[0][1]) * extents.x + math::abs(matrix.m[1][1]) * extents.y + math::abs(matrix.m[2][1]) * extents.z;
+	world_extents.z = math::abs(matrix.m[0][2]) * extents.x + math::abs(matrix.m[1][2]) * extents.y + math::abs(matrix.m[2][2]) * extents.z;
+
+	return { world_center - world_extents, world_center + world_extents };
+}
+
+void Bounding_Boxes::resize(u32 box_count)
+{
+	u32 padded_count = ((box_count + CULLING_BATCH_SIZE - 1) / CULLING_BATCH_SIZE) * CULLING_BATCH_SIZE;
+	if (padded_count > capacity) {
+		u32 new_capacity = math::max(padded_count, capacity * 2);
+		min_x.resize(new_capacity);
+		min_y.resize(new_capacity);
+		min_z.resize(new_capacity);
+		max_x.resize(new_capacity);
+		max_y.resize(new_capacity);
+		max_z.resize(new_capacity);
+		capacity = new_capacity;
+	}
+	count = box_count;
+
+	// Padded boxes are inverted, they are outside of any plane.
+	for (u32 i = box_count; i < padded_count; i++) {
+		min_x[i] = FLT_MAX;
+		min_y[i] = FLT_MAX;
+		min_z[i] = FLT_MAX;
+		max_x[i] = -FLT_MAX;
+		max_y[i] = -FLT_MAX;
+		max_z[i] = -FLT_MAX;
+	}
+}
+
+void Bounding_Boxes::set(u32 index, const AABB &aabb)
+{
+	assert(index < count);
+
+	min_x[index] = aabb.min.x;
+	min_y[index] = aabb.min.y;
+	min_z[index] = aabb.min.z;
+	max_x[index] = aabb.max.x;
+	max_y[index] = aabb.max.y;
+	max_z[index] = aabb.max.z;
+}
+
+void Bounding_Boxes::set_unbounded(u32 index)
+{
+	set(index, { Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX), Vector3(FLT_MAX, FLT_MAX, FLT_MAX) });
+}
+
+AABB Bounding_Boxes::get(u32 index)
+{
+	assert(index < count);
+
+	return { Vector3(min_x[index], min_y[index], min_z[index]), Vector3(max_x[index], max_y[index], max_z[index]) };
+}
+
+bool Bounding_Boxes::is_unbounded(u32 index)
+{
+	assert(index < count);
+
+	return min_x[index] == -FLT_MAX;
+}
+
+void cull_bounding_boxes(Frustum *frustum, Bounding_Boxes *boxes, Array<u32> *visible_indices, u8 *visibility)
+{
+	assert(frustum);
+	assert(boxes);
+	assert(visible_indices);
+
+	// For every plane only the box corner lying farthest along the plane normal is tested,
+	// which corner it is depends only on the plane so the choice is made once per plane.
+	float *positive_x[6];
+	float *positive_y[6];
+	float *positive_z[6];
+	for (u32 i = 0; i < 6; i++) {
+		positive_x[i] = (frustum->planes[i].x > 0.0f) ? boxes->max_x.items : boxes->min_x.items;
+		positive_y[i] = (frustum->planes[i].y > 0.0f) ? boxes->max_y.items : boxes->min_y.items;
+		positive_z[i] = (frustum->planes[i].z > 0.0f) ? boxes->max_z.items : boxes->min_z.items;
+	}
+
+	for (u32 i = 0; i < boxes->count; i += CULLING_BATCH_SIZE) {
+		u32 mask = 0;
+#ifdef CULLING_USE_SSE
+		__m128 zero = _mm_setzero_ps();
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (u32 j = 0; j < 6; j++) {
+			Vector4 &plane = frustum->planes[j];
+			__m128 distance = _mm_set1_ps(plane.w);
+			distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.x), _mm_loadu_ps(&positive_x[j][i])));
+			distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.y), _mm_loadu_ps(&positive_y[j][i])));
+			distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(plane.z), _mm_loadu_ps(&positive_z[j][i])));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, zero));
+		}
+		mask = (u32)_mm_movemask_ps(inside);
+#else
+		for (u32 k = 0; k < CULLING_BATCH_SIZE; k++) {
+			bool inside = true;
+			for (u32 j = 0; (j < 6) && inside; j++) {
+				Vector4 &plane = frustum->planes[j];
+				float distance = plane.x * positive_x[j][i + k] + plane.y * positive_y[j][i + k] + plane.z * positive_z[j][i + k] + plane.w;
+				inside = distance >= 0.0f;
+			}
+			mask |= inside ? (1 << k) : 0;
+		}
+#endif
+		u32 batch_count = math::min(CULLING_BATCH_SIZE, boxes->count - i);
+		for (u32 k = 0; k < batch_count; k++) {
+			bool visible = (mask & (1 << k)) != 0;
+			if (visible) {
+				visible_indices->push(i + k);
+			}
+			if (visibility) {
+				visibility[i + k] = visible ? 1 : 0;
+			}
+		}
+	}
+}
+
+void run_culling_job(void *data)
+{
+	PROFILE_ZONE("Culling job");
+
+	Culling_Job *culling_job = (Culling_Job *)data;
+	culling_job->visible_indices->count = 0;
+	cull_bounding_boxes(&culling_job->frustum, culling_job->bounding_boxes, culling_job->visible_indices, culling_job->visibility);
+}
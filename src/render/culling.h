@@ -0,0 +1,61 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include "../collision/collision.h"
+#include "../libs/number_types.h"
+#include "../libs/math/vector.h"
+#include "../libs/math/matrix.h"
+#include "../libs/structures/array.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define CULLING_USE_SSE
+#endif
+
+const u32 CULLING_BATCH_SIZE = 4;
+
+struct Frustum {
+	// left, right, bottom, top, near, far.
+	// A point is inside a plane if dot(plane.xyz, point) + plane.w >= 0. Planes are not normalized.
+	Vector4 planes[6];
+};
+
+Frustum make_frustum(const Matrix4 &view_projection_matrix);
+// The frustum of an orthographic shadow cascade without the near plane, objects between the light and the cascade still cast shadows into it.
+Frustum make_shadow_caster_frustum(const Matrix4 &view_projection_matrix);
+AABB transform_AABB(const AABB &aabb, const Matrix4 &matrix);
+
+// Bounding boxes are kept in SoA layout, so one SIMD test checks CULLING_BATCH_SIZE boxes against a plane.
+// The storage is padded up to CULLING_BATCH_SIZE, padded boxes are never reported as visible.
+struct Bounding_Boxes {
+	u32 count = 0;
+	u32 capacity = 0;
+
+	Array<float> min_x;
+	Array<float> min_y;
+	Array<float> min_z;
+	Array<float> max_x;
+	Array<float> max_y;
+	Array<float> max_z;
+
+	void resize(u32 box_count);
+	void set(u32 index, const AABB &aabb);
+	void set_unbounded(u32 index);
+	AABB get(u32 index);
+	bool is_unbounded(u32 index);
+};
+
+// Appends indices of boxes intersecting the frustum to visible_indices.
+// If visibility is passed it must hold at least boxes->count items, each one is set to 1 or 0.
+void cull_bounding_boxes(Frustum *frustum, Bounding_Boxes *boxes, Array<u32> *visible_indices, u8 *visibility = NULL);
+
+struct Culling_Job {
+	Frustum frustum;
+	Bounding_Boxes *bounding_boxes = NULL;
+	Array<u32> *visible_indices = NULL;
+	u8 *visibility = NULL;
+};
+
+// A job function for the job system, data is a Culling_Job. Visible indices are cleared before culling.
+void run_culling_job(void *data);
+
+#endif
@@ -9,33 +9,6 @@
 
 static const char *DEFAULT_PATH_TO_FONT_DIR = "C:/Windows/Fonts/";
 
-inline u32 *r8_to_rgba32(u8 *data, u32 width, u32 height)
-{
-	u32 *new_data = new u32[width * height];
-
-	u8 *pixels = (u8 *)new_data;
-	for (u32 row = 0; row < height; row++) {
-		u32 row_start = row * (width * sizeof(u32));
-		u32 row_2 = row * (width * sizeof(u8));
-
-		for (u32 col = 0; col < width; col++) {
-			u32 col_start = col * 4;
-			if (data[row_2 + col] > 0) {
-				pixels[row_start + col_start + 0] = 255;
-				pixels[row_start + col_start + 1] = 255;
-				pixels[row_start + col_start + 2] = 255;
-				pixels[row_start + col_start + 3] = data[row_2 + col];
-			} else {
-				pixels[row_start + col_start + 0] = 255;
-				pixels[row_start + col_start + 1] = 0;
-				pixels[row_start + col_start + 2] = 0;
-				pixels[row_start + col_start + 3] = 0;
-			}
-		}
-	}
-	return new_data;
-}
-
 Font::Font()
 {
 	characters.reserve(MAX_CHARACTERS);
@@ -43,7 +16,7 @@ Font::Font()
 
 u32 Font::get_char_advance(char c)
 {
-	return characters[c].advance;
+	return get_font_char((u8)c)->advance;
 }
 
 u32 Font::get_text_width(const char *text)
@@ -56,22 +29,7 @@ Size_u32 Font::get_text_size(const char *text, Text_Alignment text_alignment)
 {
 	assert(text);
 
-	u32 len = (u32)strlen(text);
-	u32 mines_one_len = len - 1;
-	Size_u32 text_size = { 0, 0 };
-	if (len == 0) {
-		return text_size;
-	}
-
-	Font_Char *font_char = NULL;
-	for (u32 index = 0; index < mines_one_len; index++) {
-		font_char = get_font_char(text[index]);
-		text_size.width += (font_char->advance);
-		text_size.height = math::max(text_size.height, font_char->size.height);
-	}
-	font_char = get_font_char(text[mines_one_len]);
-	text_size.width += font_char->bearing.width + font_char->size.width;
-	text_size.height = math::max(text_size.height, font_char->size.height);
+	Size_u32 text_size = get_text_run(text)->size;
 
 	switch (text_alignment) {
 		case ALIGN_TEXT_BY_MAX_NUMBER: {
@@ -90,41 +48,159 @@ Size_u32 Font::get_text_size(const char *text, Text_Alignment text_alignment)
 	return text_size;
 }
 
-Font_Char *Font::get_font_char(u8 character)
+Text_Run *Font::get_text_run(const char *text)
 {
-	return &characters[(u32)character];
+	return text_run_cache.get_text_run(this, text);
 }
 
-Font_Char::~Font_Char()
+u32 Text_Run::find_char(u32 x)
 {
-	DELETE_PTR(bitmap);
+	// Offsets grow, the char i ends at caret_offsets[i + 1].
+	u32 first = 0;
+	u32 last = get_char_count();
+	while (first < last) {
+		u32 middle = first + (last - first) / 2;
+		if (caret_offsets[middle + 1] < x) {
+			first = middle + 1;
+		} else {
+			last = middle;
+		}
+	}
+	return first;
 }
 
-Font_Char::Font_Char(const Font_Char &other)
+void Text_Run_Cache::clear()
 {
-	*this = other;
+	runs.clear();
+	run_indices.clear();
 }
 
-Font_Char &Font_Char::operator=(const Font_Char &other)
+Text_Run *Text_Run_Cache::get_text_run(Font *font, const char *text)
 {
-	if (this != &other) {
-		character = other.character;
-		advance = other.advance;
-		size = other.size;
-		bearing = other.bearing;
+	assert(font);
+	assert(text);
+
+	u32 text_hash = fast_hash(text);
+	u32 run_index = 0;
+	if (run_indices.get(text_hash, &run_index)) {
+		Text_Run *text_run = &runs[run_index];
+		if (text_run->text == text) {
+			hit_count++;
+			return text_run;
+		}
+		// A hash collision, the run is measured again for the new text.
+		miss_count++;
+		measure_text(font, text, text_run);
+		return text_run;
+	}
+	miss_count++;
 
-		if (other.bitmap) {
-			DELETE_PTR(bitmap);
-			bitmap = new u32[size.width * size.height];
-			memcpy((void *)bitmap, (void *)other.bitmap, (size.width * size.height) * sizeof(u32));
+	if (runs.count >= TEXT_RUN_CACHE_MAX_RUN_COUNT) {
+		clear();
+	}
+	run_index = runs.push(Text_Run());
+	run_indices.set(text_hash, run_index);
+
+	Text_Run *text_run = &runs[run_index];
+	text_run->text_hash = text_hash;
+	measure_text(font, text, text_run);
+	return text_run;
+}
+
+void Text_Run_Cache::measure_text(Font *font, const char *text, Text_Run *text_run)
+{
+	text_run->text = text;
+	text_run->size = { 0, 0 };
+	text_run->caret_offsets.clear();
+	text_run->caret_offsets.push(0);
+
+	u32 caret_offset = 0;
+	while (*text) {
+		Font_Char *font_char = font->get_font_char(next_codepoint(&text));
+		// The last char takes the width of its glyph instead of the advance.
+		if (*text) {
+			text_run->size.width += font_char->advance;
+		} else {
+			text_run->size.width += font_char->bearing.width + font_char->size.width;
 		}
+		text_run->size.height = math::max(text_run->size.height, font_char->size.height);
+
+		caret_offset += font_char->advance;
+		text_run->caret_offsets.push(caret_offset);
+	}
+}
+
+void Text_Run_Cache::print_stats(Font *font)
+{
+	u64 lookup_count = hit_count + miss_count;
+	float hit_rate = (lookup_count > 0) ? (float)hit_count * 100.0f / (float)lookup_count : 0.0f;
+
+	print("Text_Run_Cache: Font {} {}: {} runs, {} hits, {} misses ({}% hit rate).", font->name, font->font_size, runs.count, hit_count, miss_count, hit_rate);
+}
+
+// The pointer is valid until a new char is loaded.
+Font_Char *Font::get_font_char(u32 codepoint)
+{
+	if (codepoint < MAX_CHARACTERS) {
+		return &characters[codepoint];
+	}
+	Hash_Node<u32, Font_Char> *entry = extended_characters.get_table_entry(codepoint);
+	if (!entry) {
+		// Chars which failed to load are kept too, so they are not loaded every frame.
+		Font_Char font_char;
+		load_char_metrics(codepoint, &font_char);
+		extended_characters.set(codepoint, font_char);
+		entry = extended_characters.get_table_entry(codepoint);
+	}
+	return &entry->value;
+}
+
+bool Font::load_char_metrics(u32 codepoint, Font_Char *font_char)
+{
+	assert(face);
+	assert(font_char);
+
+	*font_char = Font_Char();
+	font_char->codepoint = codepoint;
+
+	if (FT_Load_Char(face, codepoint, FT_LOAD_DEFAULT)) {
+		print("Font::load_char_metrics: Failed to load char {} of font {}.", codepoint, name);
+		return false;
+	}
+	// The outline is not rasterized, hinted metrics are in 26.6 fixed point and match the bitmap of the glyph.
+	FT_Glyph_Metrics *metrics = &face->glyph->metrics;
+	font_char->advance = face->glyph->advance.x >> 6;
+	font_char->bearing = Size_u32(metrics->horiBearingX >> 6, metrics->horiBearingY >> 6);
+	font_char->size = Size_u32((metrics->width + 63) >> 6, (metrics->height + 63) >> 6);
+	return true;
+}
+
+u8 *Font::rasterize_char(u32 codepoint, u32 *width, u32 *height, u32 *pitch)
+{
+	assert(face);
+
+	if (FT_Load_Char(face, codepoint, FT_LOAD_RENDER)) {
+		print("Font::rasterize_char: Failed to rasterize char {} of font {}.", codepoint, name);
+		return NULL;
 	}
-	return *this;
+	FT_Bitmap *bitmap = &face->glyph->bitmap;
+	assert(bitmap->pitch >= 0);
+
+	*width = bitmap->width;
+	*height = bitmap->rows;
+	*pitch = (u32)bitmap->pitch;
+	return (u8 *)bitmap->buffer;
 }
 
-u32 Font_Char::get_index()
+Font_Manager::~Font_Manager()
 {
-	return (u32)character;
+	for (Hash_Node<String, Font *> *node = font_table.first_entry(); node; node = font_table.next_entry(node)) {
+		DELETE_PTR(node->value);
+	}
+	// Faces of fonts are released together with the library.
+	if (library) {
+		FT_Done_FreeType(library);
+	}
 }
 
 void Font_Manager::init()
@@ -140,61 +216,57 @@ void Font_Manager::init()
 	} else {
 		path_to_font_dir = path;
 	}
+
+	if (FT_Init_FreeType(&library)) {
+		print("Font_Manager::init: Could not init FreeType Library.");
+		library = NULL;
+	}
 }
 
 bool Font_Manager::load_font(const char *name, u32 font_size)
 {
-	FT_Library ft;
-	if (FT_Init_FreeType(&ft)) {
-		print("Font_Manager::load_font: Could not init FreeType Library.");
+	if (!library) {
+		print("Font_Manager::load_font: FreeType Library was not initialized.");
 		return false;
 	}
 
 	FT_Face face;
 	String full_path_to_font_file = path_to_font_dir + "\\" + name + ".ttf";
-	if (FT_New_Face(ft, full_path_to_font_file, 0, &face)) {
+	if (FT_New_Face(library, full_path_to_font_file, 0, &face)) {
 		print("Font_Manager::load_font: Failed to load font {}.ttf.", name);
 		return false;
 	}
 
-	face->num_fixed_sizes;
 	if (FT_Set_Pixel_Sizes(face, 0, font_size)) {
 		print("Font_Manager::load_font: Failed to load font {}.ttf with size {}.", name, font_size);
+		FT_Done_Face(face);
 		return false;
 	}
 
 	char *font_name = format("{}_{}", name, font_size);
-	Font font;
-	font.name = font_name;
-	font.font_size = font_size;
-
-	for (u8 c = 0; c < MAX_CHARACTERS; c++) {
-		if (FT_Load_Char(face, c, FT_LOAD_RENDER)) {
-			print("Font::init: Failed to load Char [{}] index [{}]", (char)c, (int)c);
+	// The face stays open, glyphs are rasterized when they are drawn for the first time.
+	Font *font = new Font();
+	font_table.set(font_name, font);
+	font->name = font_name;
+	font->font_size = font_size;
+	font->font_id = font_count++;
+	font->face = face;
+
+	for (u32 c = 0; c < MAX_CHARACTERS; c++) {
+		Font_Char *font_char = &font->characters[c];
+		if (!font->load_char_metrics(c, font_char)) {
 			continue;
 		}
 
-		Font_Char font_char;
-		font_char.character = c;
-		font_char.advance = face->glyph->advance.x >> 6;
-		font_char.bearing = Size_u32(face->glyph->bitmap_left, face->glyph->bitmap_top);
-		font_char.size = Size_u32(face->glyph->bitmap.width, face->glyph->bitmap.rows);
-
-		u32 *data = r8_to_rgba32((u8 *)face->glyph->bitmap.buffer, face->glyph->bitmap.width, face->glyph->bitmap.rows);
-		font_char.bitmap = data;
-
-		font.characters[font_char.get_index()] = font_char;
-
-		font.max_symbol_height = math::max(font.max_symbol_height, font_char.size.height);
+		font->max_symbol_height = math::max(font->max_symbol_height, font_char->size.height);
 
 		if (isalpha(c)) {
-			font.max_alphabet_height = math::max(font.max_alphabet_height, font_char.size.height);
+			font->max_alphabet_height = math::max(font->max_alphabet_height, font_char->size.height);
 		}
 		if (isdigit(c)) {
-			font.max_number_height = math::max(font.max_alphabet_height, font_char.size.height);
+			font->max_number_height = math::max(font->max_alphabet_height, font_char->size.height);
 		}
 	}
-	font_table.set(font_name, font);
 	free_string(font_name);
 
 	return true;
@@ -212,7 +284,7 @@ Font *Font_Manager::get_font(const char *name, u32 font_size)
 		}
 
 	}
-	Font *font = &font_table[font_name];
+	Font *font = font_table[font_name];
 	free_string(font_name);
 	return font;
 }
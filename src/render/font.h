@@ -14,20 +14,72 @@
 const u32 MAX_CHARACTERS = 128;
 const u32 CONTORL_CHARACTERS = 32;
 
-struct Font_Char {
-	Font_Char() {}
-	Font_Char(const Font_Char &other);
-	~Font_Char();
+// Returns the codepoint at the text and moves the text to the next one. Bytes which are not valid UTF-8 are returned as they are.
+inline u32 next_codepoint(const char **text)
+{
+	const u8 *bytes = (const u8 *)*text;
+	u32 length = 1;
+	u32 codepoint = bytes[0];
+	if ((bytes[0] & 0xe0) == 0xc0) {
+		length = 2;
+		codepoint = bytes[0] & 0x1f;
+	} else if ((bytes[0] & 0xf0) == 0xe0) {
+		length = 3;
+		codepoint = bytes[0] & 0x0f;
+	} else if ((bytes[0] & 0xf8) == 0xf0) {
+		length = 4;
+		codepoint = bytes[0] & 0x07;
+	}
+	for (u32 i = 1; i < length; i++) {
+		if ((bytes[i] & 0xc0) != 0x80) {
+			*text += 1;
+			return bytes[0];
+		}
+		codepoint = (codepoint << 6) | (bytes[i] & 0x3f);
+	}
+	*text += length;
+	return codepoint;
+}
 
-	u8 character;
-	u32 *bitmap = NULL;
-	u32 advance;
+// Only metrics of chars are kept, glyph bitmaps are rasterized by Glyph_Cache when they are drawn.
+struct Font_Char {
+	u32 codepoint = 0;
+	u32 advance = 0;
 	Size_u32 bearing;
 	Size_u32 size;
+};
+
+const u32 TEXT_RUN_CACHE_MAX_RUN_COUNT = 1024;
+
+struct Font;
 
+// A text measured once. caret_offsets[i] is the distance from the start of the text to the char i,
+// so there is one more offset than chars.
+struct Text_Run {
+	u32 text_hash = 0;
+	String text;
+	Size_u32 size; // The height is the max height of chars in the text.
+	Array<u32> caret_offsets;
 
-	Font_Char &operator=(const Font_Char &other);
-	u32 get_index();
+	u32 get_char_count() { return caret_offsets.count - 1; }
+	// Returns the index of the first char which ends at x or after it, the char count if the text ends before x.
+	u32 find_char(u32 x);
+};
+
+// Text runs of a font are keyed by hashes of their texts. When the cache is full it is cleared,
+// the GUI measures the same texts every frame so they are back in the cache after one frame.
+struct Text_Run_Cache {
+	u64 hit_count = 0;
+	u64 miss_count = 0;
+
+	Array<Text_Run> runs;
+	Hash_Table<u32, u32> run_indices;
+
+	void clear();
+	// The pointer is valid until the next text is added.
+	Text_Run *get_text_run(Font *font, const char *text);
+	void measure_text(Font *font, const char *text, Text_Run *text_run);
+	void print_stats(Font *font);
 };
 
 enum Text_Alignment {
@@ -41,6 +93,8 @@ struct Font {
 	Font();
 	String name;
 	u32 font_size;
+	u32 font_id = 0; // Unique for every loaded font, glyphs are cached by it.
+	FT_Face face = NULL;
 
 	u32 max_symbol_height = 0;
 	u32 max_alphabet_height = 0;
@@ -49,17 +103,28 @@ struct Font {
 	u32 bitmaps_width = 0;
 	u32 bitmaps_height = 0;
 
-	Array<Font_Char> characters;
+	Array<Font_Char> characters; // ASCII chars are loaded with the font.
+	Hash_Table<u32, Font_Char> extended_characters; // Other chars are loaded on first use.
+	Text_Run_Cache text_run_cache;
 
 	u32 get_char_advance(char c);
 	u32 get_text_width(const char *text);
 	Size_u32 get_text_size(const char *text, Text_Alignment text_alignment = ALIGN_TEXT_BY_MAX_SYMBOL_IN_TEXT);
-	Font_Char *get_font_char(u8 character);
+	Text_Run *get_text_run(const char *text);
+	// The pointer to an extended char is valid until the next extended char is loaded.
+	Font_Char *get_font_char(u32 codepoint);
+	bool load_char_metrics(u32 codepoint, Font_Char *font_char);
+	// The bitmap has one byte per pixel and is valid until the next char of the font is loaded.
+	u8 *rasterize_char(u32 codepoint, u32 *width, u32 *height, u32 *pitch);
 };
 
 struct Font_Manager {
+	~Font_Manager();
+
+	u32 font_count = 0;
+	FT_Library library = NULL;
 	String path_to_font_dir;
-	Hash_Table<String, Font> font_table;
+	Hash_Table<String, Font *> font_table; // Fonts are allocated separately, the gui and render fonts keep pointers to them.
 
 	void init();
 	bool load_font(const char *name, u32 font_size);
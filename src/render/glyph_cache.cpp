@@ -0,0 +1,233 @@
+#include <assert.h>
+#include <string.h>
+
+#include "font.h"
+#include "glyph_cache.h"
+#include "render_system.h"
+#include "../sys/sys.h"
+#include "../sys/utils.h"
+#include "../libs/math/functions.h"
+
+const u32 NO_SHELF = UINT32_MAX;
+
+// A shelf more than a half higher than the glyph is skipped, so small glyphs don't take space of big ones.
+inline bool shelf_fits_height(u32 shelf_height, u32 height)
+{
+	return (shelf_height >= height) && (shelf_height <= (height + height / 2));
+}
+
+void Glyph_Cache::init(Gpu_Device *_gpu_device, Render_Pipeline *_render_pipeline, u32 _atlas_size)
+{
+	assert(_gpu_device);
+	assert(_render_pipeline);
+
+	gpu_device = _gpu_device;
+	render_pipeline = _render_pipeline;
+	atlas_size = _atlas_size;
+
+	Array<u8> empty_atlas;
+	empty_atlas.reserve(atlas_size * atlas_size);
+	memset((void *)empty_atlas.items, 0, atlas_size * atlas_size);
+
+	Texture2D_Desc atlas_desc;
+	atlas_desc.width = atlas_size;
+	atlas_desc.height = atlas_size;
+	atlas_desc.mip_levels = 1;
+	atlas_desc.format = DXGI_FORMAT_R8_UNORM;
+	atlas_desc.data = (void *)empty_atlas.items;
+
+	gpu_device->create_texture_2d(&atlas_desc, &atlas);
+	gpu_device->create_shader_resource_view(&atlas_desc, &atlas);
+}
+
+void Glyph_Cache::release()
+{
+	for (Hash_Node<u64, Glyph> *node = glyphs.first_entry(); node; node = glyphs.next_entry(node)) {
+		DELETE_PTR(node->value.primitive);
+	}
+	glyphs.clear();
+	shelves.clear();
+	used_height = 0;
+}
+
+void Glyph_Cache::new_frame()
+{
+	frame_index++;
+}
+
+Primitive_2D *Glyph_Cache::get_glyph(Font *font, u32 codepoint)
+{
+	assert(font);
+
+	u64 key = make_glyph_key(font->font_id, codepoint);
+	Hash_Node<u64, Glyph> *node = glyphs.get_table_entry(key);
+	if (!node) {
+		if (!add_glyph(font, codepoint, key)) {
+			return NULL;
+		}
+		node = glyphs.get_table_entry(key);
+	}
+	Glyph *glyph = &node->value;
+	glyph->last_used_frame = frame_index;
+	shelves[glyph->shelf_index].last_used_frame = frame_index;
+	return glyph->primitive;
+}
+
+Primitive_2D *Glyph_Cache::touch(u64 key)
+{
+	Hash_Node<u64, Glyph> *node = glyphs.get_table_entry(key);
+	if (!node) {
+		return NULL;
+	}
+	node->value.last_used_frame = frame_index;
+	shelves[node->value.shelf_index].last_used_frame = frame_index;
+	return node->value.primitive;
+}
+
+// The shelf with the least height which fits the glyph is taken.
+u32 Glyph_Cache::find_shelf(u32 width, u32 height)
+{
+	u32 found_shelf = NO_SHELF;
+	for (u32 i = 0; i < shelves.count; i++) {
+		Shelf *shelf = &shelves[i];
+		if (!shelf_fits_height(shelf->height, height) || ((atlas_size - shelf->used_width) < width)) {
+			continue;
+		}
+		if ((found_shelf == NO_SHELF) || (shelf->height < shelves[found_shelf].height)) {
+			found_shelf = i;
+		}
+	}
+	if ((found_shelf == NO_SHELF) && ((used_height + height) <= atlas_size)) {
+		Shelf shelf;
+		shelf.y = used_height;
+		shelf.height = height;
+		found_shelf = shelves.push(shelf);
+		used_height += height;
+	}
+	return found_shelf;
+}
+
+// Only shelves which find_shelf would take for the glyph are evicted. Evicted shelves keep their height,
+// except the last shelf which is released, so a shelf of another height can be placed instead of it.
+bool Glyph_Cache::evict_shelf(u32 height)
+{
+	u32 lru_shelf = NO_SHELF;
+	for (u32 i = 0; i < shelves.count; i++) {
+		Shelf *shelf = &shelves[i];
+		if (!shelf_fits_height(shelf->height, height) || ((shelf->last_used_frame + 1) >= frame_index) || shelf->glyph_keys.is_empty()) {
+			continue;
+		}
+		if ((lru_shelf == NO_SHELF) || (shelf->last_used_frame < shelves[lru_shelf].last_used_frame)) {
+			lru_shelf = i;
+		}
+	}
+	if (lru_shelf != NO_SHELF) {
+		evict_glyphs(&shelves[lru_shelf]);
+		return true;
+	}
+
+	if (shelves.is_empty()) {
+		return false;
+	}
+	Shelf *last_shelf = &shelves.last();
+	if ((!last_shelf->glyph_keys.is_empty() && ((last_shelf->last_used_frame + 1) >= frame_index)) || ((used_height - last_shelf->height + height) > atlas_size)) {
+		return false;
+	}
+	evict_glyphs(last_shelf);
+	used_height -= last_shelf->height;
+	shelves.pop();
+	return true;
+}
+
+void Glyph_Cache::evict_glyphs(Shelf *shelf)
+{
+	for (u32 i = 0; i < shelf->glyph_keys.count; i++) {
+		Glyph glyph;
+		if (glyphs.get(shelf->glyph_keys[i], glyph)) {
+			DELETE_PTR(glyph.primitive);
+			glyphs.remove(shelf->glyph_keys[i]);
+			evicted_glyph_count++;
+		}
+	}
+	shelf->glyph_keys.clear();
+	shelf->used_width = 0;
+}
+
+bool Glyph_Cache::add_glyph(Font *font, u32 codepoint, u64 key)
+{
+	// Metrics are copied, the font char can be moved by loading other chars.
+	Font_Char font_char = *font->get_font_char(codepoint);
+	if ((font_char.size.width == 0) || (font_char.size.height == 0)) {
+		return false;
+	}
+	if ((font_char.size.width + GLYPH_CACHE_GLYPH_PADDING) > atlas_size || (font_char.size.height + GLYPH_CACHE_GLYPH_PADDING) > atlas_size) {
+		return false;
+	}
+
+	u32 bitmap_width = 0;
+	u32 bitmap_height = 0;
+	u32 bitmap_pitch = 0;
+	u8 *bitmap = font->rasterize_char(codepoint, &bitmap_width, &bitmap_height, &bitmap_pitch);
+	if (!bitmap) {
+		return false;
+	}
+
+	// Glyphs are padded on the right and bottom, so the padding clears pixels left by evicted glyphs.
+	u32 width = font_char.size.width + GLYPH_CACHE_GLYPH_PADDING;
+	u32 height = font_char.size.height + GLYPH_CACHE_GLYPH_PADDING;
+	u32 shelf_index = find_shelf(width, height);
+	if ((shelf_index == NO_SHELF) && evict_shelf(height)) {
+		shelf_index = find_shelf(width, height);
+	}
+	if (shelf_index == NO_SHELF) {
+		print("Glyph_Cache::add_glyph: The atlas has no space for char {} of font {}.", codepoint, font->name);
+		return false;
+	}
+	Shelf *shelf = &shelves[shelf_index];
+
+	// The bitmap is cut or padded to the size of the char metrics, text layout uses them.
+	glyph_bitmap.reserve(width * height);
+	memset((void *)glyph_bitmap.items, 0, width * height);
+	u32 copy_width = math::min(bitmap_width, font_char.size.width);
+	u32 copy_height = math::min(bitmap_height, font_char.size.height);
+	for (u32 row = 0; row < copy_height; row++) {
+		memcpy((void *)&glyph_bitmap[row * width], (void *)&bitmap[row * bitmap_pitch], copy_width);
+	}
+
+	Rect_u32 rect;
+	rect.x = shelf->used_width;
+	rect.y = shelf->y;
+	rect.width = width;
+	rect.height = height;
+	render_pipeline->update_subresource(&atlas, (void *)glyph_bitmap.items, width, &rect);
+
+	float atlas_width = (float)atlas_size;
+	float u0 = (float)rect.x / atlas_width;
+	float v0 = (float)rect.y / atlas_width;
+	float u1 = (float)(rect.x + font_char.size.width) / atlas_width;
+	float v1 = (float)(rect.y + font_char.size.height) / atlas_width;
+
+	Primitive_2D *primitive = new Primitive_2D();
+	primitive->add_point(Vector2(0.0f, 0.0f), Vector2(u0, v0));
+	primitive->add_point(Vector2((float)font_char.size.width, 0.0f), Vector2(u1, v0));
+	primitive->add_point(Vector2((float)font_char.size.width, (float)font_char.size.height), Vector2(u1, v1));
+	primitive->add_point(Vector2(0.0f, (float)font_char.size.height), Vector2(u0, v1));
+	primitive->make_triangle_polygon();
+
+	Glyph glyph;
+	glyph.shelf_index = shelf_index;
+	glyph.last_used_frame = frame_index;
+	glyph.primitive = primitive;
+	glyphs.set(key, glyph);
+
+	shelf->used_width += width;
+	shelf->glyph_keys.push(key);
+	rasterized_glyph_count++;
+	return true;
+}
+
+void Glyph_Cache::print_stats()
+{
+	print("Glyph_Cache: {} glyphs are in {} shelves, {} of {} atlas rows are used.", glyphs.count, shelves.count, used_height, atlas_size);
+	print("Glyph_Cache: {} glyphs were rasterized, {} glyphs were evicted.", rasterized_glyph_count, evicted_glyph_count);
+}
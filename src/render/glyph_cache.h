@@ -0,0 +1,70 @@
+#ifndef GLYPH_CACHE_H
+#define GLYPH_CACHE_H
+
+#include "render_api.h"
+#include "../libs/number_types.h"
+#include "../libs/structures/array.h"
+#include "../libs/structures/hash_table.h"
+
+struct Font;
+struct Primitive_2D;
+
+const u32 GLYPH_CACHE_ATLAS_SIZE = 1024;
+const u32 GLYPH_CACHE_GLYPH_PADDING = 1;
+
+inline u64 make_glyph_key(u32 font_id, u32 codepoint)
+{
+	return ((u64)font_id << 32) | (u64)codepoint;
+}
+
+struct Glyph {
+	u32 shelf_index = 0;
+	u32 last_used_frame = 0;
+	Primitive_2D *primitive = NULL; // A quad of the glyph size with uvs of the glyph in the atlas.
+};
+
+// Glyphs of all fonts are rasterized on first use into one R8 atlas. The atlas is split into shelves, a shelf is a row
+// of glyphs with about the same height. If there is no space for a glyph the least recently used shelf,
+// which was not used in the current or the previous frame, is emptied and its glyphs are rasterized again on next use.
+struct Glyph_Cache {
+	struct Shelf {
+		u32 y = 0;
+		u32 height = 0;
+		u32 used_width = 0;
+		u32 last_used_frame = 0;
+		Array<u64> glyph_keys;
+	};
+
+	u32 atlas_size = 0;
+	u32 used_height = 0;
+	u32 frame_index = 0;
+
+	u64 rasterized_glyph_count = 0;
+	u64 evicted_glyph_count = 0;
+
+	Texture2D atlas;
+	Gpu_Device *gpu_device = NULL;
+	Render_Pipeline *render_pipeline = NULL;
+
+	Array<Shelf> shelves;
+	Array<u8> glyph_bitmap;
+	Hash_Table<u64, Glyph> glyphs;
+
+	void init(Gpu_Device *_gpu_device, Render_Pipeline *_render_pipeline, u32 _atlas_size = GLYPH_CACHE_ATLAS_SIZE);
+	void release();
+	void new_frame();
+
+	// Returns NULL if the glyph is empty or doesn't fit in the atlas.
+	Primitive_2D *get_glyph(Font *font, u32 codepoint);
+	// Marks the glyph as used, returns NULL if its shelf was evicted.
+	Primitive_2D *touch(u64 key);
+
+	u32 find_shelf(u32 width, u32 height);
+	bool evict_shelf(u32 height);
+	void evict_glyphs(Shelf *shelf);
+	bool add_glyph(Font *font, u32 codepoint, u64 key);
+
+	void print_stats();
+};
+
+#endif
@@ -24,13 +24,15 @@ const u32 CB_SHADOW_ATLAS_INFO_REGISTER = 6;
 
 const u32 SHADOW_ATLAS_TEXTURE_REGISTER = 1;
 const u32 JITTERING_SAMPLES_TEXTURE_REGISTER = 2;
+const u32 LIGHTS_REGISTER = 7;
+const u32 LIGHT_CLUSTERS_REGISTER = 15;
+const u32 LIGHT_INDICES_REGISTER = 16;
 
 const u32 POINT_SAMPLING_REGISTER = 0;
 const u32 LINEAR_SAMPLING_REGISTER = 1;
 
 struct CB_Render_2d_Info {
-	Matrix4 position_orthographic_matrix;
-	Vector4 color;
+	Matrix4 orthographic_matrix;
 };
 
 struct CB_Frame_Info {
@@ -42,7 +44,11 @@ struct CB_Frame_Info {
 	Vector3 camera_direction;
 	float far_plane;
 	u32 light_count;
-	Pad3 pad;
+	float cluster_depth_scale;
+	float cluster_depth_bias;
+	Pad1 pad;
+	Vector2 cluster_tile_scale;
+	Pad2 pad2;
 };
 
 struct CB_Shadow_Atlas_Info {
@@ -63,6 +69,11 @@ struct Hlsl_Light {
 	u32 light_type;
 };
 
+struct Hlsl_Light_Cluster {
+	u32 light_offset;
+	u32 light_count;
+};
+
 struct Cascaded_Shadows_Info {
 	Vector3 light_direction;
 	u32 shadow_map_start_index;
@@ -0,0 +1,222 @@
+#include <assert.h>
+#include <math.h>
+
+#include "light_clusters.h"
+#include "../game/world.h"
+#include "../sys/profiling.h"
+#include "../libs/math/functions.h"
+
+inline float get_axis_distance_squared(float value, float min, float max)
+{
+	float distance = (value < min) ? (min - value) : ((value > max) ? (value - max) : 0.0f);
+	return distance * distance;
+}
+
+// Both assignment paths must use the same expression, so their results are equal bit for bit.
+inline bool sphere_touches_cluster(float distance_x, float distance_y, float distance_z, float radius_squared)
+{
+	return ((distance_x + distance_y) + distance_z) <= radius_squared;
+}
+
+struct Light_Sphere {
+	Vector3 center;
+	float radius_squared;
+};
+
+// Spot lights are tested with the sphere of their range, it is conservative but doesn't need the cone.
+inline Light_Sphere get_light_sphere(Hlsl_Light *light, const Matrix4 &view_matrix)
+{
+	Light_Sphere sphere;
+	sphere.center = light->position * view_matrix;
+	sphere.radius_squared = light->range * light->range;
+	return sphere;
+}
+
+inline bool sphere_touches_cluster(Light_Sphere *sphere, AABB *bounds)
+{
+	float distance_x = get_axis_distance_squared(sphere->center.x, bounds->min.x, bounds->max.x);
+	float distance_y = get_axis_distance_squared(sphere->center.y, bounds->min.y, bounds->max.y);
+	float distance_z = get_axis_distance_squared(sphere->center.z, bounds->min.z, bounds->max.z);
+	return sphere_touches_cluster(distance_x, distance_y, distance_z, sphere->radius_squared);
+}
+
+void Light_Clusters::release()
+{
+	fov = 0.0f;
+	ratio = 0.0f;
+	near_plane = 0.0f;
+	far_plane = 0.0f;
+
+	slice_depths.clear();
+	cluster_bounds.clear();
+	pair_clusters.clear();
+	pair_lights.clear();
+	cluster_fill_counts.clear();
+	clusters.clear();
+	light_indices.clear();
+}
+
+void Light_Clusters::update_bounds(float _fov, float _ratio, float _near_plane, float _far_plane)
+{
+	assert(_near_plane > 0.0f);
+	assert(_far_plane > _near_plane);
+
+	if ((fov == _fov) && (ratio == _ratio) && (near_plane == _near_plane) && (far_plane == _far_plane)) {
+		return;
+	}
+	fov = _fov;
+	ratio = _ratio;
+	near_plane = _near_plane;
+	far_plane = _far_plane;
+
+	slice_depths.reserve(LIGHT_CLUSTER_Z_COUNT + 1);
+	for (u32 k = 0; k <= LIGHT_CLUSTER_Z_COUNT; k++) {
+		slice_depths[k] = near_plane * powf(far_plane / near_plane, (float)k / (float)LIGHT_CLUSTER_Z_COUNT);
+	}
+	slice_depths[LIGHT_CLUSTER_Z_COUNT] = far_plane;
+
+	float tan_y = math::tan(fov * 0.5f);
+	float tan_x = tan_y * ratio;
+
+	// A tile is a pyramid part, the bounds of the part are found from its corners at the slice borders.
+	cluster_bounds.reserve(LIGHT_CLUSTER_COUNT);
+	for (u32 k = 0; k < LIGHT_CLUSTER_Z_COUNT; k++) {
+		float near_depth = slice_depths[k];
+		float far_depth = slice_depths[k + 1];
+		for (u32 j = 0; j < LIGHT_CLUSTER_Y_COUNT; j++) {
+			float top = (1.0f - 2.0f * (float)j / (float)LIGHT_CLUSTER_Y_COUNT) * tan_y;
+			float bottom = (1.0f - 2.0f * (float)(j + 1) / (float)LIGHT_CLUSTER_Y_COUNT) * tan_y;
+			for (u32 i = 0; i < LIGHT_CLUSTER_X_COUNT; i++) {
+				float left = (-1.0f + 2.0f * (float)i / (float)LIGHT_CLUSTER_X_COUNT) * tan_x;
+				float right = (-1.0f + 2.0f * (float)(i + 1) / (float)LIGHT_CLUSTER_X_COUNT) * tan_x;
+
+				AABB *bounds = &cluster_bounds[get_light_cluster_index(i, j, k)];
+				bounds->min.x = math::min(left * near_depth, left * far_depth);
+				bounds->max.x = math::max(right * near_depth, right * far_depth);
+				bounds->min.y = math::min(bottom * near_depth, bottom * far_depth);
+				bounds->max.y = math::max(top * near_depth, top * far_depth);
+				bounds->min.z = near_depth;
+				bounds->max.z = far_depth;
+			}
+		}
+	}
+}
+
+void Light_Clusters::assign_lights(Array<Hlsl_Light> *lights, const Matrix4 &view_matrix)
+{
+	PROFILE_ZONE("Light_Clusters::assign_lights");
+
+	assert(lights);
+	assert(cluster_bounds.count == LIGHT_CLUSTER_COUNT);
+
+	pair_clusters.clear();
+	pair_lights.clear();
+
+	for (u32 light_index = 0; light_index < lights->count; light_index++) {
+		Hlsl_Light *light = &lights->get(light_index);
+		if (light->light_type == DIRECTIONAL_LIGHT_TYPE) {
+			for (u32 cluster_index = 0; cluster_index < LIGHT_CLUSTER_COUNT; cluster_index++) {
+				pair_clusters.push(cluster_index);
+				pair_lights.push(light_index);
+			}
+			continue;
+		}
+		Light_Sphere sphere = get_light_sphere(light, view_matrix);
+		float radius = light->range;
+
+		// The slice range is widened by one slice, the distance test decides for border slices.
+		u32 first_slice = find_slice(sphere.center.z - radius);
+		u32 last_slice = find_slice(sphere.center.z + radius);
+		first_slice = (first_slice > 0) ? first_slice - 1 : 0;
+		last_slice = math::min(last_slice + 1, LIGHT_CLUSTER_Z_COUNT - 1);
+
+		// Distances along axes are separable, x bounds depend only on a column and y bounds only on a row of a slice.
+		for (u32 k = first_slice; k <= last_slice; k++) {
+			float distance_z = get_axis_distance_squared(sphere.center.z, slice_depths[k], slice_depths[k + 1]);
+			if (distance_z > sphere.radius_squared) {
+				continue;
+			}
+			for (u32 j = 0; j < LIGHT_CLUSTER_Y_COUNT; j++) {
+				AABB *row_bounds = &cluster_bounds[get_light_cluster_index(0, j, k)];
+				float distance_y = get_axis_distance_squared(sphere.center.y, row_bounds->min.y, row_bounds->max.y);
+				if ((distance_y + distance_z) > sphere.radius_squared) {
+					continue;
+				}
+				for (u32 i = 0; i < LIGHT_CLUSTER_X_COUNT; i++) {
+					u32 cluster_index = get_light_cluster_index(i, j, k);
+					AABB *bounds = &cluster_bounds[cluster_index];
+					float distance_x = get_axis_distance_squared(sphere.center.x, bounds->min.x, bounds->max.x);
+					if (sphere_touches_cluster(distance_x, distance_y, distance_z, sphere.radius_squared)) {
+						pair_clusters.push(cluster_index);
+						pair_lights.push(light_index);
+					}
+				}
+			}
+		}
+	}
+
+	// Pairs are sorted by clusters with a counting sort, it keeps the order of lights inside a cluster.
+	clusters.reserve(LIGHT_CLUSTER_COUNT);
+	cluster_fill_counts.reserve(LIGHT_CLUSTER_COUNT);
+	for (u32 i = 0; i < LIGHT_CLUSTER_COUNT; i++) {
+		clusters[i].light_offset = 0;
+		clusters[i].light_count = 0;
+		cluster_fill_counts[i] = 0;
+	}
+	for (u32 i = 0; i < pair_clusters.count; i++) {
+		clusters[pair_clusters[i]].light_count++;
+	}
+	u32 light_offset = 0;
+	for (u32 i = 0; i < LIGHT_CLUSTER_COUNT; i++) {
+		clusters[i].light_offset = light_offset;
+		light_offset += clusters[i].light_count;
+	}
+	light_indices.reserve(pair_lights.count);
+	for (u32 i = 0; i < pair_clusters.count; i++) {
+		u32 cluster_index = pair_clusters[i];
+		light_indices[clusters[cluster_index].light_offset + cluster_fill_counts[cluster_index]++] = pair_lights[i];
+	}
+}
+
+void Light_Clusters::assign_lights_brute_force(Array<Hlsl_Light> *lights, const Matrix4 &view_matrix)
+{
+	assert(lights);
+	assert(cluster_bounds.count == LIGHT_CLUSTER_COUNT);
+
+	clusters.reserve(LIGHT_CLUSTER_COUNT);
+	light_indices.clear();
+	for (u32 cluster_index = 0; cluster_index < LIGHT_CLUSTER_COUNT; cluster_index++) {
+		clusters[cluster_index].light_offset = light_indices.count;
+		for (u32 light_index = 0; light_index < lights->count; light_index++) {
+			Hlsl_Light *light = &lights->get(light_index);
+			if (light->light_type == DIRECTIONAL_LIGHT_TYPE) {
+				light_indices.push(light_index);
+				continue;
+			}
+			Light_Sphere sphere = get_light_sphere(light, view_matrix);
+			if (sphere_touches_cluster(&sphere, &cluster_bounds[cluster_index])) {
+				light_indices.push(light_index);
+			}
+		}
+		clusters[cluster_index].light_count = light_indices.count - clusters[cluster_index].light_offset;
+	}
+}
+
+float Light_Clusters::get_depth_scale()
+{
+	return (float)LIGHT_CLUSTER_Z_COUNT / logf(far_plane / near_plane);
+}
+
+float Light_Clusters::get_depth_bias()
+{
+	return -(float)LIGHT_CLUSTER_Z_COUNT * logf(near_plane) / logf(far_plane / near_plane);
+}
+
+u32 Light_Clusters::find_slice(float view_depth)
+{
+	if (view_depth <= near_plane) {
+		return 0;
+	}
+	float slice = floorf(logf(view_depth) * get_depth_scale() + get_depth_bias());
+	return (u32)math::clamp(slice, 0.0f, (float)(LIGHT_CLUSTER_Z_COUNT - 1));
+}
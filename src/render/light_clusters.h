@@ -0,0 +1,57 @@
+#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+#include "hlsl.h"
+#include "../collision/collision.h"
+#include "../libs/number_types.h"
+#include "../libs/math/matrix.h"
+#include "../libs/structures/array.h"
+
+// The counts are mirrored in hlsl/light.hlsl.
+const u32 LIGHT_CLUSTER_X_COUNT = 16;
+const u32 LIGHT_CLUSTER_Y_COUNT = 9;
+const u32 LIGHT_CLUSTER_Z_COUNT = 24;
+const u32 LIGHT_CLUSTER_COUNT = LIGHT_CLUSTER_X_COUNT * LIGHT_CLUSTER_Y_COUNT * LIGHT_CLUSTER_Z_COUNT;
+
+// The view frustum is split into screen tiles and exponential depth slices, a cluster is a tile of a slice.
+// Clusters are indexed as x + y * LIGHT_CLUSTER_X_COUNT + z * LIGHT_CLUSTER_X_COUNT * LIGHT_CLUSTER_Y_COUNT,
+// the tile with y 0 is at the top of the screen.
+// Point and spot lights are assigned to clusters their range sphere intersects, directional lights are assigned to every cluster.
+// Indices of lights in a cluster are in ascending order, so the assignment doesn't depend on how it was found.
+struct Light_Clusters {
+	float fov = 0.0f;
+	float ratio = 0.0f;
+	float near_plane = 0.0f;
+	float far_plane = 0.0f;
+
+	Array<float> slice_depths; // LIGHT_CLUSTER_Z_COUNT + 1 view space depths of slice borders.
+	Array<AABB> cluster_bounds; // View space bounds of clusters.
+
+	Array<u32> pair_clusters; // Clusters and lights of found intersections in order of lights.
+	Array<u32> pair_lights;
+	Array<u32> cluster_fill_counts;
+
+	Array<Hlsl_Light_Cluster> clusters;
+	Array<u32> light_indices;
+
+	void release();
+	// Bounds are rebuilt only if the projection differs from the one they were built for.
+	void update_bounds(float _fov, float _ratio, float _near_plane, float _far_plane);
+
+	// Fills clusters and light_indices. Only clusters touched by each light are tested, the bounds must be updated.
+	void assign_lights(Array<Hlsl_Light> *lights, const Matrix4 &view_matrix);
+	// Tests every light against every cluster, the result must be equal to assign_lights.
+	void assign_lights_brute_force(Array<Hlsl_Light> *lights, const Matrix4 &view_matrix);
+
+	// Scale and bias turning log(view depth) into a slice index.
+	float get_depth_scale();
+	float get_depth_bias();
+	u32 find_slice(float view_depth);
+};
+
+inline u32 get_light_cluster_index(u32 x, u32 y, u32 z)
+{
+	return x + y * LIGHT_CLUSTER_X_COUNT + z * LIGHT_CLUSTER_X_COUNT * LIGHT_CLUSTER_Y_COUNT;
+}
+
+#endif
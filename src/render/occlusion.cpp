@@ -0,0 +1,467 @@
+#include <assert.h>
+#include <math.h>
+#include <float.h>
+
+#include "occlusion.h"
+#include "../sys/profiling.h"
+#include "../sys/job_system.h"
+#include "../libs/math/functions.h"
+
+// The macros are defined in occlusion.h.
+#ifdef OCCLUSION_USE_SSE
+#include <emmintrin.h>
+#endif
+#ifdef OCCLUSION_USE_AVX2
+#include <immintrin.h>
+#endif
+
+// The kernel is written once and instanced for 1, 4 and 8 corners of a row.
+struct Scalar_Pixels {
+	typedef float Value;
+	typedef bool Mask;
+
+	static const u32 WIDTH = 1;
+
+	static Value load(const float *data) { return *data; }
+	static void store(float *data, Value value) { *data = value; }
+	static Value set(float value) { return value; }
+	static Value lane_offsets() { return 0.0f; }
+	static Value add(Value a, Value b) { return a + b; }
+	static Value mul(Value a, Value b) { return a * b; }
+	static Value min(Value a, Value b) { return (a < b) ? a : b; }
+	static Mask greater_equal(Value a, Value b) { return a >= b; }
+	static Mask mask_and(Mask a, Mask b) { return a && b; }
+	static Value select(Mask mask, Value a, Value b) { return mask ? a : b; }
+};
+
+#ifdef OCCLUSION_USE_SSE
+struct Sse_Pixels {
+	typedef __m128 Value;
+	typedef __m128 Mask;
+
+	static const u32 WIDTH = 4;
+
+	static Value load(const float *data) { return _mm_loadu_ps(data); }
+	static void store(float *data, Value value) { _mm_storeu_ps(data, value); }
+	static Value set(float value) { return _mm_set1_ps(value); }
+	static Value lane_offsets() { return _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f); }
+	static Value add(Value a, Value b) { return _mm_add_ps(a, b); }
+	static Value mul(Value a, Value b) { return _mm_mul_ps(a, b); }
+	static Value min(Value a, Value b) { return _mm_min_ps(a, b); }
+	static Mask greater_equal(Value a, Value b) { return _mm_cmpge_ps(a, b); }
+	static Mask mask_and(Mask a, Mask b) { return _mm_and_ps(a, b); }
+	static Value select(Mask mask, Value a, Value b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+};
+#endif
+
+#ifdef OCCLUSION_USE_AVX2
+struct Avx_Pixels {
+	typedef __m256 Value;
+	typedef __m256 Mask;
+
+	static const u32 WIDTH = 8;
+
+	static Value load(const float *data) { return _mm256_loadu_ps(data); }
+	static void store(float *data, Value value) { _mm256_storeu_ps(data, value); }
+	static Value set(float value) { return _mm256_set1_ps(value); }
+	static Value lane_offsets() { return _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f); }
+	static Value add(Value a, Value b) { return _mm256_add_ps(a, b); }
+	static Value mul(Value a, Value b) { return _mm256_mul_ps(a, b); }
+	static Value min(Value a, Value b) { return _mm256_min_ps(a, b); }
+	static Mask greater_equal(Value a, Value b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+	static Mask mask_and(Mask a, Mask b) { return _mm256_and_ps(a, b); }
+	static Value select(Mask mask, Value a, Value b) { return _mm256_blendv_ps(b, a, mask); }
+};
+#endif
+
+#if defined(OCCLUSION_USE_AVX2)
+typedef Avx_Pixels Pixel_Lanes;
+#elif defined(OCCLUSION_USE_SSE)
+typedef Sse_Pixels Pixel_Lanes;
+#else
+typedef Scalar_Pixels Pixel_Lanes;
+#endif
+
+// An edge function a * x + b * y + c of the edge from first to second, it is not negative inside triangles with a positive area.
+struct Edge_Function {
+	float a;
+	float b;
+	float c;
+};
+
+inline Edge_Function make_edge_function(const Vector3 &first, const Vector3 &second)
+{
+	Edge_Function edge;
+	edge.a = first.y - second.y;
+	edge.b = second.x - first.x;
+	edge.c = -(edge.a * first.x + edge.b * first.y);
+	return edge;
+}
+
+// Edges are moved out by a small part of a pixel for the coverage test, so corners on an edge shared by two triangles
+// are not lost to rounding in both of them.
+inline float find_edge_tolerance(const Edge_Function &edge)
+{
+	return (fabsf(edge.a) + fabsf(edge.b)) * (1.0f / 1024.0f);
+}
+
+inline float find_edge_value(const Vector3 &first, const Vector3 &second, const Vector3 &point)
+{
+	return (second.x - first.x) * (point.y - first.y) - (second.y - first.y) * (point.x - first.x);
+}
+
+// Corner rows from first_y to last_y are rasterized by chunks of L::WIDTH corners from first_x, first_x must be aligned to L::WIDTH.
+// Every chunk must be inside corners of one tile, so only the thread of the tile writes to it.
+template <typename L>
+inline void rasterize_triangle(Occluder_Triangle *triangle, float *corner_depths, s32 first_x, s32 last_x, s32 first_y, s32 last_y)
+{
+	typedef typename L::Value Value;
+
+	Vector3 *v = triangle->vertices;
+	Edge_Function edge_01 = make_edge_function(v[0], v[1]);
+	Edge_Function edge_12 = make_edge_function(v[1], v[2]);
+	Edge_Function edge_20 = make_edge_function(v[2], v[0]);
+
+	// Depth is interpolated by barycentric coordinates, it is a plane in the screen space.
+	float inverse_area = 1.0f / find_edge_value(v[0], v[1], v[2]);
+	float depth_1 = (v[1].z - v[0].z) * inverse_area;
+	float depth_2 = (v[2].z - v[0].z) * inverse_area;
+	float depth_a = depth_1 * edge_20.a + depth_2 * edge_01.a;
+	float depth_b = depth_1 * edge_20.b + depth_2 * edge_01.b;
+	float depth_c = v[0].z + depth_1 * edge_20.c + depth_2 * edge_01.c;
+
+	float edge_01_c = edge_01.c + find_edge_tolerance(edge_01);
+	float edge_12_c = edge_12.c + find_edge_tolerance(edge_12);
+	float edge_20_c = edge_20.c + find_edge_tolerance(edge_20);
+
+	Value zero = L::set(0.0f);
+	Value lane_offsets = L::lane_offsets();
+	Value edge_01_a = L::set(edge_01.a);
+	Value edge_12_a = L::set(edge_12.a);
+	Value edge_20_a = L::set(edge_20.a);
+	Value depth_a_lanes = L::set(depth_a);
+
+	for (s32 y = first_y; y <= last_y; y++) {
+		float corner_y = (float)y;
+		Value edge_01_row = L::set(edge_01.b * corner_y + edge_01_c);
+		Value edge_12_row = L::set(edge_12.b * corner_y + edge_12_c);
+		Value edge_20_row = L::set(edge_20.b * corner_y + edge_20_c);
+		Value depth_row = L::set(depth_b * corner_y + depth_c);
+
+		float *row = &corner_depths[y * OCCLUSION_CORNER_ROW_PITCH];
+		for (s32 x = first_x; x <= last_x; x += L::WIDTH) {
+			Value corner_x = L::add(L::set((float)x), lane_offsets);
+			typename L::Mask inside = L::greater_equal(L::add(L::mul(edge_01_a, corner_x), edge_01_row), zero);
+			inside = L::mask_and(inside, L::greater_equal(L::add(L::mul(edge_12_a, corner_x), edge_12_row), zero));
+			inside = L::mask_and(inside, L::greater_equal(L::add(L::mul(edge_20_a, corner_x), edge_20_row), zero));
+
+			Value depth = L::add(L::mul(depth_a_lanes, corner_x), depth_row);
+			Value current_depth = L::load(&row[x]);
+			L::store(&row[x], L::select(inside, L::min(current_depth, depth), current_depth));
+		}
+	}
+}
+
+void Occlusion_Buffer::begin_frame(const Matrix4 &_view_projection_matrix)
+{
+	view_projection_matrix = _view_projection_matrix;
+	occluder_count = 0;
+	occludee_count = 0;
+	occluded_count = 0;
+	triangles.clear();
+
+	if (depths.count != (OCCLUSION_BUFFER_WIDTH * OCCLUSION_BUFFER_HEIGHT)) {
+		depths.reserve(OCCLUSION_BUFFER_WIDTH * OCCLUSION_BUFFER_HEIGHT);
+		corner_depths.reserve(OCCLUSION_CORNER_ROW_PITCH * OCCLUSION_CORNER_ROW_COUNT);
+		block_depths.reserve(OCCLUSION_BLOCK_X_COUNT * OCCLUSION_BLOCK_Y_COUNT);
+	}
+}
+
+void Occlusion_Buffer::add_occluder(Vertex_PNTUV *vertices, u32 vertex_count, u32 *indices, u32 index_count, const Matrix4 &world_matrix)
+{
+	assert(vertices);
+	assert(indices);
+
+	Matrix4 world_view_projection_matrix = world_matrix * view_projection_matrix;
+	clip_vertices.reserve(vertex_count);
+	for (u32 i = 0; i < vertex_count; i++) {
+		clip_vertices[i] = Vector4(vertices[i].position, 1.0f) * world_view_projection_matrix;
+	}
+	for (u32 i = 0; (i + 2) < index_count; i += 3) {
+		assert((indices[i] < vertex_count) && (indices[i + 1] < vertex_count) && (indices[i + 2] < vertex_count));
+		add_triangle(clip_vertices[indices[i]], clip_vertices[indices[i + 1]], clip_vertices[indices[i + 2]]);
+	}
+	occluder_count++;
+}
+
+inline Vector4 lerp_clip_vertex(const Vector4 &first, const Vector4 &second, float t)
+{
+	return Vector4(first.x + (second.x - first.x) * t, first.y + (second.y - first.y) * t, first.z + (second.z - first.z) * t, first.w + (second.w - first.w) * t);
+}
+
+inline Vector3 to_buffer_space(const Vector4 &clip_vertex)
+{
+	float inverse_w = 1.0f / clip_vertex.w;
+	float x = (clip_vertex.x * inverse_w * 0.5f + 0.5f) * (float)OCCLUSION_BUFFER_WIDTH;
+	float y = (0.5f - clip_vertex.y * inverse_w * 0.5f) * (float)OCCLUSION_BUFFER_HEIGHT;
+	return Vector3(x, y, clip_vertex.z * inverse_w);
+}
+
+// Corners from the returned first to the returned last are between min and max, a row of pixel_count pixels has pixel_count + 1 corners.
+inline void find_corner_range(float min, float max, s32 pixel_count, s32 *first, s32 *last)
+{
+	*first = (s32)math::clamp(ceilf(min), 0.0f, (float)(pixel_count + 1));
+	*last = (s32)math::clamp(floorf(max), -1.0f, (float)pixel_count);
+}
+
+// The last corners of the buffer belong to the last tiles.
+inline s32 get_corner_tile(s32 corner, u32 tile_size, u32 tile_count)
+{
+	return math::min(corner / (s32)tile_size, (s32)tile_count - 1);
+}
+
+static void add_buffer_space_triangle(Array<Occluder_Triangle> *triangles, Vector3 vertex_0, Vector3 vertex_1, Vector3 vertex_2)
+{
+	if ((vertex_0.z > 1.0f) && (vertex_1.z > 1.0f) && (vertex_2.z > 1.0f)) {
+		return;
+	}
+	// Occluders are drawn from both sides, back faces are turned so all edge functions are positive inside.
+	float area = find_edge_value(vertex_0, vertex_1, vertex_2);
+	if (area == 0.0f) {
+		return;
+	}
+	Occluder_Triangle triangle;
+	triangle.vertices[0] = vertex_0;
+	triangle.vertices[1] = (area > 0.0f) ? vertex_1 : vertex_2;
+	triangle.vertices[2] = (area > 0.0f) ? vertex_2 : vertex_1;
+
+	find_corner_range(math::min(vertex_0.x, math::min(vertex_1.x, vertex_2.x)), math::max(vertex_0.x, math::max(vertex_1.x, vertex_2.x)), OCCLUSION_BUFFER_WIDTH, &triangle.min_x, &triangle.max_x);
+	find_corner_range(math::min(vertex_0.y, math::min(vertex_1.y, vertex_2.y)), math::max(vertex_0.y, math::max(vertex_1.y, vertex_2.y)), OCCLUSION_BUFFER_HEIGHT, &triangle.min_y, &triangle.max_y);
+	if ((triangle.min_x > triangle.max_x) || (triangle.min_y > triangle.max_y)) {
+		return;
+	}
+	triangles->push(triangle);
+}
+
+void Occlusion_Buffer::add_triangle(const Vector4 &clip_vertex_0, const Vector4 &clip_vertex_1, const Vector4 &clip_vertex_2)
+{
+	// Points with z >= 0 are in front of the near plane in the d3d clip space, the triangle is clipped into a polygon of up to 4 vertices.
+	const Vector4 *triangle[3] = { &clip_vertex_0, &clip_vertex_1, &clip_vertex_2 };
+	Vector4 polygon[4];
+	u32 polygon_vertex_count = 0;
+	for (u32 i = 0; i < 3; i++) {
+		const Vector4 *current = triangle[i];
+		const Vector4 *next = triangle[(i + 1) % 3];
+		if (current->z >= 0.0f) {
+			polygon[polygon_vertex_count++] = *current;
+		}
+		if ((current->z >= 0.0f) != (next->z >= 0.0f)) {
+			polygon[polygon_vertex_count++] = lerp_clip_vertex(*current, *next, current->z / (current->z - next->z));
+		}
+	}
+	if (polygon_vertex_count < 3) {
+		return;
+	}
+
+	Vector3 buffer_vertices[4];
+	for (u32 i = 0; i < polygon_vertex_count; i++) {
+		if (polygon[i].w <= 0.0f) {
+			return;
+		}
+		buffer_vertices[i] = to_buffer_space(polygon[i]);
+	}
+	for (u32 i = 1; (i + 1) < polygon_vertex_count; i++) {
+		add_buffer_space_triangle(&triangles, buffer_vertices[0], buffer_vertices[i], buffer_vertices[i + 1]);
+	}
+}
+
+static void rasterize_tiles_corners(u32 first, u32 last, void *data)
+{
+	Occlusion_Buffer *occlusion_buffer = (Occlusion_Buffer *)data;
+	for (u32 i = first; i < last; i++) {
+		occlusion_buffer->rasterize_tile_corners(i);
+	}
+}
+
+static void resolve_tiles(u32 first, u32 last, void *data)
+{
+	Occlusion_Buffer *occlusion_buffer = (Occlusion_Buffer *)data;
+	for (u32 i = first; i < last; i++) {
+		occlusion_buffer->resolve_tile(i);
+	}
+}
+
+void Occlusion_Buffer::rasterize(Job_System *job_system)
+{
+	PROFILE_ZONE("Occlusion_Buffer::rasterize");
+
+	assert(depths.count == (OCCLUSION_BUFFER_WIDTH * OCCLUSION_BUFFER_HEIGHT));
+
+	for (u32 i = 0; i < OCCLUSION_TILE_COUNT; i++) {
+		tile_triangles[i].clear();
+	}
+	for (u32 i = 0; i < triangles.count; i++) {
+		Occluder_Triangle *triangle = &triangles[i];
+		s32 first_tile_x = get_corner_tile(triangle->min_x, OCCLUSION_TILE_WIDTH, OCCLUSION_TILE_X_COUNT);
+		s32 last_tile_x = get_corner_tile(triangle->max_x, OCCLUSION_TILE_WIDTH, OCCLUSION_TILE_X_COUNT);
+		s32 first_tile_y = get_corner_tile(triangle->min_y, OCCLUSION_TILE_HEIGHT, OCCLUSION_TILE_Y_COUNT);
+		s32 last_tile_y = get_corner_tile(triangle->max_y, OCCLUSION_TILE_HEIGHT, OCCLUSION_TILE_Y_COUNT);
+		for (s32 tile_y = first_tile_y; tile_y <= last_tile_y; tile_y++) {
+			for (s32 tile_x = first_tile_x; tile_x <= last_tile_x; tile_x++) {
+				tile_triangles[tile_x + tile_y * OCCLUSION_TILE_X_COUNT].push(i);
+			}
+		}
+	}
+
+	if (job_system) {
+		job_system->parallel_for(OCCLUSION_TILE_COUNT, 1, rasterize_tiles_corners, (void *)this);
+		job_system->parallel_for(OCCLUSION_TILE_COUNT, 1, resolve_tiles, (void *)this);
+	} else {
+		rasterize_tiles_corners(0, OCCLUSION_TILE_COUNT, (void *)this);
+		resolve_tiles(0, OCCLUSION_TILE_COUNT, (void *)this);
+	}
+}
+
+// A tile owns corners at top left of its pixels, the last tiles of rows and columns also own the last corners of the buffer.
+void Occlusion_Buffer::rasterize_tile_corners(u32 tile_index)
+{
+	assert(tile_index < OCCLUSION_TILE_COUNT);
+
+	u32 tile_x = tile_index % OCCLUSION_TILE_X_COUNT;
+	u32 tile_y = tile_index / OCCLUSION_TILE_X_COUNT;
+	s32 tile_min_x = (s32)(tile_x * OCCLUSION_TILE_WIDTH);
+	s32 tile_min_y = (s32)(tile_y * OCCLUSION_TILE_HEIGHT);
+	s32 tile_max_x = tile_min_x + (s32)OCCLUSION_TILE_WIDTH - ((tile_x == (OCCLUSION_TILE_X_COUNT - 1)) ? 0 : 1);
+	s32 tile_max_y = tile_min_y + (s32)OCCLUSION_TILE_HEIGHT - ((tile_y == (OCCLUSION_TILE_Y_COUNT - 1)) ? 0 : 1);
+
+	for (s32 y = tile_min_y; y <= tile_max_y; y++) {
+		float *row = &corner_depths[y * OCCLUSION_CORNER_ROW_PITCH];
+		for (s32 x = tile_min_x; x <= tile_max_x; x++) {
+			row[x] = 1.0f;
+		}
+	}
+
+	Array<u32> *triangle_indices = &tile_triangles[tile_index];
+	for (u32 i = 0; i < triangle_indices->count; i++) {
+		Occluder_Triangle *triangle = &triangles[triangle_indices->get(i)];
+		s32 first_x = math::max(triangle->min_x, tile_min_x);
+		s32 last_x = math::min(triangle->max_x, tile_max_x);
+		s32 first_y = math::max(triangle->min_y, tile_min_y);
+		s32 last_y = math::min(triangle->max_y, tile_max_y);
+		if ((first_x > last_x) || (first_y > last_y)) {
+			continue;
+		}
+		first_x -= first_x % (s32)OCCLUSION_LANE_COUNT;
+		rasterize_triangle<Pixel_Lanes>(triangle, corner_depths.items, first_x, last_x, first_y, last_y);
+	}
+}
+
+// Depth is linear inside a triangle, so the farthest depth of a pixel covered by one triangle is at one of its corners.
+void Occlusion_Buffer::resolve_tile(u32 tile_index)
+{
+	assert(tile_index < OCCLUSION_TILE_COUNT);
+
+	s32 tile_min_x = (s32)((tile_index % OCCLUSION_TILE_X_COUNT) * OCCLUSION_TILE_WIDTH);
+	s32 tile_min_y = (s32)((tile_index / OCCLUSION_TILE_X_COUNT) * OCCLUSION_TILE_HEIGHT);
+	s32 tile_max_x = tile_min_x + (s32)OCCLUSION_TILE_WIDTH - 1;
+	s32 tile_max_y = tile_min_y + (s32)OCCLUSION_TILE_HEIGHT - 1;
+
+	for (s32 y = tile_min_y; y <= tile_max_y; y++) {
+		float *row = &depths[y * OCCLUSION_BUFFER_WIDTH];
+		float *top_corners = &corner_depths[y * OCCLUSION_CORNER_ROW_PITCH];
+		float *bottom_corners = &corner_depths[(y + 1) * OCCLUSION_CORNER_ROW_PITCH];
+		for (s32 x = tile_min_x; x <= tile_max_x; x++) {
+			float top_depth = math::max(top_corners[x], top_corners[x + 1]);
+			float bottom_depth = math::max(bottom_corners[x], bottom_corners[x + 1]);
+			row[x] = math::max(top_depth, bottom_depth);
+		}
+	}
+
+	// Blocks keep the farthest depth, a box nearer than a block depth can be visible in the block.
+	for (s32 block_y = tile_min_y / (s32)OCCLUSION_BLOCK_SIZE; block_y <= (tile_max_y / (s32)OCCLUSION_BLOCK_SIZE); block_y++) {
+		for (s32 block_x = tile_min_x / (s32)OCCLUSION_BLOCK_SIZE; block_x <= (tile_max_x / (s32)OCCLUSION_BLOCK_SIZE); block_x++) {
+			float block_depth = 0.0f;
+			for (u32 y = 0; y < OCCLUSION_BLOCK_SIZE; y++) {
+				float *row = &depths[(block_y * OCCLUSION_BLOCK_SIZE + y) * OCCLUSION_BUFFER_WIDTH + block_x * OCCLUSION_BLOCK_SIZE];
+				for (u32 x = 0; x < OCCLUSION_BLOCK_SIZE; x++) {
+					block_depth = math::max(block_depth, row[x]);
+				}
+			}
+			block_depths[block_x + block_y * OCCLUSION_BLOCK_X_COUNT] = block_depth;
+		}
+	}
+}
+
+bool Occlusion_Buffer::project_AABB(const AABB &aabb, Occlusion_Rect *rect)
+{
+	assert(rect);
+
+	float min_x = FLT_MAX;
+	float min_y = FLT_MAX;
+	float max_x = -FLT_MAX;
+	float max_y = -FLT_MAX;
+	rect->min_depth = FLT_MAX;
+	for (u32 i = 0; i < 8; i++) {
+		Vector3 corner = Vector3((i & 1) ? aabb.max.x : aabb.min.x, (i & 2) ? aabb.max.y : aabb.min.y, (i & 4) ? aabb.max.z : aabb.min.z);
+		Vector4 clip_corner = Vector4(corner, 1.0f) * view_projection_matrix;
+		if (!(clip_corner.z >= 0.0f) || !(clip_corner.w > 0.0f)) {
+			return false;
+		}
+		Vector3 buffer_corner = to_buffer_space(clip_corner);
+		min_x = math::min(min_x, buffer_corner.x);
+		min_y = math::min(min_y, buffer_corner.y);
+		max_x = math::max(max_x, buffer_corner.x);
+		max_y = math::max(max_y, buffer_corner.y);
+		rect->min_depth = math::min(rect->min_depth, buffer_corner.z);
+	}
+	// Every pixel touched by the box is taken, not only the ones with covered centers.
+	rect->min_x = (s32)math::clamp(floorf(min_x), 0.0f, (float)OCCLUSION_BUFFER_WIDTH);
+	rect->min_y = (s32)math::clamp(floorf(min_y), 0.0f, (float)OCCLUSION_BUFFER_HEIGHT);
+	rect->max_x = (s32)math::clamp(floorf(max_x), -1.0f, (float)(OCCLUSION_BUFFER_WIDTH - 1));
+	rect->max_y = (s32)math::clamp(floorf(max_y), -1.0f, (float)(OCCLUSION_BUFFER_HEIGHT - 1));
+	return true;
+}
+
+float Occlusion_Buffer::find_screen_area(const AABB &aabb)
+{
+	Occlusion_Rect rect;
+	if (!project_AABB(aabb, &rect)) {
+		return 1.0f;
+	}
+	if ((rect.min_x > rect.max_x) || (rect.min_y > rect.max_y)) {
+		return 0.0f;
+	}
+	return (float)((rect.max_x - rect.min_x + 1) * (rect.max_y - rect.min_y + 1)) / (float)(OCCLUSION_BUFFER_WIDTH * OCCLUSION_BUFFER_HEIGHT);
+}
+
+bool Occlusion_Buffer::is_visible(const AABB &aabb)
+{
+	Occlusion_Rect rect;
+	if (!project_AABB(aabb, &rect)) {
+		return true;
+	}
+	// Boxes outside of the screen are left to frustum culling.
+	if ((rect.min_x > rect.max_x) || (rect.min_y > rect.max_y)) {
+		return true;
+	}
+	for (s32 block_y = rect.min_y / (s32)OCCLUSION_BLOCK_SIZE; block_y <= (rect.max_y / (s32)OCCLUSION_BLOCK_SIZE); block_y++) {
+		for (s32 block_x = rect.min_x / (s32)OCCLUSION_BLOCK_SIZE; block_x <= (rect.max_x / (s32)OCCLUSION_BLOCK_SIZE); block_x++) {
+			if (rect.min_depth > block_depths[block_x + block_y * OCCLUSION_BLOCK_X_COUNT]) {
+				continue;
+			}
+			// The block doesn't hide the box as a whole, so pixels of the block under the box are checked.
+			s32 first_y = math::max(rect.min_y, block_y * (s32)OCCLUSION_BLOCK_SIZE);
+			s32 last_y = math::min(rect.max_y, block_y * (s32)OCCLUSION_BLOCK_SIZE + (s32)OCCLUSION_BLOCK_SIZE - 1);
+			s32 first_x = math::max(rect.min_x, block_x * (s32)OCCLUSION_BLOCK_SIZE);
+			s32 last_x = math::min(rect.max_x, block_x * (s32)OCCLUSION_BLOCK_SIZE + (s32)OCCLUSION_BLOCK_SIZE - 1);
+			for (s32 y = first_y; y <= last_y; y++) {
+				for (s32 x = first_x; x <= last_x; x++) {
+					if (rect.min_depth <= depths[y * OCCLUSION_BUFFER_WIDTH + x]) {
+						return true;
+					}
+				}
+			}
+		}
+	}
+	return false;
+}
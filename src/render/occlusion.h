@@ -0,0 +1,107 @@
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include "vertices.h"
+#include "../collision/collision.h"
+#include "../libs/number_types.h"
+#include "../libs/math/vector.h"
+#include "../libs/math/matrix.h"
+#include "../libs/structures/array.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define OCCLUSION_USE_SSE
+#endif
+
+// AVX2 is used only if the compiler is allowed to generate it (/arch:AVX2), there is no runtime dispatch.
+#if defined(__AVX2__)
+#define OCCLUSION_USE_AVX2
+#endif
+
+#if defined(OCCLUSION_USE_AVX2)
+const u32 OCCLUSION_LANE_COUNT = 8;
+#elif defined(OCCLUSION_USE_SSE)
+const u32 OCCLUSION_LANE_COUNT = 4;
+#else
+const u32 OCCLUSION_LANE_COUNT = 1;
+#endif
+
+// The buffer is split into tiles rasterized by separate jobs, tiles are split into blocks of the hierarchical depth.
+// Widths of tiles are multiples of 8, so SIMD rows never cross a tile.
+const u32 OCCLUSION_BUFFER_WIDTH = 320;
+const u32 OCCLUSION_BUFFER_HEIGHT = 192;
+const u32 OCCLUSION_TILE_WIDTH = 80;
+const u32 OCCLUSION_TILE_HEIGHT = 48;
+const u32 OCCLUSION_TILE_X_COUNT = OCCLUSION_BUFFER_WIDTH / OCCLUSION_TILE_WIDTH;
+const u32 OCCLUSION_TILE_Y_COUNT = OCCLUSION_BUFFER_HEIGHT / OCCLUSION_TILE_HEIGHT;
+const u32 OCCLUSION_TILE_COUNT = OCCLUSION_TILE_X_COUNT * OCCLUSION_TILE_Y_COUNT;
+const u32 OCCLUSION_BLOCK_SIZE = 8;
+const u32 OCCLUSION_BLOCK_X_COUNT = OCCLUSION_BUFFER_WIDTH / OCCLUSION_BLOCK_SIZE;
+const u32 OCCLUSION_BLOCK_Y_COUNT = OCCLUSION_BUFFER_HEIGHT / OCCLUSION_BLOCK_SIZE;
+// Occluders are rasterized at pixel corners, a row of corners has space for a SIMD chunk starting at the last corner.
+const u32 OCCLUSION_CORNER_ROW_PITCH = OCCLUSION_BUFFER_WIDTH + 8;
+const u32 OCCLUSION_CORNER_ROW_COUNT = OCCLUSION_BUFFER_HEIGHT + 1;
+
+// Occluders are picked from meshes with at most OCCLUSION_MAX_OCCLUDER_TRIANGLE_COUNT triangles
+// which cover at least OCCLUSION_MIN_OCCLUDER_SCREEN_AREA of the screen.
+const u32 OCCLUSION_MAX_OCCLUDER_TRIANGLE_COUNT = 2048;
+const u32 OCCLUSION_TRIANGLE_BUDGET = 65536;
+const float OCCLUSION_MIN_OCCLUDER_SCREEN_AREA = 0.01f;
+
+struct Job_System;
+
+// A triangle in the buffer space, x and y are in pixels with y going down, z is the d3d depth.
+// Bounds are the first and the last pixel corners which can be covered.
+struct Occluder_Triangle {
+	Vector3 vertices[3];
+	s32 min_x;
+	s32 min_y;
+	s32 max_x;
+	s32 max_y;
+};
+
+struct Occlusion_Rect {
+	s32 min_x;
+	s32 min_y;
+	s32 max_x;
+	s32 max_y;
+	float min_depth;
+};
+
+// Occluders are rasterized on the CPU into a low resolution depth buffer. Depths are rasterized at pixel corners,
+// a corner keeps the nearest depth of occluders covering it. A pixel is covered only if all its corners are covered
+// and it takes the farthest depth of its corners, so objects seen through partly covered pixels at edges of occluders
+// are not hidden. Every block of OCCLUSION_BLOCK_SIZE pixels keeps the farthest depth of its pixels, so most tests
+// of bounding boxes read only a few blocks. Triangles crossing the near plane are clipped.
+struct Occlusion_Buffer {
+	Matrix4 view_projection_matrix;
+
+	u32 occluder_count = 0;
+	u32 occludee_count = 0;
+	u32 occluded_count = 0;
+
+	Array<float> depths;
+	Array<float> corner_depths;
+	Array<float> block_depths;
+	Array<Vector4> clip_vertices;
+	Array<Occluder_Triangle> triangles;
+	Array<u32> tile_triangles[OCCLUSION_TILE_COUNT]; // Indices of triangles overlapping tiles.
+
+	void begin_frame(const Matrix4 &_view_projection_matrix);
+	// Indices are relative to vertices.
+	void add_occluder(Vertex_PNTUV *vertices, u32 vertex_count, u32 *indices, u32 index_count, const Matrix4 &world_matrix);
+	void add_triangle(const Vector4 &clip_vertex_0, const Vector4 &clip_vertex_1, const Vector4 &clip_vertex_2);
+	// Tiles are rasterized by jobs if the job system is passed, otherwise by the calling thread.
+	// Corners of a tile are rasterized before pixels of the tile are resolved, pixels read corners of neighbour tiles.
+	void rasterize(Job_System *job_system = NULL);
+	void rasterize_tile_corners(u32 tile_index);
+	void resolve_tile(u32 tile_index);
+
+	// Returns false if the box crosses the near plane.
+	bool project_AABB(const AABB &aabb, Occlusion_Rect *rect);
+	// The part of the buffer covered by the projected box, boxes crossing the near plane cover the whole buffer.
+	float find_screen_area(const AABB &aabb);
+	// The buffer must be rasterized. Boxes crossing the near plane are always visible.
+	bool is_visible(const AABB &aabb);
+};
+
+#endif
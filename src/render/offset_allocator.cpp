@@ -0,0 +1,112 @@
+#include <assert.h>
+
+#include "offset_allocator.h"
+#include "../libs/math/functions.h"
+
+void Offset_Allocator::reset(u32 _capacity)
+{
+	capacity = _capacity;
+	used_count = 0;
+	free_ranges.clear();
+	if (capacity > 0) {
+		free_ranges.push({ 0, capacity });
+	}
+}
+
+void Offset_Allocator::grow(u32 new_capacity)
+{
+	assert(new_capacity >= capacity);
+
+	if (new_capacity == capacity) {
+		return;
+	}
+	u32 old_capacity = capacity;
+	capacity = new_capacity;
+	if (!free_ranges.is_empty() && ((free_ranges.last().offset + free_ranges.last().count) == old_capacity)) {
+		free_ranges.last().count += new_capacity - old_capacity;
+	} else {
+		free_ranges.push({ old_capacity, new_capacity - old_capacity });
+	}
+}
+
+void Offset_Allocator::free(u32 offset, u32 count)
+{
+	assert((offset + count) <= capacity);
+	assert(count <= used_count);
+
+	if (count == 0) {
+		return;
+	}
+	used_count -= count;
+
+	u32 index = 0;
+	while ((index < free_ranges.count) && (free_ranges[index].offset < offset)) {
+		index++;
+	}
+	assert((index == free_ranges.count) || ((offset + count) <= free_ranges[index].offset));
+	assert((index == 0) || ((free_ranges[index - 1].offset + free_ranges[index - 1].count) <= offset));
+
+	bool merge_with_previous = (index > 0) && ((free_ranges[index - 1].offset + free_ranges[index - 1].count) == offset);
+	bool merge_with_next = (index < free_ranges.count) && ((offset + count) == free_ranges[index].offset);
+
+	if (merge_with_previous && merge_with_next) {
+		free_ranges[index - 1].count += count + free_ranges[index].count;
+		free_ranges.remove(index);
+	} else if (merge_with_previous) {
+		free_ranges[index - 1].count += count;
+	} else if (merge_with_next) {
+		free_ranges[index].offset = offset;
+		free_ranges[index].count += count;
+	} else {
+		free_ranges.push({ offset, count });
+		for (u32 i = free_ranges.count - 1; i > index; i--) {
+			free_ranges[i] = free_ranges[i - 1];
+		}
+		free_ranges[index] = { offset, count };
+	}
+}
+
+u32 Offset_Allocator::allocate(u32 count)
+{
+	if (count == 0) {
+		return 0;
+	}
+	u32 best_index = UINT32_MAX;
+	for (u32 i = 0; i < free_ranges.count; i++) {
+		if ((free_ranges[i].count >= count) && ((best_index == UINT32_MAX) || (free_ranges[i].count < free_ranges[best_index].count))) {
+			best_index = i;
+			if (free_ranges[i].count == count) {
+				break;
+			}
+		}
+	}
+	if (best_index == UINT32_MAX) {
+		return OFFSET_ALLOCATOR_NO_SPACE;
+	}
+	Range *range = &free_ranges[best_index];
+	u32 offset = range->offset;
+	if (range->count == count) {
+		free_ranges.remove(best_index);
+	} else {
+		range->offset += count;
+		range->count -= count;
+	}
+	used_count += count;
+	return offset;
+}
+
+u32 Offset_Allocator::get_largest_free_range()
+{
+	u32 largest_range = 0;
+	for (u32 i = 0; i < free_ranges.count; i++) {
+		largest_range = math::max(largest_range, free_ranges[i].count);
+	}
+	return largest_range;
+}
+
+// Growing by at least the current capacity keeps the number of reallocations of the buffer logarithmic.
+// The new space is added to the end, so count elements always fit the grown buffer.
+u32 Offset_Allocator::get_grown_capacity(u32 count, u32 min_capacity)
+{
+	return math::max(math::max(capacity * 2, capacity + count), min_capacity);
+}
@@ -0,0 +1,42 @@
+#ifndef OFFSET_ALLOCATOR_H
+#define OFFSET_ALLOCATOR_H
+
+#include <stdint.h>
+
+#include "../libs/number_types.h"
+#include "../libs/structures/array.h"
+
+const u32 OFFSET_ALLOCATOR_NO_SPACE = UINT32_MAX;
+
+// Allocates ranges of elements in a buffer of capacity elements, the allocator doesn't own the buffer.
+// Free ranges are sorted by offsets, a freed range is merged with its neighbours.
+// A range is allocated from the smallest free range which fits it.
+struct Offset_Allocator {
+	struct Range {
+		u32 offset = 0;
+		u32 count = 0;
+	};
+
+	u32 capacity = 0;
+	u32 used_count = 0;
+	Array<Range> free_ranges;
+
+	void reset(u32 _capacity);
+	// The buffer has to be grown by the owner, new elements are added to the end.
+	void grow(u32 new_capacity);
+	void free(u32 offset, u32 count);
+
+	// Returns OFFSET_ALLOCATOR_NO_SPACE if there is no free range which fits count elements.
+	u32 allocate(u32 count);
+	u32 get_free_count();
+	u32 get_largest_free_range();
+	// The capacity which the owner should grow to when count elements don't fit.
+	u32 get_grown_capacity(u32 count, u32 min_capacity);
+};
+
+inline u32 Offset_Allocator::get_free_count()
+{
+	return capacity - used_count;
+}
+
+#endif
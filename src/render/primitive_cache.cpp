@@ -0,0 +1,219 @@
+#include <assert.h>
+
+#include "primitive_cache.h"
+#include "render_system.h"
+#include "../sys/sys.h"
+#include "../sys/utils.h"
+#include "../libs/math/functions.h"
+#include "../libs/structures/hash_table.h"
+
+inline bool fits_bits(u32 value, u32 bit_count)
+{
+	return value < (1u << bit_count);
+}
+
+u64 make_primitive_2d_key(Primitive_2D_Shape shape, u32 width, u32 height, u32 thickness, u32 rounding, u32 flags)
+{
+	assert(fits_bits(shape, 3));
+
+	if (!fits_bits(flags, 4) || !fits_bits(rounding, 9) || !fits_bits(thickness, 8) || !fits_bits(width, 20) || !fits_bits(height, 20)) {
+		return PRIMITIVE_CACHE_NO_KEY;
+	}
+	return ((u64)shape << 61) | ((u64)flags << 57) | ((u64)rounding << 48) | ((u64)thickness << 40) | ((u64)width << 20) | (u64)height;
+}
+
+inline u32 get_memory_size(Primitive_2D *primitive)
+{
+	return sizeof(Primitive_2D) + primitive->vertices.count * sizeof(Vertex_X2UV) + primitive->indices.count * sizeof(u32);
+}
+
+void Primitive_Cache::release()
+{
+	Entry *entry = NULL;
+	For(entries, entry) {
+		DELETE_PTR(entry->primitive);
+	}
+	slots.clear();
+	entries.clear();
+	free_entries.clear();
+	entry_count = 0;
+	memory_size = 0;
+	most_recently_used = PRIMITIVE_CACHE_NO_ENTRY;
+	least_recently_used = PRIMITIVE_CACHE_NO_ENTRY;
+}
+
+void Primitive_Cache::new_frame()
+{
+	frame_index++;
+}
+
+u32 Primitive_Cache::find_slot(u64 key)
+{
+	assert(!slots.is_empty());
+
+	u32 mask = slots.count - 1;
+	u32 slot = hash(key) & mask;
+	while ((slots[slot] != PRIMITIVE_CACHE_NO_ENTRY) && (entries[slots[slot]].key != key)) {
+		slot = (slot + 1) & mask;
+	}
+	return slot;
+}
+
+void Primitive_Cache::grow_slots()
+{
+	u32 slot_count = math::max(PRIMITIVE_CACHE_MIN_SLOT_COUNT, slots.count * 2);
+	slots.reserve(slot_count);
+	for (u32 i = 0; i < slot_count; i++) {
+		slots[i] = PRIMITIVE_CACHE_NO_ENTRY;
+	}
+	for (u32 i = 0; i < entries.count; i++) {
+		if (entries[i].primitive) {
+			slots[find_slot(entries[i].key)] = i;
+		}
+	}
+}
+
+// Entries after the removed one are shifted back, so lookups don't need tombstones.
+void Primitive_Cache::remove_slot(u32 slot)
+{
+	u32 mask = slots.count - 1;
+	u32 empty_slot = slot;
+	slots[empty_slot] = PRIMITIVE_CACHE_NO_ENTRY;
+
+	for (u32 next_slot = (slot + 1) & mask; slots[next_slot] != PRIMITIVE_CACHE_NO_ENTRY; next_slot = (next_slot + 1) & mask) {
+		u32 home_slot = hash(entries[slots[next_slot]].key) & mask;
+		// The entry stays if its home slot lies cyclically in (empty_slot, next_slot].
+		bool stays = (empty_slot < next_slot) ? ((home_slot > empty_slot) && (home_slot <= next_slot)) : ((home_slot > empty_slot) || (home_slot <= next_slot));
+		if (!stays) {
+			slots[empty_slot] = slots[next_slot];
+			slots[next_slot] = PRIMITIVE_CACHE_NO_ENTRY;
+			empty_slot = next_slot;
+		}
+	}
+}
+
+void Primitive_Cache::link_as_most_recent(u32 entry_index)
+{
+	Entry *entry = &entries[entry_index];
+	entry->more_recent = PRIMITIVE_CACHE_NO_ENTRY;
+	entry->less_recent = most_recently_used;
+	if (most_recently_used != PRIMITIVE_CACHE_NO_ENTRY) {
+		entries[most_recently_used].more_recent = entry_index;
+	} else {
+		least_recently_used = entry_index;
+	}
+	most_recently_used = entry_index;
+}
+
+void Primitive_Cache::unlink(u32 entry_index)
+{
+	Entry *entry = &entries[entry_index];
+	if (entry->more_recent != PRIMITIVE_CACHE_NO_ENTRY) {
+		entries[entry->more_recent].less_recent = entry->less_recent;
+	} else {
+		most_recently_used = entry->less_recent;
+	}
+	if (entry->less_recent != PRIMITIVE_CACHE_NO_ENTRY) {
+		entries[entry->less_recent].more_recent = entry->more_recent;
+	} else {
+		least_recently_used = entry->more_recent;
+	}
+	entry->more_recent = PRIMITIVE_CACHE_NO_ENTRY;
+	entry->less_recent = PRIMITIVE_CACHE_NO_ENTRY;
+}
+
+u32 Primitive_Cache::use_entry(u64 key)
+{
+	if (slots.is_empty()) {
+		return PRIMITIVE_CACHE_NO_ENTRY;
+	}
+	u32 entry_index = slots[find_slot(key)];
+	if (entry_index == PRIMITIVE_CACHE_NO_ENTRY) {
+		return PRIMITIVE_CACHE_NO_ENTRY;
+	}
+	entries[entry_index].last_used_frame = frame_index;
+	if (most_recently_used != entry_index) {
+		unlink(entry_index);
+		link_as_most_recent(entry_index);
+	}
+	return entry_index;
+}
+
+Primitive_2D *Primitive_Cache::find(u64 key)
+{
+	u32 entry_index = use_entry(key);
+	if (entry_index == PRIMITIVE_CACHE_NO_ENTRY) {
+		miss_count++;
+		return NULL;
+	}
+	hit_count++;
+	return entries[entry_index].primitive;
+}
+
+Primitive_2D *Primitive_Cache::touch(u64 key)
+{
+	u32 entry_index = use_entry(key);
+	return (entry_index != PRIMITIVE_CACHE_NO_ENTRY) ? entries[entry_index].primitive : NULL;
+}
+
+void Primitive_Cache::add(u64 key, Primitive_2D *primitive)
+{
+	assert(primitive);
+
+	// The table is kept at most half full.
+	if (((entry_count + 1) * 2) > slots.count) {
+		grow_slots();
+	}
+	u32 slot = find_slot(key);
+	assert(slots[slot] == PRIMITIVE_CACHE_NO_ENTRY);
+
+	u32 entry_index = 0;
+	if (!free_entries.is_empty()) {
+		entry_index = free_entries.pop();
+	} else {
+		entry_index = entries.push(Entry());
+	}
+	Entry *entry = &entries[entry_index];
+	entry->key = key;
+	entry->memory_size = get_memory_size(primitive);
+	entry->last_used_frame = frame_index;
+	entry->primitive = primitive;
+
+	slots[slot] = entry_index;
+	link_as_most_recent(entry_index);
+	entry_count++;
+	memory_size += entry->memory_size;
+
+	evict_entries();
+}
+
+void Primitive_Cache::evict_entries()
+{
+	while ((memory_size > memory_budget) && (least_recently_used != PRIMITIVE_CACHE_NO_ENTRY)) {
+		u32 entry_index = least_recently_used;
+		Entry *entry = &entries[entry_index];
+		if ((entry->last_used_frame + 1) >= frame_index) {
+			// The rest of entries were used later.
+			break;
+		}
+		remove_slot(find_slot(entry->key));
+		unlink(entry_index);
+
+		memory_size -= entry->memory_size;
+		DELETE_PTR(entry->primitive);
+		*entry = Entry();
+		free_entries.push(entry_index);
+
+		entry_count--;
+		eviction_count++;
+	}
+}
+
+void Primitive_Cache::print_stats()
+{
+	u64 lookup_count = hit_count + miss_count;
+	float hit_rate = (lookup_count > 0) ? (float)hit_count * 100.0f / (float)lookup_count : 0.0f;
+
+	print("Primitive_Cache: {} primitives use {} of {} bytes.", entry_count, memory_size, memory_budget);
+	print("Primitive_Cache: {} hits, {} misses ({}% hit rate), {} evictions.", hit_count, miss_count, hit_rate, eviction_count);
+}
@@ -0,0 +1,83 @@
+#ifndef PRIMITIVE_CACHE_H
+#define PRIMITIVE_CACHE_H
+
+#include <stdint.h>
+
+#include "../libs/number_types.h"
+#include "../libs/structures/array.h"
+
+struct Primitive_2D;
+
+const u32 PRIMITIVE_CACHE_NO_ENTRY = UINT32_MAX;
+const u64 PRIMITIVE_CACHE_NO_KEY = 0;
+const u32 PRIMITIVE_CACHE_MEMORY_BUDGET = 4 * 1024 * 1024;
+const u32 PRIMITIVE_CACHE_MIN_SLOT_COUNT = 256;
+
+enum Primitive_2D_Shape : u32 {
+	PRIMITIVE_2D_RECT = 1,
+	PRIMITIVE_2D_OUTLINES,
+	PRIMITIVE_2D_TEXTURE,
+	PRIMITIVE_2D_LINE,
+	PRIMITIVE_2D_CIRCLE,
+	PRIMITIVE_2D_OUTLINE_CIRCLE
+};
+
+// Sizes in keys are in quarters of a pixel.
+inline u32 quantize_primitive_size(float size)
+{
+	return (size > 0.0f) ? (u32)(size * 4.0f + 0.5f) : 0;
+}
+
+// The key is packed as | shape 3 bits | flags 4 bits | rounding 9 bits | thickness 8 bits | width 20 bits | height 20 bits |.
+// Returns PRIMITIVE_CACHE_NO_KEY if a value doesn't fit its bits, such primitives are not cached.
+u64 make_primitive_2d_key(Primitive_2D_Shape shape, u32 width, u32 height, u32 thickness = 0, u32 rounding = 0, u32 flags = 0);
+
+// Geometry of 2D primitives in a flat open addressing table. If the cache is over the memory budget
+// the least recently used primitives are deleted, primitives used in the current or the previous frame are never deleted
+// because render primitive lists can still point to them.
+struct Primitive_Cache {
+	struct Entry {
+		u64 key = 0;
+		u32 memory_size = 0;
+		u32 last_used_frame = 0;
+		u32 more_recent = PRIMITIVE_CACHE_NO_ENTRY;
+		u32 less_recent = PRIMITIVE_CACHE_NO_ENTRY;
+		Primitive_2D *primitive = NULL;
+	};
+
+	u32 memory_budget = PRIMITIVE_CACHE_MEMORY_BUDGET;
+	u32 memory_size = 0;
+	u32 frame_index = 0;
+	u32 entry_count = 0;
+	u32 most_recently_used = PRIMITIVE_CACHE_NO_ENTRY;
+	u32 least_recently_used = PRIMITIVE_CACHE_NO_ENTRY;
+
+	u64 hit_count = 0;
+	u64 miss_count = 0;
+	u64 eviction_count = 0;
+
+	Array<u32> slots; // Indices of entries, the count is a power of two.
+	Array<Entry> entries;
+	Array<u32> free_entries;
+
+	void release();
+	void new_frame();
+
+	Primitive_2D *find(u64 key);
+	// The primitive must be filled, the cache owns it after the call.
+	void add(u64 key, Primitive_2D *primitive);
+	// Marks the primitive as used without counting a lookup, returns NULL if it was evicted.
+	Primitive_2D *touch(u64 key);
+
+	void print_stats();
+
+	u32 find_slot(u64 key);
+	u32 use_entry(u64 key);
+	void grow_slots();
+	void remove_slot(u32 slot);
+	void link_as_most_recent(u32 entry_index);
+	void unlink(u32 entry_index);
+	void evict_entries();
+};
+
+#endif
@@ -7,6 +7,7 @@
 #include "../libs/os/path.h"
 #include "../libs/os/file.h"
 #include "../sys/sys.h"
+#include "../libs/math/functions.h"
 
 static Multisample_Info default_render_api_multisample;
 
@@ -32,13 +33,17 @@ void begin_mark_rendering_event(const wchar_t *event_name)
 {
 	assert(event_name);
 	debug_mark_rendering_event_counter++;
-	directx_annotation_interface->BeginEvent(event_name);
+	if (directx_annotation_interface) {
+		directx_annotation_interface->BeginEvent(event_name);
+	}
 }
 
 void end_mark_rendering_event()
 {
 	assert(--debug_mark_rendering_event_counter >= 0);
-	directx_annotation_interface->EndEvent();
+	if (directx_annotation_interface) {
+		directx_annotation_interface->EndEvent();
+	}
 }
 
 inline D3D11_PRIMITIVE_TOPOLOGY to_dx11_primitive_type(Render_Primitive_Type primitive_type)
@@ -289,6 +294,12 @@ u32 dxgi_format_size(DXGI_FORMAT format)
 		case DXGI_FORMAT_B4G4R4A4_UNORM:
 			return 2;
 
+		case DXGI_FORMAT_R8_TYPELESS:
+		case DXGI_FORMAT_R8_UNORM:
+		case DXGI_FORMAT_R8_UINT:
+		case DXGI_FORMAT_R8_SNORM:
+		case DXGI_FORMAT_R8_SINT:
+		case DXGI_FORMAT_A8_UNORM:
 		case DXGI_FORMAT_BC2_TYPELESS:
 		case DXGI_FORMAT_BC2_UNORM:
 		case DXGI_FORMAT_BC2_UNORM_SRGB:
@@ -337,6 +348,10 @@ void Gpu_Device::create_gpu_buffer(Gpu_Buffer_Desc *desc, Gpu_Buffer *buffer)
 	buffer->data_count = desc->data_count;
 	buffer->data_size = desc->data_size;
 
+	if (backend == RENDER_BACKEND_NULL) {
+		return;
+	}
+
 	D3D11_BUFFER_DESC buffer_desc;
 	ZeroMemory(&buffer_desc, sizeof(D3D11_BUFFER_DESC));
 	buffer_desc.Usage = to_dx11_resource_usage(desc->usage);
@@ -374,6 +389,10 @@ void Gpu_Device::create_texture_2d(Texture2D_Desc *texture_desc, Texture2D *text
 	assert(texture);
 	assert(texture_desc);
 
+	if (backend == RENDER_BACKEND_NULL) {
+		return;
+	}
+
 	D3D11_TEXTURE2D_DESC texture_2d_desc;
 	ZeroMemory(&texture_2d_desc, sizeof(D3D11_TEXTURE2D_DESC));
 	texture_2d_desc.Width = texture_desc->width;
@@ -411,6 +430,10 @@ void Gpu_Device::create_texture_3d(Texture3D_Desc *texture_desc, Texture3D *text
 	assert(texture);
 	assert(texture_desc);
 
+	if (backend == RENDER_BACKEND_NULL) {
+		return;
+	}
+
 	D3D11_TEXTURE3D_DESC texture_3d_desc;
 	ZeroMemory(&texture_3d_desc, sizeof(D3D11_TEXTURE3D_DESC));
 	texture_3d_desc.Width = texture_desc->width;
@@ -437,6 +460,10 @@ void Gpu_Device::create_texture_3d(Texture3D_Desc *texture_desc, Texture3D *text
 
 void Gpu_Device::create_rasterizer_state(Rasterizer_Desc *rasterizer_desc, Rasterizer_State *rasterizer_state)
 {
+	if (backend == RENDER_BACKEND_NULL) {
+		return;
+	}
+
 	HR(dx11_device->CreateRasterizerState(&rasterizer_desc->desc, rasterizer_state->ReleaseAndGetAddressOf()));
 }
 
@@ -445,6 +472,10 @@ void Gpu_Device::create_blend_state(Blend_State_Desc *blending_desc, Blend_State
 	assert(blending_desc);
 	assert(blend_state);
 
+	if (backend == RENDER_BACKEND_NULL) {
+		return;
+	}
+
 	D3D11_BLEND_DESC desc;
 	ZeroMemory(&desc, sizeof(desc));
 	desc.AlphaToCoverageEnable = false;
@@ -465,6 +496,10 @@ void Gpu_Device::create_depth_stencil_state(Depth_Stencil_State_Desc *depth_sten
 	assert(depth_stencil_desc);
 	assert(depth_stencil_state);
 
+	if (backend == RENDER_BACKEND_NULL) {
+		return;
+	}
+
 	D3D11_DEPTH_STENCIL_DESC desc;
 	ZeroMemory(&desc, sizeof(D3D11_DEPTH_STENCILOP_DESC));
 
@@ -508,6 +543,10 @@ inline DXGI_FORMAT to_depth_stencil_view_format(DXGI_FORMAT format)
 
 void Gpu_Device::create_shader_resource_view(Gpu_Buffer *gpu_buffer)
 {
+	if (backend == RENDER_BACKEND_NULL) {
+		return;
+	}
+
 	D3D11_SHADER_RESOURCE_VIEW_DESC shader_resource_view_desc;
 	ZeroMemory(&shader_resource_view_desc, sizeof(shader_resource_view_desc));
 	shader_resource_view_desc.Format = DXGI_FORMAT_UNKNOWN;
@@ -529,6 +568,10 @@ inline DXGI_FORMAT to_shader_resource_view_format(DXGI_FORMAT format)
 
 void Gpu_Device::create_shader_resource_view(Texture2D_Desc *texture_desc, Texture2D *texture)
 {
+	if (backend == RENDER_BACKEND_NULL) {
+		return;
+	}
+
 	D3D11_SHADER_RESOURCE_VIEW_DESC shader_resource_view_desc;
 	ZeroMemory(&shader_resource_view_desc, sizeof(shader_resource_view_desc));
 	shader_resource_view_desc.Format = to_shader_resource_view_format(texture_desc->format);
@@ -550,6 +593,10 @@ void Gpu_Device::create_shader_resource_view(Texture2D_Desc *texture_desc, Textu
 
 void Gpu_Device::create_shader_resource_view(Texture3D_Desc *texture_desc, Texture3D *texture)
 {
+	if (backend == RENDER_BACKEND_NULL) {
+		return;
+	}
+
 	D3D11_SHADER_RESOURCE_VIEW_DESC shader_resource_view_desc;
 	ZeroMemory(&shader_resource_view_desc, sizeof(shader_resource_view_desc));
 	shader_resource_view_desc.Format = to_shader_resource_view_format(texture_desc->format);
@@ -562,6 +609,10 @@ void Gpu_Device::create_shader_resource_view(Texture3D_Desc *texture_desc, Textu
 
 void Gpu_Device::create_depth_stencil_view(Texture2D_Desc *texture_desc, Texture2D *texture)
 {
+	if (backend == RENDER_BACKEND_NULL) {
+		return;
+	}
+
 	D3D11_DEPTH_STENCIL_VIEW_DESC depth_stencil_view_desc;
 	ZeroMemory(&depth_stencil_view_desc, sizeof(D3D11_DEPTH_STENCIL_VIEW_DESC));
 	depth_stencil_view_desc.Format = to_depth_stencil_view_format(texture_desc->format);
@@ -571,11 +622,19 @@ void Gpu_Device::create_depth_stencil_view(Texture2D_Desc *texture_desc, Texture
 
 void Gpu_Device::create_render_target_view(Texture2D *texture)
 {
+	if (backend == RENDER_BACKEND_NULL) {
+		return;
+	}
+
 	HR(dx11_device->CreateRenderTargetView(texture->resource.Get(), NULL, texture->rtv.ReleaseAndGetAddressOf()));
 }
 
 void Gpu_Device::create_unordered_access_view(Gpu_Buffer *gpu_buffer)
 {
+	if (backend == RENDER_BACKEND_NULL) {
+		return;
+	}
+
 	D3D11_UNORDERED_ACCESS_VIEW_DESC unordered_access_view_desc;
 	ZeroMemory(&unordered_access_view_desc, sizeof(D3D11_UNORDERED_ACCESS_VIEW_DESC));
 	unordered_access_view_desc.Format = DXGI_FORMAT_UNKNOWN;
@@ -590,6 +649,10 @@ void Gpu_Device::create_unordered_access_view(Texture2D_Desc *texture_desc, Text
 {
 	assert(!is_multisampled_texture(texture_desc));
 
+	if (backend == RENDER_BACKEND_NULL) {
+		return;
+	}
+
 	D3D11_UNORDERED_ACCESS_VIEW_DESC unordered_access_view_desc;
 	ZeroMemory(&unordered_access_view_desc, sizeof(D3D11_UNORDERED_ACCESS_VIEW_DESC));
 	unordered_access_view_desc.Format = texture_desc->format;
@@ -600,36 +663,64 @@ void Gpu_Device::create_unordered_access_view(Texture2D_Desc *texture_desc, Text
 
 void Gpu_Device::create_shader(u8 *byte_code, u32 byte_code_size, Vertex_Shader &shader)
 {
+	if (backend == RENDER_BACKEND_NULL) {
+		return;
+	}
+
 	HR(dx11_device->CreateVertexShader((void *)byte_code, byte_code_size, NULL, shader.ReleaseAndGetAddressOf()));
 }
 
 void Gpu_Device::create_shader(u8 *byte_code, u32 byte_code_size, Geometry_Shader &shader)
 {
+	if (backend == RENDER_BACKEND_NULL) {
+		return;
+	}
+
 	HR(dx11_device->CreateGeometryShader((void *)byte_code, byte_code_size, NULL, shader.ReleaseAndGetAddressOf()));
 }
 
 void Gpu_Device::create_shader(u8 *byte_code, u32 byte_code_size, Compute_Shader &shader)
 {
+	if (backend == RENDER_BACKEND_NULL) {
+		return;
+	}
+
 	HR(dx11_device->CreateComputeShader((void *)byte_code, byte_code_size, NULL, shader.ReleaseAndGetAddressOf()));
 }
 
 void Gpu_Device::create_shader(u8 *byte_code, u32 byte_code_size, Hull_Shader &shader)
 {
+	if (backend == RENDER_BACKEND_NULL) {
+		return;
+	}
+
 	HR(dx11_device->CreateHullShader((void *)byte_code, byte_code_size, NULL, shader.ReleaseAndGetAddressOf()));
 }
 
 void Gpu_Device::create_shader(u8 *byte_code, u32 byte_code_size, Domain_Shader &shader)
 {
+	if (backend == RENDER_BACKEND_NULL) {
+		return;
+	}
+
 	HR(dx11_device->CreateDomainShader((void *)byte_code, byte_code_size, NULL, shader.ReleaseAndGetAddressOf()));
 }
 
 void Gpu_Device::create_shader(u8 *byte_code, u32 byte_code_size, Pixel_Shader &shader)
 {
+	if (backend == RENDER_BACKEND_NULL) {
+		return;
+	}
+
 	HR(dx11_device->CreatePixelShader((void *)byte_code, byte_code_size, NULL, shader.ReleaseAndGetAddressOf()));
 }
 
 void Gpu_Device::create_input_layout(void *shader_bytecode, u32 shader_bytecode_size, Input_Layout_Elements *input_layout_elements, Input_Layout &input_layout)
 {
+	if (backend == RENDER_BACKEND_NULL) {
+		return;
+	}
+
 	u32 alignment_offset = 0;
 	Array<D3D11_INPUT_ELEMENT_DESC> layout_elements;
 	
@@ -641,11 +732,27 @@ void Gpu_Device::create_input_layout(void *shader_bytecode, u32 shader_bytecode_
 	HR(dx11_device->CreateInputLayout(layout_elements.items, layout_elements.count, shader_bytecode, shader_bytecode_size, input_layout.ReleaseAndGetAddressOf()));
 }
 
+void *Render_Pipeline::get_null_mapped_memory(u32 size)
+{
+	assert(is_null_backend());
+
+	u32 required_size = math::max(size, NULL_BACKEND_MIN_MAPPED_MEMORY_SIZE);
+	if (null_mapped_memory.count < required_size) {
+		null_mapped_memory.reserve(required_size);
+	}
+	return (void *)null_mapped_memory.items;
+}
+
 void Render_Pipeline::resolve_subresource(Texture2D *dst_texture, Texture2D *src_texture, DXGI_FORMAT format)
 {
 	assert(dst_texture);
 	assert(src_texture);
 
+	record(RENDER_COMMAND_COPY_RESOURCE);
+	if (is_null_backend()) {
+		return;
+	}
+
 	dx11_context->ResolveSubresource(dst_texture->get(), 0, src_texture->get(), 0, format);
 }
 
@@ -673,11 +780,19 @@ void Render_Pipeline::apply(Render_Pipeline_State *render_pipeline_state)
 
 void Render_Pipeline::clear_depth_stencil_view(const Depth_Stencil_View &depth_stencil_view, float depth_value, u8 stencil_value)
 {
+	record(RENDER_COMMAND_CLEAR);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->ClearDepthStencilView(depth_stencil_view.Get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, depth_value, stencil_value);
 }
 
 void Render_Pipeline::clear_render_target_view(const Render_Target_View &render_target_view, const Color &color)
 {
+	record(RENDER_COMMAND_CLEAR);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->ClearRenderTargetView(render_target_view.Get(), (float *)&color);
 }
 
@@ -686,9 +801,15 @@ void Render_Pipeline::update_constant_buffer(Gpu_Buffer *gpu_buffer, void *data)
 	assert(gpu_buffer);
 	assert(data);
 
-	void *buffer_data = map(*gpu_buffer);
-	memcpy(buffer_data, data, gpu_buffer->data_size);
-	unmap(*gpu_buffer);
+	record_upload(RENDER_COMMAND_UPDATE_CONSTANT_BUFFER, gpu_buffer->data_size);
+	if (is_null_backend()) {
+		return;
+	}
+
+	D3D11_MAPPED_SUBRESOURCE subresource;
+	HR(dx11_context->Map(gpu_buffer->get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &subresource));
+	memcpy(subresource.pData, data, gpu_buffer->data_size);
+	dx11_context->Unmap(gpu_buffer->get(), 0);
 }
 
 void Render_Pipeline::update_subresource(Texture2D *texture, void *data, u32 row_pitch, Rect_u32 *rect)
@@ -696,6 +817,21 @@ void Render_Pipeline::update_subresource(Texture2D *texture, void *data, u32 row
 	assert(texture);
 	assert(data);
 
+	if (command_log) {
+		u32 row_count = 0;
+		if (rect) {
+			row_count = rect->height;
+		} else if (!is_null_backend()) {
+			Texture2D_Desc texture_desc;
+			texture->get_desc(&texture_desc);
+			row_count = texture_desc.height;
+		}
+		record_upload(RENDER_COMMAND_UPDATE_SUBRESOURCE, row_pitch * row_count);
+	}
+	if (is_null_backend()) {
+		return;
+	}
+
 	if (rect) {
 		D3D11_BOX box = { rect->x, rect->y, 0, rect->right(), rect->bottom(), 1 };
 		dx11_context->UpdateSubresource(texture->resource.Get(), 0, &box, (const void *)data, row_pitch, 0);
@@ -704,28 +840,63 @@ void Render_Pipeline::update_subresource(Texture2D *texture, void *data, u32 row
 	}
 }
 
+void Render_Pipeline::update_subresource(Gpu_Buffer *gpu_buffer, void *data, u32 offset, u32 size)
+{
+	assert(gpu_buffer);
+	assert(data);
+	assert((offset + size) <= gpu_buffer->get_data_width());
+
+	record_upload(RENDER_COMMAND_UPDATE_SUBRESOURCE, size);
+	if (is_null_backend()) {
+		return;
+	}
+
+	D3D11_BOX box = { offset, 0, 0, offset + size, 1, 1 };
+	dx11_context->UpdateSubresource(gpu_buffer->get(), 0, &box, (const void *)data, 0, 0);
+}
+
 void Render_Pipeline::generate_mips(const Shader_Resource_View &shader_resource)
 {
+	record(RENDER_COMMAND_GENERATE_MIPS);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->GenerateMips(shader_resource.Get());
 }
 
 void Render_Pipeline::set_input_layout(void *pointer)
 {
+	record(RENDER_COMMAND_SET_INPUT_ASSEMBLER);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->IASetInputLayout(NULL);
 }
 
 void Render_Pipeline::set_input_layout(const Input_Layout &input_layout)
 {
+	record(RENDER_COMMAND_SET_INPUT_ASSEMBLER);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->IASetInputLayout(input_layout.Get());
 }
 
 void Render_Pipeline::set_primitive(Render_Primitive_Type primitive_type)
 {
+	record(RENDER_COMMAND_SET_INPUT_ASSEMBLER);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->IASetPrimitiveTopology(to_dx11_primitive_type(primitive_type));
 }
 
 void Render_Pipeline::set_vertex_buffer(Gpu_Buffer *gpu_buffer)
 {
+	record(RENDER_COMMAND_SET_INPUT_ASSEMBLER);
+	if (is_null_backend()) {
+		return;
+	}
 	u32 offsets = 0;
 	u32 strides = 0;
 	if (gpu_buffer) {
@@ -738,6 +909,10 @@ void Render_Pipeline::set_vertex_buffer(Gpu_Buffer *gpu_buffer)
 
 void Render_Pipeline::set_index_buffer(Gpu_Buffer *gpu_buffer)
 {
+	record(RENDER_COMMAND_SET_INPUT_ASSEMBLER);
+	if (is_null_backend()) {
+		return;
+	}
 	if (gpu_buffer) {
 		dx11_context->IASetIndexBuffer(gpu_buffer->resource.Get(), DXGI_FORMAT_R32_UINT, 0);
 	} else {
@@ -748,93 +923,176 @@ void Render_Pipeline::set_index_buffer(Gpu_Buffer *gpu_buffer)
 void Render_Pipeline::set_vertex_shader(Shader *shader)
 {
 	assert(shader);
+
+	record(RENDER_COMMAND_SET_SHADER);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->VSSetShader(shader->vertex_shader.Get(), 0, 0);
 }
 
 void Render_Pipeline::set_geometry_shader(Shader *shader)
 {
 	assert(shader);
+
+	record(RENDER_COMMAND_SET_SHADER);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->GSSetShader(shader->geometry_shader.Get(), 0, 0);
 }
 
 void Render_Pipeline::set_compute_shader(Shader *shader)
 {
 	assert(shader);
+
+	record(RENDER_COMMAND_SET_SHADER);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->CSSetShader(shader->compute_shader.Get(), 0, 0);
 }
 
 void Render_Pipeline::set_hull_shader(Shader *shader)
 {
 	assert(shader);
+
+	record(RENDER_COMMAND_SET_SHADER);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->HSSetShader(shader->hull_shader.Get(), 0, 0);
 }
 
 void Render_Pipeline::set_domain_shader(Shader *shader)
 {
 	assert(shader);
+
+	record(RENDER_COMMAND_SET_SHADER);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->DSSetShader(shader->domain_shader.Get(), 0, 0);
 }
 
 void Render_Pipeline::set_pixel_shader(Shader *shader)
 {
 	assert(shader);
+
+	record(RENDER_COMMAND_SET_SHADER);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->PSSetShader(shader->pixel_shader.Get(), 0, 0);
 }
 
+void Render_Pipeline::reset_geometry_shader()
+{
+	record(RENDER_COMMAND_SET_SHADER);
+	if (is_null_backend()) {
+		return;
+	}
+	dx11_context->GSSetShader(NULL, 0, 0);
+}
+
 void Render_Pipeline::set_vertex_shader_resource(u32 gpu_register, const Gpu_Buffer &constant_buffer)
 {
+	record(RENDER_COMMAND_SET_CONSTANT_BUFFER, gpu_register);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->VSSetConstantBuffers(gpu_register, 1, constant_buffer.resource.GetAddressOf());
 }
 
 void Render_Pipeline::set_vertex_shader_resource(u32 gpu_register, const Shader_Resource_View &shader_resource)
 {
+	record(RENDER_COMMAND_SET_SHADER_RESOURCE, gpu_register);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->VSSetShaderResources(gpu_register, 1, shader_resource.GetAddressOf());
 }
 
 void Render_Pipeline::set_vertex_shader_resource(u32 shader_resource_register, const Gpu_Struct_Buffer &struct_buffer)
 {
+	record(RENDER_COMMAND_SET_SHADER_RESOURCE, shader_resource_register);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->VSSetShaderResources(shader_resource_register, 1, struct_buffer.gpu_buffer.srv.GetAddressOf());
 }
 
 void Render_Pipeline::set_geometry_shader_resource(u32 gpu_register, const Gpu_Buffer &constant_buffer)
 {
+	record(RENDER_COMMAND_SET_CONSTANT_BUFFER, gpu_register);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->GSSetConstantBuffers(gpu_register, 1, constant_buffer.resource.GetAddressOf());
 }
 
 void Render_Pipeline::set_pixel_shader_sampler(u32 sampler_register, const Sampler_State &sampler_state)
 {
+	record(RENDER_COMMAND_SET_SAMPLER, sampler_register);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->PSSetSamplers(sampler_register, 1, sampler_state.GetAddressOf());
 }
 
 void Render_Pipeline::set_pixel_shader_resource(u32 gpu_register, const Gpu_Buffer &constant_buffer)
 {
+	record(RENDER_COMMAND_SET_CONSTANT_BUFFER, gpu_register);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->PSSetConstantBuffers(gpu_register, 1, constant_buffer.resource.GetAddressOf());
 }
 
 void Render_Pipeline::set_pixel_shader_resource(u32 shader_resource_register, const Shader_Resource_View &shader_resource_view)
 {
+	record(RENDER_COMMAND_SET_SHADER_RESOURCE, shader_resource_register);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->PSSetShaderResources(shader_resource_register, 1, shader_resource_view.GetAddressOf());
 }
 
 void Render_Pipeline::set_pixel_shader_resource(u32 shader_resource_register, const Gpu_Struct_Buffer &struct_buffer)
 {
+	record(RENDER_COMMAND_SET_SHADER_RESOURCE, shader_resource_register);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->PSSetShaderResources(shader_resource_register, 1, struct_buffer.gpu_buffer.srv.GetAddressOf());
 }
 
 void Render_Pipeline::reset_pixel_shader_resource(u32 shader_resource_register)
 {
+	record(RENDER_COMMAND_SET_SHADER_RESOURCE, shader_resource_register);
+	if (is_null_backend()) {
+		return;
+	}
 	Shader_Resource_View temp = nullptr;
 	dx11_context->PSSetShaderResources(shader_resource_register, 1, temp.GetAddressOf());
 }
 
 void Render_Pipeline::reset_compute_shader_resource_view(u32 shader_resource_register)
 {
+	record(RENDER_COMMAND_SET_SHADER_RESOURCE, shader_resource_register);
+	if (is_null_backend()) {
+		return;
+	}
 	Shader_Resource_View temp = nullptr;
 	dx11_context->CSSetShaderResources(shader_resource_register, 1, temp.GetAddressOf());
 }
 
 void Render_Pipeline::reset_compute_unordered_access_view(u32 shader_resource_register)
 {
+	record(RENDER_COMMAND_SET_SHADER_RESOURCE, shader_resource_register);
+	if (is_null_backend()) {
+		return;
+	}
 	u32 uav_initial_counts = -1;
 	Unordered_Access_View temp = nullptr;
 	dx11_context->CSSetUnorderedAccessViews(shader_resource_register, 1, temp.GetAddressOf(), &uav_initial_counts);
@@ -842,27 +1100,47 @@ void Render_Pipeline::reset_compute_unordered_access_view(u32 shader_resource_re
 
 void Render_Pipeline::set_compute_shader_resource(u32 gpu_register, const Gpu_Buffer &constant_buffer)
 {
+	record(RENDER_COMMAND_SET_CONSTANT_BUFFER, gpu_register);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->CSSetConstantBuffers(gpu_register, 1, constant_buffer.resource.GetAddressOf());
 }
 
 void Render_Pipeline::set_compute_shader_resource(u32 shader_resource_register, const Shader_Resource_View &shader_resource_view)
 {
+	record(RENDER_COMMAND_SET_SHADER_RESOURCE, shader_resource_register);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->CSSetShaderResources(shader_resource_register, 1, shader_resource_view.GetAddressOf());
 }
 
 void Render_Pipeline::set_compute_shader_resource(u32 shader_resource_register, const Unordered_Access_View &unordered_access_view)
 {
+	record(RENDER_COMMAND_SET_SHADER_RESOURCE, shader_resource_register);
+	if (is_null_backend()) {
+		return;
+	}
 	u32 uav_initial_counts = -1;
 	dx11_context->CSSetUnorderedAccessViews(shader_resource_register, 1, unordered_access_view.GetAddressOf(), &uav_initial_counts);
 }
 
 void Render_Pipeline::set_rasterizer_state(const Rasterizer_State &rasterizer_state)
 {
+	record(RENDER_COMMAND_SET_STATE);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->RSSetState(rasterizer_state.Get());
 }
 
 void Render_Pipeline::set_scissor(Rect_s32 *rect)
 {
+	record(RENDER_COMMAND_SET_STATE);
+	if (is_null_backend()) {
+		return;
+	}
 	D3D11_RECT rects[1];
 	rects[0].left = rect->x;
 	rects[0].right = rect->right();
@@ -874,6 +1152,10 @@ void Render_Pipeline::set_scissor(Rect_s32 *rect)
 
 void Render_Pipeline::set_viewport(Viewport *viewport)
 {
+	record(RENDER_COMMAND_SET_STATE);
+	if (is_null_backend()) {
+		return;
+	}
 	D3D11_VIEWPORT dx11_view_port;
 	dx11_view_port.TopLeftX = (float)viewport->x;
 	dx11_view_port.TopLeftY = (float)viewport->y;
@@ -887,38 +1169,66 @@ void Render_Pipeline::set_viewport(Viewport *viewport)
 
 void Render_Pipeline::reset_rasterizer()
 {
+	record(RENDER_COMMAND_SET_STATE);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->RSSetState(0);
 }
 
 void Render_Pipeline::set_blend_state(const Blend_State &blend_state)
 {
+	record(RENDER_COMMAND_SET_STATE);
+	if (is_null_backend()) {
+		return;
+	}
 	float b[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
 	dx11_context->OMSetBlendState(blend_state.Get(), b, 0xffffffff);
 }
 
 void Render_Pipeline::reset_blending_state()
 {
+	record(RENDER_COMMAND_SET_STATE);
+	if (is_null_backend()) {
+		return;
+	}
 	float b[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
 	dx11_context->OMSetBlendState(0, b, 0xffffffff);
 }
 
 void Render_Pipeline::set_depth_stencil_state(const Depth_Stencil_State &depth_stencil_state, u32 stencil_ref)
 {
+	record(RENDER_COMMAND_SET_STATE);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->OMSetDepthStencilState(depth_stencil_state.Get(), stencil_ref);
 }
 
 void Render_Pipeline::reset_depth_stencil_state()
 {
+	record(RENDER_COMMAND_SET_STATE);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->OMSetDepthStencilState(NULL, 0);
 }
 
 void Render_Pipeline::reset_render_target()
 {
+	record(RENDER_COMMAND_SET_RENDER_TARGET);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->OMSetRenderTargets(0, nullptr, nullptr);
 }
 
 void Render_Pipeline::set_render_target(const Render_Target_View &render_target_view, const Depth_Stencil_View &depth_stencil_view)
 {
+	record(RENDER_COMMAND_SET_RENDER_TARGET);
+	if (is_null_backend()) {
+		return;
+	}
 	u32 render_target_count = 0;
 	if (render_target_view) {
 		render_target_count = 1;
@@ -928,6 +1238,10 @@ void Render_Pipeline::set_render_target(const Render_Target_View &render_target_
 
 void Render_Pipeline::set_render_target_and_unordered_access_view(const Render_Target_View &render_target_view, const Depth_Stencil_View &depth_stencil_view, const Unordered_Access_View &unordered_access_view)
 {
+	record(RENDER_COMMAND_SET_RENDER_TARGET);
+	if (is_null_backend()) {
+		return;
+	}
 	u32 render_target_count = 0;
 	u32 unordered_access_count = 0;
 	u32 slot_offset = 0;
@@ -944,6 +1258,10 @@ void Render_Pipeline::set_render_target_and_unordered_access_view(const Render_T
 
 void Render_Pipeline::reset_vertex_buffer()
 {
+	record(RENDER_COMMAND_SET_INPUT_ASSEMBLER);
+	if (is_null_backend()) {
+		return;
+	}
 	u32 strides = 0;
 	u32 offsets = 0;
 	dx11_context->IASetVertexBuffers(0, 0, NULL, &strides, &offsets);
@@ -951,21 +1269,46 @@ void Render_Pipeline::reset_vertex_buffer()
 
 void Render_Pipeline::reset_index_buffer()
 {
+	record(RENDER_COMMAND_SET_INPUT_ASSEMBLER);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->IASetIndexBuffer(NULL, DXGI_FORMAT_R32_UINT, 0);
 }
 
 void Render_Pipeline::draw(u32 vertex_count)
 {
+	record(RENDER_COMMAND_DRAW, 0, vertex_count);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->Draw(vertex_count, 0);
 }
 
+void Render_Pipeline::draw_instanced(u32 vertex_count, u32 instance_count)
+{
+	record(RENDER_COMMAND_DRAW_INSTANCED, instance_count, vertex_count * instance_count);
+	if (is_null_backend()) {
+		return;
+	}
+	dx11_context->DrawInstanced(vertex_count, instance_count, 0, 0);
+}
+
 void Render_Pipeline::draw_indexed(u32 index_count, u32 index_offset, u32 vertex_offset)
 {
+	record(RENDER_COMMAND_DRAW_INDEXED, 0, index_count);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->DrawIndexed(index_count, index_offset, vertex_offset);
 }
 
 void Render_Pipeline::dispatch(u32 thread_group_count_x, u32 thread_group_count_y, u32 thread_group_count_z)
 {
+	record(RENDER_COMMAND_DISPATCH, 0, thread_group_count_x * thread_group_count_y * thread_group_count_z);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->Dispatch(thread_group_count_x, thread_group_count_y, thread_group_count_z);
 }
 
@@ -1050,6 +1393,10 @@ void Texture2D::release()
 
 void Texture2D::get_desc(Texture2D_Desc *texture_desc)
 {
+	if (!resource) {
+		// The null backend doesn't create textures, the desc is left as it is.
+		return;
+	}
 	D3D11_TEXTURE2D_DESC d3d11_texture_desc;
 	resource.Get()->GetDesc(&d3d11_texture_desc);
 	texture_desc->width = d3d11_texture_desc.Width;
@@ -1113,6 +1460,18 @@ void init_render_api(Gpu_Device *gpu_device, Render_Pipeline *render_pipeline)
 	current_render_pipeline = render_pipeline;
 }
 
+void init_null_render_api(Gpu_Device *gpu_device, Render_Pipeline *render_pipeline)
+{
+	assert(gpu_device);
+	assert(render_pipeline);
+
+	gpu_device->backend = RENDER_BACKEND_NULL;
+	render_pipeline->backend = RENDER_BACKEND_NULL;
+
+	current_gpu_device = gpu_device;
+	current_render_pipeline = render_pipeline;
+}
+
 void setup_multisampling(Gpu_Device *gpu_device, Multisample_Info *multisample_info)
 {
 	assert(gpu_device);
@@ -1206,6 +1565,9 @@ void get_max_multisampling_level(Gpu_Device *gpu_device, Multisample_Info *multi
 
 void Swap_Chain::init(Gpu_Device *gpu_device, Win32_Window *window)
 {
+	if (gpu_device->backend == RENDER_BACKEND_NULL) {
+		return;
+	}
 	DXGI_SWAP_CHAIN_DESC swap_chain_desc;
 	swap_chain_desc.BufferDesc.Width = window->width;
 	swap_chain_desc.BufferDesc.Height = window->height;
@@ -1233,13 +1595,26 @@ void Swap_Chain::init(Gpu_Device *gpu_device, Win32_Window *window)
 	HR(dxgi_factory->CreateSwapChain(gpu_device->dx11_device.Get(), &swap_chain_desc, dxgi_swap_chain.ReleaseAndGetAddressOf()));
 }
 
+void Swap_Chain::present()
+{
+	if (dxgi_swap_chain) {
+		HR(dxgi_swap_chain->Present(0, DXGI_PRESENT_ALLOW_TEARING));
+	}
+}
+
 void Swap_Chain::resize(u32 window_width, u32 window_height)
 {
+	if (!dxgi_swap_chain) {
+		return;
+	}
 	HR(dxgi_swap_chain->ResizeBuffers(1, window_width, window_height, DXGI_FORMAT_R8G8B8A8_UNORM, 0));
 }
 
 void Swap_Chain::get_back_buffer_as_texture(Texture2D *texture)
 {
+	if (!dxgi_swap_chain) {
+		return;
+	}
 	HR(dxgi_swap_chain->GetBuffer(0, __uuidof(ID3D11Texture2D), reinterpret_cast<void **>(texture->resource.GetAddressOf())));
 }
 
@@ -6,6 +6,7 @@
 #include <wrl/client.h>
 
 #include "../sys/utils.h"
+#include "render_command_log.h"
 #include "../win32/win_helpers.h"
 #include "../libs/color.h"
 #include "../libs/number_types.h"
@@ -56,6 +57,8 @@ const u32 BIND_VIDEO_ENCODER = 0x400L;
 const u32 CPU_ACCESS_WRITE = 0x10000L;
 const u32 CPU_ACCESS_READ = 0x20000L;
 
+const u32 NULL_BACKEND_MIN_MAPPED_MEMORY_SIZE = 256;
+
 const u32 CLEAR_DEPTH_BUFFER = 0x1L;
 const u32 CLEAR_STENCIL_BUFFER = 0x2L;
 
@@ -328,13 +331,17 @@ struct Texture3D : Gpu_Resource<ID3D11Texture3D>, Gpu_Resource_Views {
 	void release();
 };
 
+// Dynamic buffers are rewritten completely by every update, default buffers can be updated by ranges.
 struct Gpu_Struct_Buffer {
+	Resource_Usage usage = RESOURCE_USAGE_DYNAMIC;
 	Gpu_Buffer gpu_buffer;
 
 	template <typename T>
 	void allocate(u32 elements_count);
 	template <typename T>
 	void update(Array<T> *array);
+	template <typename T>
+	void update(Array<T> *array, u32 first_element, u32 element_count);
 	void free();
 };
 
@@ -353,7 +360,15 @@ struct Gpu_RWStruct_Buffer {
 	void free();
 };
 
+// The null backend creates no gpu resources and skips every d3d11 call,
+// it is used to run the CPU side of rendering without a gpu.
+enum Render_Backend {
+	RENDER_BACKEND_DX11,
+	RENDER_BACKEND_NULL
+};
+
 struct Gpu_Device {
+	Render_Backend backend = RENDER_BACKEND_DX11;
 	Dx11_Device dx11_device;
 	Dx11_Debug debug;
 
@@ -415,13 +430,23 @@ struct Render_Pipeline_State {
 struct Swap_Chain {
 	DXGI_Swap_Chain dxgi_swap_chain;
 
+	void present();
+
 	void init(Gpu_Device *gpu_device, Win32_Window *window);
 	void resize(u32 window_width, u32 window_height);
 	void get_back_buffer_as_texture(Texture2D *texture);
 };
 
 struct Render_Pipeline {
+	Render_Backend backend = RENDER_BACKEND_DX11;
 	Dx11_Device_Context dx11_context;
+	Render_Command_Log *command_log = NULL;
+	Array<u8> null_mapped_memory; // Mapped resources of the null backend point here.
+
+	bool is_null_backend();
+	void record(Render_Command_Type type, u32 slot = 0, u32 count = 0);
+	void record_upload(Render_Command_Type type, u32 byte_count);
+	void *get_null_mapped_memory(u32 size);
 
 	template <typename T>
 	void copy_resource(const Gpu_Resource<T> &dst, const Gpu_Resource<T> &src);
@@ -443,6 +468,7 @@ struct Render_Pipeline {
 
 	void update_constant_buffer(Gpu_Buffer *gpu_buffer, void *data);
 	void update_subresource(Texture2D *resource, void *source_data, u32 row_pitch, Rect_u32 *rect = NULL);
+	void update_subresource(Gpu_Buffer *gpu_buffer, void *source_data, u32 offset, u32 size);
 	void generate_mips(const Shader_Resource_View &shader_resource);
 
 	//@Note: may be this should be removed from code.
@@ -460,6 +486,7 @@ struct Render_Pipeline {
 	void set_hull_shader(Shader *shader);
 	void set_domain_shader(Shader *shader);
 	void set_pixel_shader(Shader *shader);
+	void reset_geometry_shader();
 
 	void set_vertex_shader_resource(u32 gpu_register, const Gpu_Buffer &constant_buffer);
 	void set_vertex_shader_resource(u32 gpu_register, const Shader_Resource_View &shader_resource);
@@ -495,6 +522,7 @@ struct Render_Pipeline {
 	void reset_render_target();
 
 	void draw(u32 vertex_count);
+	void draw_instanced(u32 vertex_count, u32 instance_count);
 	void draw_indexed(u32 index_count, u32 index_offset, u32 vertex_offset);
 
 	void dispatch(u32 thread_group_count_x, u32 thread_group_count_y, u32 thread_group_count_z);
@@ -506,15 +534,57 @@ Gpu_Device *get_current_gpu_device();
 Render_Pipeline *get_current_render_pipeline();
 
 void init_render_api(Gpu_Device *gpu_device, Render_Pipeline *render_pipeline);
+void init_null_render_api(Gpu_Device *gpu_device, Render_Pipeline *render_pipeline);
 void setup_multisampling(Gpu_Device *gpu_device, Multisample_Info *multisample_info);
 void get_max_multisampling_level(Gpu_Device *gpu_device, Multisample_Info *multisample_info, DXGI_FORMAT format);
 
 void begin_mark_rendering_event(const wchar_t *event_name);
 void end_mark_rendering_event();
 
+inline bool Render_Pipeline::is_null_backend()
+{
+	return backend == RENDER_BACKEND_NULL;
+}
+
+inline void Render_Pipeline::record(Render_Command_Type type, u32 slot, u32 count)
+{
+	if (command_log) {
+		command_log->add(type, slot, count);
+	}
+}
+
+inline void Render_Pipeline::record_upload(Render_Command_Type type, u32 byte_count)
+{
+	if (command_log) {
+		command_log->add_upload(type, byte_count);
+	}
+}
+
+inline u32 get_mapped_size(Gpu_Resource<ID3D11Buffer> &resource)
+{
+	return static_cast<Gpu_Buffer &>(resource).get_data_width();
+}
+
+template <typename T>
+inline u32 get_mapped_size(Gpu_Resource<T> &resource)
+{
+	// Sizes of textures are not tracked, the null backend gives them the minimum size of scratch memory.
+	return 0;
+}
+
 template <typename T>
 inline void *Render_Pipeline::map(Gpu_Resource<T> &resource, Map_Type map_type)
 {
+	u32 mapped_size = get_mapped_size(resource);
+	if (map_type == MAP_TYPE_READ) {
+		record(RENDER_COMMAND_MAP);
+	} else {
+		record_upload(RENDER_COMMAND_MAP, mapped_size);
+	}
+	if (is_null_backend()) {
+		return get_null_mapped_memory(mapped_size);
+	}
+
 	D3D11_MAP dx11_map_type;
 	switch (map_type) {
 		case MAP_TYPE_READ: {
@@ -549,32 +619,45 @@ inline void *Render_Pipeline::map(Gpu_Resource<T> &resource, Map_Type map_type)
 template <typename T>
 inline void Render_Pipeline::unmap(Gpu_Resource<T> &resource)
 {
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->Unmap(resource.get(), 0);
 }
 
 template<typename T>
 inline void Render_Pipeline::copy_resource(const Gpu_Resource<T> &dst, const Gpu_Resource<T> &src)
 {
+	record(RENDER_COMMAND_COPY_RESOURCE);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->CopyResource(dst.resource.Get(), src.resource.Get());
 }
 
 template<typename T>
 inline void Render_Pipeline::copy_subresource(const Gpu_Resource<T> &dst, u32 dst_x, u32 dst_y, const Gpu_Resource<T> &src)
 {
+	record(RENDER_COMMAND_COPY_RESOURCE);
+	if (is_null_backend()) {
+		return;
+	}
 	dx11_context->CopySubresourceRegion(dst.resource.Get(), 0, dst_x, dst_y, 0, src.resource.Get(), 0, NULL);
 }
 
 template<typename T>
 inline void Gpu_Struct_Buffer::allocate(u32 elements_count)
 {
+	assert((usage == RESOURCE_USAGE_DYNAMIC) || (usage == RESOURCE_USAGE_DEFAULT));
+
 	Gpu_Buffer_Desc desc;
-	desc.usage = RESOURCE_USAGE_DYNAMIC;
+	desc.usage = usage;
 	desc.data = NULL;
 	desc.data_size = sizeof(T);
 	desc.struct_size = sizeof(T);
 	desc.data_count = elements_count;
 	desc.bind_flags = BIND_SHADER_RESOURCE;
-	desc.cpu_access = CPU_ACCESS_WRITE;
+	desc.cpu_access = (usage == RESOURCE_USAGE_DYNAMIC) ? CPU_ACCESS_WRITE : 0;
 	desc.misc_flags = RESOURCE_MISC_BUFFER_STRUCTURED;
 
 	Gpu_Device *gpu_device = get_current_gpu_device();
@@ -596,11 +679,37 @@ inline void Gpu_Struct_Buffer::update(Array<T> *array)
 		allocate<T>(array->count);
 	}
 
+	if (usage == RESOURCE_USAGE_DEFAULT) {
+		render_pipeline->update_subresource(&gpu_buffer, (void *)array->items, 0, sizeof(T) * array->count);
+		return;
+	}
 	T *buffer = (T *)render_pipeline->map(gpu_buffer);
 	memcpy((void *)buffer, (void *)array->items, sizeof(T) * array->count);
 	render_pipeline->unmap(gpu_buffer);
 }
 
+// If the buffer has to grow, the whole array is uploaded to the new buffer.
+template<typename T>
+inline void Gpu_Struct_Buffer::update(Array<T> *array, u32 first_element, u32 element_count)
+{
+	assert(usage == RESOURCE_USAGE_DEFAULT);
+	assert((first_element + element_count) <= array->count);
+
+	if (element_count == 0) {
+		return;
+	}
+
+	Render_Pipeline *render_pipeline = get_current_render_pipeline();
+
+	if (array->count > gpu_buffer.data_count) {
+		free();
+		allocate<T>(array->size);
+		render_pipeline->update_subresource(&gpu_buffer, (void *)array->items, 0, sizeof(T) * array->count);
+		return;
+	}
+	render_pipeline->update_subresource(&gpu_buffer, (void *)&array->items[first_element], sizeof(T) * first_element, sizeof(T) * element_count);
+}
+
 inline void Gpu_Struct_Buffer::free()
 {
 	if (!gpu_buffer.is_empty()) {
@@ -649,6 +758,7 @@ inline void Gpu_RWStruct_Buffer::write(Array<T> *array)
 	
 	Gpu_Buffer temp_gpu_buffer;
 	gpu_device->create_gpu_buffer(&temp_gpu_buffer_desc, &temp_gpu_buffer);
+	render_pipeline->record_upload(RENDER_COMMAND_UPDATE_SUBRESOURCE, sizeof(T) * array->count);
 	render_pipeline->copy_resource(gpu_buffer, temp_gpu_buffer);
 	
 	temp_gpu_buffer.free();
@@ -685,8 +795,13 @@ inline void Gpu_RWStruct_Buffer::read(Array<T> *array)
 template<typename T>
 inline void Gpu_RWStruct_Buffer::reset()
 {
+	Render_Pipeline *render_pipeline = get_current_render_pipeline();
+	render_pipeline->record(RENDER_COMMAND_CLEAR);
+	if (render_pipeline->is_null_backend()) {
+		return;
+	}
 	UINT temp[4] = { 0, 0, 0, 0 };
-	get_current_render_pipeline()->dx11_context->ClearUnorderedAccessViewUint(gpu_buffer.uav.Get(), temp);
+	render_pipeline->dx11_context->ClearUnorderedAccessViewUint(gpu_buffer.uav.Get(), temp);
 }
 
 inline void Gpu_RWStruct_Buffer::free()
@@ -0,0 +1,85 @@
+#include <assert.h>
+
+#include "render_batches.h"
+#include "render_world.h"
+#include "../libs/math/functions.h"
+
+inline u64 make_batch_key(Mesh_Id mesh_id, bool group_by_textures)
+{
+	return ((u64)mesh_id.instance_idx << 32) | (group_by_textures ? (u64)mesh_id.textures_idx : 0);
+}
+
+void Render_Batches::begin_frame()
+{
+	instance_world_matrix_indices.count = 0;
+}
+
+void Render_Batches::build(Array<u32> *render_entity_indices, Array<Render_Entity> *render_entities, Model_Storage *model_storage, bool group_by_textures, Array<Render_Batch> *batches)
+{
+	assert(render_entity_indices);
+	assert(render_entities);
+	assert(model_storage);
+	assert(batches);
+
+	batches->clear();
+	if (render_entity_indices->is_empty()) {
+		return;
+	}
+	batch_table.clear();
+	render_entity_batches.reserve(render_entity_indices->count);
+
+	// The first pass finds a batch of every render entity and counts instances of the batches.
+	for (u32 i = 0; i < render_entity_indices->count; i++) {
+		Render_Entity *render_entity = &render_entities->get(render_entity_indices->get(i));
+
+		u32 batch_index = batches->count;
+		u64 batch_key = make_batch_key(render_entity->mesh_id, group_by_textures);
+		if (!group_render_entities || !batch_table.get(batch_key, batch_index)) {
+			Render_Batch batch;
+			batch.mesh_idx = render_entity->mesh_id.instance_idx;
+			batch.textures_idx = render_entity->mesh_id.textures_idx;
+			batch.index_count = model_storage->mesh_instances[render_entity->mesh_id.instance_idx].index_count;
+			batches->push(batch);
+			if (group_render_entities) {
+				batch_table.set(batch_key, batch_index);
+			}
+		}
+		batches->get(batch_index).instance_count++;
+		render_entity_batches[i] = batch_index;
+	}
+
+	u32 first_instance = instance_world_matrix_indices.count;
+	u32 instance_count = first_instance + render_entity_indices->count;
+	if (instance_count > instance_world_matrix_indices.size) {
+		instance_world_matrix_indices.resize(math::max(instance_count, instance_world_matrix_indices.size * 2));
+	}
+	instance_world_matrix_indices.count = instance_count;
+
+	for (u32 i = 0; i < batches->count; i++) {
+		Render_Batch *batch = &batches->get(i);
+		batch->first_instance = first_instance;
+		first_instance += batch->instance_count;
+		batch->instance_count = 0;
+	}
+
+	// The second pass places world matrix indices of the instances, they keep the order of render_entity_indices inside a batch.
+	for (u32 i = 0; i < render_entity_indices->count; i++) {
+		Render_Batch *batch = &batches->get(render_entity_batches[i]);
+		Render_Entity *render_entity = &render_entities->get(render_entity_indices->get(i));
+		instance_world_matrix_indices[batch->first_instance + batch->instance_count] = render_entity->world_matrix_idx;
+		batch->instance_count++;
+	}
+}
+
+void Render_Batches::upload()
+{
+	instance_struct_buffer.update(&instance_world_matrix_indices);
+}
+
+void Render_Batches::free()
+{
+	instance_world_matrix_indices.clear();
+	batch_table.clear();
+	render_entity_batches.clear();
+	instance_struct_buffer.free();
+}
@@ -0,0 +1,40 @@
+#ifndef RENDER_BATCHES_H
+#define RENDER_BATCHES_H
+
+#include "render_api.h"
+#include "../libs/number_types.h"
+#include "../libs/structures/array.h"
+#include "../libs/structures/hash_table.h"
+
+struct Model_Storage;
+struct Render_Entity;
+
+// Render entities with the same mesh (and the same textures if they are grouped by them) are drawn
+// by one instanced draw. Instance i of a batch reads its world matrix index from the instance buffer
+// at first_instance + i.
+struct Render_Batch {
+	u32 mesh_idx = 0;
+	u32 textures_idx = 0;
+	u32 index_count = 0;
+	u32 first_instance = 0;
+	u32 instance_count = 0;
+};
+
+// Batches of all render entity lists of a frame share one instance buffer.
+struct Render_Batches {
+	// If grouping is off every render entity gets its own batch, it is used to compare draw counts.
+	bool group_render_entities = true;
+
+	Array<u32> instance_world_matrix_indices;
+	Gpu_Struct_Buffer instance_struct_buffer;
+
+	Hash_Table<u64, u32> batch_table;
+	Array<u32> render_entity_batches;
+
+	void begin_frame();
+	void build(Array<u32> *render_entity_indices, Array<Render_Entity> *render_entities, Model_Storage *model_storage, bool group_by_textures, Array<Render_Batch> *batches);
+	void upload();
+	void free();
+};
+
+#endif
@@ -0,0 +1,118 @@
+#include <assert.h>
+#include <string.h>
+
+#include "render_command_log.h"
+#include "../sys/sys.h"
+
+static const char *render_command_type_strings[RENDER_COMMAND_TYPE_COUNT] = {
+	"Draw",
+	"Draw indexed",
+	"Draw instanced",
+	"Dispatch",
+	"Set shader",
+	"Set shader resource",
+	"Set constant buffer",
+	"Set sampler",
+	"Set input assembler",
+	"Set state",
+	"Set render target",
+	"Update constant buffer",
+	"Map",
+	"Update subresource",
+	"Copy resource",
+	"Clear",
+	"Generate mips"
+};
+
+const char *to_string(Render_Command_Type command_type)
+{
+	assert(command_type < RENDER_COMMAND_TYPE_COUNT);
+	return render_command_type_strings[command_type];
+}
+
+void Render_Frame_Stats::reset()
+{
+	memset((void *)command_counts, 0, sizeof(command_counts));
+	uploaded_bytes = 0;
+	drawn_vertex_count = 0;
+}
+
+u32 Render_Frame_Stats::get_draw_call_count()
+{
+	return command_counts[RENDER_COMMAND_DRAW] + command_counts[RENDER_COMMAND_DRAW_INDEXED] + command_counts[RENDER_COMMAND_DRAW_INSTANCED] + command_counts[RENDER_COMMAND_DISPATCH];
+}
+
+u32 Render_Frame_Stats::get_bind_count()
+{
+	u32 bind_count = 0;
+	for (u32 i = RENDER_COMMAND_SET_SHADER; i <= RENDER_COMMAND_SET_RENDER_TARGET; i++) {
+		bind_count += command_counts[i];
+	}
+	return bind_count;
+}
+
+Render_Command_Log::Render_Command_Log()
+{
+	frame_stats.reset();
+	previous_frame_stats.reset();
+}
+
+void Render_Command_Log::begin_frame()
+{
+	previous_frame_stats = frame_stats;
+	frame_stats.reset();
+	commands.clear();
+	frame_index++;
+}
+
+void Render_Command_Log::add(Render_Command_Type type, u32 slot, u32 count)
+{
+	assert(type < RENDER_COMMAND_TYPE_COUNT);
+
+	frame_stats.command_counts[type]++;
+	if ((type == RENDER_COMMAND_DRAW) || (type == RENDER_COMMAND_DRAW_INDEXED) || (type == RENDER_COMMAND_DRAW_INSTANCED)) {
+		frame_stats.drawn_vertex_count += count;
+	}
+	if (record_commands) {
+		Render_Command command;
+		command.type = type;
+		command.slot = slot;
+		command.count = count;
+		commands.push(command);
+	}
+}
+
+void Render_Command_Log::add_upload(Render_Command_Type type, u32 byte_count)
+{
+	frame_stats.uploaded_bytes += byte_count;
+	add(type, 0, byte_count);
+}
+
+void Render_Command_Log::print_frame_stats()
+{
+	print("Render_Command_Log: Frame {}: {} draw calls, {} binds, {} uploaded bytes, {} drawn vertices.", frame_index, frame_stats.get_draw_call_count(), frame_stats.get_bind_count(), frame_stats.uploaded_bytes, frame_stats.drawn_vertex_count);
+	for (u32 i = 0; i < RENDER_COMMAND_TYPE_COUNT; i++) {
+		if (frame_stats.command_counts[i] > 0) {
+			print("  {}: {}", to_string((Render_Command_Type)i), frame_stats.command_counts[i]);
+		}
+	}
+}
+
+void Render_Command_Log::print_commands()
+{
+	for (u32 i = 0; i < commands.count; i++) {
+		print("  {} {}: slot {}, count {}", i, to_string(commands[i].type), commands[i].slot, commands[i].count);
+	}
+}
+
+void Render_Command_Log::compare_with_previous_frame()
+{
+	for (u32 i = 0; i < RENDER_COMMAND_TYPE_COUNT; i++) {
+		if (frame_stats.command_counts[i] != previous_frame_stats.command_counts[i]) {
+			print("Render_Command_Log: {} changed from {} to {} in frame {}.", to_string((Render_Command_Type)i), previous_frame_stats.command_counts[i], frame_stats.command_counts[i], frame_index);
+		}
+	}
+	if (frame_stats.uploaded_bytes != previous_frame_stats.uploaded_bytes) {
+		print("Render_Command_Log: Uploaded bytes changed from {} to {} in frame {}.", previous_frame_stats.uploaded_bytes, frame_stats.uploaded_bytes, frame_index);
+	}
+}
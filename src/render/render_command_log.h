@@ -0,0 +1,68 @@
+#ifndef RENDER_COMMAND_LOG_H
+#define RENDER_COMMAND_LOG_H
+
+#include "../libs/number_types.h"
+#include "../libs/structures/array.h"
+
+enum Render_Command_Type {
+	RENDER_COMMAND_DRAW,
+	RENDER_COMMAND_DRAW_INDEXED,
+	RENDER_COMMAND_DRAW_INSTANCED,
+	RENDER_COMMAND_DISPATCH,
+	RENDER_COMMAND_SET_SHADER,
+	RENDER_COMMAND_SET_SHADER_RESOURCE,
+	RENDER_COMMAND_SET_CONSTANT_BUFFER,
+	RENDER_COMMAND_SET_SAMPLER,
+	RENDER_COMMAND_SET_INPUT_ASSEMBLER,
+	RENDER_COMMAND_SET_STATE,
+	RENDER_COMMAND_SET_RENDER_TARGET,
+	RENDER_COMMAND_UPDATE_CONSTANT_BUFFER,
+	RENDER_COMMAND_MAP,
+	RENDER_COMMAND_UPDATE_SUBRESOURCE,
+	RENDER_COMMAND_COPY_RESOURCE,
+	RENDER_COMMAND_CLEAR,
+	RENDER_COMMAND_GENERATE_MIPS,
+	RENDER_COMMAND_TYPE_COUNT
+};
+
+const char *to_string(Render_Command_Type command_type);
+
+struct Render_Command {
+	Render_Command_Type type;
+	u32 slot = 0; // The instance count for instanced draws.
+	u32 count = 0; // Vertices, indices or thread groups for draws and dispatches, uploaded bytes for updates.
+};
+
+struct Render_Frame_Stats {
+	u32 command_counts[RENDER_COMMAND_TYPE_COUNT];
+	u64 uploaded_bytes = 0;
+	u64 drawn_vertex_count = 0;
+
+	void reset();
+	u32 get_draw_call_count();
+	u32 get_bind_count();
+};
+
+// Collects every command the render pipeline submits during a frame.
+// Only the counters are kept if record_commands is false, that is cheap enough to leave on while profiling.
+struct Render_Command_Log {
+	Render_Command_Log();
+
+	bool record_commands = false;
+	u32 frame_index = 0;
+
+	Array<Render_Command> commands;
+	Render_Frame_Stats frame_stats;
+	Render_Frame_Stats previous_frame_stats;
+
+	void begin_frame();
+	void add(Render_Command_Type type, u32 slot = 0, u32 count = 0);
+	void add_upload(Render_Command_Type type, u32 byte_count);
+
+	void print_frame_stats();
+	void print_commands();
+	// Prints counters that changed since the previous frame.
+	void compare_with_previous_frame();
+};
+
+#endif
@@ -71,7 +71,7 @@ inline bool validate_render_pipeline(String *render_pass_name, Render_Pipeline_S
 
 struct Depth_Map_Pass_Data {
 	u32 mesh_idx;
-	u32 world_matrix_idx;
+	u32 first_instance;
 	Pad2 pad;
 	Matrix4 view_projection_matrix;
 };
@@ -131,12 +131,16 @@ void Forwar_Light_Pass::render(Render_World *render_world, Render_Pipeline *rend
 	render_pipeline->set_vertex_shader_resource(2, render_world->model_storage.mesh_struct_buffer);
 	render_pipeline->set_vertex_shader_resource(4, render_world->model_storage.index_struct_buffer);
 	render_pipeline->set_vertex_shader_resource(5, render_world->model_storage.vertex_struct_buffer);
+	render_pipeline->set_vertex_shader_resource(6, render_world->render_batches.instance_struct_buffer);
 
 	render_pipeline->set_pixel_shader_resource(CB_SHADOW_ATLAS_INFO_REGISTER, shadow_atlas_info_cbuffer);
 	render_pipeline->set_pixel_shader_resource(SHADOW_ATLAS_TEXTURE_REGISTER, render_world->shadow_atlas.srv);
-	render_pipeline->set_pixel_shader_resource(7, render_world->lights_struct_buffer);
+	render_pipeline->set_pixel_shader_resource(LIGHTS_REGISTER, render_world->lights_struct_buffer);
+	render_pipeline->set_pixel_shader_resource(LIGHT_CLUSTERS_REGISTER, render_world->light_clusters_sb);
+	render_pipeline->set_pixel_shader_resource(LIGHT_INDICES_REGISTER, render_world->light_indices_sb);
 	render_pipeline->set_pixel_shader_resource(8, render_world->cascaded_view_projection_matrices_sb);
 	render_pipeline->set_pixel_shader_resource(9, render_world->cascaded_shadows_info_sb);
+	render_pipeline->set_pixel_shader_resource(10, render_world->cascaded_shadow_atlas_rects_sb);
 	render_pipeline->set_pixel_shader_resource(JITTERING_SAMPLES_TEXTURE_REGISTER, render_world->jittering_samples.srv);
 	render_pipeline->set_pixel_shader_sampler(LINEAR_SAMPLING_REGISTER, render_pipeline_states->linear_sampling);
 	// Bind point sampling in order to get rid of a d3d11 warning.
@@ -144,22 +148,22 @@ void Forwar_Light_Pass::render(Render_World *render_world, Render_Pipeline *rend
 	// The Pixel Shader unit expects a Sampler to be set at Slot 0, but none is bound. This is perfectly valid, as a NULL Sampler maps to default Sampler state. However, the developer may not want to rely on the defaults.
 	render_pipeline->set_pixel_shader_sampler(POINT_SAMPLING_REGISTER, render_pipeline_states->point_sampling);
 
-	Render_Entity *render_entity = NULL;
 	Forwar_Light_Pass::Pass_Data pass_data;
 
-	For(render_world->game_render_entities, render_entity) {
-		pass_data.mesh_idx = render_entity->mesh_id.instance_idx;
-		pass_data.world_matrix_idx = render_entity->world_matrix_idx;
+	for (u32 i = 0; i < render_world->visible_render_batches.count; i++) {
+		Render_Batch *render_batch = &render_world->visible_render_batches[i];
+		pass_data.mesh_idx = render_batch->mesh_idx;
+		pass_data.first_instance = render_batch->first_instance;
 
 		render_pipeline->update_constant_buffer(&pass_data_cbuffer, (void *)&pass_data);
 
-		Mesh_Textures *mesh_textures = render_world->model_storage.get_mesh_textures(render_entity->mesh_id.textures_idx);
+		Mesh_Textures *mesh_textures = render_world->model_storage.get_mesh_textures(render_batch->textures_idx);
 		render_pipeline->set_pixel_shader_resource(11, render_world->model_storage.get_texture(mesh_textures->normal_idx)->srv);
 		render_pipeline->set_pixel_shader_resource(12, render_world->model_storage.get_texture(mesh_textures->diffuse_idx)->srv);
 		render_pipeline->set_pixel_shader_resource(13, render_world->model_storage.get_texture(mesh_textures->specular_idx)->srv);
 		render_pipeline->set_pixel_shader_resource(14, render_world->model_storage.get_texture(mesh_textures->displacement_idx)->srv);
 
-		render_pipeline->draw(render_world->model_storage.mesh_instances[render_entity->mesh_id.instance_idx].index_count);
+		render_pipeline->draw_instanced(render_batch->index_count, render_batch->instance_count);
 	}
 	// Reset shadow atlas in order to get rid of warnings (Resource being set to OM DepthStencil is still bound on input!, Forcing PS shader resource slot 1 to NULL) from directx 11.
 	render_pipeline->reset_pixel_shader_resource(SHADOW_ATLAS_TEXTURE_REGISTER);
@@ -177,11 +181,14 @@ void Shadows_Pass::setup_render_pipeline(Shader_Manager *shader_manager, const D
 {
 	assert(shader_manager);
 
+	clear_depth_shader = GET_SHADER(shader_manager, clear_depth);
+
 	render_pipeline_state.primitive_type = RENDER_PRIMITIVE_TRIANGLES;
 	render_pipeline_state.shader = GET_SHADER(shader_manager, depth_map);
+	render_pipeline_state.rasterizer_state = render_pipeline_states->depth_clamping_state; // Casters between the light and the near plane are clamped to it.
 	render_pipeline_state.depth_stencil_view = depth_stencil_view;
 	render_pipeline_state.render_target_view = nullptr;
-	is_valid = validate_render_pipeline(&name, &render_pipeline_state, SKIP_VIEWPORT_VALIDATION | SKIP_RENDER_TARGET_VIEW_VALIDATION);
+	is_valid = validate_render_pipeline(&name, &render_pipeline_state, SKIP_VIEWPORT_VALIDATION | SKIP_RENDER_TARGET_VIEW_VALIDATION) && ::is_valid(clear_depth_shader, VALIDATE_VERTEX_SHADER);
 }
 
 void Shadows_Pass::render(Render_World *render_world, Render_Pipeline *render_pipeline)
@@ -191,8 +198,20 @@ void Shadows_Pass::render(Render_World *render_world, Render_Pipeline *render_pi
 	assert(is_valid);
 
 	begin_mark_rendering_event(L"Shadows rendering");
+
+	// Regions of cached cascades must be kept, then only regions of rendered cascades are cleared.
+	bool clear_shadow_atlas = true;
+	Cascaded_Shadows *cascaded_shadows = NULL;
+	For(render_world->cascaded_shadows_list, cascaded_shadows) {
+		Cascaded_Shadow_Map *cascaded_shadow_map = NULL;
+		For(cascaded_shadows->cascaded_shadow_maps, cascaded_shadow_map) {
+			clear_shadow_atlas &= !cascaded_shadow_map->is_cached;
+		}
+	}
 	//@Note: this code can be moved to render world
-	render_pipeline->clear_depth_stencil_view(render_world->shadow_atlas.dsv);
+	if (clear_shadow_atlas) {
+		render_pipeline->clear_depth_stencil_view(render_world->shadow_atlas.dsv);
+	}
 
 	render_pipeline->apply(&render_pipeline_state);
 
@@ -201,24 +220,41 @@ void Shadows_Pass::render(Render_World *render_world, Render_Pipeline *render_pi
 	render_pipeline->set_vertex_shader_resource(2, render_world->model_storage.mesh_struct_buffer);
 	render_pipeline->set_vertex_shader_resource(4, render_world->model_storage.index_struct_buffer);
 	render_pipeline->set_vertex_shader_resource(5, render_world->model_storage.vertex_struct_buffer);
+	render_pipeline->set_vertex_shader_resource(6, render_world->render_batches.instance_struct_buffer);
 
 	Depth_Map_Pass_Data pass_data;
 
-	Cascaded_Shadows *cascaded_shadows = NULL;
 	For(render_world->cascaded_shadows_list, cascaded_shadows) {
 		Cascaded_Shadow_Map *cascaded_shadow_map = NULL;
 		For(cascaded_shadows->cascaded_shadow_maps, cascaded_shadow_map) {
+			if (!cascaded_shadow_map->is_active) {
+				// The tile of an inactive cascade may still be allocated, its depth is lost after clearing the atlas.
+				cascaded_shadow_map->is_rendered &= !clear_shadow_atlas;
+				continue;
+			}
+			if (cascaded_shadow_map->is_cached) {
+				continue;
+			}
 			render_pipeline->set_viewport(&cascaded_shadow_map->viewport);
 
-			Render_Entity *render_entity = NULL;
-			For(render_world->game_render_entities, render_entity) {
-				pass_data.mesh_idx = render_entity->mesh_id.instance_idx;
-				pass_data.world_matrix_idx = render_entity->world_matrix_idx;
+			if (!clear_shadow_atlas) {
+				render_pipeline->set_vertex_shader(clear_depth_shader);
+				render_pipeline->set_depth_stencil_state(render_pipeline_states->clear_depth_state);
+				render_pipeline->draw(3);
+				render_pipeline->set_vertex_shader(render_pipeline_state.shader);
+				render_pipeline->set_depth_stencil_state(render_pipeline_state.depth_stencil_state);
+			}
+
+			for (u32 i = 0; i < cascaded_shadow_map->render_batches.count; i++) {
+				Render_Batch *render_batch = &cascaded_shadow_map->render_batches[i];
+				pass_data.mesh_idx = render_batch->mesh_idx;
+				pass_data.first_instance = render_batch->first_instance;
 				pass_data.view_projection_matrix = cascaded_shadow_map->view_projection_matrix;
 
 				render_pipeline->update_constant_buffer(&pass_data_cbuffer, (void *)&pass_data);
-				render_pipeline->draw(render_world->model_storage.mesh_instances[render_entity->mesh_id.instance_idx].index_count);
+				render_pipeline->draw_instanced(render_batch->index_count, render_batch->instance_count);
 			}
+			cascaded_shadow_map->is_rendered = true;
 		}
 	}
 	end_mark_rendering_event();
@@ -269,31 +305,33 @@ void Debug_Cascade_Shadows_Pass::render(Render_World *render_world, Render_Pipel
 	render_pipeline->set_vertex_shader_resource(2, render_world->model_storage.mesh_struct_buffer);
 	render_pipeline->set_vertex_shader_resource(4, render_world->model_storage.index_struct_buffer);
 	render_pipeline->set_vertex_shader_resource(5, render_world->model_storage.vertex_struct_buffer);
+	render_pipeline->set_vertex_shader_resource(6, render_world->render_batches.instance_struct_buffer);
 
 	render_pipeline->set_pixel_shader_resource(CB_SHADOW_ATLAS_INFO_REGISTER, shadow_atlas_info_cbuffer);
 	render_pipeline->set_pixel_shader_resource(SHADOW_ATLAS_TEXTURE_REGISTER, render_world->shadow_atlas.srv);
 	render_pipeline->set_pixel_shader_resource(7, render_world->lights_struct_buffer);
 	render_pipeline->set_pixel_shader_resource(8, render_world->cascaded_view_projection_matrices_sb);
 	render_pipeline->set_pixel_shader_resource(9, render_world->cascaded_shadows_info_sb);
+	render_pipeline->set_pixel_shader_resource(10, render_world->cascaded_shadow_atlas_rects_sb);
 	render_pipeline->set_pixel_shader_resource(JITTERING_SAMPLES_TEXTURE_REGISTER, render_world->jittering_samples.srv);
 	render_pipeline->set_pixel_shader_sampler(POINT_SAMPLING_REGISTER, render_pipeline_states->point_sampling);
 
-	Render_Entity *render_entity = NULL;
 	Debug_Cascade_Shadows_Pass::Pass_Data pass_data;
 
-	For(render_world->game_render_entities, render_entity) {
-		pass_data.mesh_idx = render_entity->mesh_id.instance_idx;
-		pass_data.world_matrix_idx = render_entity->world_matrix_idx;
+	for (u32 i = 0; i < render_world->visible_render_batches.count; i++) {
+		Render_Batch *render_batch = &render_world->visible_render_batches[i];
+		pass_data.mesh_idx = render_batch->mesh_idx;
+		pass_data.first_instance = render_batch->first_instance;
 
 		render_pipeline->update_constant_buffer(&pass_data_cbuffer, (void *)&pass_data);
 
-		Mesh_Textures *mesh_textures = render_world->model_storage.get_mesh_textures(render_entity->mesh_id.textures_idx);
+		Mesh_Textures *mesh_textures = render_world->model_storage.get_mesh_textures(render_batch->textures_idx);
 		render_pipeline->set_pixel_shader_resource(11, render_world->model_storage.get_texture(mesh_textures->normal_idx)->srv);
 		render_pipeline->set_pixel_shader_resource(12, render_world->model_storage.get_texture(mesh_textures->diffuse_idx)->srv);
 		render_pipeline->set_pixel_shader_resource(13, render_world->model_storage.get_texture(mesh_textures->specular_idx)->srv);
 		render_pipeline->set_pixel_shader_resource(14, render_world->model_storage.get_texture(mesh_textures->displacement_idx)->srv);
 
-		render_pipeline->draw(render_world->model_storage.mesh_instances[render_entity->mesh_id.instance_idx].index_count);
+		render_pipeline->draw_instanced(render_batch->index_count, render_batch->instance_count);
 	}
 	// Reset shadow atlas in order to get rid of warnings (Resource being set to OM DepthStencil is still bound on input!, Forcing PS shader resource slot 1 to NULL) from directx 11.
 	render_pipeline->reset_pixel_shader_resource(SHADOW_ATLAS_TEXTURE_REGISTER);
@@ -306,10 +344,19 @@ void Outlining_Pass::add_render_entity_index(u32 entity_index)
 }
 
 void Outlining_Pass::delete_render_entity_index(u32 entity_index)
+{
+	for (u32 i = render_entity_indices.count; i > 0; i--) {
+		if (render_entity_indices[i - 1] == entity_index) {
+			render_entity_indices.swap_remove(i - 1);
+		}
+	}
+}
+
+void Outlining_Pass::replace_render_entity_index(u32 old_entity_index, u32 new_entity_index)
 {
 	for (u32 i = 0; i < render_entity_indices.count; i++) {
-		if (render_entity_indices[i] == entity_index) {
-			render_entity_indices.remove(i);
+		if (render_entity_indices[i] == old_entity_index) {
+			render_entity_indices[i] = new_entity_index;
 		}
 	}
 }
@@ -381,11 +428,13 @@ void Outlining_Pass::render(Render_World *render_world, Render_Pipeline *render_
 	render_pipeline->set_vertex_shader_resource(5, render_world->model_storage.vertex_struct_buffer);
 	render_pipeline->set_pixel_shader_resource(CB_PASS_DATA_REGISTER, pass_data_cbuffer);
 
-	Render_Entity *render_entity = NULL;
 	Render_Pass::Pass_Data pass_data;
 
 	for (u32 i = 0; i < render_entity_indices.count; i++) {
 		u32 index = render_entity_indices[i];
+		if ((index < render_world->render_entity_visibility.count) && !render_world->render_entity_visibility[index]) {
+			continue;
+		}
 		Render_Entity *render_entity = &render_world->game_render_entities[index];
 
 		pass_data.mesh_idx = render_entity->mesh_id.instance_idx;
@@ -472,6 +521,7 @@ void Voxelization::render(Render_World *render_world, Render_Pipeline *render_pi
 	render_pipeline->set_vertex_shader_resource(2, render_world->model_storage.mesh_struct_buffer);
 	render_pipeline->set_vertex_shader_resource(4, render_world->model_storage.index_struct_buffer);
 	render_pipeline->set_vertex_shader_resource(5, render_world->model_storage.vertex_struct_buffer);
+	render_pipeline->set_vertex_shader_resource(6, render_world->render_batches.instance_struct_buffer);
 	render_pipeline->set_vertex_shader_resource(1, voxelization_info_cbuffer);
 
 	render_pipeline->set_geometry_shader_resource(1, voxelization_info_cbuffer);
@@ -479,19 +529,19 @@ void Voxelization::render(Render_World *render_world, Render_Pipeline *render_pi
 	render_pipeline->set_pixel_shader_resource(1, voxelization_info_cbuffer);
 	render_pipeline->set_pixel_shader_sampler(LINEAR_SAMPLING_REGISTER, render_pipeline_states->linear_sampling);
 
-	Render_Entity *render_entity = NULL;
 	Render_Pass::Pass_Data pass_data;
 
-	For(render_world->game_render_entities, render_entity) {
-		pass_data.mesh_idx = render_entity->mesh_id.instance_idx;
-		pass_data.world_matrix_idx = render_entity->world_matrix_idx;
+	for (u32 i = 0; i < render_world->voxel_grid_render_batches.count; i++) {
+		Render_Batch *render_batch = &render_world->voxel_grid_render_batches[i];
+		pass_data.mesh_idx = render_batch->mesh_idx;
+		pass_data.first_instance = render_batch->first_instance;
 		
-		Mesh_Textures *mesh_textures = render_world->model_storage.get_mesh_textures(render_entity->mesh_id.textures_idx);
+		Mesh_Textures *mesh_textures = render_world->model_storage.get_mesh_textures(render_batch->textures_idx);
 		render_pipeline->set_pixel_shader_resource(12, render_world->model_storage.get_texture(mesh_textures->diffuse_idx)->srv);
 		
 		render_pipeline->update_constant_buffer(&pass_data_cbuffer, (void *)&pass_data);
-		render_pipeline->draw(render_world->model_storage.mesh_instances[render_entity->mesh_id.instance_idx].index_count);
+		render_pipeline->draw_instanced(render_batch->index_count, render_batch->instance_count);
 	}
-	render_pipeline->dx11_context->GSSetShader(nullptr, 0, 0);
+	render_pipeline->reset_geometry_shader();
 	end_mark_rendering_event();
 }
\ No newline at end of file
@@ -21,7 +21,7 @@ struct Render_Pass {
 		u32 mesh_idx;
 		u32 world_matrix_idx;
 		u32 pad1;
-		u32 pad2;
+		u32 first_instance; // Offset of the drawn batch in the instance buffer.
 	};
 	bool is_valid = false;
 	Render_Pipeline_States *render_pipeline_states = NULL;
@@ -42,6 +42,8 @@ struct Forwar_Light_Pass : Render_Pass {
 };
 
 struct Shadows_Pass : Render_Pass {
+	Shader *clear_depth_shader = NULL;
+
 	void init(Gpu_Device *gpu_device, Render_Pipeline_States *_render_pipeline_states);
 	void render(Render_World *render_world, Render_Pipeline *render_pipeline);
 	void setup_render_pipeline(Shader_Manager *shader_manager, const Depth_Stencil_View &depth_stencil_view);
@@ -75,6 +77,7 @@ struct Outlining_Pass : Render_Pass {
 
 	void add_render_entity_index(u32 entity_index);
 	void delete_render_entity_index(u32 entity_index);
+	void replace_render_entity_index(u32 old_entity_index, u32 new_entity_index);
 	void reset_render_entity_indices();
 
 	void setup_outlining(u32 outlining_size_in_pixels, const Color &color);
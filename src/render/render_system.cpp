@@ -43,51 +43,6 @@ inline Vector2 quad(float t, Vector2 p0, Vector2 p1, Vector2 p2)
 	return (float)pow((1.0f - t), 2.0f) * p0 + 2.0f * (1.0f - t) * t * p1 + (float)pow(t, 2.0f) * p2;
 }
 
-static int compare_rects_u32(const void *first_rect, const void *second_rect)
-{
-	assert(first_rect);
-	assert(second_rect);
-
-	const Rect_u32 *first = static_cast<const Rect_u32 *>(first_rect);
-	const Rect_u32 *second = static_cast<const Rect_u32 *>(second_rect);
-
-	return first->height > second->height;
-}
-
-inline void pack_rects_in_rect(Rect_u32 *main_rect, Array<Rect_u32 *> &rects)
-{
-	assert(main_rect);
-
-	qsort(rects.items, rects.count, sizeof(rects[0]), compare_rects_u32);
-
-	u32 x_pos = 0;
-	u32 y_pos = 0;
-	u32 large = 0;
-
-	Rect_u32 *rect = NULL;
-	For(rects, rect) {
-
-		if ((rect->width + x_pos) > main_rect->width) {
-			y_pos += large;
-			x_pos = 0;
-			large = 0;
-		}
-
-		if ((y_pos + rect->height) > main_rect->height) {
-			break;
-		}
-
-		rect->x = x_pos;
-		rect->y = y_pos;
-
-		x_pos += rect->width;
-
-		if (rect->height > large) {
-			large = rect->height;
-		}
-	}
-}
-
 void Primitive_2D::add_rounded_points(float x, float y, float width, float height, Rect_Side rect_side, u32 rounding)
 {
 	add_rounded_points(x, y, width, height, rect_side, (float)rounding, (float)rounding);
@@ -197,12 +152,12 @@ void Render_Primitive_List::get_clip_rect(Rect_s32 *rect)
 
 void Render_Primitive_List::add_outlines(int x, int y, int width, int height, const Color &color, float outline_width, u32 rounding, u32 flags)
 {
-	String hash = String((int)width) + String((int)height) + String((int)outline_width) + String("outline");
+	u64 key = make_primitive_2d_key(PRIMITIVE_2D_OUTLINES, quantize_primitive_size((float)width), quantize_primitive_size((float)height), quantize_primitive_size(outline_width), rounding, flags);
 
 	Vector2 position = { (float)x, (float)y };
 	Matrix4 transform_matrix = make_translation_matrix(&position);
 
-	Primitive_2D *primitive = make_or_find_primitive(transform_matrix, &render_2d->default_texture, color, hash);
+	Primitive_2D *primitive = make_or_find_primitive(transform_matrix, &render_2d->default_texture, color, key);
 	if (!primitive) {
 		return;
 	}
@@ -218,7 +173,7 @@ void Render_Primitive_List::add_outlines(int x, int y, int width, int height, co
 	((flags & ROUND_BOTTOM_LEFT_RECT) && is_rounded) ? primitive->add_rounded_points(0.0f, 0.0f, (float)width, (float)height, RECT_SIDE_LEFT_BOTTOM, rounding) : primitive->add_point(Vector2(0.0f, (float)height));
 
 	primitive->make_outline_triangle_polygons();
-	render_2d->add_primitive(primitive);
+	render_2d->cache_primitive(key, primitive);
 }
 
 void Render_Primitive_List::add_text(Rect_s32 *rect, const char *text, Text_Alignment text_alignmnet)
@@ -230,38 +185,46 @@ void Render_Primitive_List::add_text(int x, int y, const char *text, Text_Alignm
 {
 	assert(text);
 
-	u32 len = (u32)strlen(text);
-	if (len == 0) {
+	if (*text == '\0') {
 		return;
 	}
 
 	u32 max_height = font->get_text_size(text, text_alignment).height;
-	Font_Char *font_char = font->get_font_char(text[0]);
-	Vector2 position = { (float)x, (float)(y + (max_height - font_char->size.height) + (font_char->size.height - font_char->bearing.height)) };
-
-	Render_Primitive_2D info;
-	info.texture = render_font->font_atlas;
-	info.transform_matrix = make_translation_matrix(&position);
-	info.color = Color::White;
-	info.primitive = render_font->lookup_table[text[0]];
-	get_clip_rect(&info.clip_rect);
-
-	x += font_char->advance;
-	render_primitives.push(info);
-
-	for (u32 i = 1; i < len; i++) {
-		Font_Char *font_char = font->get_font_char(text[i]);
-		Vector2 position = { (float)x + font_char->bearing.width, (float)(y + (max_height - font_char->size.height) + (font_char->size.height - font_char->bearing.height)) };
-
-		Render_Primitive_2D info;
-		info.texture = render_font->font_atlas;
-		info.transform_matrix = make_translation_matrix(&position);
-		info.color = Color::White;
-		info.primitive = render_font->lookup_table[text[i]];
-		get_clip_rect(&info.clip_rect);
-
-		x += font_char->advance;
-		render_primitives.push(info);
+	Text_Run *text_run = font->get_text_run(text);
+
+	Rect_s32 clip_rect;
+	get_clip_rect(&clip_rect);
+
+	// Only chars which cross the clip rect are added, list columns and edit fields often hold texts wider than them.
+	s32 clip_right = clip_rect.x + clip_rect.width;
+	if ((clip_right <= x) || ((x + (s32)text_run->size.width) < clip_rect.x)) {
+		return;
+	}
+	u32 first_char = (clip_rect.x > x) ? text_run->find_char((u32)(clip_rect.x - x)) : 0;
+	u32 last_char = math::min(text_run->find_char((u32)(clip_right - x)) + 1, text_run->get_char_count());
+
+	for (u32 i = 0; i < first_char; i++) {
+		next_codepoint(&text);
+	}
+	for (u32 i = first_char; i < last_char; i++) {
+		Font_Char font_char = *font->get_font_char(next_codepoint(&text));
+		// The first char is placed without its bearing.
+		s32 char_x = x + (s32)text_run->caret_offsets[i] + ((i > 0) ? (s32)font_char.bearing.width : 0);
+		Vector2 position = { (float)char_x, (float)(y + (max_height - font_char.size.height) + (font_char.size.height - font_char.bearing.height)) };
+
+		// Empty glyphs like spaces only move the text.
+		Primitive_2D *primitive = render_2d->glyph_cache.get_glyph(font, font_char.codepoint);
+		if (primitive) {
+			Render_Primitive_2D info;
+			info.texture = render_2d->glyph_cache.atlas;
+			info.transform_matrix = make_translation_matrix(&position);
+			info.color = Color::White;
+			info.primitive = primitive;
+			info.clip_rect = clip_rect;
+			info.glyph = true;
+			info.cache_key = make_glyph_key(font->font_id, font_char.codepoint);
+			render_primitives.push(info);
+		}
 	}
 }
 
@@ -287,16 +250,12 @@ void Render_Primitive_List::add_rect(s32 x, s32 y, s32 width, s32 height, const
 
 void Render_Primitive_List::add_rect(float x, float y, float width, float height, const Color &color, u32 rounding, u32 flags)
 {
-	//////////////////////////////////////////////////////////
-	// &Note I am not sure that chache works for primitives //
-	//////////////////////////////////////////////////////////
-	String hash = String((int)width) + String((int)height) + String((int)rounding) + String((int)flags);
-
+	u64 key = make_primitive_2d_key(PRIMITIVE_2D_RECT, quantize_primitive_size(width), quantize_primitive_size(height), 0, rounding, flags);
 
 	Vector2 position = { (float)x, (float)y };
 	Matrix4 transform_matrix = make_translation_matrix(&position);
 
-	Primitive_2D *primitive = make_or_find_primitive(transform_matrix, &render_2d->default_texture, color, hash);
+	Primitive_2D *primitive = make_or_find_primitive(transform_matrix, &render_2d->default_texture, color, key);
 	if (!primitive) {
 		return;
 	}
@@ -315,7 +274,7 @@ void Render_Primitive_List::add_rect(float x, float y, float width, float height
 	((flags & ROUND_BOTTOM_LEFT_RECT) && is_rounded) ? primitive->add_rounded_points(0.0f, 0.0f, width, height, RECT_SIDE_LEFT_BOTTOM, x_rounding, y_rounding) : primitive->add_point(Vector2(0.0f, height));
 
 	primitive->make_triangle_polygon();
-	render_2d->add_primitive(primitive);
+	render_2d->cache_primitive(key, primitive);
 }
 
 void Render_Primitive_List::add_texture(Rect_s32 *rect, Texture2D *resource)
@@ -325,12 +284,12 @@ void Render_Primitive_List::add_texture(Rect_s32 *rect, Texture2D *resource)
 
 void Render_Primitive_List::add_texture(int x, int y, int width, int height, Texture2D *resource)
 {
-	String hash = String(width + height);
+	u64 key = make_primitive_2d_key(PRIMITIVE_2D_TEXTURE, quantize_primitive_size((float)width), quantize_primitive_size((float)height));
 
 	Vector2 position = { (float)x, (float)y };
 	Matrix4 transform_matrix = make_translation_matrix(&position);
 
-	Primitive_2D *primitive = make_or_find_primitive(transform_matrix, resource, Color::White, hash);
+	Primitive_2D *primitive = make_or_find_primitive(transform_matrix, resource, Color::White, key);
 	if (!primitive) {
 		return;
 	}
@@ -341,7 +300,7 @@ void Render_Primitive_List::add_texture(int x, int y, int width, int height, Tex
 	primitive->add_point(Vector2(0.0f, (float)height), Vector2(0.0f, 1.0f));
 
 	primitive->make_triangle_polygon();
-	render_2d->add_primitive(primitive);
+	render_2d->cache_primitive(key, primitive);
 }
 
 void Render_Primitive_List::add_line(const Point_s32 &first_point, const Point_s32 &second_point, const Color &color, float thickness)
@@ -372,9 +331,9 @@ void Render_Primitive_List::add_line(const Point_s32 &first_point, const Point_s
 	Vector2 temp1 = first_point.to_vector2();
 	Vector2 temp2 = second_point.to_vector2();
 	float line_width = (float)find_distance(temp1, temp2);
-	String hash = String(line_width + thickness);
+	u64 key = make_primitive_2d_key(PRIMITIVE_2D_LINE, quantize_primitive_size(line_width), 0, quantize_primitive_size(thickness));
 
-	Primitive_2D *primitive = make_or_find_primitive(transform_matrix, &render_2d->default_texture, color, hash);
+	Primitive_2D *primitive = make_or_find_primitive(transform_matrix, &render_2d->default_texture, color, key);
 	if (!primitive) {
 		return;
 	}
@@ -385,7 +344,7 @@ void Render_Primitive_List::add_line(const Point_s32 &first_point, const Point_s
 	primitive->add_point(Vector2(0.0f, thickness));
 
 	primitive->make_triangle_polygon();
-	render_2d->add_primitive(primitive);
+	render_2d->cache_primitive(key, primitive);
 }
 
 // Flips degrees from the first quadrant to the fourth quadrant 
@@ -416,11 +375,12 @@ void Render_Primitive_List::add_circle(int x, int y, u32 radius, const Color &co
 
 	Circle_Range range = { flip_degrees(circle_range.end), flip_degrees(circle_range.start) };
 
-	String hash = "filled_circle" + String(x) + String(y);
+	// Degrees of the range fit in 9 bits.
+	u64 key = make_primitive_2d_key(PRIMITIVE_2D_CIRCLE, quantize_primitive_size((float)radius), (range.start << 9) | range.end);
 	Vector2 position = { (float)x, (float)y };
 	Matrix4 transform_matrix = make_translation_matrix(&position);
 
-	Primitive_2D *primitive = make_or_find_primitive(transform_matrix, &render_2d->default_texture, color, hash);
+	Primitive_2D *primitive = make_or_find_primitive(transform_matrix, &render_2d->default_texture, color, key);
 	if (!primitive) {
 		return;
 	}
@@ -431,16 +391,16 @@ void Render_Primitive_List::add_circle(int x, int y, u32 radius, const Color &co
 		primitive->add_point(point);
 	}
 	primitive->make_triangle_polygon();
-	render_2d->add_primitive(primitive);
+	render_2d->cache_primitive(key, primitive);
 }
 
 void Render_Primitive_List::add_outline_circle(int x, int y, u32 radius, float thickness, const Color &color)
 {
-	String hash = "filled_outline_circle" + String(x) + String(y);
+	u64 key = make_primitive_2d_key(PRIMITIVE_2D_OUTLINE_CIRCLE, quantize_primitive_size((float)radius), 0, quantize_primitive_size(thickness));
 	Vector2 position = { (float)x, (float)y };
 	Matrix4 transform_matrix = make_translation_matrix(&position);
 
-	Primitive_2D *primitive = make_or_find_primitive(transform_matrix, &render_2d->default_texture, color, hash);
+	Primitive_2D *primitive = make_or_find_primitive(transform_matrix, &render_2d->default_texture, color, key);
 	if (!primitive) {
 		return;
 	}
@@ -459,27 +419,28 @@ void Render_Primitive_List::add_outline_circle(int x, int y, u32 radius, float t
 		primitive->add_point(inner_point);
 	}
 	primitive->make_outline_triangle_polygons();
-	render_2d->add_primitive(primitive);
+	render_2d->cache_primitive(key, primitive);
 }
 
-Primitive_2D *Render_Primitive_List::make_or_find_primitive(Matrix4 &transform_matrix, Texture2D *texture, const Color &color, String &primitve_hash)
+Primitive_2D *Render_Primitive_List::make_or_find_primitive(Matrix4 &transform_matrix, Texture2D *texture, const Color &color, u64 primitive_key)
 {
 	Render_Primitive_2D render_primitive;
 	render_primitive.color.value = color.value;
 	render_primitive.texture = *texture;
 	render_primitive.transform_matrix = transform_matrix;
 	get_clip_rect(&render_primitive.clip_rect);
+	render_primitive.cache_key = primitive_key;
 
 	// if we found primitve we can just push it in render primitives array
-	Primitive_2D *found_primitive = NULL;
-	if (render_2d->lookup_table.get(primitve_hash, found_primitive)) {
+	Primitive_2D *found_primitive = (primitive_key != PRIMITIVE_CACHE_NO_KEY) ? render_2d->primitive_cache.find(primitive_key) : NULL;
+	if (found_primitive) {
 		render_primitive.primitive = found_primitive;
 		render_primitives.push(render_primitive);
 		return NULL;
 	}
 
+	// The caller fills the primitive and adds it to the cache.
 	Primitive_2D *primitive = new Primitive_2D;
-	render_2d->lookup_table.set(primitve_hash, primitive);
 	render_primitive.primitive = primitive;
 	render_primitives.push(render_primitive);
 	return primitive;
@@ -487,13 +448,16 @@ Primitive_2D *Render_Primitive_List::make_or_find_primitive(Matrix4 &transform_m
 
 Render_2D::~Render_2D()
 {
+	glyph_cache.release();
+	primitive_cache.release();
+
 	Primitive_2D *primitive = NULL;
-	For(primitives, primitive) {
+	For(uncached_primitives, primitive) {
 		DELETE_PTR(primitive);
 	}
 
-	for (u32 i = 0; i < render_fonts.count; i++) {
-		DELETE_PTR(render_fonts.get_node(i)->value);
+	for (Hash_Node<String, Render_Font *> *node = render_fonts.first_entry(); node; node = render_fonts.next_entry(node)) {
+		DELETE_PTR(node->value);
 	}
 }
 
@@ -509,6 +473,14 @@ void Render_2D::init(Render_System *render_sys, Shader_Manager *shader_manager)
 		return;
 	}
 
+	render_2d_text = GET_SHADER(shader_manager, render_2d_text);
+	if (!is_valid(render_2d_text, VALIDATE_PIXEL_SHADER)) {
+		print("Render_2D::init: Failed to initialize Render_2D. {} is not valid.", render_2d_text->file_name);
+		return;
+	}
+
+	glyph_cache.init(gpu_device, render_pipeline);
+
 	gpu_device->create_constant_buffer(sizeof(CB_Render_2d_Info), &constant_buffer);
 
 	Texture2D_Desc texture_desc;
@@ -546,17 +518,6 @@ void Render_2D::init(Render_System *render_sys, Shader_Manager *shader_manager)
 	initialized = true;
 }
 
-void Render_2D::add_primitive(Primitive_2D *primitive)
-{
-	primitive->vertex_offset = total_vertex_count;
-	primitive->index_offset = total_index_count;
-
-	total_vertex_count += primitive->vertices.count;
-	total_index_count += primitive->indices.count;
-
-	primitives.push(primitive);
-}
-
 void Render_2D::add_render_primitive_list(Render_Primitive_List *render_primitive_list)
 {
 	draw_list.push(render_primitive_list);
@@ -573,68 +534,182 @@ Render_Font *Render_2D::get_render_font(Font *font)
 	return render_font;
 }
 
+void Render_2D::cache_primitive(u64 key, Primitive_2D *primitive)
+{
+	if (key == PRIMITIVE_CACHE_NO_KEY) {
+		uncached_primitives.push(primitive);
+	} else {
+		primitive_cache.add(key, primitive);
+	}
+}
+
+bool Render_2D::keep_render_primitive_list(Render_Primitive_List *render_primitive_list)
+{
+	Render_Primitive_2D *render_primitive = NULL;
+	For(render_primitive_list->render_primitives, render_primitive) {
+		// Uncached primitives are deleted in the next frame, so the list has to be filled again.
+		if (!render_primitive->glyph && (render_primitive->cache_key == PRIMITIVE_CACHE_NO_KEY)) {
+			return false;
+		}
+		// The key can be added again after eviction, then it has another primitive and the list points to the deleted one.
+		Primitive_2D *primitive = render_primitive->glyph ? glyph_cache.touch(render_primitive->cache_key) : primitive_cache.touch(render_primitive->cache_key);
+		if (!primitive || (primitive != render_primitive->primitive)) {
+			return false;
+		}
+	}
+	return true;
+}
+
 void Render_2D::new_frame()
 {
 	Render_Primitive_List *list = NULL;
 	For(draw_list, list) {
-		list->render_primitives.count = 0;
+		if (!list->retained) {
+			list->render_primitives.count = 0;
+		}
 	}
 	draw_list.count = 0;
-}
 
-void Render_2D::render_frame()
-{
-	begin_mark_rendering_event(L"2D Rendering");
-
-	if ((total_vertex_count == 0) || !initialized) {
-		return;
+	Primitive_2D *primitive = NULL;
+	For(uncached_primitives, primitive) {
+		DELETE_PTR(primitive);
 	}
+	uncached_primitives.count = 0;
 
-	static u32 privious_total_vertex_count;
+	glyph_cache.new_frame();
+	primitive_cache.new_frame();
+}
 
-	if (vertex_buffer.is_empty() || (privious_total_vertex_count != total_vertex_count)) {
-		privious_total_vertex_count = total_vertex_count;
+inline bool equal_clip_rects(const Rect_s32 &first, const Rect_s32 &second)
+{
+	return (first.x == second.x) && (first.y == second.y) && (first.width == second.width) && (first.height == second.height);
+}
 
-		if (!vertex_buffer.is_empty()) {
-			vertex_buffer.free();
-			index_buffer.free();
-		}
+inline bool can_be_batched(Render_Primitive_2D *first, Render_Primitive_2D *second)
+{
+	return (first->texture.srv.Get() == second->texture.srv.Get()) && equal_clip_rects(first->clip_rect, second->clip_rect);
+}
+
+void Render_2D::reserve_frame_buffers(u32 vertex_count, u32 index_count)
+{
+	// The buffers grow twice, so a frame a bit bigger than the previous one doesn't recreate them.
+	if (vertex_count > vertex_buffer.data_count) {
+		u32 new_vertex_count = math::max(vertex_count, vertex_buffer.data_count * 2);
+		vertex_buffer.free();
 
 		Gpu_Buffer_Desc vertex_buffer_desc;
-		vertex_buffer_desc.data_count = total_vertex_count;
-		vertex_buffer_desc.data_size = sizeof(Vertex_X2UV);
+		vertex_buffer_desc.data_count = new_vertex_count;
+		vertex_buffer_desc.data_size = sizeof(Vertex_X2UVC);
 		vertex_buffer_desc.usage = RESOURCE_USAGE_DYNAMIC;
 		vertex_buffer_desc.bind_flags = BIND_VERTEX_BUFFER;
 		vertex_buffer_desc.cpu_access = CPU_ACCESS_WRITE;
 
 		gpu_device->create_gpu_buffer(&vertex_buffer_desc, &vertex_buffer);
+	}
+
+	if (index_count > index_buffer.data_count) {
+		u32 new_index_count = math::max(index_count, index_buffer.data_count * 2);
+		index_buffer.free();
 
 		Gpu_Buffer_Desc index_buffer_desc;
-		index_buffer_desc.data_count = total_index_count;
+		index_buffer_desc.data_count = new_index_count;
 		index_buffer_desc.data_size = sizeof(u32);
 		index_buffer_desc.usage = RESOURCE_USAGE_DYNAMIC;
 		index_buffer_desc.bind_flags = BIND_INDEX_BUFFER;
 		index_buffer_desc.cpu_access = CPU_ACCESS_WRITE;
 
 		gpu_device->create_gpu_buffer(&index_buffer_desc, &index_buffer);
+	}
+}
+
+// Vertices of all render primitives are transformed to the screen space and get the color of their primitive,
+// so primitives don't need their own constant buffer and can be merged in batches.
+void Render_2D::fill_frame_buffers()
+{
+	frame_vertex_count = 0;
+	frame_index_count = 0;
+	draw_batches.count = 0;
+
+	Render_Primitive_List *list = NULL;
+	For(draw_list, list) {
+		Render_Primitive_2D *render_primitive = NULL;
+		For(list->render_primitives, render_primitive) {
+			frame_vertex_count += render_primitive->primitive->vertices.count;
+			frame_index_count += render_primitive->primitive->indices.count;
+		}
+	}
 
-		Vertex_X2UV *vertices = (Vertex_X2UV *)render_pipeline->map(vertex_buffer);
-		u32 *indices = (u32 *)render_pipeline->map(index_buffer);
+	if (frame_index_count == 0) {
+		return;
+	}
+	reserve_frame_buffers(frame_vertex_count, frame_index_count);
 
-		Primitive_2D *primitive = NULL;
-		For(primitives, primitive) {
+	// The buffers are filled one after another, the null backend gives the same scratch memory to every mapped buffer.
+	u32 vertex_offset = 0;
+	Vertex_X2UVC *vertices = (Vertex_X2UVC *)render_pipeline->map(vertex_buffer);
 
-			memcpy((void *)vertices, primitive->vertices.items, primitive->vertices.count * sizeof(Vertex_X2UV));
-			memcpy((void *)indices, primitive->indices.items, primitive->indices.count * sizeof(u32));
-			vertices += primitive->vertices.count;
-			indices += primitive->indices.count;
+	For(draw_list, list) {
+		Render_Primitive_2D *render_primitive = NULL;
+		For(list->render_primitives, render_primitive) {
+			Primitive_2D *primitive = render_primitive->primitive;
+			Matrix4 &matrix = render_primitive->transform_matrix;
+
+			for (u32 i = 0; i < primitive->vertices.count; i++) {
+				Vertex_X2UV *vertex = &primitive->vertices[i];
+				Vector2 position;
+				position.x = vertex->position.x * matrix.m[0][0] + vertex->position.y * matrix.m[1][0] + matrix.m[3][0];
+				position.y = vertex->position.x * matrix.m[0][1] + vertex->position.y * matrix.m[1][1] + matrix.m[3][1];
+				vertices[vertex_offset + i] = Vertex_X2UVC(position, vertex->uv, render_primitive->color.value);
+			}
+			vertex_offset += primitive->vertices.count;
 		}
+	}
+	render_pipeline->unmap(vertex_buffer);
+
+	vertex_offset = 0;
+	u32 index_offset = 0;
+	Draw_Batch *draw_batch = NULL;
+	u32 *indices = (u32 *)render_pipeline->map(index_buffer);
 
-		render_pipeline->unmap(vertex_buffer);
-		render_pipeline->unmap(index_buffer);
+	For(draw_list, list) {
+		Render_Primitive_2D *render_primitive = NULL;
+		For(list->render_primitives, render_primitive) {
+			Primitive_2D *primitive = render_primitive->primitive;
+			for (u32 i = 0; i < primitive->indices.count; i++) {
+				indices[index_offset + i] = primitive->indices[i] + vertex_offset;
+			}
+
+			if (!draw_batch || !can_be_batched(draw_batch->render_primitive, render_primitive)) {
+				draw_batches.push(Draw_Batch());
+				draw_batch = &draw_batches.last();
+				draw_batch->render_primitive = render_primitive;
+				draw_batch->index_offset = index_offset;
+			}
+			draw_batch->index_count += primitive->indices.count;
+
+			vertex_offset += primitive->vertices.count;
+			index_offset += primitive->indices.count;
+		}
 	}
+	render_pipeline->unmap(index_buffer);
+}
 
-	render_pipeline->set_input_layout(render_system->input_layouts.vertex_P2UV2);
+void Render_2D::render_frame()
+{
+	if (!initialized) {
+		return;
+	}
+
+	begin_mark_rendering_event(L"2D Rendering");
+
+	fill_frame_buffers();
+
+	if (draw_batches.is_empty()) {
+		end_mark_rendering_event();
+		return;
+	}
+
+	render_pipeline->set_input_layout(render_system->input_layouts.vertex_P2UV2C4);
 	render_pipeline->set_primitive(RENDER_PRIMITIVE_TRIANGLES);
 
 	render_pipeline->set_vertex_buffer(&vertex_buffer);
@@ -654,26 +729,29 @@ void Render_2D::render_frame()
 	render_pipeline->set_render_target(render_system->multisampling_back_buffer_texture.rtv, render_system->multisampling_depth_stencil_texture.dsv);
 
 	CB_Render_2d_Info cb_render_info;
-
-	Render_Primitive_List *list = NULL;
-	For(draw_list, list) {
-		Render_Primitive_2D *render_primitive = NULL;
-		For(list->render_primitives, render_primitive) {
-
-			render_pipeline->set_scissor(&render_primitive->clip_rect);
-
-			cb_render_info.position_orthographic_matrix = render_primitive->transform_matrix * render_system->view.orthogonal_matrix;
-
-			cb_render_info.color = render_primitive->color.value;
-
-			render_pipeline->update_constant_buffer(&constant_buffer, &cb_render_info);
-			render_pipeline->set_vertex_shader_resource(CB_RENDER_2D_INFO_REGISTER, constant_buffer);
-			render_pipeline->set_pixel_shader_resource(CB_RENDER_2D_INFO_REGISTER, constant_buffer);
-			render_pipeline->set_pixel_shader_resource(0, render_primitive->texture.srv);
-
-			Primitive_2D *primitive = render_primitive->primitive;
-			render_pipeline->draw_indexed(primitive->indices.count, primitive->index_offset, primitive->vertex_offset);
+	cb_render_info.orthographic_matrix = render_system->view.orthogonal_matrix;
+
+	render_pipeline->update_constant_buffer(&constant_buffer, &cb_render_info);
+	render_pipeline->set_vertex_shader_resource(CB_RENDER_2D_INFO_REGISTER, constant_buffer);
+	render_pipeline->set_pixel_shader_resource(CB_RENDER_2D_INFO_REGISTER, constant_buffer);
+
+	Rect_s32 *clip_rect = NULL;
+	Extend_Shader *pixel_shader = render_2d;
+	Draw_Batch *draw_batch = NULL;
+	For(draw_batches, draw_batch) {
+		Render_Primitive_2D *render_primitive = draw_batch->render_primitive;
+		if (!clip_rect || !equal_clip_rects(*clip_rect, render_primitive->clip_rect)) {
+			clip_rect = &render_primitive->clip_rect;
+			render_pipeline->set_scissor(clip_rect);
+		}
+		// The glyph atlas has one channel, text is drawn by its own pixel shader.
+		Extend_Shader *batch_pixel_shader = (render_primitive->texture.srv.Get() == glyph_cache.atlas.srv.Get()) ? render_2d_text : render_2d;
+		if (batch_pixel_shader != pixel_shader) {
+			pixel_shader = batch_pixel_shader;
+			render_pipeline->set_pixel_shader(pixel_shader);
 		}
+		render_pipeline->set_pixel_shader_resource(0, render_primitive->texture.srv);
+		render_pipeline->draw_indexed(draw_batch->index_count, draw_batch->index_offset, 0);
 	}
 
 	render_pipeline->reset_rasterizer();
@@ -693,7 +771,7 @@ void View::update_projection_matries(u32 fov_in_degrees, u32 width, u32 height,
 	orthogonal_matrix = XMMatrixOrthographicOffCenterLH(0.0f, (float)width, (float)height, 0.0f, near_plane, far_plane);
 }
 
-void Render_System::init(Win32_Window *window)
+void Render_System::init(Win32_Window *window, Render_Backend backend)
 {
 	assert(window);
 	assert(window->width > 0);
@@ -704,7 +782,12 @@ void Render_System::init(Win32_Window *window)
 
 	view.update_projection_matries(60, Render_System::screen_width, Render_System::screen_height, 1.0f, 10000.0f);
 
-	init_render_api(&gpu_device, &render_pipeline);
+	if (backend == RENDER_BACKEND_NULL) {
+		init_null_render_api(&gpu_device, &render_pipeline);
+	} else {
+		init_render_api(&gpu_device, &render_pipeline);
+	}
+	render_pipeline.command_log = &command_log;
 
 	swap_chain.init(&gpu_device, window);
 	init_render_targets(Render_System::screen_width, Render_System::screen_height);
@@ -714,7 +797,11 @@ void Render_System::init(Win32_Window *window)
 	print("Rendering system info:");
 	print("  Window resolution {}x{}.", Render_System::screen_width, Render_System::screen_height);
 	print("  FOV {} degrees.", 60);
-	print("  Render API based on Directx 11.");
+	if (backend == RENDER_BACKEND_NULL) {
+		print("  Render API is the null backend, nothing is submitted to a gpu.");
+	} else {
+		print("  Render API based on Directx 11.");
+	}
 }
 
 void Render_System::init_render_targets(u32 window_width, u32 window_height)
@@ -787,9 +874,10 @@ void Render_System::init_render_targets(u32 window_width, u32 window_height)
 
 void Render_System::init_input_layouts(Shader_Manager *shader_manager)
 {
-	Input_Layout_Elements position_uv_input_layout;
-	position_uv_input_layout.add("POSITION", DXGI_FORMAT_R32G32_FLOAT);
-	position_uv_input_layout.add("TEXCOORD", DXGI_FORMAT_R32G32_FLOAT);
+	Input_Layout_Elements position_uv_color_input_layout;
+	position_uv_color_input_layout.add("POSITION", DXGI_FORMAT_R32G32_FLOAT);
+	position_uv_color_input_layout.add("TEXCOORD", DXGI_FORMAT_R32G32_FLOAT);
+	position_uv_color_input_layout.add("COLOR", DXGI_FORMAT_R32G32B32A32_FLOAT);
 
 	Input_Layout_Elements position_input_layout;
 	position_input_layout.add("POSITION", DXGI_FORMAT_R32G32B32_FLOAT);
@@ -797,7 +885,7 @@ void Render_System::init_input_layouts(Shader_Manager *shader_manager)
 	Extend_Shader *render_2d = GET_SHADER(shader_manager, render_2d);
 	Extend_Shader *draw_vertices = GET_SHADER(shader_manager, draw_vertices);
 	
-	gpu_device.create_input_layout((void *)render_2d->bytecode, render_2d->bytecode_size, &position_uv_input_layout, input_layouts.vertex_P2UV2);
+	gpu_device.create_input_layout((void *)render_2d->bytecode, render_2d->bytecode_size, &position_uv_color_input_layout, input_layouts.vertex_P2UV2C4);
 	gpu_device.create_input_layout((void *)draw_vertices->bytecode, draw_vertices->bytecode_size, &position_input_layout, input_layouts.vertex_P3);
 }
 
@@ -815,6 +903,8 @@ void Render_System::resize(u32 window_width, u32 window_height)
 
 void Render_System::new_frame()
 {
+	command_log.begin_frame();
+
 	swap_chain.get_back_buffer_as_texture(&back_buffer_texture);
 
 	begin_mark_rendering_event(L"Frame rendering");
@@ -842,7 +932,7 @@ void Render_System::end_frame()
 	Engine::get_render_world()->render_passes.outlining.render(Engine::get_render_world(), &render_pipeline);
 
 	BEGIN_TASK("Swap chain");
-	HR(swap_chain.dxgi_swap_chain->Present(0, DXGI_PRESENT_ALLOW_TEARING));
+	swap_chain.present();
 	END_TASK();
 
 	end_mark_rendering_event();
@@ -852,81 +942,12 @@ void Render_System::end_frame()
 #endif
 }
 
-void Render_Font::init(Render_2D *render_2d, Font *font)
+void Render_Font::init(Render_2D *render_2d, Font *_font)
 {
-	assert(font);
+	assert(_font);
 	assert(render_2d);
 
-	Hash_Table<char, Rect_f32> uvs;
-	make_font_atlas(font, &uvs);
-
-	// Exp (MAX_CHARACTERS - 1) skips DEL char
-	for (u8 c = CONTORL_CHARACTERS; c < (MAX_CHARACTERS - 1); c++) {
-
-		Size_u32 size = font->get_font_char(c)->size;
-		Rect_f32 &uv = uvs[c];
-
-		Primitive_2D *primitive = new Primitive_2D();
-
-		primitive->add_point(Vector2(0.0f, 0.0f), Vector2(uv.x, uv.y));
-		primitive->add_point(Vector2((float)size.width, 0.0f), Vector2(uv.right(), uv.y));
-		primitive->add_point(Vector2((float)size.width, (float)size.height), Vector2(uv.right(), uv.bottom()));
-		primitive->add_point(Vector2(0.0f, (float)size.height), Vector2(uv.x, uv.bottom()));
-
-		primitive->make_triangle_polygon();
-		render_2d->add_primitive(primitive);
-
-		lookup_table.set(c, primitive);
-	}
-}
-
-void Render_Font::make_font_atlas(Font *font, Hash_Table<char, Rect_f32> *font_uvs)
-{
-	assert(font);
-	assert(font_uvs);
-
-	Texture2D_Desc texture_atlas_desc;
-	texture_atlas_desc.width = 200;
-	texture_atlas_desc.height = 200;
-	texture_atlas_desc.mip_levels = 1;
-
-	Engine::get_render_system()->gpu_device.create_texture_2d(&texture_atlas_desc, &font_atlas);
-	Engine::get_render_system()->gpu_device.create_shader_resource_view(&texture_atlas_desc, &font_atlas);
-
-	fill_texture((void *)&Color::Black, &font_atlas);
-
-	Array<Rect_u32 *> rect_pointers;
-	Array<Rect_u32> rects;
-	rects.reserve(MAX_CHARACTERS);
-
-	for (u8 c = CONTORL_CHARACTERS; c < (MAX_CHARACTERS - 1); c++) {
-		Font_Char *font_char = font->get_font_char(c);
-		rects[c] = Rect_u32(font_char->size);
-		rect_pointers.push(&rects[c]);
-	}
-
-	Rect_u32 atlas_rect;
-	atlas_rect.set_size(texture_atlas_desc.width, texture_atlas_desc.height);
-
-	pack_rects_in_rect(&atlas_rect, rect_pointers);
-
-	for (u8 c = CONTORL_CHARACTERS; c < (MAX_CHARACTERS - 1); c++) {
-		Font_Char *font_char = font->get_font_char(c);
-		Rect_u32 rect = rects[c];
-
-		Rect_f32 uv;
-		uv.x = static_cast<float>(rect.x) / static_cast<float>(texture_atlas_desc.width);
-		uv.y = static_cast<float>(rect.y) / static_cast<float>(texture_atlas_desc.height);
-		uv.width = static_cast<float>(rect.width) / static_cast<float>(texture_atlas_desc.width);
-		uv.height = static_cast<float>(rect.height) / static_cast<float>(texture_atlas_desc.height);
-
-		font_uvs->set((char)c, uv);
-
-		if ((rect.width == 0) && (rect.height == 0)) {
-			continue;
-		}
-		Engine::get_render_system()->render_pipeline.update_subresource(&font_atlas, (void *)font_char->bitmap, sizeof(u32) * font_char->size.width, &rect);
-	}
+	font = _font;
 }
 
 void Render_Pipeline_States::init(Gpu_Device *gpu_device)
@@ -940,12 +961,21 @@ void Render_Pipeline_States::init(Gpu_Device *gpu_device)
 	disabled_multisampling_rasterizer_state_desc.set_depthclip(false);
 	gpu_device->create_rasterizer_state(&disabled_multisampling_rasterizer_state_desc, &disabled_multisampling_state);
 
+	Rasterizer_Desc depth_clamping_rasterizer_state_desc;
+	depth_clamping_rasterizer_state_desc.set_depthclip(false);
+	gpu_device->create_rasterizer_state(&depth_clamping_rasterizer_state_desc, &depth_clamping_state);
+
 	Depth_Stencil_State_Desc default_depth_stencil_state_desc;
 	gpu_device->create_depth_stencil_state(&default_depth_stencil_state_desc, &default_depth_stencil_state);
 
 	default_depth_stencil_state_desc.enable_depth_test = false;
 	gpu_device->create_depth_stencil_state(&default_depth_stencil_state_desc, &disabled_depth_test);
 
+	// Disabling the depth test disables depth writes too, so depth is cleared with the test always passing.
+	Depth_Stencil_State_Desc clear_depth_state_desc;
+	clear_depth_state_desc.depth_compare_func = COMPARISON_ALWAYS;
+	gpu_device->create_depth_stencil_state(&clear_depth_state_desc, &clear_depth_state);
+
 	Blend_State_Desc blend_state_desc;
 	gpu_device->create_blend_state(&blend_state_desc, &default_blend_state);
 
@@ -981,7 +1011,9 @@ void Render_Pipeline_States::init(Gpu_Device *gpu_device)
 	point_sampling_desc.BorderColor[0] = 1.0f;
 	point_sampling_desc.BorderColor[0] = 1.0f;
 
-	HR(gpu_device->dx11_device.Get()->CreateSamplerState(&point_sampling_desc, point_sampling.ReleaseAndGetAddressOf()));
+	if (gpu_device->backend == RENDER_BACKEND_DX11) {
+		HR(gpu_device->dx11_device.Get()->CreateSamplerState(&point_sampling_desc, point_sampling.ReleaseAndGetAddressOf()));
+	}
 
 	D3D11_SAMPLER_DESC linear_sampling_desc;
 	ZeroMemory(&linear_sampling_desc, sizeof(D3D11_SAMPLER_DESC));
@@ -999,7 +1031,9 @@ void Render_Pipeline_States::init(Gpu_Device *gpu_device)
 	linear_sampling_desc.BorderColor[0] = 1.0f;
 	linear_sampling_desc.BorderColor[0] = 1.0f;
 
-	HR(gpu_device->dx11_device.Get()->CreateSamplerState(&linear_sampling_desc, linear_sampling.ReleaseAndGetAddressOf()));
+	if (gpu_device->backend == RENDER_BACKEND_DX11) {
+		HR(gpu_device->dx11_device.Get()->CreateSamplerState(&linear_sampling_desc, linear_sampling.ReleaseAndGetAddressOf()));
+	}
 
 	Depth_Stencil_State_Desc temp;
 	temp.enable_depth_test = true;
@@ -8,17 +8,16 @@
 #include "font.h"
 #include "vertices.h"
 #include "render_api.h"
+#include "glyph_cache.h"
+#include "primitive_cache.h"
 #include "shader_manager.h"
 #include "../libs/color.h"
 #include "../libs/math/matrix.h"
 #include "../libs/math/vector.h"
 #include "../win32/win_helpers.h"
 
+// Vertices are in the local space of a primitive, Render_2D transforms them every frame.
 struct Primitive_2D {
-	//Vars is set by Render_2D
-	u32 vertex_offset = 0;
-	u32 index_offset = 0;
-
 	Array<Vertex_X2UV> vertices;
 	Array<u32> indices;
 
@@ -36,16 +35,17 @@ struct Render_Primitive_2D {
 	Rect_s32 clip_rect;
 	Texture2D texture;
 	Matrix4 transform_matrix;
+	bool glyph = false;
+	u64 cache_key = 0; // A key in the glyph cache or the primitive cache.
 };
 
 struct Render_2D;
 
+// Glyphs of all fonts are kept in Render_2D::glyph_cache.
 struct Render_Font {
-	Texture2D font_atlas;
-	Hash_Table<u8, Primitive_2D *> lookup_table;
+	Font *font = NULL;
 
 	void init(Render_2D *render_2d, Font *font);
-	void make_font_atlas(Font *font, Hash_Table<char, Rect_f32> *font_uvs);
 };
 
 const u32 ROUND_TOP_LEFT_RECT = 0x1;
@@ -73,6 +73,7 @@ struct Render_Primitive_List {
 	Render_2D *render_2d = NULL;
 	Font *font = NULL;
 	Render_Font *render_font = NULL;
+	bool retained = false; // Render_2D doesn't clear a retained list, the owner clears it before filling it again.
 
 	Array<Rect_s32> clip_rects;
 	Array<Render_Primitive_2D> render_primitives;
@@ -98,7 +99,7 @@ struct Render_Primitive_List {
 	void add_circle(int x, int y, u32 radius, const Color &color, const Circle_Range &circle_range = { 0, 360 } );
 	void add_outline_circle(int x, int y, u32 radius, float thickness, const Color &color);
 
-	Primitive_2D *make_or_find_primitive(Matrix4 &transform_matx, Texture2D *texture, const Color &color, String &primitve_hash);
+	Primitive_2D *make_or_find_primitive(Matrix4 &transform_matx, Texture2D *texture, const Color &color, u64 primitive_key);
 };
 
 struct Render_System;
@@ -110,7 +111,15 @@ struct Render_2D {
 
 	Texture2D default_texture;
 
+	// Consecutive render primitives with the same texture and clip rect are drawn by one draw call.
+	struct Draw_Batch {
+		Render_Primitive_2D *render_primitive = NULL;
+		u32 index_offset = 0;
+		u32 index_count = 0;
+	};
+
 	Gpu_Buffer constant_buffer;
+	// The buffers are persistent, they are recreated only if the frame doesn't fit them.
 	Gpu_Buffer vertex_buffer;
 	Gpu_Buffer index_buffer;
 
@@ -119,25 +128,32 @@ struct Render_2D {
 	Depth_Stencil_State depth_stencil_state;
 
 	Extend_Shader *render_2d = NULL;
+	Extend_Shader *render_2d_text = NULL;
 
 	Gpu_Device *gpu_device = NULL;
 	Render_Pipeline *render_pipeline = NULL;
 	Render_System *render_system = NULL;
 
-	u32 total_vertex_count = 0;
-	u32 total_index_count = 0;
+	u32 frame_vertex_count = 0;
+	u32 frame_index_count = 0;
 
-	Array<Primitive_2D *> primitives;
+	Array<Draw_Batch> draw_batches;
+	Glyph_Cache glyph_cache;
+	Primitive_Cache primitive_cache;
+	Array<Primitive_2D *> uncached_primitives; // Primitives without a cache key, they are deleted in the next frame.
 	Array<Render_Primitive_List *> draw_list;
-	Hash_Table<String, Primitive_2D *> lookup_table;
 	Hash_Table<String, Render_Font *> render_fonts;
 
 	void init(Render_System *render_sys, Shader_Manager *shader_manager);
-	void add_primitive(Primitive_2D *primitive);
 	void add_render_primitive_list(Render_Primitive_List *render_primitive_list);
 	Render_Font *get_render_font(Font *font);
+	void cache_primitive(u64 key, Primitive_2D *primitive);
+	// Marks cached primitives of a list drawn again without refilling as used, returns false if some of them were evicted.
+	bool keep_render_primitive_list(Render_Primitive_List *render_primitive_list);
 
 	void new_frame();
+	void reserve_frame_buffers(u32 vertex_count, u32 index_count);
+	void fill_frame_buffers();
 	void render_frame(); // @Clean up change name 
 };
 
@@ -177,7 +193,9 @@ struct Render_Pipeline_States {
 	Sampler_State linear_sampling;
 	Rasterizer_State default_rasterizer_state;
 	Rasterizer_State disabled_multisampling_state;
+	Rasterizer_State depth_clamping_state;
 	Depth_Stencil_State default_depth_stencil_state;
+	Depth_Stencil_State clear_depth_state;
 	Depth_Stencil_State disabled_depth_test;
 	Depth_Stencil_State outlining_depth_stencil_state;
 	Depth_Stencil_State pre_outlining_depth_stencil_state;
@@ -219,7 +237,7 @@ struct Render_System {
 	static u32 screen_height;
 
 	struct Input_Layouts {
-		Input_Layout vertex_P2UV2;
+		Input_Layout vertex_P2UV2C4;
 		Input_Layout vertex_P3;
 	} input_layouts;
 
@@ -241,8 +259,9 @@ struct Render_System {
 	Gpu_Device gpu_device;
 	Render_Pipeline render_pipeline;
 	Render_Pipeline_States render_pipeline_states;
+	Render_Command_Log command_log;
 
-	void init(Win32_Window *window);
+	void init(Win32_Window *window, Render_Backend backend = RENDER_BACKEND_DX11);
 	void init_render_targets(u32 window_width, u32 window_height);
 	void init_input_layouts(Shader_Manager *shader_manager);
 
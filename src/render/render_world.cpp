@@ -1,13 +1,16 @@
 #include <assert.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "../sys/sys.h"
 #include "../sys/engine.h"
+#include "../sys/profiling.h"
 
 #include "render_world.h"
 #include "../libs/os/path.h"
 #include "../libs/os/file.h"
+#include "../libs/mesh_cache.h"
 #include "../libs/math/functions.h"
 
 const Color DEFAULT_MESH_COLOR = Color(105, 105, 105);
@@ -22,14 +25,30 @@ Matrix4 get_world_matrix(Entity *entity)
 	return make_scale_matrix(&entity->scaling) * rotate(&entity->rotation) * make_translation_matrix(&entity->position);
 }
 
+// The unified arrays grow geometrically, so adding meshes one by one reallocates them and the gpu buffers a few times only.
+const u32 MIN_UNIFIED_VERTEX_CAPACITY = 65536;
+const u32 MIN_UNIFIED_INDEX_CAPACITY = 196608;
+
 template <typename T>
-static bool copy_array(Array<T> *dst, Array<T> *src, u32 dst_index_offset = 0)
+static void grow_unified_array(Array<T> *unified_array, Offset_Allocator *allocator, u32 new_capacity)
 {
-	if ((!dst->is_empty() && !src->is_empty()) && (dst->count >= (dst_index_offset + src->count))) {
-		memcpy((void *)&dst->items[dst_index_offset], (void *)src->items, sizeof(T) * src->count);
-		return true;
+	if (unified_array->size < new_capacity) {
+		unified_array->resize(new_capacity);
 	}
-	return false;
+	unified_array->count = new_capacity;
+	allocator->grow(new_capacity);
+}
+
+template <typename T>
+static u32 allocate_unified_range(Array<T> *unified_array, Offset_Allocator *allocator, u32 count, u32 min_capacity)
+{
+	u32 offset = allocator->allocate(count);
+	if (offset == OFFSET_ALLOCATOR_NO_SPACE) {
+		grow_unified_array(unified_array, allocator, allocator->get_grown_capacity(count, min_capacity));
+		offset = allocator->allocate(count);
+		assert(offset != OFFSET_ALLOCATOR_NO_SPACE);
+	}
+	return offset;
 }
 
 static float generate_random_offset()
@@ -63,19 +82,6 @@ static void make_jittering_sampling_filters(u32 tile_size, u32 filter_size, Arra
 	}
 }
 
-Render_Entity *find_render_entity(Array<Render_Entity> *render_entities, Entity_Id entity_id, u32 *index)
-{
-	for (u32 i = 0; i < render_entities->count; i++) {
-		if (render_entities->get(i).entity_id == entity_id) {
-			if (index) {
-				*index = i;
-			}
-			return &render_entities->get(i);
-		}
-	}
-	return NULL;
-}
-
 void Render_Camera::update(Camera *camera, Camera *camera_info)
 {
 	view_matrix = make_look_at_matrix(camera->position, camera->target);
@@ -148,6 +154,11 @@ void Model_Storage::init(Gpu_Device *gpu_device)
 	default_textures.white = textures.push(create_color_texture(gpu_device, width, height, Color::White));
 	default_textures.black = textures.push(create_color_texture(gpu_device, width, height, Color::Black));
 	default_textures.green = textures.push(create_color_texture(gpu_device, width, height, Color(0.5f, 0.5f, 1.0f)));
+
+	// Only changed ranges of the unified buffers are uploaded, it needs buffers which can be updated partially.
+	vertex_struct_buffer.usage = RESOURCE_USAGE_DEFAULT;
+	index_struct_buffer.usage = RESOURCE_USAGE_DEFAULT;
+	mesh_struct_buffer.usage = RESOURCE_USAGE_DEFAULT;
 }
 
 void Model_Storage::release_all_resources()
@@ -159,6 +170,14 @@ void Model_Storage::release_all_resources()
 	meshes_textures.clear();
 	loaded_models_files.clear();
 
+	free_mesh_instances.clear();
+
+	free_memory(&mesh_bvhs);
+	mesh_bvhs.clear();
+
+	vertex_allocator.reset(0);
+	index_allocator.reset(0);
+
 	mesh_table.clear();
 	texture_table.clear();
 
@@ -174,23 +193,29 @@ void Model_Storage::add_models_file(const char *file_name)
 
 void Model_Storage::reserve_memory_for_new_models(u32 mesh_count, u32 total_vertex_count, u32 total_index_count)
 {
-	mesh_instances.resize(mesh_instances.count + mesh_count);
-	unified_vertices.resize(unified_vertices.count + total_vertex_count);
-	unified_indices.resize(unified_indices.count + total_index_count);
+	if ((mesh_instances.count + mesh_count) > mesh_instances.size) {
+		mesh_instances.resize(mesh_instances.count + mesh_count);
+	}
+	if (vertex_allocator.get_free_count() < total_vertex_count) {
+		grow_unified_array(&unified_vertices, &vertex_allocator, vertex_allocator.get_grown_capacity(total_vertex_count, MIN_UNIFIED_VERTEX_CAPACITY));
+	}
+	if (index_allocator.get_free_count() < total_index_count) {
+		grow_unified_array(&unified_indices, &index_allocator, index_allocator.get_grown_capacity(total_index_count, MIN_UNIFIED_INDEX_CAPACITY));
+	}
 }
 
-bool validate_model_name_and_get_string_id(String_Id *model_string_id, Loading_Model *model)
+static bool validate_model_name_and_get_string_id(String_Id *model_string_id, String &name, String &file_name)
 {
-	if (!model->name.is_empty() && !model->file_name.is_empty()) {
-		*model_string_id = fast_hash(model->file_name + "_" + model->name);
+	if (!name.is_empty() && !file_name.is_empty()) {
+		*model_string_id = fast_hash(file_name + "_" + name);
 		return true;
-	} else if (exclusive_or(model->name.is_empty(), model->file_name.is_empty())) {
-		if (model->name.is_empty()) {
-			*model_string_id = fast_hash(model->file_name);
-			print("[Mesh storage] Warning: A tringle mesh contains only a file name '{}' it's possible to get the collision.", model->file_name);
+	} else if (exclusive_or(name.is_empty(), file_name.is_empty())) {
+		if (name.is_empty()) {
+			*model_string_id = fast_hash(file_name);
+			print("[Mesh storage] Warning: A tringle mesh contains only a file name '{}' it's possible to get the collision.", file_name);
 		} else {
-			*model_string_id = fast_hash(model->name);
-			print("[Mesh storage] Warning: A tringle mesh contains only a name '{}' it's possible to get the collision.", model->name);
+			*model_string_id = fast_hash(name);
+			print("[Mesh storage] Warning: A tringle mesh contains only a name '{}' it's possible to get the collision.", name);
 		}
 		return true;
 	}
@@ -198,6 +223,11 @@ bool validate_model_name_and_get_string_id(String_Id *model_string_id, Loading_M
 	return false;
 }
 
+bool validate_model_name_and_get_string_id(String_Id *model_string_id, Loading_Model *model)
+{
+	return validate_model_name_and_get_string_id(model_string_id, model->name, model->file_name);
+}
+
 void Model_Storage::add_models(Array<Loading_Model *> &models, Array<Pair<Loading_Model *, Mesh_Id>> &result)
 {
 	result.resize(models.count);
@@ -230,32 +260,199 @@ void Model_Storage::add_models(Array<Loading_Model *> &models, Array<Pair<Loadin
 
 		mesh_id.textures_idx = meshes_textures.push(mesh_textures);
 
-		Mesh_Instance mesh_info;
-		mesh_info.vertex_count = model->mesh.vertices.count;
-		mesh_info.index_count = model->mesh.indices.count;
-		mesh_info.vertex_offset = unified_vertices.count;
-		mesh_info.index_offset = unified_indices.count;
+		mesh_id.instance_idx = allocate_mesh_instance(model->mesh.vertices.count, model->mesh.indices.count);
 
-		mesh_id.instance_idx = mesh_instances.push(mesh_info);
+		Mesh_Instance *mesh_instance = &mesh_instances[mesh_id.instance_idx];
+		memcpy((void *)&unified_vertices[mesh_instance->vertex_offset], (void *)model->mesh.vertices.items, sizeof(Vertex_PNTUV) * mesh_instance->vertex_count);
+		memcpy((void *)&unified_indices[mesh_instance->index_offset], (void *)model->mesh.indices.items, sizeof(u32) * mesh_instance->index_count);
 
-		merge(&unified_vertices, &model->mesh.vertices);
-		merge(&unified_indices, &model->mesh.indices);
+		upload_mesh_instance(mesh_id.instance_idx);
+		build_mesh_bvh(mesh_id.instance_idx);
 
 		result.push({ model, mesh_id });
 
 		mesh_table.set(model_string_id, mesh_id);
 	}
-	
-	mesh_struct_buffer.update(&mesh_instances);
+}
+
+u32 Model_Storage::add_models(Mesh_Cache *mesh_cache)
+{
+	assert(mesh_cache);
+	assert(mesh_cache->header);
+
+	reserve_memory_for_new_models(mesh_cache->model_count(), mesh_cache->header->total_vertex_count, mesh_cache->header->total_index_count);
+
+	u32 added_models_count = 0;
+	for (u32 i = 0; i < mesh_cache->model_count(); i++) {
+		Cooked_Model *model = &mesh_cache->models[i];
+
+		String name = mesh_cache->get_string(model->name);
+		String file_name = mesh_cache->get_string(model->file_name);
+
+		String_Id model_string_id;
+		if (!validate_model_name_and_get_string_id(&model_string_id, name, file_name)) {
+			continue;
+		}
+
+		Mesh_Id mesh_id;
+		if (mesh_table.get(model_string_id, mesh_id)) {
+			print("[Mesh storage] Info: {} mesh has already been placed in the mesh storage.", name);
+			added_models_count++;
+			continue;
+		}
+
+		String normal_texture_name = mesh_cache->get_string(model->normal_texture_name);
+		String diffuse_texture_name = mesh_cache->get_string(model->diffuse_texture_name);
+		String specular_texture_name = mesh_cache->get_string(model->specular_texture_name);
+		String displacement_texture_name = mesh_cache->get_string(model->displacement_texture_name);
+
+		Mesh_Textures mesh_textures;
+		mesh_textures.normal_idx = find_texture_or_get_default(normal_texture_name, file_name, default_textures.normal);
+		mesh_textures.diffuse_idx = find_texture_or_get_default(diffuse_texture_name, file_name, default_textures.diffuse);
+		mesh_textures.specular_idx = find_texture_or_get_default(specular_texture_name, file_name, default_textures.specular);
+		mesh_textures.displacement_idx = find_texture_or_get_default(displacement_texture_name, file_name, default_textures.displacement);
+
+		mesh_id.textures_idx = meshes_textures.push(mesh_textures);
+
+		mesh_id.instance_idx = allocate_mesh_instance(model->vertex_count, model->index_count);
+
+		// Vertices and indices are copied straight from the mapped file, indices are relative to a mesh so they don't need to be patched.
+		Mesh_Instance *mesh_instance = &mesh_instances[mesh_id.instance_idx];
+		memcpy((void *)&unified_vertices[mesh_instance->vertex_offset], (void *)mesh_cache->get_vertices(model), sizeof(Vertex_PNTUV) * model->vertex_count);
+		memcpy((void *)&unified_indices[mesh_instance->index_offset], (void *)mesh_cache->get_indices(model), sizeof(u32) * model->index_count);
+
+		upload_mesh_instance(mesh_id.instance_idx);
+		build_mesh_bvh(mesh_id.instance_idx);
+
+		mesh_table.set(model_string_id, mesh_id);
+		added_models_count++;
+	}
+	return added_models_count;
+}
+
+u32 Model_Storage::allocate_mesh_instance(u32 vertex_count, u32 index_count)
+{
+	Mesh_Instance mesh_instance;
+	mesh_instance.vertex_count = vertex_count;
+	mesh_instance.index_count = index_count;
+	mesh_instance.vertex_offset = allocate_unified_range(&unified_vertices, &vertex_allocator, vertex_count, MIN_UNIFIED_VERTEX_CAPACITY);
+	mesh_instance.index_offset = allocate_unified_range(&unified_indices, &index_allocator, index_count, MIN_UNIFIED_INDEX_CAPACITY);
+
+	if (!free_mesh_instances.is_empty()) {
+		u32 instance_idx = free_mesh_instances.pop();
+		mesh_instances[instance_idx] = mesh_instance;
+		return instance_idx;
+	}
+	return mesh_instances.push(mesh_instance);
+}
+
+// If a gpu buffer has to grow, the whole unified array is uploaded instead of the mesh range.
+void Model_Storage::upload_mesh_instance(u32 instance_idx)
+{
+	Mesh_Instance *mesh_instance = &mesh_instances[instance_idx];
+	vertex_struct_buffer.update(&unified_vertices, mesh_instance->vertex_offset, mesh_instance->vertex_count);
+	index_struct_buffer.update(&unified_indices, mesh_instance->index_offset, mesh_instance->index_count);
+	mesh_struct_buffer.update(&mesh_instances, instance_idx, 1);
+}
+
+void Model_Storage::remove_mesh(Mesh_Id mesh_id)
+{
+	assert(mesh_id.instance_idx < mesh_instances.count);
+
+	if (free_mesh_instances.find(mesh_id.instance_idx)) {
+		print("Model_Storage::remove_mesh: The mesh instance {} has already been removed.", mesh_id.instance_idx);
+		return;
+	}
+	Mesh_Instance *mesh_instance = &mesh_instances[mesh_id.instance_idx];
+	vertex_allocator.free(mesh_instance->vertex_offset, mesh_instance->vertex_count);
+	index_allocator.free(mesh_instance->index_offset, mesh_instance->index_count);
+
+	// The freed ranges are not uploaded, the zeroed instance makes draws of the mesh empty.
+	*mesh_instance = Mesh_Instance();
+	mesh_struct_buffer.update(&mesh_instances, mesh_id.instance_idx, 1);
+
+	if (mesh_id.instance_idx < mesh_bvhs.count) {
+		mesh_bvhs[mesh_id.instance_idx]->free();
+	}
+	for (Hash_Node<String_Id, Mesh_Id> *node = mesh_table.first_entry(); node; node = mesh_table.next_entry(node)) {
+		if (node->value.instance_idx == mesh_id.instance_idx) {
+			mesh_table.remove(node->key);
+			break;
+		}
+	}
+	free_mesh_instances.push(mesh_id.instance_idx);
+}
+
+struct Unified_Range {
+	u32 offset;
+	u32 count;
+	u32 instance_idx;
+};
+
+static int compare_unified_ranges(const void *first, const void *second)
+{
+	u32 first_offset = ((const Unified_Range *)first)->offset;
+	u32 second_offset = ((const Unified_Range *)second)->offset;
+	return (first_offset < second_offset) ? -1 : ((first_offset > second_offset) ? 1 : 0);
+}
+
+// Ranges are moved in the order of their offsets, so a range is never moved over data which hasn't been moved yet.
+template <typename T>
+static void compact_unified_array(Array<T> *unified_array, Offset_Allocator *allocator, Array<Unified_Range> *ranges)
+{
+	qsort((void *)ranges->items, ranges->count, sizeof(Unified_Range), compare_unified_ranges);
+
+	u32 offset = 0;
+	for (u32 i = 0; i < ranges->count; i++) {
+		Unified_Range *range = &ranges->get(i);
+		if (range->offset != offset) {
+			memmove((void *)&unified_array->items[offset], (void *)&unified_array->items[range->offset], sizeof(T) * range->count);
+		}
+		range->offset = offset;
+		offset += range->count;
+	}
+	allocator->reset(allocator->capacity);
+	u32 first_offset = allocator->allocate(offset);
+	assert((offset == 0) || (first_offset == 0));
+}
+
+void Model_Storage::defragment()
+{
+	Array<Unified_Range> vertex_ranges;
+	Array<Unified_Range> index_ranges;
+	for (u32 i = 0; i < mesh_instances.count; i++) {
+		Mesh_Instance *mesh_instance = &mesh_instances[i];
+		if (mesh_instance->vertex_count > 0) {
+			vertex_ranges.push({ mesh_instance->vertex_offset, mesh_instance->vertex_count, i });
+		}
+		if (mesh_instance->index_count > 0) {
+			index_ranges.push({ mesh_instance->index_offset, mesh_instance->index_count, i });
+		}
+	}
+	compact_unified_array(&unified_vertices, &vertex_allocator, &vertex_ranges);
+	compact_unified_array(&unified_indices, &index_allocator, &index_ranges);
+
+	for (u32 i = 0; i < vertex_ranges.count; i++) {
+		mesh_instances[vertex_ranges[i].instance_idx].vertex_offset = vertex_ranges[i].offset;
+	}
+	for (u32 i = 0; i < index_ranges.count; i++) {
+		mesh_instances[index_ranges[i].instance_idx].index_offset = index_ranges[i].offset;
+	}
+	// Almost every mesh is moved, so the buffers are uploaded as a whole.
 	vertex_struct_buffer.update(&unified_vertices);
 	index_struct_buffer.update(&unified_indices);
+	mesh_struct_buffer.update(&mesh_instances);
 }
 
-void Model_Storage::allocate_gpu_memory()
+void Model_Storage::build_mesh_bvh(u32 instance_idx)
 {
-	mesh_struct_buffer.allocate<Mesh_Instance>(1000);
-	index_struct_buffer.allocate<u32>(100000);
-	vertex_struct_buffer.allocate<Vertex_PNTUV>(100000);
+	assert(instance_idx < mesh_instances.count);
+
+	while (mesh_bvhs.count <= instance_idx) {
+		mesh_bvhs.push(new Mesh_BVH());
+	}
+	Mesh_Instance *mesh_instance = &mesh_instances[instance_idx];
+	mesh_bvhs[instance_idx]->build(&unified_vertices[mesh_instance->vertex_offset], &unified_indices[mesh_instance->index_offset], mesh_instance->index_count);
 }
 
 bool Model_Storage::add_texture(const char *texture_name, const char *full_path_to_texture_file, Texture_Idx *texture_idx)
@@ -288,13 +485,13 @@ bool Model_Storage::update_mesh(Mesh_Id mesh_id, Triangle_Mesh *triangle_mesh)
 {
 	Mesh_Instance mesh_instance = mesh_instances[mesh_id.instance_idx];
 	if ((triangle_mesh->vertices.count == mesh_instance.vertex_count) && (triangle_mesh->indices.count == mesh_instance.index_count)) {
-		u32 vertex_offset = mesh_instance.vertex_offset > 0 ? mesh_instance.vertex_offset : 0;
-		u32 index_offset = mesh_instance.index_offset > 0 ? mesh_instance.index_offset : 0;
-		copy_array(&unified_vertices, &triangle_mesh->vertices, vertex_offset);
-		copy_array(&unified_indices, &triangle_mesh->indices, index_offset);
+		memcpy((void *)&unified_vertices[mesh_instance.vertex_offset], (void *)triangle_mesh->vertices.items, sizeof(Vertex_PNTUV) * mesh_instance.vertex_count);
+		memcpy((void *)&unified_indices[mesh_instance.index_offset], (void *)triangle_mesh->indices.items, sizeof(u32) * mesh_instance.index_count);
+
+		build_mesh_bvh(mesh_id.instance_idx);
 
-		vertex_struct_buffer.update(&unified_vertices);
-		index_struct_buffer.update(&unified_indices);
+		vertex_struct_buffer.update(&unified_vertices, mesh_instance.vertex_offset, mesh_instance.vertex_count);
+		index_struct_buffer.update(&unified_indices, mesh_instance.index_offset, mesh_instance.index_count);
 		return true;
 	}
 	return false;
@@ -323,6 +520,13 @@ Texture_Idx Model_Storage::find_texture_or_get_default(String &texture_file_name
 	return default_texture;
 }
 
+void Model_Storage::print_stats()
+{
+	print("Model_Storage: {} mesh instances, {} of them are removed and can be reused.", mesh_instances.count, free_mesh_instances.count);
+	print("Model_Storage: {} of {} vertices are used, {} free ranges, the largest free range has {} vertices.", vertex_allocator.used_count, vertex_allocator.capacity, vertex_allocator.free_ranges.count, vertex_allocator.get_largest_free_range());
+	print("Model_Storage: {} of {} indices are used, {} free ranges, the largest free range has {} indices.", index_allocator.used_count, index_allocator.capacity, index_allocator.free_ranges.count, index_allocator.get_largest_free_range());
+}
+
 void Cascaded_Shadow_Map::init(float fov, float aspect_ratio, Shadow_Cascade_Range *shadow_cascade_range)
 {
 	float half_height = (float)shadow_cascade_range->end * math::tan(fov * 0.5f);
@@ -367,6 +571,9 @@ void Render_World::init(Engine *engine)
 	render_sys->gpu_device.create_constant_buffer(sizeof(CB_Frame_Info), &frame_info_cbuffer);
 
 	lights_struct_buffer.allocate<Hlsl_Light>(100);
+	light_clusters_sb.allocate<Hlsl_Light_Cluster>(LIGHT_CLUSTER_COUNT);
+	light_indices_sb.allocate<u32>(1024);
+	world_matrices_struct_buffer.usage = RESOURCE_USAGE_DEFAULT;
 	world_matrices_struct_buffer.allocate<Matrix4>(100);
 
 	if (!render_camera.is_entity_camera_set()) {
@@ -388,6 +595,7 @@ void Render_World::init_shadow_rendering()
 	render_sys->gpu_device.create_shader_resource_view(&depth_stencil_desc, &shadow_atlas);
 
 	fill_texture((void *)&DEFAULT_DEPTH_VALUE, &shadow_atlas);
+	shadow_atlas_allocator.init(SHADOW_ATLAS_SIZE, SHADOW_ATLAS_MIN_TILE_SIZE, CASCADE_SIZE);
 
 	shadow_cascade_ranges.push({ 1, 15 });
 	shadow_cascade_ranges.push({ 15, 150 });
@@ -474,12 +682,23 @@ void Render_World::release_render_entities_resources()
 {
 	light_info_list.clear();
 	shader_lights.clear();
+	light_clusters.release();
 
 	render_entity_world_matrices.clear();
+	dirty_world_matrix_chunks.clear();
+	transformed_render_entities.clear();
+	transformed_world_matrices.clear();
 	light_view_matrices.clear();
 	cascaded_view_projection_matrices.clear();
+	cascaded_shadow_atlas_rects.clear();
 
 	game_render_entities.clear();
+	render_entity_table.clear();
+	render_entity_visibility.clear();
+	visible_render_entities.clear();
+	voxel_grid_render_entities.clear();
+	visible_render_batches.clear();
+	voxel_grid_render_batches.clear();
 
 	cascaded_shadows_list.clear();
 	cascaded_shadows_info_list.clear();
@@ -487,13 +706,20 @@ void Render_World::release_render_entities_resources()
 	model_storage.release_all_resources();
 
 	lights_struct_buffer.free();
+	light_clusters_sb.free();
+	light_indices_sb.free();
 	cascaded_shadows_info_sb.free();
 	world_matrices_struct_buffer.free();
 	cascaded_view_projection_matrices_sb.free();
+	cascaded_shadow_atlas_rects_sb.free();
+	render_batches.free();
+	shadow_atlas_allocator.reset();
 }
 
 void Render_World::update()
 {
+	PROFILE_ZONE("Render_World::update");
+
 	update_render_entities();
 
 	Camera *camera = game_world->get_camera(render_camera.camera_id);
@@ -510,16 +736,322 @@ void Render_World::update()
 
 	update_shadows();
 	update_global_illumination();
+	update_light_clusters();
+	cull_render_entities();
+	update_shadow_cascades_caching();
+	update_shadow_atlas_tiles();
+	build_render_batches();
 }
 
+// Transforms are gathered in SoA layout, so world matrices are built by SIMD batches and then scattered to their places.
+static void update_world_matrices(u32 first, u32 last, void *data)
+{
+	Render_World *render_world = (Render_World *)data;
+	Transforms *transforms = &render_world->transformed_render_entity_transforms;
+	for (u32 i = first; i < last; i++) {
+		Render_Entity *render_entity = &render_world->game_render_entities[render_world->transformed_render_entities[i]];
+		Entity *entity = render_world->game_world->get_entity(render_entity->entity_id);
+		transforms->set(i, entity->scaling, entity->rotation, entity->position);
+	}
+	build_world_matrices(transforms, first, last, render_world->transformed_world_matrices.items);
+
+	for (u32 i = first; i < last; i++) {
+		Render_Entity *render_entity = &render_world->game_render_entities[render_world->transformed_render_entities[i]];
+		render_world->render_entity_world_matrices[render_entity->world_matrix_idx] = render_world->transformed_world_matrices[i];
+	}
+}
+
+// Only world matrices of entities transformed since the last frame are recomputed and uploaded.
 void Render_World::update_render_entities()
 {
-	Render_Entity *render_entity = NULL;
-	For(game_render_entities, render_entity) {
-		Entity *entity = game_world->get_entity(render_entity->entity_id);
-		render_entity_world_matrices[render_entity->world_matrix_idx] = get_world_matrix(entity);
+	PROFILE_ZONE("Render_World::update_render_entities");
+
+	transformed_render_entities.clear();
+	for (u32 i = 0; i < game_world->transformed_entities.count; i++) {
+		u32 render_entity_index;
+		if (render_entity_table.get(game_world->transformed_entities[i], &render_entity_index)) {
+			transformed_render_entities.push(render_entity_index);
+		}
+	}
+	game_world->clear_transform_changes();
+
+	transformed_render_entity_transforms.resize(transformed_render_entities.count);
+	if (transformed_render_entities.count > transformed_world_matrices.size) {
+		transformed_world_matrices.resize(math::max(transformed_render_entities.count, transformed_world_matrices.size * 2));
+	}
+	transformed_world_matrices.count = transformed_render_entities.count;
+
+	// Every render entity writes only its own world matrix, so batches can run on any thread.
+	Engine::get_job_system()->parallel_for(transformed_render_entities.count, RENDER_ENTITIES_BATCH_SIZE, update_world_matrices, (void *)this);
+
+	for (u32 i = 0; i < transformed_render_entities.count; i++) {
+		mark_world_matrix_dirty(game_render_entities[transformed_render_entities[i]].world_matrix_idx);
+	}
+	upload_world_matrices();
+}
+
+void Render_World::mark_world_matrix_dirty(u32 world_matrix_idx)
+{
+	u32 chunk_index = world_matrix_idx / WORLD_MATRICES_CHUNK_SIZE;
+	while (dirty_world_matrix_chunks.count <= chunk_index) {
+		dirty_world_matrix_chunks.push(0);
+	}
+	dirty_world_matrix_chunks[chunk_index] = 1;
+}
+
+// Neighbouring dirty chunks are uploaded by one update.
+void Render_World::upload_world_matrices()
+{
+	for (u32 i = 0; i < dirty_world_matrix_chunks.count;) {
+		if (!dirty_world_matrix_chunks[i]) {
+			i++;
+			continue;
+		}
+		u32 first_chunk = i;
+		for (; (i < dirty_world_matrix_chunks.count) && dirty_world_matrix_chunks[i]; i++) {
+			dirty_world_matrix_chunks[i] = 0;
+		}
+		u32 first_matrix = first_chunk * WORLD_MATRICES_CHUNK_SIZE;
+		u32 last_matrix = math::min(i * WORLD_MATRICES_CHUNK_SIZE, render_entity_world_matrices.count);
+		if (first_matrix < last_matrix) {
+			world_matrices_struct_buffer.update(&render_entity_world_matrices, first_matrix, last_matrix - first_matrix);
+		}
 	}
-	world_matrices_struct_buffer.update(&render_entity_world_matrices);
+}
+
+static void update_render_entity_bounds(u32 first, u32 last, void *data)
+{
+	Render_World *render_world = (Render_World *)data;
+	for (u32 i = first; i < last; i++) {
+		Render_Entity *render_entity = &render_world->game_render_entities[i];
+		Mesh_BVH *mesh_bvh = render_world->model_storage.get_mesh_bvh(render_entity->mesh_id.instance_idx);
+		if (mesh_bvh && !mesh_bvh->is_empty()) {
+			// The BVH root holds the mesh bounds in object space.
+			render_world->render_entity_bounds.set(i, transform_AABB(mesh_bvh->nodes[0].bounds, render_world->render_entity_world_matrices[render_entity->world_matrix_idx]));
+		} else {
+			Entity *entity = render_world->game_world->get_entity(render_entity->entity_id);
+			if (entity && (entity->bounding_box_type == BOUNDING_BOX_TYPE_AABB)) {
+				render_world->render_entity_bounds.set(i, entity->AABB_box);
+			} else {
+				render_world->render_entity_bounds.set_unbounded(i);
+			}
+		}
+	}
+}
+
+void Render_World::cull_render_entities()
+{
+	PROFILE_ZONE("Render_World::cull_render_entities");
+
+	render_entity_bounds.resize(game_render_entities.count);
+	if (render_entity_visibility.size < game_render_entities.count) {
+		render_entity_visibility.resize(game_render_entities.count);
+	}
+	render_entity_visibility.count = game_render_entities.count;
+
+	Engine::get_job_system()->parallel_for(game_render_entities.count, RENDER_ENTITIES_BATCH_SIZE, update_render_entity_bounds, (void *)this);
+
+	// Every frustum is culled by a separate job into its own list.
+	Array<Culling_Job> culling_jobs;
+
+	Culling_Job camera_culling_job;
+	camera_culling_job.frustum = make_frustum(render_camera.view_matrix * render_sys->view.perspective_matrix);
+	camera_culling_job.bounding_boxes = &render_entity_bounds;
+	camera_culling_job.visible_indices = &visible_render_entities;
+	camera_culling_job.visibility = render_entity_visibility.items;
+	culling_jobs.push(camera_culling_job);
+
+	Culling_Job voxel_grid_culling_job;
+	voxel_grid_culling_job.frustum = make_frustum(left_to_right_voxel_view_matrix * voxel_matrix);
+	voxel_grid_culling_job.bounding_boxes = &render_entity_bounds;
+	voxel_grid_culling_job.visible_indices = &voxel_grid_render_entities;
+	culling_jobs.push(voxel_grid_culling_job);
+
+	for (u32 i = 0; i < cascaded_shadows_list.count; i++) {
+		for (u32 j = 0; j < cascaded_shadows_list[i].cascaded_shadow_maps.count; j++) {
+			Cascaded_Shadow_Map *cascaded_shadow_map = &cascaded_shadows_list[i].cascaded_shadow_maps[j];
+
+			Culling_Job cascade_culling_job;
+			cascade_culling_job.frustum = make_shadow_caster_frustum(cascaded_shadow_map->view_projection_matrix);
+			cascade_culling_job.bounding_boxes = &render_entity_bounds;
+			cascade_culling_job.visible_indices = &cascaded_shadow_map->visible_render_entities;
+			culling_jobs.push(cascade_culling_job);
+		}
+	}
+
+	Array<Job> jobs;
+	jobs.reserve(culling_jobs.count);
+	for (u32 i = 0; i < culling_jobs.count; i++) {
+		jobs[i].function = run_culling_job;
+		jobs[i].data = (void *)&culling_jobs[i];
+	}
+	Job_System *job_system = Engine::get_job_system();
+	Job_Counter counter;
+	job_system->run_jobs(jobs.items, jobs.count, &counter);
+	job_system->wait(&counter);
+
+	if (occlusion_culling) {
+		cull_occluded_render_entities();
+	}
+}
+
+static void test_render_entity_occlusion(u32 first, u32 last, void *data)
+{
+	Render_World *render_world = (Render_World *)data;
+	for (u32 i = first; i < last; i++) {
+		u32 index = render_world->visible_render_entities[i];
+		if (!render_world->render_entity_bounds.is_unbounded(index) && !render_world->occlusion_buffer.is_visible(render_world->render_entity_bounds.get(index))) {
+			render_world->render_entity_visibility[index] = 0;
+		}
+	}
+}
+
+// Occluders are picked from visible entities with simple meshes which cover enough of the screen,
+// then entities hidden behind them are removed from the visible list. Shadow cascades and the voxel grid are not affected.
+void Render_World::cull_occluded_render_entities()
+{
+	PROFILE_ZONE("Render_World::cull_occluded_render_entities");
+
+	occlusion_buffer.begin_frame(render_camera.view_matrix * render_sys->view.perspective_matrix);
+
+	u32 triangle_count = 0;
+	for (u32 i = 0; i < visible_render_entities.count; i++) {
+		u32 index = visible_render_entities[i];
+		Render_Entity *render_entity = &game_render_entities[index];
+		Model_Storage::Mesh_Instance *mesh_instance = &model_storage.mesh_instances[render_entity->mesh_id.instance_idx];
+		u32 mesh_triangle_count = mesh_instance->index_count / 3;
+		if ((mesh_triangle_count > OCCLUSION_MAX_OCCLUDER_TRIANGLE_COUNT) || ((triangle_count + mesh_triangle_count) > OCCLUSION_TRIANGLE_BUDGET)) {
+			continue;
+		}
+		if (render_entity_bounds.is_unbounded(index) || (occlusion_buffer.find_screen_area(render_entity_bounds.get(index)) < OCCLUSION_MIN_OCCLUDER_SCREEN_AREA)) {
+			continue;
+		}
+		Vertex_PNTUV *vertices = &model_storage.unified_vertices[mesh_instance->vertex_offset];
+		u32 *indices = &model_storage.unified_indices[mesh_instance->index_offset];
+		occlusion_buffer.add_occluder(vertices, mesh_instance->vertex_count, indices, mesh_instance->index_count, render_entity_world_matrices[render_entity->world_matrix_idx]);
+		triangle_count += mesh_triangle_count;
+	}
+	if (occlusion_buffer.occluder_count == 0) {
+		return;
+	}
+	Job_System *job_system = Engine::get_job_system();
+	occlusion_buffer.rasterize(job_system);
+	job_system->parallel_for(visible_render_entities.count, RENDER_ENTITIES_BATCH_SIZE, test_render_entity_occlusion, (void *)this);
+
+	u32 visible_count = 0;
+	for (u32 i = 0; i < visible_render_entities.count; i++) {
+		u32 index = visible_render_entities[i];
+		if (render_entity_visibility[index]) {
+			visible_render_entities[visible_count++] = index;
+		}
+	}
+	occlusion_buffer.occludee_count = visible_render_entities.count;
+	occlusion_buffer.occluded_count = visible_render_entities.count - visible_count;
+	visible_render_entities.count = visible_count;
+}
+
+static u32 hash_shadow_casters(Render_World *render_world, Array<u32> *render_entity_indices)
+{
+	u32 casters_hash = hash(render_entity_indices->count);
+	for (u32 i = 0; i < render_entity_indices->count; i++) {
+		Render_Entity *render_entity = &render_world->game_render_entities[render_entity_indices->get(i)];
+		Matrix4 *world_matrix = &render_world->render_entity_world_matrices[render_entity->world_matrix_idx];
+		casters_hash = hash(casters_hash ^ render_entity->mesh_id.instance_idx);
+		casters_hash = hash(casters_hash ^ fast_hash((void *)world_matrix, sizeof(Matrix4)));
+	}
+	return casters_hash;
+}
+
+static void update_light_cascades_caching(u32 first, u32 last, void *data)
+{
+	Render_World *render_world = (Render_World *)data;
+	for (u32 i = first; i < last; i++) {
+		Cascaded_Shadows *cascaded_shadows = &render_world->cascaded_shadows_list[i];
+		for (u32 j = 0; j < cascaded_shadows->cascaded_shadow_maps.count; j++) {
+			Cascaded_Shadow_Map *cascaded_shadow_map = &cascaded_shadows->cascaded_shadow_maps[j];
+			u32 casters_hash = hash_shadow_casters(render_world, &cascaded_shadow_map->visible_render_entities);
+			bool same_matrix = !memcmp((void *)&cascaded_shadow_map->view_projection_matrix, (void *)&cascaded_shadow_map->rendered_view_projection_matrix, sizeof(Matrix4));
+
+			cascaded_shadow_map->is_cached = render_world->cache_shadow_cascades && cascaded_shadow_map->is_rendered && same_matrix && (casters_hash == cascaded_shadow_map->casters_hash);
+			cascaded_shadow_map->casters_hash = casters_hash;
+			cascaded_shadow_map->rendered_view_projection_matrix = cascaded_shadow_map->view_projection_matrix;
+		}
+	}
+}
+
+void Render_World::update_shadow_cascades_caching()
+{
+	PROFILE_ZONE("Render_World::update_shadow_cascades_caching");
+
+	// Near cascades follow the camera texel by texel, so mostly far cascades stay cached.
+	Engine::get_job_system()->parallel_for(cascaded_shadows_list.count, 1, update_light_cascades_caching, (void *)this);
+}
+
+void Render_World::update_shadow_atlas_tiles()
+{
+	shadow_atlas_allocator.begin_frame();
+
+	// Tiles of active cascades are touched first, so they can't be evicted by tiles allocated after them.
+	for (u32 i = 0; i < cascaded_shadows_list.count; i++) {
+		for (u32 j = 0; j < cascaded_shadows_list[i].cascaded_shadow_maps.count; j++) {
+			Cascaded_Shadow_Map *cascaded_shadow_map = &cascaded_shadows_list[i].cascaded_shadow_maps[j];
+			cascaded_shadow_map->is_active = !cascaded_shadow_map->visible_render_entities.is_empty();
+			if (cascaded_shadow_map->is_active && shadow_atlas_allocator.is_allocated(&cascaded_shadow_map->atlas_tile)) {
+				shadow_atlas_allocator.touch(&cascaded_shadow_map->atlas_tile);
+			}
+		}
+	}
+
+	for (u32 i = 0; i < cascaded_shadows_list.count; i++) {
+		for (u32 j = 0; j < cascaded_shadows_list[i].cascaded_shadow_maps.count; j++) {
+			Cascaded_Shadow_Map *cascaded_shadow_map = &cascaded_shadows_list[i].cascaded_shadow_maps[j];
+			Shadow_Atlas_Tile *atlas_tile = &cascaded_shadow_map->atlas_tile;
+			if (cascaded_shadow_map->is_active && !shadow_atlas_allocator.is_allocated(atlas_tile)) {
+				// The tile was evicted or has never been allocated, a new tile has no depth to reuse.
+				cascaded_shadow_map->is_rendered = false;
+				cascaded_shadow_map->is_cached = false;
+				if (shadow_atlas_allocator.allocate(cascaded_shadow_map->atlas_tile_size, atlas_tile)) {
+					cascaded_shadow_map->viewport.x = atlas_tile->x;
+					cascaded_shadow_map->viewport.y = atlas_tile->y;
+					cascaded_shadow_map->viewport.width = atlas_tile->size;
+					cascaded_shadow_map->viewport.height = atlas_tile->size;
+				} else {
+					cascaded_shadow_map->is_active = false;
+				}
+			}
+
+			Vector4 *atlas_rect = &cascaded_shadow_atlas_rects[cascaded_shadow_map->view_projection_matrix_index];
+			if (cascaded_shadow_map->is_active) {
+				float atlas_texel_size = 1.0f / (float)SHADOW_ATLAS_SIZE;
+				*atlas_rect = Vector4((float)atlas_tile->x * atlas_texel_size, (float)atlas_tile->y * atlas_texel_size, (float)atlas_tile->size * atlas_texel_size, (float)atlas_tile->size * atlas_texel_size);
+			} else {
+				*atlas_rect = Vector4(0.0f, 0.0f, 0.0f, 0.0f);
+			}
+		}
+	}
+	cascaded_shadow_atlas_rects_sb.update(&cascaded_shadow_atlas_rects);
+}
+
+void Render_World::build_render_batches()
+{
+	PROFILE_ZONE("Render_World::build_render_batches");
+
+	render_batches.begin_frame();
+	render_batches.build(&visible_render_entities, &game_render_entities, &model_storage, true, &visible_render_batches);
+	render_batches.build(&voxel_grid_render_entities, &game_render_entities, &model_storage, true, &voxel_grid_render_batches);
+
+	// Depth rendering doesn't sample textures, so cascade batches are grouped only by meshes.
+	for (u32 i = 0; i < cascaded_shadows_list.count; i++) {
+		for (u32 j = 0; j < cascaded_shadows_list[i].cascaded_shadow_maps.count; j++) {
+			Cascaded_Shadow_Map *cascaded_shadow_map = &cascaded_shadows_list[i].cascaded_shadow_maps[j];
+			if (!cascaded_shadow_map->is_active || cascaded_shadow_map->is_cached) {
+				cascaded_shadow_map->render_batches.clear();
+				continue;
+			}
+			render_batches.build(&cascaded_shadow_map->visible_render_entities, &game_render_entities, &model_storage, false, &cascaded_shadow_map->render_batches);
+		}
+	}
+	render_batches.upload();
 }
 
 void Render_World::update_global_illumination()
@@ -543,6 +1075,22 @@ void Render_World::update_global_illumination()
 	back_to_front_voxel_view_matrix = make_look_to_matrix(back_to_front_view_position, Vector3::base_z);
 }
 
+// Lights and their cluster lists are uploaded once per frame, add_light and update_light only change shader_lights.
+void Render_World::update_light_clusters()
+{
+	light_clusters.update_bounds(render_sys->view.fov, render_sys->view.ratio, render_sys->view.near_plane, render_sys->view.far_plane);
+	light_clusters.assign_lights(&shader_lights, render_camera.view_matrix);
+
+	frame_info.cluster_depth_scale = light_clusters.get_depth_scale();
+	frame_info.cluster_depth_bias = light_clusters.get_depth_bias();
+	frame_info.cluster_tile_scale.x = (float)LIGHT_CLUSTER_X_COUNT / (float)Render_System::screen_width;
+	frame_info.cluster_tile_scale.y = (float)LIGHT_CLUSTER_Y_COUNT / (float)Render_System::screen_height;
+
+	lights_struct_buffer.update(&shader_lights);
+	light_clusters_sb.update(&light_clusters.clusters);
+	light_indices_sb.update(&light_clusters.light_indices);
+}
+
 void Render_World::add_light(Entity_Id light_id)
 {
 	Light *light = (Light *)game_world->get_entity(light_id);
@@ -567,7 +1115,6 @@ void Render_World::add_light(Entity_Id light_id)
 		hlsl_light.light_type = light->light_type;
 
 		shader_lights.push(hlsl_light);
-		lights_struct_buffer.update(&shader_lights);
 
 		light_info_list.push(light_info);
 	}
@@ -578,24 +1125,55 @@ void Render_World::add_render_entity(Entity_Id entity_id, Mesh_Id mesh_id, void
 	Render_Entity render_entity;
 	render_entity.entity_id = entity_id;
 	render_entity.mesh_id = mesh_id;
-	render_entity.world_matrix_idx = render_entity_world_matrices.push(Matrix4());
+	Entity *entity = game_world->get_entity(entity_id);
+	render_entity.world_matrix_idx = render_entity_world_matrices.push(entity ? get_world_matrix(entity) : Matrix4());
+	mark_world_matrix_dirty(render_entity.world_matrix_idx);
 
-	game_render_entities.push(render_entity);
+	render_entity_table.set(entity_id, game_render_entities.push(render_entity));
+}
+
+// The last render entity takes the place of the deleted one, so only its index is updated.
+bool Render_World::delete_render_entity(Entity_Id entity_id)
+{
+	u32 render_entity_index;
+	if (!render_entity_table.get(entity_id, &render_entity_index)) {
+		return false;
+	}
+	render_entity_table.remove(entity_id);
+	render_passes.outlining.delete_render_entity_index(render_entity_index);
+
+	u32 last_render_entity_index = game_render_entities.count - 1;
+	game_render_entities.swap_remove(render_entity_index);
+	if (render_entity_index < last_render_entity_index) {
+		render_entity_table.set(game_render_entities[render_entity_index].entity_id, render_entity_index);
+		render_passes.outlining.replace_render_entity_index(last_render_entity_index, render_entity_index);
+	}
+	return true;
 }
 
-u32 Render_World::delete_render_entity(Entity_Id entity_id)
+Render_Entity *Render_World::find_render_entity(Entity_Id entity_id, u32 *index)
 {
 	u32 render_entity_index;
-	find_render_entity(&game_render_entities, entity_id, &render_entity_index);
-	game_render_entities.remove(render_entity_index);
+	if (!render_entity_table.get(entity_id, &render_entity_index)) {
+		return NULL;
+	}
+	if (index) {
+		*index = render_entity_index;
+	}
+	return &game_render_entities[render_entity_index];
+}
 
-	for (u32 i = 0; i < game_render_entities.count; i++) {
-		Render_Entity *render_entity = &game_render_entities[i];
-		if (render_entity->entity_id.index > entity_id.index) {
-			render_entity->entity_id.index -= 1;
-		}
+// Directional lights shadow the whole visible scene, so they get the biggest tiles.
+static float get_shadow_importance(Light *light)
+{
+	switch (light->light_type) {
+		case DIRECTIONAL_LIGHT_TYPE:
+			return 1.0f;
+		case SPOT_LIGHT_TYPE:
+			return 0.5f;
+		default:
+			return 0.25f;
 	}
-	return render_entity_index;
 }
 
 bool Render_World::add_shadow(Light *light)
@@ -612,15 +1190,15 @@ bool Render_World::add_shadow(Light *light)
 	Cascaded_Shadows cascaded_shadows;
 	cascaded_shadows.light_direction = light->direction;
 
+	// Atlas tiles are allocated when cascades get casters.
+	u32 atlas_tile_size = shadow_atlas_allocator.get_tile_size(get_shadow_importance(light));
 	for (u32 i = 0; i < shadow_cascade_ranges.count; i++) {
 		Cascaded_Shadow_Map cascaded_shadow_map;
 		cascaded_shadow_map.view_projection_matrix_index = cascaded_view_projection_matrices.push(Matrix4());
+		cascaded_shadow_atlas_rects.push(Vector4(0.0f, 0.0f, 0.0f, 0.0f));
 		cascaded_shadow_map.init(render_sys->view.fov, render_sys->view.ratio, &shadow_cascade_ranges[i]);
+		cascaded_shadow_map.atlas_tile_size = atlas_tile_size;
 
-		if (!get_shadow_atls_viewport(&cascaded_shadow_map.viewport)) {
-			assert(false);
-			return false;
-		}
 		cascaded_shadows.cascaded_shadow_maps.push(cascaded_shadow_map);
 		cascaded_shadow_map_count++;
 	}
@@ -650,91 +1228,158 @@ void Render_World::update_light(Light *light)
 		hlsl_light->radius = light->radius;
 		hlsl_light->range = light->range;
 		hlsl_light->light_type = light->light_type;
-		lights_struct_buffer.update(&shader_lights);
 	} else {
 		print("Render_World::update_cascade_shadows: A cascade shadows was not found. Can not update The cascade shadows");
 	}
 }
 
-void Render_World::update_shadows()
+// Lists of the lights which were added after the deleted one are shifted, so their indices are updated.
+bool Render_World::delete_light(Entity_Id light_id)
 {
-	for (u32 i = 0; i < cascaded_shadows_list.count; i++) {
-		Vector3 light_direction = cascaded_shadows_list[i].light_direction;
+	Find_Result<Light_Info> result = find_in_array(light_info_list, light_id, find_cascade_shadows);
+	if (!result.found) {
+		return false;
+	}
+	Light_Info light_info = result.data;
+	light_info_list.remove(result.index);
+	frame_info.light_count--;
+
+	Cascaded_Shadows *cascaded_shadows = &cascaded_shadows_list[light_info.cascade_shadows_index];
+	u32 cascade_count = cascaded_shadows->cascaded_shadow_maps.count;
+	u32 first_matrix_index = (cascade_count > 0) ? cascaded_shadows->cascaded_shadow_maps[0].view_projection_matrix_index : 0;
+	for (u32 i = 0; i < cascade_count; i++) {
+		shadow_atlas_allocator.free(&cascaded_shadows->cascaded_shadow_maps[i].atlas_tile);
+		cascaded_view_projection_matrices.remove(first_matrix_index);
+		cascaded_shadow_atlas_rects.remove(first_matrix_index);
+	}
+	cascaded_shadow_map_count -= cascade_count;
 
+	cascaded_shadows_list.remove(light_info.cascade_shadows_index);
+	cascaded_shadows_info_list.remove(light_info.cascaded_shadows_info_index);
+	shader_lights.remove(light_info.hlsl_light_index);
+
+	for (u32 i = 0; i < cascaded_shadows_list.count; i++) {
 		for (u32 j = 0; j < cascaded_shadows_list[i].cascaded_shadow_maps.count; j++) {
 			Cascaded_Shadow_Map *cascaded_shadow_map = &cascaded_shadows_list[i].cascaded_shadow_maps[j];
+			if (cascaded_shadow_map->view_projection_matrix_index > first_matrix_index) {
+				cascaded_shadow_map->view_projection_matrix_index -= cascade_count;
+			}
+		}
+	}
+	for (u32 i = light_info.cascaded_shadows_info_index; i < cascaded_shadows_info_list.count; i++) {
+		cascaded_shadows_info_list[i].shadow_map_start_index -= cascade_count;
+		cascaded_shadows_info_list[i].shadow_map_end_index -= cascade_count;
+	}
+	cascaded_shadows_info_sb.update(&cascaded_shadows_info_list);
+
+	for (u32 i = 0; i < light_info_list.count; i++) {
+		Light_Info *other_light_info = &light_info_list[i];
+		if (other_light_info->cascade_shadows_index > light_info.cascade_shadows_index) {
+			other_light_info->cascade_shadows_index--;
+		}
+		if (other_light_info->cascaded_shadows_info_index > light_info.cascaded_shadows_info_index) {
+			other_light_info->cascaded_shadows_info_index--;
+		}
+		if (other_light_info->hlsl_light_index > light_info.hlsl_light_index) {
+			other_light_info->hlsl_light_index--;
+		}
+	}
+	return true;
+}
+
+static void update_light_cascades(u32 first, u32 last, void *data)
+{
+	Render_World *render_world = (Render_World *)data;
+	for (u32 i = first; i < last; i++) {
+		render_world->update_cascaded_shadows(&render_world->cascaded_shadows_list[i]);
+	}
+}
+
+void Render_World::update_shadows()
+{
+	PROFILE_ZONE("Render_World::update_shadows");
 
-			Vector3 view_position = cascaded_shadow_map->view_position * inverse(&render_camera.debug_view_matrix);
-			Vector3 temp_view_position = view_position;
+	// Lights write only to their own cascades and view projection matrices, the buffer is uploaded after the join.
+	Engine::get_job_system()->parallel_for(cascaded_shadows_list.count, 1, update_light_cascades, (void *)this);
 
-			//float w = cascaded_shadow->cascade_width / CASCADE_WIDTH;
-			//float h = cascaded_shadow->cascade_width / CASCADE_WIDTH;
-			//float d = cascaded_shadow->cascade_width / CASCADE_WIDTH;
+	cascaded_view_projection_matrices_sb.update(&cascaded_view_projection_matrices);
+}
 
-			//temp_view_position.x /= w;
-			//temp_view_position.x = std::floor(temp_view_position.x);
-			//temp_view_position.x *= w;
+void Render_World::update_cascaded_shadows(Cascaded_Shadows *cascaded_shadows)
+{
+	Vector3 light_direction = cascaded_shadows->light_direction;
 
-			//temp_view_position.y /= h;
-			//temp_view_position.y = std::floor(temp_view_position.y);
-			//temp_view_position.y *= h;
+	for (u32 j = 0; j < cascaded_shadows->cascaded_shadow_maps.count; j++) {
+		Cascaded_Shadow_Map *cascaded_shadow_map = &cascaded_shadows->cascaded_shadow_maps[j];
 
-			//temp_view_position.z /= d;
-			//temp_view_position.z = std::floor(temp_view_position.z);
-			//temp_view_position.z *= d;
+		Vector3 view_position = cascaded_shadow_map->view_position * inverse(&render_camera.debug_view_matrix);
+		Vector3 temp_view_position = view_position;
 
-			//Vector3 old_view_position = view_position;
+		//float w = cascaded_shadow->cascade_width / CASCADE_WIDTH;
+		//float h = cascaded_shadow->cascade_width / CASCADE_WIDTH;
+		//float d = cascaded_shadow->cascade_width / CASCADE_WIDTH;
 
-			float radius = cascaded_shadow_map->cascade_width / 2.0f;
-			//float texel_per_unit = CASCADE_WIDTH / (radius * 2.0f);
+		//temp_view_position.x /= w;
+		//temp_view_position.x = std::floor(temp_view_position.x);
+		//temp_view_position.x *= w;
 
-			//Matrix4 scalar = make_scale_matrix(texel_per_unit);
-			//Matrix4 look_at = make_look_at_matrix(Vector3::zero, negate(&cascaded_shadow->light_direction)) * scalar;
-			//Matrix4 inverse_look_at = inverse(&look_at);
+		//temp_view_position.y /= h;
+		//temp_view_position.y = std::floor(temp_view_position.y);
+		//temp_view_position.y *= h;
 
-			//view_position = view_position * look_at;
-			//view_position.x = std::floor(view_position.x);
-			//view_position.y = std::floor(view_position.y);
-			//view_position.z = std::floor(view_position.z);
-			//view_position = view_position * inverse_look_at;
+		//temp_view_position.z /= d;
+		//temp_view_position.z = std::floor(temp_view_position.z);
+		//temp_view_position.z *= d;
 
+		//Vector3 old_view_position = view_position;
 
-			Vector3 view_direction = view_position + light_direction;
-			Matrix4 light_view_matrix = make_look_at_matrix(view_position, view_direction);
+		float radius = cascaded_shadow_map->cascade_width / 2.0f;
+		//float texel_per_unit = CASCADE_WIDTH / (radius * 2.0f);
 
-			//auto r = cascaded_shadow->cascade_width / CASCADE_WIDTH;
-			//radius /= r;
-			//radius = std::floor(radius);
-			//radius *= r;
+		//Matrix4 scalar = make_scale_matrix(texel_per_unit);
+		//Matrix4 look_at = make_look_at_matrix(Vector3::zero, negate(&cascaded_shadow->light_direction)) * scalar;
+		//Matrix4 inverse_look_at = inverse(&look_at);
 
-			Matrix4 projection_matrix = XMMatrixOrthographicOffCenterLH(-radius, radius, -radius, radius, -5000.0f, 5000.0f);
+		//view_position = view_position * look_at;
+		//view_position.x = std::floor(view_position.x);
+		//view_position.y = std::floor(view_position.y);
+		//view_position.z = std::floor(view_position.z);
+		//view_position = view_position * inverse_look_at;
 
-			cascaded_shadow_map->view_projection_matrix = light_view_matrix * projection_matrix;
 
-			XMMATRIX shadowMatrix = XMLoadFloat4x4(&cascaded_shadow_map->view_projection_matrix);
-			XMVECTOR shadowOrigin = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
-			shadowOrigin = XMVector4Transform(shadowOrigin, shadowMatrix);
-			shadowOrigin = XMVectorScale(shadowOrigin, (float)CASCADE_SIZE / 2.0f);
+		Vector3 view_direction = view_position + light_direction;
+		Matrix4 light_view_matrix = make_look_at_matrix(view_position, view_direction);
 
-			XMVECTOR roundedOrigin = XMVectorRound(shadowOrigin);
-			XMVECTOR roundOffset = XMVectorSubtract(roundedOrigin, shadowOrigin);
-			roundOffset = XMVectorScale(roundOffset, 2.0f / (float)CASCADE_SIZE);
-			roundOffset = XMVectorSetZ(roundOffset, 0.0f);
-			roundOffset = XMVectorSetW(roundOffset, 0.0f);
+		//auto r = cascaded_shadow->cascade_width / CASCADE_WIDTH;
+		//radius /= r;
+		//radius = std::floor(radius);
+		//radius *= r;
 
-			Matrix4 matrix = cascaded_shadow_map->view_projection_matrix;
-			Vector4 vector = roundOffset;
-			vector.x += matrix.m[3][0];
-			vector.y += matrix.m[3][1];
-			vector.z += matrix.m[3][2];
-			vector.w += matrix.m[3][3];
-			matrix.set_row_3(vector);
-			cascaded_shadow_map->view_projection_matrix = matrix;
-			cascaded_view_projection_matrices[cascaded_shadow_map->view_projection_matrix_index] = matrix;
-		}
+		Matrix4 projection_matrix = XMMatrixOrthographicOffCenterLH(-radius, radius, -radius, radius, -5000.0f, 5000.0f);
+
+		cascaded_shadow_map->view_projection_matrix = light_view_matrix * projection_matrix;
+
+		XMMATRIX shadowMatrix = XMLoadFloat4x4(&cascaded_shadow_map->view_projection_matrix);
+		XMVECTOR shadowOrigin = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+		shadowOrigin = XMVector4Transform(shadowOrigin, shadowMatrix);
+		shadowOrigin = XMVectorScale(shadowOrigin, (float)cascaded_shadow_map->atlas_tile_size / 2.0f);
+
+		XMVECTOR roundedOrigin = XMVectorRound(shadowOrigin);
+		XMVECTOR roundOffset = XMVectorSubtract(roundedOrigin, shadowOrigin);
+		roundOffset = XMVectorScale(roundOffset, 2.0f / (float)cascaded_shadow_map->atlas_tile_size);
+		roundOffset = XMVectorSetZ(roundOffset, 0.0f);
+		roundOffset = XMVectorSetW(roundOffset, 0.0f);
+
+		Matrix4 matrix = cascaded_shadow_map->view_projection_matrix;
+		Vector4 vector = roundOffset;
+		vector.x += matrix.m[3][0];
+		vector.y += matrix.m[3][1];
+		vector.z += matrix.m[3][2];
+		vector.w += matrix.m[3][3];
+		matrix.set_row_3(vector);
+		cascaded_shadow_map->view_projection_matrix = matrix;
+		cascaded_view_projection_matrices[cascaded_shadow_map->view_projection_matrix_index] = matrix;
 	}
-	world_matrices_struct_buffer.update(&render_entity_world_matrices);
-	cascaded_view_projection_matrices_sb.update(&cascaded_view_projection_matrices);
 }
 
 void Render_World::set_camera_for_rendering(Entity_Id camera_id)
@@ -756,35 +1401,6 @@ void Render_World::set_camera_for_debuging(Entity_Id camera_info_id)
 	render_camera.camera_info_id = camera_info_id;
 }
 
-bool Render_World::get_shadow_atls_viewport(Viewport *viewport)
-{
-	static u32 x = 0;
-	static u32 y = 0;
-
-	Point_u32 shadow_map_position;
-	shadow_map_position.x = CASCADE_SIZE + x;
-	shadow_map_position.y = CASCADE_SIZE + y;
-
-	if ((shadow_map_position.x <= SHADOW_ATLAS_SIZE) && (shadow_map_position.y <= SHADOW_ATLAS_SIZE)) {
-		viewport->x = x;
-		viewport->y = y;
-		viewport->width = CASCADE_SIZE;
-		viewport->height = CASCADE_SIZE;
-		x += CASCADE_SIZE;
-	} else if ((shadow_map_position.x > SHADOW_ATLAS_SIZE) && (shadow_map_position.y < SHADOW_ATLAS_SIZE)) {
-		viewport->x = 0;
-		viewport->y = y;
-		viewport->width = CASCADE_SIZE;
-		viewport->height = CASCADE_SIZE;
-		x = 0;
-		y += CASCADE_SIZE;
-	} else {
-		print("Render_World::get_shadow_atls_view_port: The shadow atlas is out of space.");
-		return false;
-	}
-	return true;
-}
-
 Model_Storage *Render_World::get_model_storage()
 {
 	return &model_storage;
@@ -799,6 +1415,7 @@ void Render_World::render()
 
 	Render_Pass *render_pass = NULL;
 	For(frame_render_passes, render_pass) {
+		PROFILE_ZONE(render_pass->name.c_str());
 		render_pass->render(this, &render_sys->render_pipeline);
 	}
 }
@@ -3,10 +3,18 @@
 
 #include "hlsl.h"
 #include "mesh.h"
+#include "culling.h"
+#include "occlusion.h"
+#include "offset_allocator.h"
 #include "render_passes.h"
+#include "render_batches.h"
+#include "shadow_atlas.h"
+#include "transforms.h"
+#include "light_clusters.h"
 #include "render_system.h"
 #include "render_helpers.h"
 #include "../game/world.h"
+#include "../collision/bvh.h"
 #include "../libs/color.h"
 #include "../libs/number_types.h"
 #include "../libs/math/vector.h"
@@ -15,6 +23,7 @@
 #include "../libs/structures/array.h"
 
 struct Engine;
+struct Mesh_Cache;
 struct Render_Pass;
 typedef u32 Texture_Idx;
 typedef u32 Render_Entity_Idx;
@@ -22,6 +31,8 @@ typedef u32 Render_Entity_Idx;
 const u32 CASCADE_COUNT = 3;
 const u32 SHADOW_ATLAS_SIZE = 8192;
 const u32 CASCADE_SIZE = 1024;
+const u32 RENDER_ENTITIES_BATCH_SIZE = 256; // Render entities processed by one job.
+const u32 WORLD_MATRICES_CHUNK_SIZE = 64; // Changed world matrices are uploaded by chunks.
 
 const R24U8 DEFAULT_DEPTH_VALUE = R24U8(0xffffff, 0);
 
@@ -36,8 +47,12 @@ struct Render_Entity {
 	Entity_Id entity_id;
 };
 
+inline u32 hash(const Entity_Id &entity_id)
+{
+	return ::hash(((u64)entity_id.type << 32) | ((u64)entity_id.generation << ENTITY_INDEX_BITS) | (u64)entity_id.index);
+}
+
 Matrix4 get_world_matrix(Entity *entity);
-Render_Entity *find_render_entity(Array<Render_Entity> *render_entities, Entity_Id entity_id, u32 *index = NULL);
 
 struct Mesh_Textures {
 	Texture_Idx normal_idx;
@@ -72,6 +87,12 @@ struct Model_Storage {
 	Array<Mesh_Instance> mesh_instances;
 	Array<Mesh_Textures> meshes_textures;
 	Array<String> loaded_models_files;
+	Array<Mesh_BVH *> mesh_bvhs; // Indexed the same way as mesh_instances.
+	Array<u32> free_mesh_instances; // Instances of removed meshes, they are reused by new meshes.
+
+	// The counts of the unified arrays are equal to the capacities of the allocators.
+	Offset_Allocator vertex_allocator;
+	Offset_Allocator index_allocator;
 
 	Hash_Table<String_Id, Mesh_Id> mesh_table;
 	Hash_Table<String_Id, Texture_Idx> texture_table;
@@ -85,17 +106,28 @@ struct Model_Storage {
 
 	void add_models_file(const char *file_name);
 
-	void allocate_gpu_memory();
 	void reserve_memory_for_new_models(u32 mesh_count, u32 total_vertex_count, u32 total_index_count);
 	
 	void add_models(Array<Loading_Model *> &models, Array<Pair<Loading_Model *, Mesh_Id>> &result);
-
+	u32 add_models(Mesh_Cache *mesh_cache);
+	// Render entities which use the mesh have to be deleted before.
+	void remove_mesh(Mesh_Id mesh_id);
+	// Moves meshes to the start of the unified arrays, so all free space is in one range at the end.
+	void defragment();
+
+	// Vertices and indices of the instance have to be copied to the returned offsets of the unified arrays.
+	u32 allocate_mesh_instance(u32 vertex_count, u32 index_count);
+	void upload_mesh_instance(u32 instance_idx);
+	void build_mesh_bvh(u32 instance_idx);
 	bool add_texture(const char *texture_name, const char *full_path_to_texture_file, Texture_Idx *texture_idx);
 	bool update_mesh(Mesh_Id mesh_id, Triangle_Mesh *triangle_mesh);
 	Texture_Idx find_texture_or_get_default(String &texture_file_name, String &mesh_file_name, Texture_Idx default_texture);
 
 	Mesh_Textures *get_mesh_textures(u32 index);
 	Texture2D *get_texture(Texture_Idx texture_idx);
+	Mesh_BVH *get_mesh_bvh(u32 instance_idx);
+
+	void print_stats();
 };
 
 inline Mesh_Textures *Model_Storage::get_mesh_textures(u32 index)
@@ -108,6 +140,11 @@ inline Texture2D *Model_Storage::get_texture(Texture_Idx texture_idx)
 	return &textures[texture_idx];
 }
 
+inline Mesh_BVH *Model_Storage::get_mesh_bvh(u32 instance_idx)
+{
+	return (instance_idx < mesh_bvhs.count) ? mesh_bvhs[instance_idx] : NULL;
+}
+
 struct Shadow_Cascade_Range {
 	u32 start = 0;
 	u32 end = 0;
@@ -131,6 +168,19 @@ struct Cascaded_Shadow_Map {
 	Vector3 view_position;
 	Viewport viewport;
 	Matrix4 view_projection_matrix;
+	Array<u32> visible_render_entities;
+	Array<Render_Batch> render_batches;
+
+	// The cascade has casters and an atlas tile in the current frame, otherwise it doesn't shadow anything.
+	bool is_active = false;
+	u32 atlas_tile_size = CASCADE_SIZE;
+	Shadow_Atlas_Tile atlas_tile;
+
+	// The atlas region keeps the depth rendered in a previous frame while the snapped matrix and the casters are the same.
+	bool is_cached = false;
+	bool is_rendered = false;
+	u32 casters_hash = 0;
+	Matrix4 rendered_view_projection_matrix;
 
 	void init(float fov, float aspect_ratio, Shadow_Cascade_Range *shadow_cascade_range);
 };
@@ -189,6 +239,8 @@ struct Render_World {
 	Game_World *game_world = NULL;
 	Render_System *render_sys = NULL;
 
+	bool cache_shadow_cascades = true;
+	bool occlusion_culling = true;
 	u32 cascaded_shadow_map_count = 0;
 	u32 jittering_tile_size = 0;
 	u32 jittering_filter_size = 0;
@@ -208,31 +260,53 @@ struct Render_World {
 	Bounding_Sphere world_bounding_sphere;
 
 	Array<Matrix4> render_entity_world_matrices;
+	Array<u8> dirty_world_matrix_chunks;
+	Array<u32> transformed_render_entities;
+	Transforms transformed_render_entity_transforms;
+	Array<Matrix4> transformed_world_matrices;
 	Array<Matrix4> light_view_matrices; // is the code necessary ? 
 	Array<Matrix4> cascaded_view_projection_matrices;
+	Array<Vector4> cascaded_shadow_atlas_rects; // Offset and scale of cascade tiles in the atlas uv space, the scale is zero for inactive cascades.
 
 	Array<Render_Entity> game_render_entities;
+	Hash_Table<Entity_Id, u32> render_entity_table; // Indices of render entities in game_render_entities.
+
+	// Visibility of render entities for the current frame, the lists hold indices into game_render_entities.
+	Bounding_Boxes render_entity_bounds;
+	Array<u8> render_entity_visibility;
+	Occlusion_Buffer occlusion_buffer;
+	Array<u32> visible_render_entities;
+	Array<u32> voxel_grid_render_entities;
+
+	Render_Batches render_batches;
+	Array<Render_Batch> visible_render_batches;
+	Array<Render_Batch> voxel_grid_render_batches;
 
 	Array<Cascaded_Shadows> cascaded_shadows_list;
 	Array<Cascaded_Shadows_Info> cascaded_shadows_info_list;
 	Array<Shadow_Cascade_Range> shadow_cascade_ranges;
 	Array<Light_Info> light_info_list;
 	Array<Hlsl_Light> shader_lights;
+	Light_Clusters light_clusters;
 
 	Array<Render_Pass *> frame_render_passes;
 
 	Model_Storage model_storage;
 
 	Texture2D shadow_atlas;
+	Shadow_Atlas_Allocator shadow_atlas_allocator;
 	Texture3D jittering_samples;
 
 	Gpu_Buffer frame_info_cbuffer;
 
 	Gpu_RWStruct_Buffer voxels_sb;
 	Gpu_Struct_Buffer lights_struct_buffer;
+	Gpu_Struct_Buffer light_clusters_sb;
+	Gpu_Struct_Buffer light_indices_sb;
 	Gpu_Struct_Buffer cascaded_shadows_info_sb;
 	Gpu_Struct_Buffer world_matrices_struct_buffer;
 	Gpu_Struct_Buffer cascaded_view_projection_matrices_sb;
+	Gpu_Struct_Buffer cascaded_shadow_atlas_rects_sb;
 
 	struct Render_Passes {
 		Shadows_Pass shadows;
@@ -252,23 +326,32 @@ struct Render_World {
 
 	void update();
 	void update_shadows();
+	void update_cascaded_shadows(Cascaded_Shadows *cascaded_shadows);
 	void update_render_entities();
+	void mark_world_matrix_dirty(u32 world_matrix_idx);
+	void upload_world_matrices();
 	void update_global_illumination();
+	void update_light_clusters();
+	void cull_render_entities();
+	void cull_occluded_render_entities();
+	void build_render_batches();
+	void update_shadow_cascades_caching();
+	void update_shadow_atlas_tiles();
 
 	void add_render_entity(Entity_Id entity_id, Mesh_Id mesh_id, void *args = NULL);
 	bool add_shadow(Light *light);
 	void add_light(Entity_Id light_id);
 	void update_light(Light *light);
+	bool delete_light(Entity_Id light_id);
 
-	u32 delete_render_entity(Entity_Id entity_id);
+	bool delete_render_entity(Entity_Id entity_id);
+	Render_Entity *find_render_entity(Entity_Id entity_id, u32 *index = NULL);
 
 	void render();
 
 	void set_camera_for_rendering(Entity_Id camera_id);
 	void set_camera_for_debuging(Entity_Id camera_info_id);
 
-	bool get_shadow_atls_viewport(Viewport *viewport);
-
 	Vector3 get_light_position(Vector3 light_direction);
 
 	Model_Storage *get_model_storage();
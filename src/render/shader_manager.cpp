@@ -328,12 +328,14 @@ void Shader_Manager::init(Gpu_Device *_gpu_device)
 	gpu_device = _gpu_device;
 
 	u32 shader_count = 0;
+	shader_table[shader_count++] = { "clear_depth.hlsl", &shaders.clear_depth };
 	shader_table[shader_count++] = { "debug_cascaded_shadows.hlsl", &shaders.debug_cascaded_shadows };
 	shader_table[shader_count++] = { "depth_map.hlsl", &shaders.depth_map };
 	shader_table[shader_count++] = { "draw_vertices.hlsl", &shaders.draw_vertices };
 	shader_table[shader_count++] = { "forward_light.hlsl", &shaders.forward_light };
 	shader_table[shader_count++] = { "outlining.hlsl", &shaders.outlining };
 	shader_table[shader_count++] = { "render_2d.hlsl", &shaders.render_2d };
+	shader_table[shader_count++] = { "render_2d_text.hlsl", &shaders.render_2d_text };
 	shader_table[shader_count++] = { "silhouette.hlsl", &shaders.silhouette };
 	shader_table[shader_count++] = { "voxelization.hlsl", &shaders.voxelization };
 
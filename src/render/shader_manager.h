@@ -47,12 +47,14 @@ struct Shader_Manager {
 	~Shader_Manager();
 
 	struct Shader_List {
+		Extend_Shader clear_depth;
 		Extend_Shader debug_cascaded_shadows;
 		Extend_Shader depth_map;
 		Extend_Shader draw_vertices;
 		Extend_Shader forward_light;
 		Extend_Shader outlining;
 		Extend_Shader render_2d;
+		Extend_Shader render_2d_text;
 		Extend_Shader silhouette;
 		Extend_Shader voxelization;
 	} shaders;
@@ -0,0 +1,241 @@
+#include <assert.h>
+
+#include "shadow_atlas.h"
+#include "../sys/sys.h"
+#include "../libs/math/functions.h"
+
+inline bool is_power_of_two(u32 value)
+{
+	return value && !(value & (value - 1));
+}
+
+inline u32 round_up_to_power_of_two(u32 value)
+{
+	u32 result = 1;
+	while (result < value) {
+		result <<= 1;
+	}
+	return result;
+}
+
+void Shadow_Atlas_Allocator::init(u32 _atlas_size, u32 _min_tile_size, u32 _max_tile_size)
+{
+	assert(is_power_of_two(_atlas_size));
+	assert(is_power_of_two(_min_tile_size));
+	assert(is_power_of_two(_max_tile_size));
+	assert(_min_tile_size <= _max_tile_size);
+	assert(_max_tile_size <= _atlas_size);
+
+	atlas_size = _atlas_size;
+	min_tile_size = _min_tile_size;
+	max_tile_size = _max_tile_size;
+	reset();
+}
+
+void Shadow_Atlas_Allocator::reset()
+{
+	nodes.clear();
+	unlinked_child_groups.clear();
+	used_tile_count = 0;
+	evicted_tile_count = 0;
+	used_area = 0;
+
+	Node root;
+	root.size = atlas_size;
+	nodes.push(root);
+}
+
+void Shadow_Atlas_Allocator::begin_frame()
+{
+	frame_index++;
+}
+
+u32 Shadow_Atlas_Allocator::get_tile_size(float importance)
+{
+	u32 level_count = 0;
+	for (u32 size = max_tile_size; size > min_tile_size; size >>= 1) {
+		level_count++;
+	}
+	u32 level = (u32)((1.0f - math::clamp(importance, 0.0f, 1.0f)) * (float)level_count + 0.5f);
+	return max_tile_size >> level;
+}
+
+// The smallest free node fitting the tile is taken, so big free nodes are split only if there is nothing else.
+u32 Shadow_Atlas_Allocator::find_free_node(u32 tile_size)
+{
+	u32 found_node_index = SHADOW_ATLAS_NO_NODE;
+	for (u32 i = 0; i < nodes.count; i++) {
+		Node *node = &nodes[i];
+		if ((node->state != SHADOW_ATLAS_NODE_FREE) || (node->size < tile_size)) {
+			continue;
+		}
+		if ((found_node_index == SHADOW_ATLAS_NO_NODE) || (node->size < nodes[found_node_index].size)) {
+			found_node_index = i;
+			if (node->size == tile_size) {
+				break;
+			}
+		}
+	}
+	return found_node_index;
+}
+
+u32 Shadow_Atlas_Allocator::split_node(u32 node_index)
+{
+	assert(nodes[node_index].state == SHADOW_ATLAS_NODE_FREE);
+
+	u32 first_child = 0;
+	if (!unlinked_child_groups.is_empty()) {
+		first_child = unlinked_child_groups.pop();
+	} else {
+		first_child = nodes.count;
+		for (u32 i = 0; i < 4; i++) {
+			nodes.push(Node());
+		}
+	}
+	// The node may be moved by push.
+	Node *node = &nodes[node_index];
+	u32 child_size = node->size / 2;
+	for (u32 i = 0; i < 4; i++) {
+		Node *child = &nodes[first_child + i];
+		child->x = node->x + (i % 2) * child_size;
+		child->y = node->y + (i / 2) * child_size;
+		child->size = child_size;
+		child->parent = node_index;
+		child->first_child = SHADOW_ATLAS_NO_NODE;
+		child->state = SHADOW_ATLAS_NODE_FREE;
+	}
+	node->first_child = first_child;
+	node->state = SHADOW_ATLAS_NODE_SPLIT;
+	return first_child;
+}
+
+void Shadow_Atlas_Allocator::free_node(u32 node_index)
+{
+	Node *node = &nodes[node_index];
+	assert(node->state == SHADOW_ATLAS_NODE_USED);
+
+	node->state = SHADOW_ATLAS_NODE_FREE;
+	node->generation++;
+	used_tile_count--;
+	used_area -= (u64)node->size * (u64)node->size;
+
+	// Four free siblings are merged back into their parent.
+	u32 parent_index = node->parent;
+	while (parent_index != SHADOW_ATLAS_NO_NODE) {
+		Node *parent = &nodes[parent_index];
+		for (u32 i = 0; i < 4; i++) {
+			if (nodes[parent->first_child + i].state != SHADOW_ATLAS_NODE_FREE) {
+				return;
+			}
+		}
+		for (u32 i = 0; i < 4; i++) {
+			nodes[parent->first_child + i].state = SHADOW_ATLAS_NODE_UNLINKED;
+			nodes[parent->first_child + i].generation++;
+		}
+		unlinked_child_groups.push(parent->first_child);
+		parent->first_child = SHADOW_ATLAS_NO_NODE;
+		parent->state = SHADOW_ATLAS_NODE_FREE;
+		parent_index = parent->parent;
+	}
+}
+
+bool Shadow_Atlas_Allocator::allocate(u32 tile_size, Shadow_Atlas_Tile *tile, bool evict_tiles)
+{
+	assert(tile);
+	assert(atlas_size > 0);
+
+	tile_size = math::clamp(round_up_to_power_of_two(tile_size), min_tile_size, max_tile_size);
+
+	u32 node_index = find_free_node(tile_size);
+	while ((node_index == SHADOW_ATLAS_NO_NODE) && evict_tiles) {
+		u32 lru_node_index = SHADOW_ATLAS_NO_NODE;
+		for (u32 i = 0; i < nodes.count; i++) {
+			Node *node = &nodes[i];
+			if ((node->state == SHADOW_ATLAS_NODE_USED) && (node->last_used_frame != frame_index)) {
+				if ((lru_node_index == SHADOW_ATLAS_NO_NODE) || (node->last_used_frame < nodes[lru_node_index].last_used_frame)) {
+					lru_node_index = i;
+				}
+			}
+		}
+		if (lru_node_index == SHADOW_ATLAS_NO_NODE) {
+			break;
+		}
+		free_node(lru_node_index);
+		evicted_tile_count++;
+		node_index = find_free_node(tile_size);
+	}
+	if (node_index == SHADOW_ATLAS_NO_NODE) {
+		return false;
+	}
+
+	while (nodes[node_index].size > tile_size) {
+		node_index = split_node(node_index);
+	}
+	Node *node = &nodes[node_index];
+	node->state = SHADOW_ATLAS_NODE_USED;
+	node->last_used_frame = frame_index;
+	used_tile_count++;
+	used_area += (u64)node->size * (u64)node->size;
+
+	tile->node_index = node_index;
+	tile->generation = node->generation;
+	tile->x = node->x;
+	tile->y = node->y;
+	tile->size = node->size;
+	return true;
+}
+
+void Shadow_Atlas_Allocator::free(Shadow_Atlas_Tile *tile)
+{
+	assert(tile);
+
+	if (is_allocated(tile)) {
+		free_node(tile->node_index);
+	}
+	tile->node_index = SHADOW_ATLAS_NO_NODE;
+}
+
+void Shadow_Atlas_Allocator::touch(Shadow_Atlas_Tile *tile)
+{
+	assert(is_allocated(tile));
+	nodes[tile->node_index].last_used_frame = frame_index;
+}
+
+bool Shadow_Atlas_Allocator::is_allocated(Shadow_Atlas_Tile *tile)
+{
+	assert(tile);
+
+	if (tile->node_index >= nodes.count) {
+		return false;
+	}
+	Node *node = &nodes[tile->node_index];
+	return (node->state == SHADOW_ATLAS_NODE_USED) && (node->generation == tile->generation);
+}
+
+u32 Shadow_Atlas_Allocator::get_largest_free_tile_size()
+{
+	u32 largest_size = 0;
+	for (u32 i = 0; i < nodes.count; i++) {
+		if (nodes[i].state == SHADOW_ATLAS_NODE_FREE) {
+			largest_size = math::max(largest_size, nodes[i].size);
+		}
+	}
+	return largest_size;
+}
+
+float Shadow_Atlas_Allocator::get_fragmentation()
+{
+	u64 free_area = (u64)atlas_size * (u64)atlas_size - used_area;
+	u32 largest_free_tile_size = get_largest_free_tile_size();
+	return (free_area > 0) ? 1.0f - (float)((u64)largest_free_tile_size * (u64)largest_free_tile_size) / (float)free_area : 0.0f;
+}
+
+void Shadow_Atlas_Allocator::print_stats()
+{
+	u64 atlas_area = (u64)atlas_size * (u64)atlas_size;
+	u32 largest_free_tile_size = get_largest_free_tile_size();
+	float fragmentation = get_fragmentation();
+
+	print("Shadow_Atlas_Allocator: {} tiles use {}% of the atlas, {} tiles were evicted.", used_tile_count, (float)used_area * 100.0f / (float)atlas_area, evicted_tile_count);
+	print("Shadow_Atlas_Allocator: The largest free tile is {}, fragmentation of the free area is {}.", largest_free_tile_size, fragmentation);
+}
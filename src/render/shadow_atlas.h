@@ -0,0 +1,75 @@
+#ifndef SHADOW_ATLAS_H
+#define SHADOW_ATLAS_H
+
+#include <stdint.h>
+
+#include "../libs/number_types.h"
+#include "../libs/structures/array.h"
+
+const u32 SHADOW_ATLAS_MIN_TILE_SIZE = 128;
+const u32 SHADOW_ATLAS_NO_NODE = UINT32_MAX;
+
+// A tile becomes invalid when it is freed or evicted, the owner has to allocate a new one then.
+struct Shadow_Atlas_Tile {
+	u32 node_index = SHADOW_ATLAS_NO_NODE;
+	u32 generation = 0;
+	u32 x = 0;
+	u32 y = 0;
+	u32 size = 0;
+};
+
+enum Shadow_Atlas_Node_State : u32 {
+	SHADOW_ATLAS_NODE_FREE,
+	SHADOW_ATLAS_NODE_SPLIT,
+	SHADOW_ATLAS_NODE_USED,
+	SHADOW_ATLAS_NODE_UNLINKED // The node belongs to a released group of children.
+};
+
+// A quadtree allocator of square power of two tiles. A freed tile is merged with its siblings if all of them are free.
+// If a tile doesn't fit the least recently used tiles, which were not used in the current frame, are evicted.
+struct Shadow_Atlas_Allocator {
+	struct Node {
+		u32 x = 0;
+		u32 y = 0;
+		u32 size = 0;
+		u32 parent = SHADOW_ATLAS_NO_NODE;
+		u32 first_child = SHADOW_ATLAS_NO_NODE; // Children are stored in groups of four.
+		u32 generation = 0;
+		u32 last_used_frame = 0;
+		Shadow_Atlas_Node_State state = SHADOW_ATLAS_NODE_FREE;
+	};
+
+	u32 atlas_size = 0;
+	u32 min_tile_size = 0;
+	u32 max_tile_size = 0;
+	u32 frame_index = 0;
+	u32 used_tile_count = 0;
+	u32 evicted_tile_count = 0;
+	u64 used_area = 0;
+
+	Array<Node> nodes;
+	Array<u32> unlinked_child_groups;
+
+	void init(u32 _atlas_size, u32 _min_tile_size, u32 _max_tile_size);
+	void reset();
+	void begin_frame();
+
+	// Importance is in [0, 1], the most important tiles get max_tile_size.
+	u32 get_tile_size(float importance);
+
+	bool allocate(u32 tile_size, Shadow_Atlas_Tile *tile, bool evict_tiles = true);
+	void free(Shadow_Atlas_Tile *tile);
+	void touch(Shadow_Atlas_Tile *tile);
+	bool is_allocated(Shadow_Atlas_Tile *tile);
+
+	u32 get_largest_free_tile_size();
+	// The part of the free area which is not in the largest free tile.
+	float get_fragmentation();
+	void print_stats();
+
+	u32 find_free_node(u32 tile_size);
+	u32 split_node(u32 node_index);
+	void free_node(u32 node_index);
+};
+
+#endif
@@ -0,0 +1,226 @@
+#include <assert.h>
+#include <math.h>
+
+#include "transforms.h"
+#include "../libs/math/functions.h"
+
+// The macros are defined in transforms.h.
+#ifdef TRANSFORMS_USE_SSE
+#include <emmintrin.h>
+#endif
+#ifdef TRANSFORMS_USE_AVX2
+#include <immintrin.h>
+#endif
+
+const float TWO_PI = 6.283185307f;
+const float ONE_DIV_TWO_PI = 0.159154943f;
+const float HALF_PI = 1.570796327f;
+
+void Transforms::resize(u32 transform_count)
+{
+	if (transform_count > capacity) {
+		u32 new_capacity = math::max(transform_count, capacity * 2);
+		scaling_x.resize(new_capacity);
+		scaling_y.resize(new_capacity);
+		scaling_z.resize(new_capacity);
+		rotation_x.resize(new_capacity);
+		rotation_y.resize(new_capacity);
+		rotation_z.resize(new_capacity);
+		position_x.resize(new_capacity);
+		position_y.resize(new_capacity);
+		position_z.resize(new_capacity);
+		capacity = new_capacity;
+	}
+	count = transform_count;
+}
+
+void Transforms::set(u32 index, const Vector3 &scaling, const Vector3 &rotation, const Vector3 &position)
+{
+	assert(index < count);
+
+	scaling_x[index] = scaling.x;
+	scaling_y[index] = scaling.y;
+	scaling_z[index] = scaling.z;
+	rotation_x[index] = rotation.x;
+	rotation_y[index] = rotation.y;
+	rotation_z[index] = rotation.z;
+	position_x[index] = position.x;
+	position_y[index] = position.y;
+	position_z[index] = position.z;
+}
+
+// The kernel is written once and instanced for lanes of 1, 4 and 8 floats.
+struct Scalar_Lanes {
+	typedef float Value;
+	typedef bool Mask;
+
+	static const u32 WIDTH = 1;
+
+	static Value load(const float *data) { return *data; }
+	static Value set(float value) { return value; }
+	static Value add(Value a, Value b) { return a + b; }
+	static Value sub(Value a, Value b) { return a - b; }
+	static Value mul(Value a, Value b) { return a * b; }
+	static Value round(Value a) { return nearbyintf(a); }
+	static Mask greater(Value a, Value b) { return a > b; }
+	static Mask less(Value a, Value b) { return a < b; }
+	static Mask mask_or(Mask a, Mask b) { return a || b; }
+	static Value select(Mask mask, Value a, Value b) { return mask ? a : b; }
+
+	static void store_row(Matrix4 *matrices, u32 row, Value x, Value y, Value z, Value w)
+	{
+		matrices->m[row][0] = x;
+		matrices->m[row][1] = y;
+		matrices->m[row][2] = z;
+		matrices->m[row][3] = w;
+	}
+};
+
+#ifdef TRANSFORMS_USE_SSE
+struct Sse_Lanes {
+	typedef __m128 Value;
+	typedef __m128 Mask;
+
+	static const u32 WIDTH = 4;
+
+	static Value load(const float *data) { return _mm_loadu_ps(data); }
+	static Value set(float value) { return _mm_set1_ps(value); }
+	static Value add(Value a, Value b) { return _mm_add_ps(a, b); }
+	static Value sub(Value a, Value b) { return _mm_sub_ps(a, b); }
+	static Value mul(Value a, Value b) { return _mm_mul_ps(a, b); }
+	static Value round(Value a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a)); }
+	static Mask greater(Value a, Value b) { return _mm_cmpgt_ps(a, b); }
+	static Mask less(Value a, Value b) { return _mm_cmplt_ps(a, b); }
+	static Mask mask_or(Mask a, Mask b) { return _mm_or_ps(a, b); }
+	static Value select(Mask mask, Value a, Value b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+
+	// Lanes hold one component of four matrices, the transpose turns them into rows of the matrices.
+	static void store_row(Matrix4 *matrices, u32 row, Value x, Value y, Value z, Value w)
+	{
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+		_mm_storeu_ps(&matrices[0].m[row][0], x);
+		_mm_storeu_ps(&matrices[1].m[row][0], y);
+		_mm_storeu_ps(&matrices[2].m[row][0], z);
+		_mm_storeu_ps(&matrices[3].m[row][0], w);
+	}
+};
+#endif
+
+#ifdef TRANSFORMS_USE_AVX2
+struct Avx_Lanes {
+	typedef __m256 Value;
+	typedef __m256 Mask;
+
+	static const u32 WIDTH = 8;
+
+	static Value load(const float *data) { return _mm256_loadu_ps(data); }
+	static Value set(float value) { return _mm256_set1_ps(value); }
+	static Value add(Value a, Value b) { return _mm256_add_ps(a, b); }
+	static Value sub(Value a, Value b) { return _mm256_sub_ps(a, b); }
+	static Value mul(Value a, Value b) { return _mm256_mul_ps(a, b); }
+	static Value round(Value a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+	static Mask greater(Value a, Value b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+	static Mask less(Value a, Value b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	static Mask mask_or(Mask a, Mask b) { return _mm256_or_ps(a, b); }
+	static Value select(Mask mask, Value a, Value b) { return _mm256_blendv_ps(b, a, mask); }
+
+	static void store_row(Matrix4 *matrices, u32 row, Value x, Value y, Value z, Value w)
+	{
+		Sse_Lanes::store_row(matrices, row, _mm256_castps256_ps128(x), _mm256_castps256_ps128(y), _mm256_castps256_ps128(z), _mm256_castps256_ps128(w));
+		Sse_Lanes::store_row(matrices + 4, row, _mm256_extractf128_ps(x, 1), _mm256_extractf128_ps(y, 1), _mm256_extractf128_ps(z, 1), _mm256_extractf128_ps(w, 1));
+	}
+};
+#endif
+
+// The same minimax polynomials as XMVectorSinCos, so results are close to the DirectXMath path.
+template <typename L>
+inline void sin_cos(typename L::Value angle, typename L::Value *sin, typename L::Value *cos)
+{
+	typedef typename L::Value Value;
+
+	// The angle is moved to [-pi, pi] and then mirrored to [-pi/2, pi/2], the mirroring changes the sign of cos.
+	Value x = L::sub(angle, L::mul(L::set(TWO_PI), L::round(L::mul(angle, L::set(ONE_DIV_TWO_PI)))));
+	typename L::Mask above = L::greater(x, L::set(HALF_PI));
+	typename L::Mask below = L::less(x, L::set(-HALF_PI));
+	x = L::select(above, L::sub(L::set(PI), x), x);
+	x = L::select(below, L::sub(L::set(-PI), x), x);
+	Value sign = L::select(L::mask_or(above, below), L::set(-1.0f), L::set(1.0f));
+
+	Value x2 = L::mul(x, x);
+
+	Value s = L::add(L::mul(L::set(-2.3889859e-08f), x2), L::set(2.7525562e-06f));
+	s = L::add(L::mul(s, x2), L::set(-0.00019840874f));
+	s = L::add(L::mul(s, x2), L::set(0.0083333310f));
+	s = L::add(L::mul(s, x2), L::set(-0.16666667f));
+	s = L::add(L::mul(s, x2), L::set(1.0f));
+	*sin = L::mul(s, x);
+
+	Value c = L::add(L::mul(L::set(-2.6051615e-07f), x2), L::set(2.4760495e-05f));
+	c = L::add(L::mul(c, x2), L::set(-0.0013888378f));
+	c = L::add(L::mul(c, x2), L::set(0.041666638f));
+	c = L::add(L::mul(c, x2), L::set(-0.5f));
+	c = L::add(L::mul(c, x2), L::set(1.0f));
+	*cos = L::mul(c, sign);
+}
+
+// Rows of the rotation are the rows of XMMatrixRotationRollPitchYaw(rotation.x, rotation.y, rotation.z) scaled by the scaling
+// of their axis, the translation is the last row. It is scaling * rotation * translation without matrix multiplications.
+template <typename L>
+inline void build_world_matrices(Transforms *transforms, u32 index, Matrix4 *world_matrices)
+{
+	typedef typename L::Value Value;
+
+	Value sin_pitch, cos_pitch, sin_yaw, cos_yaw, sin_roll, cos_roll;
+	sin_cos<L>(L::load(&transforms->rotation_x[index]), &sin_pitch, &cos_pitch);
+	sin_cos<L>(L::load(&transforms->rotation_y[index]), &sin_yaw, &cos_yaw);
+	sin_cos<L>(L::load(&transforms->rotation_z[index]), &sin_roll, &cos_roll);
+
+	Value scaling_x = L::load(&transforms->scaling_x[index]);
+	Value scaling_y = L::load(&transforms->scaling_y[index]);
+	Value scaling_z = L::load(&transforms->scaling_z[index]);
+
+	Value sin_roll_sin_pitch = L::mul(sin_roll, sin_pitch);
+	Value cos_roll_sin_pitch = L::mul(cos_roll, sin_pitch);
+
+	Value m00 = L::mul(scaling_x, L::add(L::mul(cos_roll, cos_yaw), L::mul(sin_roll_sin_pitch, sin_yaw)));
+	Value m01 = L::mul(scaling_x, L::mul(sin_roll, cos_pitch));
+	Value m02 = L::mul(scaling_x, L::sub(L::mul(sin_roll_sin_pitch, cos_yaw), L::mul(cos_roll, sin_yaw)));
+
+	Value m10 = L::mul(scaling_y, L::sub(L::mul(cos_roll_sin_pitch, sin_yaw), L::mul(sin_roll, cos_yaw)));
+	Value m11 = L::mul(scaling_y, L::mul(cos_roll, cos_pitch));
+	Value m12 = L::mul(scaling_y, L::add(L::mul(sin_roll, sin_yaw), L::mul(cos_roll_sin_pitch, cos_yaw)));
+
+	Value m20 = L::mul(scaling_z, L::mul(cos_pitch, sin_yaw));
+	Value m21 = L::sub(L::set(0.0f), L::mul(scaling_z, sin_pitch));
+	Value m22 = L::mul(scaling_z, L::mul(cos_pitch, cos_yaw));
+
+	Value zero = L::set(0.0f);
+	Matrix4 *matrices = &world_matrices[index];
+	L::store_row(matrices, 0, m00, m01, m02, zero);
+	L::store_row(matrices, 1, m10, m11, m12, zero);
+	L::store_row(matrices, 2, m20, m21, m22, zero);
+	L::store_row(matrices, 3, L::load(&transforms->position_x[index]), L::load(&transforms->position_y[index]), L::load(&transforms->position_z[index]), L::set(1.0f));
+}
+
+void build_world_matrices(Transforms *transforms, u32 first, u32 last, Matrix4 *world_matrices)
+{
+	assert(transforms);
+	assert(world_matrices);
+	assert(first <= last);
+	assert(last <= transforms->count);
+
+	u32 index = first;
+#if defined(TRANSFORMS_USE_AVX2)
+	for (; (index + Avx_Lanes::WIDTH) <= last; index += Avx_Lanes::WIDTH) {
+		build_world_matrices<Avx_Lanes>(transforms, index, world_matrices);
+	}
+#endif
+#if defined(TRANSFORMS_USE_SSE)
+	for (; (index + Sse_Lanes::WIDTH) <= last; index += Sse_Lanes::WIDTH) {
+		build_world_matrices<Sse_Lanes>(transforms, index, world_matrices);
+	}
+#endif
+	for (; index < last; index++) {
+		build_world_matrices<Scalar_Lanes>(transforms, index, world_matrices);
+	}
+}
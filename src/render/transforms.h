@@ -0,0 +1,50 @@
+#ifndef TRANSFORMS_H
+#define TRANSFORMS_H
+
+#include "../libs/number_types.h"
+#include "../libs/math/vector.h"
+#include "../libs/math/matrix.h"
+#include "../libs/structures/array.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define TRANSFORMS_USE_SSE
+#endif
+
+// AVX2 is used only if the compiler is allowed to generate it (/arch:AVX2), there is no runtime dispatch.
+#if defined(__AVX2__)
+#define TRANSFORMS_USE_AVX2
+#endif
+
+#if defined(TRANSFORMS_USE_AVX2)
+const u32 TRANSFORMS_BATCH_SIZE = 8;
+#elif defined(TRANSFORMS_USE_SSE)
+const u32 TRANSFORMS_BATCH_SIZE = 4;
+#else
+const u32 TRANSFORMS_BATCH_SIZE = 1;
+#endif
+
+// Transforms are kept in SoA layout, so one SIMD batch builds TRANSFORMS_BATCH_SIZE world matrices.
+// Rotations are Euler angles in radians like Entity::rotation.
+struct Transforms {
+	u32 count = 0;
+	u32 capacity = 0;
+
+	Array<float> scaling_x;
+	Array<float> scaling_y;
+	Array<float> scaling_z;
+	Array<float> rotation_x;
+	Array<float> rotation_y;
+	Array<float> rotation_z;
+	Array<float> position_x;
+	Array<float> position_y;
+	Array<float> position_z;
+
+	void resize(u32 transform_count);
+	void set(u32 index, const Vector3 &scaling, const Vector3 &rotation, const Vector3 &position);
+};
+
+// Writes scaling * rotation * translation matrices of transforms in [first, last) to the same indices of world_matrices.
+// The matrices are equal to the ones built by get_world_matrix up to the precision of sin and cos.
+void build_world_matrices(Transforms *transforms, u32 first, u32 last, Matrix4 *world_matrices);
+
+#endif
@@ -19,6 +19,15 @@ struct Vertex_X2UV {
 	Vector2 uv;
 };
 
+struct Vertex_X2UVC {
+	Vertex_X2UVC() {}
+	Vertex_X2UVC(const Vector2 &position, const Vector2 &uv, const Vector4 &color) : position(position), uv(uv), color(color) {}
+
+	Vector2 position;
+	Vector2 uv;
+	Vector4 color;
+};
+
 struct Vertex_PNTUV {
 	Vertex_PNTUV() {}
 	Vertex_PNTUV(Vector3 position, Vector3 normal, Vector3 tangent, Vector2 uv) : position(position), normal(normal), tangent(tangent), uv(uv) {}
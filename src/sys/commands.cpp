@@ -14,8 +14,14 @@
 #include "../libs/str.h"
 #include "../libs/os/path.h"
 #include "../libs/os/file.h"
+#include "../libs/mesh_cache.h"
 #include "../libs/mesh_loader.h"
+#include "../libs/math/functions.h"
+#include "../render/transforms.h"
+#include "../render/occlusion.h"
+#include "../render/light_clusters.h"
 #include "../render/render_world.h"
+#include "../win32/win_time.h"
 #include "../collision/collision.h"
 
 static void load_meshes(Array<String> &mesh_names)
@@ -32,7 +38,7 @@ static void load_meshes(Array<String> &mesh_names)
 	models_loading->attach("use_scaling_value", &loading_options.use_scaling_value);
 
 	for (u32 i = 0; i < mesh_names.count; i++) {
-		begin_time_stamp();
+		s64 time_stamp = begin_time_stamp();
 
 		String full_path_to_mesh;
 		build_full_path_to_model_file(mesh_names[i], full_path_to_mesh);
@@ -65,9 +71,10 @@ static void load_meshes(Array<String> &mesh_names)
 					render_world->add_render_entity(entity_id, mesh_id);
 				}
 			}
+			cook_models(full_path_to_mesh, loaded_models, &loading_options);
 			free_memory(&loaded_models);
 			
-			print("load_meshes: {} was loaded in game and render world for {}ms", mesh_names[i].c_str(), delta_time_in_milliseconds());
+			print("load_meshes: {} was loaded in game and render world for {}ms", mesh_names[i].c_str(), delta_time_in_milliseconds(time_stamp));
 		}
 	}
 }
@@ -121,6 +128,398 @@ static void create_level(Array<String> &command_args)
 	}
 }
 
+static void print_render_stats(Array<String> &command_args)
+{
+	// Commands are run before a new frame is begun, so the log still holds the last rendered frame.
+	Render_Command_Log *command_log = &Engine::get_render_system()->command_log;
+	command_log->print_frame_stats();
+	command_log->compare_with_previous_frame();
+	if (command_log->record_commands) {
+		command_log->print_commands();
+	}
+}
+
+static void print_shadow_atlas_stats(Array<String> &command_args)
+{
+	Engine::get_render_world()->shadow_atlas_allocator.print_stats();
+}
+
+// Live tiles are marked on a grid of the min tile size, a cell marked twice means that tiles overlap.
+// Tiles evicted by the allocator are dropped from the list.
+static bool check_shadow_atlas_tiles(Shadow_Atlas_Allocator *allocator, Array<Shadow_Atlas_Tile> *tiles, Array<u8> *cells)
+{
+	u32 cells_per_row = allocator->atlas_size / allocator->min_tile_size;
+	cells->reserve(cells_per_row * cells_per_row);
+	memset((void *)cells->items, 0, cells->count);
+
+	u64 used_area = 0;
+	for (u32 i = 0; i < tiles->count;) {
+		Shadow_Atlas_Tile *tile = &tiles->get(i);
+		if (!allocator->is_allocated(tile)) {
+			tiles->swap_remove(i);
+			continue;
+		}
+		u32 first_cell_x = tile->x / allocator->min_tile_size;
+		u32 first_cell_y = tile->y / allocator->min_tile_size;
+		u32 tile_cell_count = tile->size / allocator->min_tile_size;
+		for (u32 y = first_cell_y; y < (first_cell_y + tile_cell_count); y++) {
+			for (u32 x = first_cell_x; x < (first_cell_x + tile_cell_count); x++) {
+				u8 *cell = &cells->get(y * cells_per_row + x);
+				if (*cell) {
+					print("benchmark_shadow_atlas: The tile {}x{} with size {} overlaps another tile.", tile->x, tile->y, tile->size);
+					return false;
+				}
+				*cell = 1;
+			}
+		}
+		used_area += (u64)tile->size * (u64)tile->size;
+		i++;
+	}
+	if ((used_area != allocator->used_area) || (tiles->count != allocator->used_tile_count)) {
+		print("benchmark_shadow_atlas: {} live tiles use {} pixels, the allocator counts {} tiles and {} pixels.", tiles->count, used_area, allocator->used_tile_count, allocator->used_area);
+		return false;
+	}
+	return true;
+}
+
+// Runs random allocations, frees and evictions on a separate allocator, checks its invariants on the way
+// and that freeing all tiles merges the atlas back into one free tile.
+static void benchmark_shadow_atlas(Array<String> &command_args)
+{
+	int operation_count = 100000;
+	if (!command_args.is_empty()) {
+		operation_count = atoi(command_args.first());
+	}
+	if (operation_count <= 0) {
+		print("benchmark_shadow_atlas: The command can't get an operation count, agruments is not valid.");
+		return;
+	}
+
+	// Operations are generated by a fixed LCG, so every run measures the same sequence.
+	u32 seed = 24680;
+	auto next_random = [&seed](u32 count) -> u32 {
+		seed = seed * 1664525 + 1013904223;
+		return (seed >> 8) % count;
+	};
+
+	Shadow_Atlas_Allocator allocator;
+	allocator.init(4096, SHADOW_ATLAS_MIN_TILE_SIZE, 1024);
+
+	Array<u8> cells;
+	Array<Shadow_Atlas_Tile> tiles;
+	u32 allocation_count = 0;
+	u32 failed_allocation_count = 0;
+	u32 fragmentation_sample_count = 0;
+	float fragmentation_sum = 0.0f;
+	float max_fragmentation = 0.0f;
+	s64 operation_ticks = 0;
+
+	for (u32 i = 0; i < (u32)operation_count; i++) {
+		// Tiles are touched only in their frames, so tiles of previous frames can be evicted.
+		if ((i % 16) == 0) {
+			allocator.begin_frame();
+		}
+		u32 operation = next_random(8);
+		s64 ticks = cpu_ticks_counter();
+		if ((operation < 4) || tiles.is_empty()) {
+			Shadow_Atlas_Tile tile;
+			u32 tile_size = allocator.get_tile_size((float)next_random(1001) / 1000.0f);
+			if (allocator.allocate(tile_size, &tile, (operation % 2) == 0)) {
+				tiles.push(tile);
+				allocation_count++;
+			} else {
+				failed_allocation_count++;
+			}
+		} else if (operation < 7) {
+			u32 tile_index = next_random(tiles.count);
+			allocator.free(&tiles[tile_index]);
+			tiles.swap_remove(tile_index);
+		} else {
+			Shadow_Atlas_Tile *tile = &tiles[next_random(tiles.count)];
+			if (allocator.is_allocated(tile)) {
+				allocator.touch(tile);
+			}
+		}
+		operation_ticks += cpu_ticks_counter() - ticks;
+
+		if ((i % 64) == 63) {
+			if (!check_shadow_atlas_tiles(&allocator, &tiles, &cells)) {
+				print("benchmark_shadow_atlas: The check failed after {} operations.", i + 1);
+				return;
+			}
+			float fragmentation = allocator.get_fragmentation();
+			fragmentation_sum += fragmentation;
+			max_fragmentation = math::max(max_fragmentation, fragmentation);
+			fragmentation_sample_count++;
+		}
+	}
+	if (!check_shadow_atlas_tiles(&allocator, &tiles, &cells)) {
+		print("benchmark_shadow_atlas: The check failed after all operations.");
+		return;
+	}
+	u32 live_tile_count = tiles.count;
+	float last_fragmentation = allocator.get_fragmentation();
+
+	for (u32 i = 0; i < tiles.count; i++) {
+		allocator.free(&tiles[i]);
+	}
+	bool merged = (allocator.used_tile_count == 0) && (allocator.used_area == 0) && (allocator.nodes[0].state == SHADOW_ATLAS_NODE_FREE) && (allocator.get_largest_free_tile_size() == allocator.atlas_size);
+
+	float average_fragmentation = (fragmentation_sample_count > 0) ? fragmentation_sum / (float)fragmentation_sample_count : 0.0f;
+	print("benchmark_shadow_atlas: {} operations {}ms, {} allocations, {} failed, {} tiles were evicted, {} tiles are live at the end.", operation_count, profile_ticks_to_milliseconds(operation_ticks), allocation_count, failed_allocation_count, allocator.evicted_tile_count, live_tile_count);
+	print("benchmark_shadow_atlas: Fragmentation of the free area is {} on average, {} at most, {} at the end.", average_fragmentation, max_fragmentation, last_fragmentation);
+	if (merged) {
+		print("benchmark_shadow_atlas: No tiles overlapped, freeing all tiles merged the atlas back into one free tile.");
+	} else {
+		print("benchmark_shadow_atlas: Freeing all tiles didn't merge the atlas back into one free tile.");
+	}
+}
+
+static void print_primitive_cache_stats(Array<String> &command_args)
+{
+	Engine::get_render_system()->render_2d.primitive_cache.print_stats();
+}
+
+static void print_glyph_cache_stats(Array<String> &command_args)
+{
+	Engine::get_render_system()->render_2d.glyph_cache.print_stats();
+}
+
+static void print_text_run_cache_stats(Array<String> &command_args)
+{
+	Hash_Table<String, Font *> *font_table = &Engine::get_font_manager()->font_table;
+	for (Hash_Node<String, Font *> *node = font_table->first_entry(); node; node = font_table->next_entry(node)) {
+		node->value->text_run_cache.print_stats(node->value);
+	}
+}
+
+static void print_occlusion_culling_stats(Array<String> &command_args)
+{
+	Occlusion_Buffer *occlusion_buffer = &Engine::get_render_world()->occlusion_buffer;
+	print("Occlusion_Buffer: {} occluders, {} triangles are rasterized by {} lanes into {}x{} pixels.", occlusion_buffer->occluder_count, occlusion_buffer->triangles.count, OCCLUSION_LANE_COUNT, OCCLUSION_BUFFER_WIDTH, OCCLUSION_BUFFER_HEIGHT);
+	print("Occlusion_Buffer: {} of {} tested render entities were occluded.", occlusion_buffer->occluded_count, occlusion_buffer->occludee_count);
+}
+
+static void print_mesh_storage_stats(Array<String> &command_args)
+{
+	Engine::get_render_world()->model_storage.print_stats();
+}
+
+static void defragment_mesh_storage(Array<String> &command_args)
+{
+	Model_Storage *model_storage = &Engine::get_render_world()->model_storage;
+	model_storage->defragment();
+	model_storage->print_stats();
+}
+
+// Compares building world matrices by get_world_matrix for every entity with the SoA kernel.
+static void benchmark_world_matrices(Array<String> &command_args)
+{
+	int transform_count = 100000;
+	if (!command_args.is_empty()) {
+		transform_count = atoi(command_args.first());
+	}
+	if (transform_count <= 0) {
+		print("benchmark_world_matrices: The command can't get a transform count, agruments is not valid.");
+		return;
+	}
+
+	Array<Entity> entities;
+	Transforms transforms;
+	transforms.resize((u32)transform_count);
+	for (u32 i = 0; i < (u32)transform_count; i++) {
+		Entity entity;
+		entity.scaling = Vector3(1.0f + (float)(i % 3), 1.0f, 1.0f + (float)(i % 5));
+		entity.rotation = Vector3((float)i * 0.01f, (float)i * 0.02f, (float)i * 0.03f);
+		entity.position = Vector3((float)i, (float)(i % 100), -(float)i);
+		entities.push(entity);
+		transforms.set(i, entity.scaling, entity.rotation, entity.position);
+	}
+
+	Array<Matrix4> entity_world_matrices;
+	Array<Matrix4> batch_world_matrices;
+	entity_world_matrices.reserve((u32)transform_count);
+	batch_world_matrices.reserve((u32)transform_count);
+
+	s64 ticks = cpu_ticks_counter();
+	for (u32 i = 0; i < entities.count; i++) {
+		entity_world_matrices[i] = get_world_matrix(&entities[i]);
+	}
+	float entity_path_time = profile_ticks_to_milliseconds(cpu_ticks_counter() - ticks);
+
+	ticks = cpu_ticks_counter();
+	build_world_matrices(&transforms, 0, transforms.count, batch_world_matrices.items);
+	float batch_path_time = profile_ticks_to_milliseconds(cpu_ticks_counter() - ticks);
+
+	float max_difference = 0.0f;
+	for (u32 i = 0; i < entities.count; i++) {
+		for (u32 j = 0; j < 16; j++) {
+			max_difference = math::max(max_difference, math::abs((&entity_world_matrices[i].m[0][0])[j] - (&batch_world_matrices[i].m[0][0])[j]));
+		}
+	}
+	print("benchmark_world_matrices: {} matrices, get_world_matrix {}ms, the SoA kernel with batches of {} {}ms.", transform_count, entity_path_time, TRANSFORMS_BATCH_SIZE, batch_path_time);
+	print("benchmark_world_matrices: The max difference between the matrices is {}.", max_difference);
+}
+
+// Compares the clustered light assignment with testing every light against every cluster.
+static void check_light_clusters(Array<String> &command_args)
+{
+	int light_count = 1000;
+	if (!command_args.is_empty()) {
+		light_count = atoi(command_args.first());
+	}
+	if (light_count <= 0) {
+		print("check_light_clusters: The command can't get a light count, agruments is not valid.");
+		return;
+	}
+
+	// Lights are generated by a fixed LCG, so every run checks the same scene.
+	u32 seed = 12345;
+	auto next_random = [&seed](float min, float max) -> float {
+		seed = seed * 1664525 + 1013904223;
+		return min + (max - min) * ((float)(seed >> 8) / (float)(1 << 24));
+	};
+
+	Array<Hlsl_Light> lights;
+	for (u32 i = 0; i < (u32)light_count; i++) {
+		Hlsl_Light light;
+		light.position = Vector3(next_random(-2000.0f, 2000.0f), next_random(-500.0f, 500.0f), next_random(-200.0f, 4000.0f));
+		light.direction = Vector3(0.0f, -1.0f, 0.0f);
+		light.color = Vector3(1.0f, 1.0f, 1.0f);
+		light.radius = 30.0f;
+		light.range = next_random(1.0f, 150.0f);
+		light.light_type = ((i % 64) == 63) ? DIRECTIONAL_LIGHT_TYPE : (((i % 2) == 0) ? POINT_LIGHT_TYPE : SPOT_LIGHT_TYPE);
+		lights.push(light);
+	}
+	Matrix4 view_matrix = make_look_to_matrix(Vector3(100.0f, 50.0f, -300.0f), normalize(Vector3(0.2f, -0.1f, 1.0f)));
+
+	Light_Clusters clusters;
+	Light_Clusters reference_clusters;
+	clusters.update_bounds(degrees_to_radians(60.0f), 16.0f / 9.0f, 1.0f, 10000.0f);
+	reference_clusters.update_bounds(degrees_to_radians(60.0f), 16.0f / 9.0f, 1.0f, 10000.0f);
+
+	s64 ticks = cpu_ticks_counter();
+	clusters.assign_lights(&lights, view_matrix);
+	float assign_time = profile_ticks_to_milliseconds(cpu_ticks_counter() - ticks);
+
+	ticks = cpu_ticks_counter();
+	reference_clusters.assign_lights_brute_force(&lights, view_matrix);
+	float brute_force_time = profile_ticks_to_milliseconds(cpu_ticks_counter() - ticks);
+
+	u32 mismatched_clusters = 0;
+	for (u32 i = 0; i < LIGHT_CLUSTER_COUNT; i++) {
+		Hlsl_Light_Cluster *cluster = &clusters.clusters[i];
+		Hlsl_Light_Cluster *reference_cluster = &reference_clusters.clusters[i];
+		bool equal = (cluster->light_offset == reference_cluster->light_offset) && (cluster->light_count == reference_cluster->light_count);
+		for (u32 j = 0; equal && (j < cluster->light_count); j++) {
+			equal = clusters.light_indices[cluster->light_offset + j] == reference_clusters.light_indices[reference_cluster->light_offset + j];
+		}
+		if (!equal) {
+			mismatched_clusters++;
+		}
+	}
+	print("check_light_clusters: {} lights, {} light indices in {} clusters, assign_lights {}ms, the brute force {}ms.", light_count, clusters.light_indices.count, LIGHT_CLUSTER_COUNT, assign_time, brute_force_time);
+	if (mismatched_clusters > 0) {
+		print("check_light_clusters: {} clusters don't match the brute force assignment.", mismatched_clusters);
+	} else {
+		print("check_light_clusters: The assignment matches the brute force assignment.");
+	}
+}
+
+// Rasterizes random walls by the calling thread and by the job system, then tests random boxes against the buffer.
+static void benchmark_occlusion_culling(Array<String> &command_args)
+{
+	int wall_count = 256;
+	if (!command_args.is_empty()) {
+		wall_count = atoi(command_args.first());
+	}
+	if (wall_count <= 0) {
+		print("benchmark_occlusion_culling: The command can't get a wall count, agruments is not valid.");
+		return;
+	}
+
+	// Walls and boxes are generated by a fixed LCG, so every run measures the same scene.
+	u32 seed = 54321;
+	auto next_random = [&seed](float min, float max) -> float {
+		seed = seed * 1664525 + 1013904223;
+		return min + (max - min) * ((float)(seed >> 8) / (float)(1 << 24));
+	};
+
+	Vertex_PNTUV cube_vertices[8];
+	for (u32 i = 0; i < 8; i++) {
+		cube_vertices[i].position = Vector3((i & 1) ? 0.5f : -0.5f, (i & 2) ? 0.5f : -0.5f, (i & 4) ? 0.5f : -0.5f);
+	}
+	u32 cube_indices[36] = { 0, 1, 3, 0, 3, 2, 4, 6, 7, 4, 7, 5, 0, 4, 5, 0, 5, 1, 2, 3, 7, 2, 7, 6, 0, 2, 6, 0, 6, 4, 1, 5, 7, 1, 7, 3 };
+
+	Array<Matrix4> wall_matrices;
+	for (u32 i = 0; i < (u32)wall_count; i++) {
+		Vector3 position = Vector3(next_random(-1500.0f, 1500.0f), next_random(-600.0f, 600.0f), next_random(50.0f, 3000.0f));
+		wall_matrices.push(make_scale_matrix(next_random(20.0f, 300.0f), next_random(20.0f, 300.0f), 2.0f) * make_translation_matrix(&position));
+	}
+	Array<AABB> boxes;
+	for (u32 i = 0; i < 100000; i++) {
+		Vector3 center = Vector3(next_random(-2000.0f, 2000.0f), next_random(-800.0f, 800.0f), next_random(10.0f, 4000.0f));
+		Vector3 extents = Vector3(next_random(1.0f, 20.0f), next_random(1.0f, 20.0f), next_random(1.0f, 20.0f));
+		boxes.push({ center - extents, center + extents });
+	}
+	Matrix4 view_projection_matrix = make_look_to_matrix(Vector3(0.0f, 0.0f, 0.0f), Vector3(0.0f, 0.0f, 1.0f)) * make_perspective_matrix(degrees_to_radians(60.0f), 16.0f / 9.0f, 1.0f, 10000.0f);
+
+	Occlusion_Buffer occlusion_buffer;
+	occlusion_buffer.begin_frame(view_projection_matrix);
+
+	s64 ticks = cpu_ticks_counter();
+	for (u32 i = 0; i < wall_matrices.count; i++) {
+		occlusion_buffer.add_occluder(cube_vertices, 8, cube_indices, 36, wall_matrices[i]);
+	}
+	float setup_time = profile_ticks_to_milliseconds(cpu_ticks_counter() - ticks);
+
+	ticks = cpu_ticks_counter();
+	occlusion_buffer.rasterize();
+	float single_thread_time = profile_ticks_to_milliseconds(cpu_ticks_counter() - ticks);
+	Array<float> single_thread_depths;
+	single_thread_depths.reserve(occlusion_buffer.depths.count);
+	memcpy((void *)single_thread_depths.items, (void *)occlusion_buffer.depths.items, sizeof(float) * occlusion_buffer.depths.count);
+
+	ticks = cpu_ticks_counter();
+	occlusion_buffer.rasterize(Engine::get_job_system());
+	float job_system_time = profile_ticks_to_milliseconds(cpu_ticks_counter() - ticks);
+	bool same_depths = memcmp((void *)single_thread_depths.items, (void *)occlusion_buffer.depths.items, sizeof(float) * occlusion_buffer.depths.count) == 0;
+
+	ticks = cpu_ticks_counter();
+	u32 occluded_count = 0;
+	for (u32 i = 0; i < boxes.count; i++) {
+		if (!occlusion_buffer.is_visible(boxes[i])) {
+			occluded_count++;
+		}
+	}
+	float testing_time = profile_ticks_to_milliseconds(cpu_ticks_counter() - ticks);
+
+	print("benchmark_occlusion_culling: {} walls, {} triangles, {} lanes, setup {}ms, one thread {}ms, the job system {}ms.", wall_count, occlusion_buffer.triangles.count, OCCLUSION_LANE_COUNT, setup_time, single_thread_time, job_system_time);
+	print("benchmark_occlusion_culling: {} of {} boxes are occluded, testing {}ms.", occluded_count, boxes.count, testing_time);
+	if (!same_depths) {
+		print("benchmark_occlusion_culling: Depths rasterized by the job system differ from depths rasterized by one thread.");
+	}
+}
+
+static void print_profile_frame_tree(Array<String> &command_args)
+{
+	print_profile_frame();
+}
+
+static void record_profile_trace(Array<String> &command_args)
+{
+	int frame_count = 60;
+	if (!command_args.is_empty()) {
+		frame_count = atoi(command_args.first());
+	}
+	if (frame_count <= 0) {
+		print("record_profile_trace: The command can't get a frame count, agruments is not valid.");
+		return;
+	}
+	String full_path = join_paths(get_base_path(), "profile_trace.json");
+	begin_profile_trace(full_path, (u32)frame_count);
+}
+
 struct Command {
 	String name;
 	void (*procedure)(Array<String> &args) = NULL;
@@ -146,6 +545,20 @@ void init_commands()
 	add_command("load mesh", load_meshes);
 	add_command("load level", load_level);
 	add_command("create level", create_level);
+	add_command("render stats", print_render_stats);
+	add_command("shadow atlas stats", print_shadow_atlas_stats);
+	add_command("benchmark shadow atlas", benchmark_shadow_atlas);
+	add_command("primitive cache stats", print_primitive_cache_stats);
+	add_command("glyph cache stats", print_glyph_cache_stats);
+	add_command("text run cache stats", print_text_run_cache_stats);
+	add_command("occlusion culling stats", print_occlusion_culling_stats);
+	add_command("mesh storage stats", print_mesh_storage_stats);
+	add_command("defragment mesh storage", defragment_mesh_storage);
+	add_command("benchmark world matrices", benchmark_world_matrices);
+	add_command("check light clusters", check_light_clusters);
+	add_command("benchmark occlusion culling", benchmark_occlusion_culling);
+	add_command("profile frame", print_profile_frame_tree);
+	add_command("profile trace", record_profile_trace);
 }
 
 void run_command(const char *command_name, Array<String> &command_args)
@@ -35,16 +35,13 @@ static void init_performance_displaying()
 
 static void display_performance(s64 fps, s64 frame_time)
 {
-	char *test = format("Fps", fps);
-	char *test2 = format("Frame time {} ms", frame_time);
-	u32 text_width = performance_font->get_text_width(test2);
+	Formatted_String test("Fps", fps);
+	Formatted_String test2("Frame time {} ms", frame_time);
+	u32 text_width = performance_font->get_text_width(test2.data);
 
 	s32 x = Render_System::screen_width - text_width - 10;
-	render_list.add_text(100, 5, test);
-	render_list.add_text(180, 5, test2);
-
-	free_string(test);
-	free_string(test2);
+	render_list.add_text(100, 5, test.data);
+	render_list.add_text(180, 5, test2.data);
 
 	engine->render_sys.render_2d.add_render_primitive_list(&render_list);
 }
@@ -61,10 +58,20 @@ void Engine::init(Win32_Window *window)
 {
 	BEGIN_TASK("Initialize engine");
 
+	job_system.init();
+
 	font_manager.init();
 	
+	bool null_render_backend = false;
+	Variable_Service *system = var_service.find_namespace("system");
+	ATTACH(system, null_render_backend);
+	system->attach("record_render_commands", &render_sys.command_log.record_commands);
+	system->attach("batch_render_entities", &render_world.render_batches.group_render_entities);
+	system->attach("cache_shadow_cascades", &render_world.cache_shadow_cascades);
+	system->attach("occlusion_culling", &render_world.occlusion_culling);
+
 	BEGIN_TASK("Initialize render_system");
-	render_sys.init(window);
+	render_sys.init(window, null_render_backend ? RENDER_BACKEND_NULL : RENDER_BACKEND_DX11);
 	END_TASK();
 	
 	shader_manager.init(&render_sys.gpu_device);
@@ -81,7 +88,6 @@ void Engine::init(Win32_Window *window)
 	render_world.init(this);
 
 	current_level_name = DEFAULT_LEVEL_NAME + LEVEL_EXTENSION;
-	Variable_Service *system = var_service.find_namespace("system");
 	system->attach("load_level", &current_level_name);
 
 	BEGIN_TASK("Load level");
@@ -94,7 +100,7 @@ void Engine::init(Win32_Window *window)
 	
 	engine->is_initialized = true;
 
-	END_TASK()
+	END_TASK();
 }
 
 void Engine::frame()
@@ -171,6 +177,7 @@ void Engine::shutdown()
 	save_game_and_render_world_in_level(current_level_name, &game_world, &render_world);
 	gui::shutdown();
 	var_service.shutdown();
+	job_system.shutdown();
 }
 
 void Engine::set_current_level_name(const String &level_name)
@@ -195,6 +202,11 @@ Engine *Engine::get_instance()
 	return engine;
 }
 
+Job_System *Engine::get_job_system()
+{
+	return &engine->job_system;
+}
+
 Game_World *Engine::get_game_world()
 {
 	return &engine->game_world;
@@ -2,6 +2,7 @@
 #define ENGINE_H
 
 #include "vars.h"
+#include "job_system.h"
 #include "file_tracking.h"
 #include "../gui/editor.h"
 #include "../game/world.h"
@@ -19,6 +20,7 @@ struct Engine {
 	String current_level_name;
 	
 	Editor editor;
+	Job_System job_system;
 	Variable_Service var_service;
 	File_Tracking_System file_tracking_sys;
 	Game_World game_world;
@@ -38,6 +40,7 @@ struct Engine {
 	static bool initialized();
 
 	static Engine *get_instance();
+	static Job_System *get_job_system();
 	static Game_World *get_game_world();
 	static Render_World *get_render_world();
 	static Render_System *get_render_system();
@@ -0,0 +1,247 @@
+#include <assert.h>
+
+#include "sys.h"
+#include "utils.h"
+#include "profiling.h"
+#include "job_system.h"
+#include "../libs/math/functions.h"
+
+const u32 JOB_QUEUE_INITIAL_SIZE = 64;
+
+static thread_local u32 job_thread_index = 0;
+
+struct Parallel_For_Batch {
+	Parallel_For_Function function = NULL;
+	void *data = NULL;
+	u32 first = 0;
+	u32 last = 0;
+};
+
+static void run_parallel_for_batch(void *data)
+{
+	Parallel_For_Batch *batch = (Parallel_For_Batch *)data;
+	batch->function(batch->first, batch->last, batch->data);
+}
+
+u32 get_job_thread_index()
+{
+	return job_thread_index;
+}
+
+void Job_Queue::push(const Job &job)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (count == jobs.count) {
+		// Jobs are kept in a ring buffer, its size is always a power of two.
+		Array<Job> new_jobs;
+		new_jobs.reserve((jobs.count > 0) ? jobs.count * 2 : JOB_QUEUE_INITIAL_SIZE);
+		for (u32 i = 0; i < count; i++) {
+			new_jobs[i] = jobs[(first + i) & (jobs.count - 1)];
+		}
+		jobs = std::move(new_jobs);
+		first = 0;
+	}
+	jobs[(first + count) & (jobs.count - 1)] = job;
+	count += 1;
+}
+
+bool Job_Queue::pop(Job *job)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (count == 0) {
+		return false;
+	}
+	count -= 1;
+	*job = jobs[(first + count) & (jobs.count - 1)];
+	return true;
+}
+
+bool Job_Queue::steal(Job *job)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (count == 0) {
+		return false;
+	}
+	*job = jobs[first];
+	first = (first + 1) & (jobs.count - 1);
+	count -= 1;
+	return true;
+}
+
+Job_System::~Job_System()
+{
+	shutdown();
+}
+
+void Job_System::init(u32 worker_count)
+{
+	assert(!running);
+
+	if (worker_count == 0) {
+		u32 core_count = std::thread::hardware_concurrency();
+		worker_count = (core_count > 1) ? core_count - 1 : 0;
+	}
+	thread_count = worker_count + 1;
+	queues = new Job_Queue[thread_count];
+	running = true;
+
+	// The main thread always has index 0.
+	job_thread_index = 0;
+	for (u32 i = 1; i < thread_count; i++) {
+		workers.push(new std::thread(&Job_System::worker_loop, this, i));
+	}
+	print("Job_System::init: {} worker threads were started.", worker_count);
+}
+
+void Job_System::shutdown()
+{
+	if (!running) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(wake_mutex);
+		running = false;
+	}
+	wake_condition.notify_all();
+
+	for (u32 i = 0; i < workers.count; i++) {
+		workers[i]->join();
+		DELETE_PTR(workers[i]);
+	}
+	workers.clear();
+
+	DELETE_ARRAY(queues);
+	thread_count = 0;
+	queued_job_count = 0;
+}
+
+void Job_System::run_job(Job_Function function, void *data, Job_Counter *counter)
+{
+	Job job;
+	job.function = function;
+	job.data = data;
+	run_jobs(&job, 1, counter);
+}
+
+void Job_System::run_jobs(Job *jobs, u32 job_count, Job_Counter *counter)
+{
+	assert(jobs);
+	assert(counter);
+
+	if (job_count == 0) {
+		return;
+	}
+	counter->value.fetch_add(job_count, std::memory_order_relaxed);
+
+	if (thread_count <= 1) {
+		for (u32 i = 0; i < job_count; i++) {
+			jobs[i].function(jobs[i].data);
+			counter->value.fetch_sub(1, std::memory_order_release);
+		}
+		return;
+	}
+
+	{
+		// The counter is changed under the mutex so a worker can't miss the notification
+		// between checking the counter and going to sleep.
+		std::lock_guard<std::mutex> lock(wake_mutex);
+		queued_job_count.fetch_add(job_count, std::memory_order_relaxed);
+	}
+	Job_Queue *queue = &queues[job_thread_index];
+	for (u32 i = 0; i < job_count; i++) {
+		Job job = jobs[i];
+		job.counter = counter;
+		queue->push(job);
+	}
+	if (job_count > 1) {
+		wake_condition.notify_all();
+	} else {
+		wake_condition.notify_one();
+	}
+}
+
+void Job_System::wait(Job_Counter *counter)
+{
+	assert(counter);
+
+	while (!counter->is_done()) {
+		if (!run_next_job(job_thread_index)) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+void Job_System::parallel_for(u32 count, u32 batch_size, Parallel_For_Function function, void *data)
+{
+	assert(function);
+	assert(batch_size > 0);
+
+	if (count == 0) {
+		return;
+	}
+	if ((thread_count <= 1) || (count <= batch_size)) {
+		function(0, count, data);
+		return;
+	}
+
+	u32 batch_count = (count + batch_size - 1) / batch_size;
+
+	Array<Parallel_For_Batch> batches;
+	Array<Job> jobs;
+	batches.reserve(batch_count);
+	jobs.reserve(batch_count);
+
+	for (u32 i = 0; i < batch_count; i++) {
+		batches[i].function = function;
+		batches[i].data = data;
+		batches[i].first = i * batch_size;
+		batches[i].last = math::min((i + 1) * batch_size, count);
+
+		jobs[i].function = run_parallel_for_batch;
+		jobs[i].data = (void *)&batches[i];
+	}
+
+	Job_Counter counter;
+	run_jobs(jobs.items, batch_count, &counter);
+	wait(&counter);
+}
+
+bool Job_System::run_next_job(u32 thread_index)
+{
+	assert(thread_index < thread_count);
+
+	Job job;
+	bool found = queues[thread_index].pop(&job);
+	for (u32 i = 1; !found && (i < thread_count); i++) {
+		found = queues[(thread_index + i) % thread_count].steal(&job);
+	}
+	if (!found) {
+		return false;
+	}
+	queued_job_count.fetch_sub(1, std::memory_order_relaxed);
+
+	BEGIN_PROFILE_ZONE("Job");
+	job.function(job.data);
+	END_PROFILE_ZONE();
+	job.counter->value.fetch_sub(1, std::memory_order_release);
+	return true;
+}
+
+void Job_System::worker_loop(u32 thread_index)
+{
+	job_thread_index = thread_index;
+
+	while (true) {
+		if (run_next_job(thread_index)) {
+			continue;
+		}
+		std::unique_lock<std::mutex> lock(wake_mutex);
+		wake_condition.wait(lock, [this] { return !running || (queued_job_count.load(std::memory_order_relaxed) > 0); });
+		if (!running) {
+			break;
+		}
+	}
+}
@@ -0,0 +1,77 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <condition_variable>
+
+#include "../libs/number_types.h"
+#include "../libs/structures/array.h"
+
+typedef void (*Job_Function)(void *data);
+typedef void (*Parallel_For_Function)(u32 first, u32 last, void *data);
+
+// A counter holds a number of unfinished jobs, it is decremented when a job is done.
+struct Job_Counter {
+	std::atomic<u32> value = 0;
+
+	bool is_done();
+};
+
+inline bool Job_Counter::is_done()
+{
+	return value.load(std::memory_order_acquire) == 0;
+}
+
+struct Job {
+	Job_Function function = NULL;
+	void *data = NULL;
+	Job_Counter *counter = NULL;
+};
+
+// Every thread has its own queue. An owner thread pushes and pops jobs from the back,
+// other threads steal jobs from the front, so the oldest jobs are stolen first.
+struct Job_Queue {
+	std::mutex mutex;
+	Array<Job> jobs;
+	u32 first = 0;
+	u32 count = 0;
+
+	void push(const Job &job);
+	bool pop(Job *job);
+	bool steal(Job *job);
+};
+
+struct Job_System {
+	Job_System() {}
+	~Job_System();
+
+	bool running = false;
+	u32 thread_count = 0; // Worker threads and the main thread.
+
+	Array<std::thread *> workers;
+	Job_Queue *queues = NULL;
+
+	std::mutex wake_mutex;
+	std::condition_variable wake_condition;
+	std::atomic<u32> queued_job_count = 0;
+
+	// If worker_count is 0 one worker is started for every core except the one used by the main thread.
+	void init(u32 worker_count = 0);
+	void shutdown();
+
+	void run_job(Job_Function function, void *data, Job_Counter *counter);
+	void run_jobs(Job *jobs, u32 job_count, Job_Counter *counter);
+	// The calling thread runs queued jobs until the counter reaches 0.
+	void wait(Job_Counter *counter);
+	// Splits [0, count) into batches and returns when all of them are done.
+	void parallel_for(u32 count, u32 batch_size, Parallel_For_Function function, void *data);
+
+	bool run_next_job(u32 thread_index);
+	void worker_loop(u32 thread_index);
+};
+
+u32 get_job_thread_index();
+
+#endif
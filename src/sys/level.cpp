@@ -8,6 +8,7 @@
 
 #include "../libs/os/path.h"
 #include "../libs/os/file.h"
+#include "../libs/mesh_cache.h"
 #include "../libs/mesh_loader.h"
 #include "../libs/math/structures.h"
 #include "../libs/structures/array.h"
@@ -18,15 +19,9 @@ inline bool operator==(const Mesh_Id &first, const Mesh_Id &second)
 	return (first.textures_idx == second.textures_idx) && (first.instance_idx == second.instance_idx);
 }
 
-inline u32 hash(Mesh_Id mesh_id, int table_count, int attempt)
+inline u32 hash(const Mesh_Id &mesh_id)
 {
-	char *str1 = ::to_string(mesh_id.textures_idx);
-	char *str2 = ::to_string(mesh_id.instance_idx);
-	String result = String(str1) + String(str2);
-	u32 h = ::hash(result.c_str(), table_count, attempt);
-	free_string(str1);
-	free_string(str2);
-	return h;
+	return ::hash(mesh_id.textures_idx ^ ::hash(mesh_id.instance_idx));
 }
 
 inline void load_game_entities(File *level_file, Game_World *game_world)
@@ -38,6 +33,27 @@ inline void load_game_entities(File *level_file, Game_World *game_world)
 	level_file->read(&game_world->lights);
 	level_file->read(&game_world->geometry_entities);
 	level_file->read(&game_world->cameras);
+	game_world->rebuild_entity_slots();
+}
+
+struct Mesh_File_Loading {
+	bool loaded = false;
+	bool loaded_from_cache = false;
+	String full_path_to_mesh_file;
+	Loading_Models_Options *options = NULL;
+	Loading_Models_Info info;
+	Mesh_Cache mesh_cache;
+	Array<Loading_Model *> loaded_models;
+};
+
+static void load_mesh_file(void *data)
+{
+	Mesh_File_Loading *mesh_file = (Mesh_File_Loading *)data;
+	if (mesh_file->mesh_cache.open(mesh_file->full_path_to_mesh_file, mesh_file->options)) {
+		mesh_file->loaded_from_cache = true;
+		return;
+	}
+	mesh_file->loaded = load_models_from_file(mesh_file->full_path_to_mesh_file, mesh_file->loaded_models, &mesh_file->info, mesh_file->options);
 }
 
 inline void load_saved_meshes(File *level_file, Render_World *render_world)
@@ -65,28 +81,59 @@ inline void load_saved_meshes(File *level_file, Render_World *render_world)
 	models_loading->attach("scaling_value", &loading_options.scaling_value);
 	models_loading->attach("use_scaling_value", &loading_options.use_scaling_value);
 
+	// Mesh files are read and imported by jobs, then models are added to the model storage
+	// on this thread in the order of the level file, so mesh ids don't depend on job timing.
+	Array<Mesh_File_Loading *> mesh_files;
+	Array<Job> jobs;
 	for (u32 i = 0; i < mesh_names.count; i++) {
-		String full_path_to_mesh_file;
-		build_full_path_to_model_file(mesh_names[i].c_str(), full_path_to_mesh_file);
-
-		Loading_Models_Info info;
-		Array<Loading_Model *> loaded_models;
-		if (load_models_from_file(full_path_to_mesh_file, loaded_models, &info, &loading_options)) {
-			begin_time_stamp();
-			Model_Storage *model_storage = render_world->get_model_storage();
-			
+		Mesh_File_Loading *mesh_file = new Mesh_File_Loading();
+		mesh_file->options = &loading_options;
+		build_full_path_to_model_file(mesh_names[i].c_str(), mesh_file->full_path_to_mesh_file);
+		mesh_files.push(mesh_file);
+
+		Job job;
+		job.function = load_mesh_file;
+		job.data = (void *)mesh_file;
+		jobs.push(job);
+	}
+
+	s64 time_stamp = begin_time_stamp();
+	Job_System *job_system = Engine::get_job_system();
+	if (loading_options.assimp_logging) {
+		// Assimp has only one global logger.
+		for (u32 i = 0; i < mesh_files.count; i++) {
+			load_mesh_file((void *)mesh_files[i]);
+		}
+	} else {
+		Job_Counter counter;
+		job_system->run_jobs(jobs.items, jobs.count, &counter);
+		job_system->wait(&counter);
+	}
+
+	Model_Storage *model_storage = render_world->get_model_storage();
+	for (u32 i = 0; i < mesh_files.count; i++) {
+		Mesh_File_Loading *mesh_file = mesh_files[i];
+		if (mesh_file->loaded_from_cache) {
+			if (model_storage->add_models(&mesh_file->mesh_cache) > 0) {
+				model_storage->add_models_file(mesh_names[i]);
+			}
+			print("load_saved_meshes: {} was loaded from the mesh cache in render world.", mesh_names[i].c_str());
+		} else if (mesh_file->loaded) {
 			Array<Pair<Loading_Model *, Mesh_Id>> result;
-			model_storage->reserve_memory_for_new_models(info.model_count, info.total_vertex_count, info.total_index_count);
-			model_storage->add_models(loaded_models, result);
+			model_storage->reserve_memory_for_new_models(mesh_file->info.model_count, mesh_file->info.total_vertex_count, mesh_file->info.total_index_count);
+			model_storage->add_models(mesh_file->loaded_models, result);
 
 			if (!result.is_empty()) {
 				model_storage->add_models_file(mesh_names[i]);
 			}
-			free_memory(&loaded_models);
+			cook_models(mesh_file->full_path_to_mesh_file, mesh_file->loaded_models, &loading_options);
+			free_memory(&mesh_file->loaded_models);
 
-			print("load_saved_meshes: {} was loaded in render world for {}ms", mesh_names[i].c_str(), delta_time_in_milliseconds());
+			print("load_saved_meshes: {} was loaded in render world.", mesh_names[i].c_str());
 		}
+		DELETE_PTR(mesh_file);
 	}
+	print("load_saved_meshes: {} mesh files were loaded for {}ms.", mesh_names.count, delta_time_in_milliseconds(time_stamp));
 }
 
 inline void init_render_world(File *level_file, Game_World *game_world, Render_World *render_world)
@@ -134,9 +181,11 @@ inline void save_render_entities(File *level_file, Render_World *render_world)
 		return;
 	}
 
+	Hash_Table<String_Id, Mesh_Id> *mesh_table = &render_world->model_storage.mesh_table;
+
 	Hash_Table<Mesh_Id, String_Id> table;
-	for (u32 i = 0; i < render_world->model_storage.mesh_table.count; i++) {
-		Hash_Node<String_Id, Mesh_Id> *node = render_world->model_storage.mesh_table.get_node(i);
+	table.reserve(mesh_table->count);
+	for (Hash_Node<String_Id, Mesh_Id> *node = mesh_table->first_entry(); node; node = mesh_table->next_entry(node)) {
 		table.set(node->value, node->key);
 	}
 
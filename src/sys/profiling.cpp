@@ -1,3 +1,8 @@
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+
+#include "sys.h"
 #include "profiling.h"
 
 #include "../win32/win_time.h"
@@ -14,20 +19,324 @@ __itt_domain *get_default_domain()
 }
 #endif
 
-static s64 time_stamp = 0;
+const u32 PROFILE_NO_PARENT = UINT32_MAX;
+
+struct Open_Profile_Zone {
+	const char *name = NULL;
+	s64 begin_ticks = 0;
+	u32 node_index = 0;
+};
+
+// The state is used only by the thread which ends frames.
+struct Profile_Thread_State {
+	Array<Open_Profile_Zone> open_zones;
+	u32 trace_depth = 0;
+};
+
+struct Profile_Trace_Event {
+	Profile_Event event;
+	u32 thread_index = 0;
+};
+
+struct Profile_Trace {
+	bool active = false;
+	u32 frames_left = 0;
+	s64 begin_ticks = 0;
+	String path_to_file;
+	Array<Profile_Trace_Event> events;
+};
+
+static std::mutex thread_buffers_mutex;
+static Array<Profile_Thread_Buffer *> thread_buffers;
+static thread_local Profile_Thread_Buffer *thread_buffer = NULL;
 
-void begin_time_stamp()
+static Array<Profile_Thread_State> thread_states;
+static Array<Profile_Node> frame_nodes;
+static s64 frame_begin_ticks = 0;
+static Profile_Trace trace;
+
+static Profile_Thread_Buffer *get_thread_buffer()
 {
-	time_stamp = milliseconds_counter();
+	if (!thread_buffer) {
+		thread_buffer = new Profile_Thread_Buffer();
+
+		std::lock_guard<std::mutex> lock(thread_buffers_mutex);
+		thread_buffer->thread_index = thread_buffers.count;
+		thread_buffers.push(thread_buffer);
+	}
+	return thread_buffer;
 }
 
-s64 delta_time_in_milliseconds()
+inline void push_profile_event(const char *name, Profile_Event_Type type)
 {
-	return milliseconds_counter() - time_stamp;
+	Profile_Thread_Buffer *buffer = get_thread_buffer();
+	u32 write_index = buffer->write_index.load(std::memory_order_relaxed);
+	u32 read_index = buffer->read_index.load(std::memory_order_acquire);
+
+	// After dropped events one more slot is needed for the event which marks them.
+	u32 needed_count = (buffer->lost_event_count > 0) ? 2 : 1;
+	if ((PROFILE_EVENT_BUFFER_SIZE - (write_index - read_index)) < needed_count) {
+		buffer->lost_event_count++;
+		return;
+	}
+	s64 ticks = cpu_ticks_counter();
+
+	if (buffer->lost_event_count > 0) {
+		Profile_Event *lost_event = &buffer->events[write_index & (PROFILE_EVENT_BUFFER_SIZE - 1)];
+		lost_event->name = NULL;
+		lost_event->ticks = ticks;
+		lost_event->type = PROFILE_EVENT_LOST;
+		lost_event->lost_event_count = buffer->lost_event_count;
+		buffer->lost_event_count = 0;
+		write_index++;
+	}
+
+	Profile_Event *event = &buffer->events[write_index & (PROFILE_EVENT_BUFFER_SIZE - 1)];
+	event->name = name;
+	event->ticks = ticks;
+	event->type = type;
+
+	buffer->write_index.store(write_index + 1, std::memory_order_release);
+}
+
+Profile_Zone::Profile_Zone(const char *zone_name)
+{
+	begin_profile_zone(zone_name);
+}
+
+Profile_Zone::~Profile_Zone()
+{
+	end_profile_zone();
+}
+
+void begin_profile_zone(const char *zone_name)
+{
+	push_profile_event(zone_name, PROFILE_EVENT_BEGIN);
+}
+
+void end_profile_zone()
+{
+	push_profile_event(NULL, PROFILE_EVENT_END);
+}
+
+static u32 find_or_add_node(u32 parent, const char *name, u32 thread_index)
+{
+	u32 depth = 0;
+	if (parent != PROFILE_NO_PARENT) {
+		depth = frame_nodes[parent].depth + 1;
+		// Children are always added after their parent.
+		for (u32 i = parent + 1; i < frame_nodes.count; i++) {
+			Profile_Node *node = &frame_nodes[i];
+			if ((node->parent == parent) && ((node->name == name) || !strcmp(node->name, name))) {
+				return i;
+			}
+		}
+	} else {
+		for (u32 i = 0; i < frame_nodes.count; i++) {
+			Profile_Node *node = &frame_nodes[i];
+			if ((node->parent == PROFILE_NO_PARENT) && (node->thread_index == thread_index) && ((node->name == name) || !strcmp(node->name, name))) {
+				return i;
+			}
+		}
+	}
+	Profile_Node node;
+	node.name = name;
+	node.parent = parent;
+	node.depth = depth;
+	node.thread_index = thread_index;
+	frame_nodes.push(node);
+	return frame_nodes.count - 1;
+}
+
+static void add_trace_event(Profile_Event *event, u32 thread_index)
+{
+	Profile_Thread_State *state = &thread_states[thread_index];
+	if (event->type == PROFILE_EVENT_BEGIN) {
+		state->trace_depth++;
+	} else if (state->trace_depth > 0) {
+		state->trace_depth--;
+	} else {
+		// The zone was begun before the trace.
+		return;
+	}
+	Profile_Trace_Event trace_event;
+	trace_event.event = *event;
+	trace_event.thread_index = thread_index;
+	trace.events.push(trace_event);
+}
+
+static void collect_thread_events(Profile_Thread_Buffer *buffer, s64 frame_end_ticks)
+{
+	Profile_Thread_State *state = &thread_states[buffer->thread_index];
+
+	// Zones which were not ended in previous frames continue in this one.
+	for (u32 i = 0; i < state->open_zones.count; i++) {
+		u32 parent = (i > 0) ? state->open_zones[i - 1].node_index : PROFILE_NO_PARENT;
+		state->open_zones[i].node_index = find_or_add_node(parent, state->open_zones[i].name, buffer->thread_index);
+		state->open_zones[i].begin_ticks = frame_begin_ticks;
+	}
+
+	u32 write_index = buffer->write_index.load(std::memory_order_acquire);
+	u32 read_index = buffer->read_index.load(std::memory_order_relaxed);
+
+	for (; read_index != write_index; read_index++) {
+		Profile_Event *event = &buffer->events[read_index & (PROFILE_EVENT_BUFFER_SIZE - 1)];
+		if (event->type == PROFILE_EVENT_LOST) {
+			print("end_profile_frame: {} profile events of thread {} were lost.", event->lost_event_count, buffer->thread_index);
+			// Begin events of the open zones can be lost, so they are closed. End events are ignored
+			// while no zone is open, so end events of zones begun before the lost events are skipped.
+			for (u32 i = 0; i < state->open_zones.count; i++) {
+				frame_nodes[state->open_zones[i].node_index].total_ticks += event->ticks - state->open_zones[i].begin_ticks;
+			}
+			state->open_zones.clear();
+			state->trace_depth = 0;
+			continue;
+		}
+		if (trace.active) {
+			add_trace_event(event, buffer->thread_index);
+		}
+
+		if (event->type == PROFILE_EVENT_BEGIN) {
+			u32 parent = !state->open_zones.is_empty() ? state->open_zones.last().node_index : PROFILE_NO_PARENT;
+
+			Open_Profile_Zone zone;
+			zone.name = event->name;
+			zone.begin_ticks = event->ticks;
+			zone.node_index = find_or_add_node(parent, event->name, buffer->thread_index);
+			state->open_zones.push(zone);
+
+			frame_nodes[zone.node_index].call_count++;
+		} else if (!state->open_zones.is_empty()) {
+			Open_Profile_Zone zone = state->open_zones.pop();
+			frame_nodes[zone.node_index].total_ticks += event->ticks - zone.begin_ticks;
+		}
+	}
+	// The writer can reuse the slots only after they have been read.
+	buffer->read_index.store(read_index, std::memory_order_release);
+
+	// Time of unfinished zones up to the end of the frame.
+	for (u32 i = 0; i < state->open_zones.count; i++) {
+		frame_nodes[state->open_zones[i].node_index].total_ticks += frame_end_ticks - state->open_zones[i].begin_ticks;
+	}
+}
+
+static void write_profile_trace()
+{
+	FILE *file = NULL;
+	if (fopen_s(&file, trace.path_to_file.c_str(), "w")) {
+		print("write_profile_trace: Failed to open {}.", trace.path_to_file);
+		return;
+	}
+
+	double microseconds_per_tick = 1000000.0 / (double)cpu_ticks_per_second();
+
+	fprintf(file, "{\"traceEvents\":[\n");
+	for (u32 i = 0; i < trace.events.count; i++) {
+		Profile_Trace_Event *trace_event = &trace.events[i];
+		double time_stamp = (double)(trace_event->event.ticks - trace.begin_ticks) * microseconds_per_tick;
+		const char *separator = (i + 1 < trace.events.count) ? "," : "";
+
+		if (trace_event->event.type == PROFILE_EVENT_BEGIN) {
+			fprintf(file, "{\"name\":\"%s\",\"ph\":\"B\",\"pid\":0,\"tid\":%u,\"ts\":%.3f}%s\n", trace_event->event.name, trace_event->thread_index, time_stamp, separator);
+		} else {
+			fprintf(file, "{\"ph\":\"E\",\"pid\":0,\"tid\":%u,\"ts\":%.3f}%s\n", trace_event->thread_index, time_stamp, separator);
+		}
+	}
+	fprintf(file, "],\"displayTimeUnit\":\"ms\"}\n");
+	fclose(file);
+
+	print("write_profile_trace: {} events were written to {}.", trace.events.count, trace.path_to_file);
+}
+
+void end_profile_frame()
+{
+	s64 frame_end_ticks = cpu_ticks_counter();
+
+	Array<Profile_Thread_Buffer *> buffers;
+	{
+		std::lock_guard<std::mutex> lock(thread_buffers_mutex);
+		buffers = thread_buffers;
+	}
+	while (thread_states.count < buffers.count) {
+		thread_states.push(Profile_Thread_State());
+	}
+
+	frame_nodes.clear();
+	for (u32 i = 0; i < buffers.count; i++) {
+		collect_thread_events(buffers[i], frame_end_ticks);
+	}
+	frame_begin_ticks = frame_end_ticks;
+
+	if (trace.active) {
+		trace.frames_left--;
+		if (trace.frames_left == 0) {
+			write_profile_trace();
+			trace.active = false;
+			trace.events.free();
+		}
+	}
+}
+
+Array<Profile_Node> *get_profile_frame_nodes()
+{
+	return &frame_nodes;
+}
+
+float profile_ticks_to_milliseconds(s64 ticks)
+{
+	static s64 ticks_per_second = cpu_ticks_per_second();
+	return (float)((double)ticks * 1000.0 / (double)ticks_per_second);
+}
+
+static void print_profile_nodes(u32 parent, u32 thread_index)
+{
+	for (u32 i = 0; i < frame_nodes.count; i++) {
+		Profile_Node *node = &frame_nodes[i];
+		if ((node->parent == parent) && (node->thread_index == thread_index)) {
+			String indent;
+			for (u32 j = 0; j < node->depth + 1; j++) {
+				indent.append("  ");
+			}
+			print("{}{}: {} ms, {} calls", indent, node->name, profile_ticks_to_milliseconds(node->total_ticks), node->call_count);
+			print_profile_nodes(i, thread_index);
+		}
+	}
 }
 
-s64 delta_time_in_fps()
+void print_profile_frame()
 {
-	return s64();
+	for (u32 i = 0; i < thread_states.count; i++) {
+		print("Thread {}:", i);
+		print_profile_nodes(PROFILE_NO_PARENT, i);
+	}
 }
 
+void begin_profile_trace(const char *path_to_file, u32 frame_count)
+{
+	assert(path_to_file);
+	assert(frame_count > 0);
+
+	if (trace.active) {
+		print("begin_profile_trace: A trace is already being recorded to {}.", trace.path_to_file);
+		return;
+	}
+	trace.active = true;
+	trace.frames_left = frame_count;
+	trace.begin_ticks = cpu_ticks_counter();
+	trace.path_to_file = path_to_file;
+	trace.events.clear();
+
+	for (u32 i = 0; i < thread_states.count; i++) {
+		thread_states[i].trace_depth = 0;
+	}
+}
+
+s64 begin_time_stamp()
+{
+	return milliseconds_counter();
+}
+
+s64 delta_time_in_milliseconds(s64 time_stamp)
+{
+	return milliseconds_counter() - time_stamp;
+}
@@ -1,24 +1,97 @@
 #ifndef PROFILING_H
 #define PROFILING_H
 
+#include <atomic>
+
+#include "utils.h"
 #include "../libs/number_types.h"
+#include "../libs/structures/array.h"
+
+#ifndef DISABLE_CPU_PROFILING
+#define CPU_PROFILING
+#endif
+
+#ifdef CPU_PROFILING
+#define PROFILE_ZONE(zone_name) Profile_Zone DEFER_3(_profile_zone_)(zone_name)
+#define BEGIN_PROFILE_ZONE(zone_name) begin_profile_zone(zone_name)
+#define END_PROFILE_ZONE() end_profile_zone()
+#define END_PROFILE_FRAME() end_profile_frame()
+#else
+#define PROFILE_ZONE(zone_name)
+#define BEGIN_PROFILE_ZONE(zone_name)
+#define END_PROFILE_ZONE()
+#define END_PROFILE_FRAME()
+#endif
 
 #ifdef VTUNE_PROFILING
 #include <ittnotify.h>
 __itt_domain *get_default_domain();
-#define BEGIN_TASK(task_name) __itt_task_begin(get_default_domain(), __itt_null, __itt_null, __itt_string_handle_create(task_name))
-#define END_TASK() __itt_task_end(get_default_domain());
+#define BEGIN_TASK(task_name) BEGIN_PROFILE_ZONE(task_name); __itt_task_begin(get_default_domain(), __itt_null, __itt_null, __itt_string_handle_create(task_name))
+#define END_TASK() END_PROFILE_ZONE(); __itt_task_end(get_default_domain());
 #define BEGIN_FRAME() __itt_frame_begin_v3(get_default_domain(), NULL)
-#define END_FRAME() 	__itt_frame_end_v3(get_default_domain(), NULL);
+#define END_FRAME() END_PROFILE_FRAME(); __itt_frame_end_v3(get_default_domain(), NULL);
 #else
-#define BEGIN_TASK(task_name)
-#define END_TASK()
+#define BEGIN_TASK(task_name) BEGIN_PROFILE_ZONE(task_name)
+#define END_TASK() END_PROFILE_ZONE();
 #define BEGIN_FRAME()
-#define END_FRAME()
+#define END_FRAME() END_PROFILE_FRAME();
 #endif
 
-void begin_time_stamp();
-s64 delta_time_in_milliseconds();
-s64 delta_time_in_fps();
+const u32 PROFILE_EVENT_BUFFER_SIZE = 16384; // Must be a power of two.
+
+enum Profile_Event_Type : u32 {
+	PROFILE_EVENT_BEGIN,
+	PROFILE_EVENT_END,
+	PROFILE_EVENT_LOST // Events before it were dropped because the buffer was full.
+};
+
+struct Profile_Event {
+	const char *name = NULL; // Zone names are not copied, they must live as long as the program.
+	s64 ticks = 0;
+	Profile_Event_Type type;
+	u32 lost_event_count = 0;
+};
 
-#endif
\ No newline at end of file
+// Only the owner thread writes events and only the thread ending a frame reads them.
+// The reader moves the read index after it has read the events, so the writer never overwrites
+// events which are being read. If the buffer is full new events are dropped, the next written
+// event is preceded by a PROFILE_EVENT_LOST event.
+struct Profile_Thread_Buffer {
+	u32 thread_index = 0;
+	u32 lost_event_count = 0; // Used only by the writer.
+	std::atomic<u32> read_index = 0;
+	std::atomic<u32> write_index = 0;
+	Profile_Event events[PROFILE_EVENT_BUFFER_SIZE];
+};
+
+// A node of a frame call tree, the same zone called from the same parent is merged into one node.
+struct Profile_Node {
+	const char *name = NULL;
+	u32 parent = 0;
+	u32 depth = 0;
+	u32 thread_index = 0;
+	u32 call_count = 0;
+	s64 total_ticks = 0;
+};
+
+struct Profile_Zone {
+	Profile_Zone(const char *zone_name);
+	~Profile_Zone();
+};
+
+void begin_profile_zone(const char *zone_name);
+void end_profile_zone();
+
+// Collects events of all threads and builds the call tree of the ended frame.
+void end_profile_frame();
+Array<Profile_Node> *get_profile_frame_nodes();
+float profile_ticks_to_milliseconds(s64 ticks);
+void print_profile_frame();
+
+// Events of the next frame_count frames are kept and written to path_to_file in the chrome trace event format.
+void begin_profile_trace(const char *path_to_file, u32 frame_count);
+
+s64 begin_time_stamp();
+s64 delta_time_in_milliseconds(s64 time_stamp);
+
+#endif
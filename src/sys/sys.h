@@ -12,47 +12,42 @@ void report_error(const char *error_message);
 char *get_error_message_from_error_code(DWORD hr);
 
 template <typename... Args>
-void print(Args... args)
+void print(const Args &...args)
 {
-	char *formatted_string = format(args...);
-	append_text_to_console_buffer(formatted_string, true);
-	if (formatted_string) { delete formatted_string; }
+	Formatted_String formatted_string(args...);
+	append_text_to_console_buffer(formatted_string.data, true);
 }
 
 template <typename... Args>
-void print_same_line(Args... args)
+void print_same_line(const Args &...args)
 {
-	char *formatted_string = format(args...);
-	append_text_to_console_buffer(formatted_string, false);
-	if (formatted_string) { delete formatted_string; }
+	Formatted_String formatted_string(args...);
+	append_text_to_console_buffer(formatted_string.data, false);
 }
 
 bool is_string_unique(const char *string);
 
 template <typename... Args>
-void loop_print(Args... args)
+void loop_print(const Args &...args)
 {
-	char *formatted_string = format(args...);
-	if (is_string_unique(formatted_string)) {
-		append_text_to_console_buffer(formatted_string, true);
+	Formatted_String formatted_string(args...);
+	if (is_string_unique(formatted_string.data)) {
+		append_text_to_console_buffer(formatted_string.data, true);
 	}
-	if (formatted_string) { delete formatted_string; }
 }
 
 template <typename... Args>
-void info(Args... args)
+void info(const Args &...args)
 {
-	char *formatted_string = format(args...);
-	report_info(formatted_string);
-	if (formatted_string) { delete formatted_string; }
+	Formatted_String formatted_string(args...);
+	report_info(formatted_string.data);
 }
 
 template <typename... Args>
-void error(Args... args)
+void error(const Args &...args)
 {
-	char *formatted_string = format(args...);
-	report_error(formatted_string);
-	if (formatted_string) { delete formatted_string; }
+	Formatted_String formatted_string(args...);
+	report_error(formatted_string.data);
 }
 
 #endif